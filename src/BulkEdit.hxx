@@ -38,4 +38,32 @@ public:
 	}
 };
 
+/**
+ * Like #ScopeBulkEdit, but the "bulk edit" is begun only when
+ * Begin() gets called.
+ */
+class LazyBulkEdit {
+	Partition &partition;
+
+	bool active = false;
+
+public:
+	LazyBulkEdit(Partition &_partition):partition(_partition) {}
+
+	~LazyBulkEdit() {
+		if (active)
+			partition.playlist.CommitBulk(partition.pc);
+	}
+
+	LazyBulkEdit(const LazyBulkEdit &) = delete;
+	LazyBulkEdit &operator=(const LazyBulkEdit &) = delete;
+
+	void Begin() {
+		if (!active) {
+			partition.playlist.BeginBulk();
+			active = true;
+		}
+	}
+};
+
 #endif
@@ -19,6 +19,7 @@
 
 #include "config.h"
 #include "DetachedSong.hxx"
+#include "SongAnalysis.hxx"
 #include "db/LightSong.hxx"
 #include "util/UriUtil.hxx"
 #include "fs/Traits.hxx"
@@ -29,7 +30,10 @@ DetachedSong::DetachedSong(const LightSong &other)
 	 tag(*other.tag),
 	 mtime(other.mtime),
 	 start_time(other.start_time),
-	 end_time(other.end_time) {}
+	 end_time(other.end_time),
+	 analysis(other.analysis != nullptr
+		  ? std::make_shared<SongAnalysis>(*other.analysis)
+		  : nullptr) {}
 
 DetachedSong::~DetachedSong()
 {
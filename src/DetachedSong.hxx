@@ -25,12 +25,14 @@
 #include "Chrono.hxx"
 #include "Compiler.h"
 
+#include <memory>
 #include <string>
 #include <utility>
 
 #include <time.h>
 
 struct LightSong;
+struct SongAnalysis;
 class Storage;
 class Path;
 
@@ -76,6 +78,12 @@ class DetachedSong {
 	 */
 	SongTime end_time;
 
+	/**
+	 * The results of the loudness analysis, copied from the
+	 * database; nullptr if not available.
+	 */
+	std::shared_ptr<const SongAnalysis> analysis;
+
 	explicit DetachedSong(const LightSong &other);
 
 public:
@@ -223,6 +231,18 @@ public:
 	gcc_pure
 	SignedSongTime GetDuration() const;
 
+	const SongAnalysis *GetAnalysis() const {
+		return analysis.get();
+	}
+
+	const std::shared_ptr<const SongAnalysis> &GetSharedAnalysis() const {
+		return analysis;
+	}
+
+	void SetAnalysis(std::shared_ptr<const SongAnalysis> _analysis) {
+		analysis = std::move(_analysis);
+	}
+
 	/**
 	 * Update the #tag and #mtime.
 	 *
@@ -27,6 +27,8 @@
 #ifdef ENABLE_DATABASE
 #include "db/DatabaseError.hxx"
 #include "db/LightSong.hxx"
+#include "db/update/Service.hxx"
+#include "Log.hxx"
 
 #ifdef ENABLE_SQLITE
 #include "sticker/StickerDatabase.hxx"
@@ -70,6 +72,30 @@ Instance::OnDatabaseModified()
 	idle_add(IDLE_DATABASE);
 }
 
+void
+Instance::OnDatabaseLoaded(bool success)
+{
+	/* fill in the tags of the songs restored from the state
+	   file */
+	OnDatabaseModified();
+
+	if (!success && update != nullptr) {
+		/* the database failed to load: recreate the
+		   database */
+		if (update->Enqueue("", true) == 0)
+			LogError(db_domain, "directory update failed");
+	}
+}
+
+void
+Instance::OnDatabaseAnalyzed()
+{
+	assert(database != nullptr);
+
+	/* attach the results to the songs in the queue */
+	partition->DatabaseModified(*database);
+}
+
 void
 Instance::OnDatabaseSongRemoved(const LightSong &song)
 {
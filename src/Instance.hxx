@@ -33,6 +33,7 @@ class NeighborGlue;
 class Database;
 class Storage;
 class UpdateService;
+class ClientWorkerPool;
 #endif
 
 class EventLoop;
@@ -70,6 +71,13 @@ struct Instance final
 	Storage *storage;
 
 	UpdateService *update;
+
+	/**
+	 * Executes database queries for clients.  This is nullptr if
+	 * the database plugin is not thread-safe; then all queries
+	 * run in the main thread.
+	 */
+	ClientWorkerPool *client_workers;
 #endif
 
 	ClientList *client_list;
@@ -80,6 +88,7 @@ struct Instance final
 #ifdef ENABLE_DATABASE
 		storage = nullptr;
 		update = nullptr;
+		client_workers = nullptr;
 #endif
 	}
 
@@ -106,6 +115,8 @@ struct Instance final
 private:
 #ifdef ENABLE_DATABASE
 	virtual void OnDatabaseModified() override;
+	virtual void OnDatabaseLoaded(bool success) override;
+	virtual void OnDatabaseAnalyzed() override;
 	virtual void OnDatabaseSongRemoved(const LightSong &song) override;
 #endif
 
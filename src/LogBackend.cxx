@@ -23,6 +23,14 @@
 #include "util/Domain.hxx"
 #include "util/StringUtil.hxx"
 
+#ifndef ANDROID
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+
+#include <atomic>
+#include <algorithm>
+#endif
+
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
@@ -84,12 +92,18 @@ EnableLogTimestamp()
 	enable_timestamp = true;
 }
 
-static const char *log_date(void)
+static constexpr size_t LOG_DATE_BUF_SIZE = 16;
+
+static const char *
+log_date(char *buf, time_t t)
 {
-	static constexpr size_t LOG_DATE_BUF_SIZE = 16;
-	static char buf[LOG_DATE_BUF_SIZE];
-	time_t t = time(nullptr);
-	strftime(buf, LOG_DATE_BUF_SIZE, "%b %d %H:%M : ", localtime(&t));
+	struct tm tm;
+#ifdef WIN32
+	tm = *localtime(&t);
+#else
+	localtime_r(&t, &tm);
+#endif
+	strftime(buf, LOG_DATE_BUF_SIZE, "%b %d %H:%M : ", &tm);
 	return buf;
 }
 
@@ -98,9 +112,8 @@ static const char *log_date(void)
  * characters.
  */
 static int
-chomp_length(const char *p)
+chomp_length(const char *p, size_t length)
 {
-	size_t length = strlen(p);
 	return StripRight(p, length);
 }
 
@@ -131,11 +144,12 @@ ToSysLogLevel(LogLevel log_level)
 }
 
 static void
-SysLog(const Domain &domain, LogLevel log_level, const char *message)
+SysLog(const Domain &domain, LogLevel log_level,
+       const char *message, size_t length)
 {
 	syslog(ToSysLogLevel(log_level), "%s: %.*s",
 	       domain.GetName(),
-	       chomp_length(message), message);
+	       chomp_length(message, length), message);
 }
 
 void
@@ -155,12 +169,14 @@ LogFinishSysLog()
 #endif
 
 static void
-FileLog(const Domain &domain, const char *message)
+FileLog(const Domain &domain, time_t t, const char *message, size_t length)
 {
+	char date[LOG_DATE_BUF_SIZE];
+
 	fprintf(stderr, "%s%s: %.*s\n",
-		enable_timestamp ? log_date() : "",
+		enable_timestamp ? log_date(date, t) : "",
 		domain.GetName(),
-		chomp_length(message), message);
+		chomp_length(message, length), message);
 
 #ifdef WIN32
 	/* force-flush the log file, because setvbuf() does not seem
@@ -169,6 +185,330 @@ FileLog(const Domain &domain, const char *message)
 #endif
 }
 
+/**
+ * Write one message to the configured destination.
+ */
+static void
+LogNow(const Domain &domain, LogLevel level, time_t t,
+       const char *msg, size_t length)
+{
+#ifdef HAVE_SYSLOG
+	if (enable_syslog) {
+		SysLog(domain, level, msg, length);
+		return;
+	}
+#else
+	(void)level;
+#endif
+
+	FileLog(domain, t, msg, length);
+}
+
+/**
+ * A bounded lock-free queue of log messages.  Any thread may push
+ * messages without blocking (using the algorithm by Dmitry Vyukov);
+ * they are written by the log thread, which holds #consumer_mutex
+ * while it pops messages.
+ */
+class LogQueue {
+	static constexpr size_t N_RECORDS = 512;
+	static constexpr size_t MAX_MESSAGE = 500;
+
+	struct Record {
+		/**
+		 * Equals the queue position when the record is
+		 * free; position+1 when it has been filled.
+		 */
+		std::atomic<size_t> sequence;
+
+		const Domain *domain;
+		time_t time;
+		LogLevel level;
+		unsigned short length;
+		char message[MAX_MESSAGE];
+	};
+
+	Record records[N_RECORDS];
+
+	std::atomic<size_t> tail;
+
+	/**
+	 * The position of the next record to be popped.  Protected
+	 * by #consumer_mutex.
+	 */
+	size_t head;
+
+	Mutex consumer_mutex;
+	Cond cond;
+
+	/**
+	 * Is the consumer waiting for #cond?  Producers signal it
+	 * only then, without locking the mutex; a wakeup which gets
+	 * lost this way is made up for by the wait timeout.
+	 */
+	std::atomic_bool sleeping;
+
+	/**
+	 * Set by Stop().  Protected by #consumer_mutex.
+	 */
+	bool quit;
+
+public:
+	std::atomic<unsigned> dropped;
+
+	LogQueue():tail(0), head(0), sleeping(false), quit(false),
+		   dropped(0) {
+		for (size_t i = 0; i < N_RECORDS; ++i)
+			records[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @return false if the queue is full
+	 */
+	bool Push(const Domain &domain, LogLevel level, time_t t,
+		  const char *msg) {
+		size_t position = tail.load(std::memory_order_relaxed);
+		Record *r;
+		while (true) {
+			r = &records[position % N_RECORDS];
+			const size_t sequence =
+				r->sequence.load(std::memory_order_acquire);
+			const ptrdiff_t delta = ptrdiff_t(sequence - position);
+			if (delta == 0) {
+				if (tail.compare_exchange_weak(position,
+							       position + 1,
+							       std::memory_order_relaxed))
+					break;
+			} else if (delta < 0)
+				return false;
+			else
+				position = tail.load(std::memory_order_relaxed);
+		}
+
+		r->domain = &domain;
+		r->time = t;
+		r->level = level;
+		r->length = CopyMessage(r->message, msg);
+		r->sequence.store(position + 1, std::memory_order_release);
+
+		if (sleeping.load())
+			cond.signal();
+
+		return true;
+	}
+
+	/**
+	 * Write all pending messages.
+	 */
+	void Flush() {
+		const ScopeLock protect(consumer_mutex);
+		WritePending();
+	}
+
+	/**
+	 * Wait for messages and write them.
+	 *
+	 * @return false after Stop() has been called
+	 */
+	bool Process() {
+		const ScopeLock protect(consumer_mutex);
+
+		if (!WritePending() && !quit) {
+			sleeping.store(true);
+			if (IsEmpty())
+				cond.timed_wait(consumer_mutex, 1000);
+			sleeping.store(false);
+		}
+
+		return !quit;
+	}
+
+	void Stop() {
+		const ScopeLock protect(consumer_mutex);
+		quit = true;
+		cond.signal();
+	}
+
+	/**
+	 * Start accepting messages again after Stop().
+	 */
+	void Resume() {
+		const ScopeLock protect(consumer_mutex);
+		quit = false;
+	}
+
+private:
+	/**
+	 * Copy a message into a #Record.  A message which does not
+	 * fit is cut at a character boundary and ends with an
+	 * ellipsis, so the truncation is visible in the log.
+	 *
+	 * @return the number of bytes written to #dest
+	 */
+	static size_t CopyMessage(char *dest, const char *msg) {
+		static constexpr char ellipsis[] = "\xe2\x80\xa6";
+		static constexpr size_t ellipsis_length = sizeof(ellipsis) - 1;
+
+		size_t length = strnlen(msg, MAX_MESSAGE + 1);
+		if (length <= MAX_MESSAGE) {
+			memcpy(dest, msg, length);
+			return length;
+		}
+
+		/* don't split a UTF-8 sequence */
+		length = MAX_MESSAGE - ellipsis_length;
+		while (length > 0 && (msg[length] & 0xc0) == 0x80)
+			--length;
+
+		memcpy(dest, msg, length);
+		memcpy(dest + length, ellipsis, ellipsis_length);
+		return length + ellipsis_length;
+	}
+
+	gcc_pure
+	bool IsEmpty() const {
+		const Record &r = records[head % N_RECORDS];
+		return r.sequence.load(std::memory_order_acquire) != head + 1;
+	}
+
+	/**
+	 * Caller must lock #consumer_mutex.
+	 *
+	 * @return true if at least one message was written
+	 */
+	bool WritePending() {
+		bool result = false;
+
+		while (!IsEmpty()) {
+			Record &r = records[head % N_RECORDS];
+			LogNow(*r.domain, r.level, r.time,
+			       r.message, r.length);
+			r.sequence.store(head + N_RECORDS,
+					 std::memory_order_release);
+			++head;
+			result = true;
+		}
+
+		return result;
+	}
+};
+
+/**
+ * Counts the messages of one #Domain in the current second.
+ */
+struct LogRateSlot {
+	std::atomic<const Domain *> domain;
+	std::atomic<time_t> second;
+	std::atomic<unsigned> count;
+};
+
+static constexpr size_t N_RATE_SLOTS = 64;
+static LogRateSlot log_rate_slots[N_RATE_SLOTS];
+
+static LogQueue *log_queue;
+static std::atomic_bool log_queue_enabled;
+static LogOverflow log_overflow;
+static unsigned log_rate_limit;
+
+/**
+ * Has the domain exceeded #log_rate_limit in this second?
+ */
+static bool
+IsRateLimited(const Domain &domain, time_t t)
+{
+	const size_t start = (size_t(&domain) / sizeof(void *)) % N_RATE_SLOTS;
+
+	for (size_t i = 0; i < N_RATE_SLOTS; ++i) {
+		LogRateSlot &slot = log_rate_slots[(start + i) % N_RATE_SLOTS];
+
+		const Domain *d = slot.domain.load(std::memory_order_relaxed);
+		if (d == nullptr &&
+		    slot.domain.compare_exchange_strong(d, &domain))
+			d = &domain;
+
+		if (d != &domain)
+			continue;
+
+		/* races between threads may let a few more messages
+		   pass, which is good enough */
+		if (slot.second.exchange(t) != t)
+			slot.count = 0;
+
+		return ++slot.count > log_rate_limit;
+	}
+
+	/* no slot left; don't limit this domain */
+	return false;
+}
+
+void
+StartLogQueue(LogOverflow overflow, unsigned rate_limit)
+{
+	assert(!log_queue_enabled);
+
+	log_overflow = overflow;
+	log_rate_limit = rate_limit;
+
+	/* the queue is never freed (see FinishLogQueue()), so it is
+	   reused after a restart */
+	if (log_queue == nullptr)
+		log_queue = new LogQueue();
+	else
+		log_queue->Resume();
+
+	log_queue_enabled = true;
+}
+
+bool
+ProcessLogQueue()
+{
+	assert(log_queue != nullptr);
+
+	const bool result = log_queue->Process();
+
+	/* report dropped messages after the ones which did fit into
+	   the queue */
+	const unsigned dropped = log_queue->dropped.exchange(0);
+	if (dropped > 0) {
+		static constexpr Domain log_domain("log");
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer),
+			 "%u messages dropped", dropped);
+		LogNow(log_domain, LogLevel::WARNING, time(nullptr),
+		       buffer, strlen(buffer));
+	}
+
+	return result;
+}
+
+void
+StopLogQueue()
+{
+	if (log_queue != nullptr)
+		log_queue->Stop();
+}
+
+void
+FinishLogQueue()
+{
+	if (log_queue == nullptr)
+		return;
+
+	log_queue_enabled = false;
+	log_queue->Flush();
+
+	/* don't delete the queue: a thread which has seen
+	   #log_queue_enabled before it was cleared may still be
+	   inside LogQueue::Push() */
+}
+
+void
+FlushLogQueue()
+{
+	if (log_queue_enabled)
+		log_queue->Flush();
+}
+
 #endif /* !ANDROID */
 
 void
@@ -182,13 +522,23 @@ Log(const Domain &domain, LogLevel level, const char *msg)
 	if (level < log_threshold)
 		return;
 
-#ifdef HAVE_SYSLOG
-	if (enable_syslog) {
-		SysLog(domain, level, msg);
-		return;
+	const time_t t = time(nullptr);
+
+	if (log_queue_enabled) {
+		if (log_rate_limit > 0 && IsRateLimited(domain, t)) {
+			++log_queue->dropped;
+			return;
+		}
+
+		if (log_queue->Push(domain, level, t, msg))
+			return;
+
+		if (log_overflow == LogOverflow::DROP) {
+			++log_queue->dropped;
+			return;
+		}
 	}
-#endif
 
-	FileLog(domain, msg);
+	LogNow(domain, level, t, msg, strlen(msg));
 #endif /* !ANDROID */
 }
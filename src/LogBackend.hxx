@@ -35,4 +35,60 @@ LogInitSysLog();
 void
 LogFinishSysLog();
 
+/**
+ * What Log() does with a message when the queue is full.
+ */
+enum class LogOverflow {
+	/**
+	 * Discard the message.  The calling thread never blocks.
+	 */
+	DROP,
+
+	/**
+	 * Write the message synchronously, bypassing the queue.
+	 */
+	SYNC,
+};
+
+/**
+ * Let Log() pass messages to a lock-free queue instead of writing
+ * them, so threads with real-time requirements are not blocked by
+ * slow I/O.  A thread must call ProcessLogQueue() in a loop.
+ *
+ * @param rate_limit the maximum number of messages per second and
+ * domain; 0 means no limit
+ */
+void
+StartLogQueue(LogOverflow overflow, unsigned rate_limit);
+
+/**
+ * Wait for queued messages and write them.  This is the main loop of
+ * the log thread.
+ *
+ * @return false after StopLogQueue() has been called
+ */
+bool
+ProcessLogQueue();
+
+/**
+ * Make ProcessLogQueue() return false.
+ */
+void
+StopLogQueue();
+
+/**
+ * Write the remaining messages and disable the queue.  Must be called
+ * after the log thread has exited.  The queue itself stays allocated,
+ * because other threads may still be passing a message to it.
+ */
+void
+FinishLogQueue();
+
+/**
+ * Write all queued messages now, e.g. before the process exits
+ * because of a fatal error.
+ */
+void
+FlushLogQueue();
+
 #endif /* LOG_H */
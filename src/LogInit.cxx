@@ -30,6 +30,8 @@
 #include "util/Error.hxx"
 #include "util/Domain.hxx"
 #include "system/FatalError.hxx"
+#include "thread/Thread.hxx"
+#include "thread/Name.hxx"
 
 #include <assert.h>
 #include <string.h>
@@ -50,6 +52,50 @@ static constexpr Domain log_domain("log");
 static int out_fd;
 static AllocatedPath out_path = AllocatedPath::Null();
 
+static bool log_async;
+static LogOverflow log_overflow;
+static unsigned log_rate_limit;
+
+/**
+ * Writes the messages queued by Log(), see StartLogQueue().
+ */
+static class LogThread {
+	Thread thread;
+
+public:
+	~LogThread() {
+		/* in case main() has returned early, without calling
+		   log_deinit() */
+		Stop();
+	}
+
+	void Start() {
+		StartLogQueue(log_overflow, log_rate_limit);
+
+		Error error;
+		if (!thread.Start(Run, this, error)) {
+			FinishLogQueue();
+			LogError(error);
+		}
+	}
+
+	void Stop() {
+		if (!thread.IsDefined())
+			return;
+
+		StopLogQueue();
+		thread.Join();
+		FinishLogQueue();
+	}
+
+private:
+	static void Run(gcc_unused void *ctx) {
+		SetThreadName("log");
+
+		while (ProcessLogQueue()) {}
+	}
+} log_thread;
+
 static void redirect_logs(int fd)
 {
 	assert(fd >= 0);
@@ -99,6 +145,18 @@ parse_log_level(const char *value, int line)
 	}
 }
 
+static LogOverflow
+parse_log_overflow(const char *value, int line)
+{
+	if (strcmp(value, "drop") == 0)
+		return LogOverflow::DROP;
+	else if (strcmp(value, "sync") == 0)
+		return LogOverflow::SYNC;
+	else
+		FormatFatalError("unknown log_overflow value \"%s\" at line %d",
+				 value, line);
+}
+
 #endif
 
 void
@@ -133,6 +191,13 @@ log_init(bool verbose, bool use_stdout, Error &error)
 		SetLogThreshold(parse_log_level(param->value.c_str(),
 						param->line));
 
+	log_async = config_get_bool(ConfigOption::LOG_ASYNC, true);
+	log_rate_limit = config_get_unsigned(ConfigOption::LOG_RATE_LIMIT, 0);
+	log_overflow = LogOverflow::DROP;
+	if ((param = config_get_param(ConfigOption::LOG_OVERFLOW)) != nullptr)
+		log_overflow = parse_log_overflow(param->value.c_str(),
+						  param->line);
+
 	if (use_stdout) {
 		return true;
 	} else {
@@ -178,6 +243,7 @@ void
 log_deinit(void)
 {
 #ifndef ANDROID
+	log_thread.Stop();
 	close_log_files();
 	out_path = AllocatedPath::Null();
 #endif
@@ -188,6 +254,11 @@ void setup_log_output(bool use_stdout)
 #ifdef ANDROID
 	(void)use_stdout;
 #else
+	/* the log thread is started here, because this is after
+	   daemonize_begin() has forked */
+	if (log_async)
+		log_thread.Start();
+
 	if (use_stdout)
 		return;
 
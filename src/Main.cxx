@@ -31,6 +31,7 @@
 #include "Listen.hxx"
 #include "client/Client.hxx"
 #include "client/ClientList.hxx"
+#include "client/ClientWorker.hxx"
 #include "command/AllCommands.hxx"
 #include "Partition.hxx"
 #include "tag/TagConfig.hxx"
@@ -47,6 +48,7 @@
 #include "playlist/PlaylistRegistry.hxx"
 #include "zeroconf/ZeroconfGlue.hxx"
 #include "decoder/DecoderList.hxx"
+#include "decoder/SeekTable.hxx"
 #include "AudioConfig.hxx"
 #include "pcm/PcmConvert.hxx"
 #include "unix/SignalHandlers.hxx"
@@ -231,8 +233,10 @@ glue_db_init_and_load(void)
 					     static_cast<CompositeStorage &>(*instance->storage),
 					     *instance);
 
-	/* run database update after daemonization? */
-	return db.FileExists();
+	/* run database update after daemonization?  If the database
+	   file is still being loaded, Instance::OnDatabaseLoaded()
+	   will decide that */
+	return db.IsLoading() || db.FileExists();
 }
 
 static bool
@@ -287,7 +291,12 @@ glue_state_file_init(Error &error)
 		config_get_unsigned(ConfigOption::STATE_FILE_INTERVAL,
 				    StateFile::DEFAULT_INTERVAL);
 
+	const bool queue_snapshot =
+		config_get_bool(ConfigOption::STATE_FILE_QUEUE_SNAPSHOT,
+				false);
+
 	state_file = new StateFile(std::move(path_fs), interval,
+				   queue_snapshot,
 				   *instance->partition,
 				   *instance->event_loop);
 	state_file->Read();
@@ -554,7 +563,7 @@ try {
 
 	initPermissions();
 	playlist_global_init();
-	spl_global_init();
+	spl_global_init(*instance->event_loop);
 #ifdef ENABLE_ARCHIVE
 	archive_plugin_init_all();
 #endif
@@ -566,6 +575,11 @@ try {
 
 	decoder_plugin_init_all();
 
+	if (!seek_table_global_init(error)) {
+		LogError(error);
+		return EXIT_FAILURE;
+	}
+
 #ifdef ENABLE_DATABASE
 	const bool create_db = InitDatabaseAndStorage();
 #endif
@@ -616,6 +630,17 @@ try {
 		if (job == 0)
 			FatalError("directory update failed");
 	}
+
+	if (instance->update != nullptr)
+		instance->update->StartAnalysis();
+
+	if (instance->database != nullptr &&
+	    instance->database->GetPlugin().IsThreadSafe()) {
+		instance->client_workers =
+			new ClientWorkerPool(*instance->event_loop);
+		if (!instance->client_workers->Start(error))
+			FatalError(error);
+	}
 #endif
 
 	if (!glue_state_file_init(error)) {
@@ -681,9 +706,18 @@ try {
 		delete state_file;
 	}
 
+	spl_global_finish();
+
 	instance->partition->pc.Kill();
 	ZeroconfDeinit();
 	listen_global_finish();
+
+#ifdef ENABLE_DATABASE
+	/* this must be deleted before the clients, because it may
+	   still be executing commands for them */
+	delete instance->client_workers;
+#endif
+
 	delete instance->client_list;
 
 #ifdef ENABLE_NEIGHBOR_PLUGINS
@@ -721,6 +755,7 @@ try {
 
 	delete instance->partition;
 	command_finish();
+	seek_table_global_finish();
 	decoder_plugin_deinit_all();
 #ifdef ENABLE_ARCHIVE
 	archive_plugin_deinit_all();
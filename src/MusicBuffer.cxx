@@ -41,6 +41,7 @@ void
 MusicBuffer::Return(MusicChunk *chunk)
 {
 	assert(chunk != nullptr);
+	assert(chunk->prepared == nullptr);
 
 	const ScopeLock protect(mutex);
 
@@ -56,6 +56,14 @@ struct MusicChunk {
 	 */
 	float mix_ratio;
 
+	/**
+	 * An optional chunk which contains this chunk's data after
+	 * replay gain and cross-fading have been applied.  It is
+	 * owned by #SharedFilter, and is only valid while this chunk
+	 * is in the pipe of the audio outputs.
+	 */
+	MusicChunk *prepared;
+
 	/** number of bytes stored in this chunk */
 	uint16_t length;
 
@@ -95,6 +103,7 @@ struct MusicChunk {
 
 	MusicChunk()
 		:other(nullptr),
+		 prepared(nullptr),
 		 length(0),
 		 tag(nullptr),
 		 replay_gain_serial(0) {}
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "MusicHistory.hxx"
+#include "MusicBuffer.hxx"
+#include "MusicChunk.hxx"
+#include "AudioFormat.hxx"
+
+#include <assert.h>
+
+/**
+ * Was this chunk inserted by the player, i.e. is it silence which is
+ * not part of the song?
+ */
+gcc_pure
+static bool
+IsPlayerSilence(const MusicChunk &chunk)
+{
+	return chunk.length > 0 && chunk.time.IsNegative();
+}
+
+void
+MusicHistory::Push(MusicBuffer &buffer, MusicChunk *chunk)
+{
+	if (chunk->other != nullptr || IsPlayerSilence(*chunk) ||
+	    max_size == 0) {
+		/* cross-faded chunks cannot be played again */
+		buffer.Return(chunk);
+		return;
+	}
+
+	pipe.Push(chunk);
+
+	while (pipe.GetSize() > max_size)
+		buffer.Return(pipe.Shift());
+}
+
+bool
+MusicHistory::Contains(const MusicPipe &queued,
+		       const AudioFormat audio_format,
+		       SongTime where) const
+{
+	/* the decoder may append more chunks meanwhile, but that
+	   only extends the range */
+	const auto end = queued.GetEndTime(audio_format);
+	if (end.IsNegative() || SignedSongTime(where) >= end)
+		return false;
+
+	auto start = pipe.GetStartTime();
+	if (start.IsNegative())
+		start = queued.GetStartTime();
+	return !start.IsNegative() && SignedSongTime(where) >= start;
+}
+
+void
+MusicHistory::Rewind(MusicBuffer &buffer, MusicPipe &queued, MusicPipe &dest)
+{
+	/* history and pipe form a contiguous range of the song,
+	   except for silence which was inserted by the player */
+	MusicChunk *chunk;
+	while ((chunk = queued.Shift()) != nullptr)
+		pipe.Push(chunk);
+
+	MusicPipe tmp;
+	while ((chunk = pipe.Shift()) != nullptr) {
+		if (IsPlayerSilence(*chunk))
+			buffer.Return(chunk);
+		else
+			tmp.Push(chunk);
+	}
+
+	dest.Prepend(tmp);
+}
+
+void
+MusicHistory::Skip(MusicBuffer &buffer, MusicPipe &src,
+		   const AudioFormat audio_format, SongTime where)
+{
+	const double time_to_size = audio_format.GetTimeToSize();
+	while (true) {
+		const MusicChunk *chunk = src.Peek();
+		assert(chunk != nullptr);
+
+		if (chunk->length > 0 &&
+		    chunk->time.ToDoubleS() + chunk->length / time_to_size >
+		    where.ToDoubleS())
+			break;
+
+		Push(buffer, src.Shift());
+	}
+}
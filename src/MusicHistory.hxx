@@ -0,0 +1,109 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_MUSIC_HISTORY_HXX
+#define MPD_MUSIC_HISTORY_HXX
+
+#include "MusicPipe.hxx"
+#include "Chrono.hxx"
+#include "Compiler.h"
+
+struct AudioFormat;
+struct MusicChunk;
+class MusicBuffer;
+
+/**
+ * Chunks which have been played already.  They are kept for a
+ * while, to allow short backward seeks without asking the decoder.
+ */
+class MusicHistory {
+	MusicPipe pipe;
+
+	/**
+	 * The maximum number of chunks in #pipe.  0 disables the
+	 * history.
+	 */
+	unsigned max_size;
+
+public:
+	MusicHistory():max_size(0) {}
+
+	/**
+	 * Change the maximum number of chunks.  The caller is
+	 * responsible for calling Clear() or Push() afterwards to
+	 * drop chunks which exceed the new limit.
+	 */
+	void SetMaxSize(unsigned _max_size) {
+		max_size = _max_size;
+	}
+
+	gcc_pure
+	unsigned GetSize() const {
+		return pipe.GetSize();
+	}
+
+	/**
+	 * Returns the time stamp of the oldest chunk, or a negative
+	 * value if the history is empty.
+	 */
+	gcc_pure
+	SignedSongTime GetStartTime() const {
+		return pipe.GetStartTime();
+	}
+
+	/**
+	 * Return all chunks to the buffer.
+	 */
+	void Clear(MusicBuffer &buffer) {
+		pipe.Clear(buffer);
+	}
+
+	/**
+	 * Add a chunk which has been played (or skipped).  Chunks
+	 * which cannot be played again, and the oldest chunks
+	 * exceeding the limit, are returned to the buffer.
+	 */
+	void Push(MusicBuffer &buffer, MusicChunk *chunk);
+
+	/**
+	 * Can the given position be reached with the chunks in the
+	 * history and in the given pipe (which continues where the
+	 * history ends)?
+	 */
+	gcc_pure
+	bool Contains(const MusicPipe &queued, AudioFormat audio_format,
+		      SongTime where) const;
+
+	/**
+	 * Move all chunks from the history and from the other pipe
+	 * (in this order) to the head of the destination pipe.
+	 * Silence which was inserted by the player is dropped.
+	 */
+	void Rewind(MusicBuffer &buffer, MusicPipe &queued, MusicPipe &dest);
+
+	/**
+	 * Move chunks which end before the given position from the
+	 * head of the pipe to the history.  Contains() must have
+	 * returned true.
+	 */
+	void Skip(MusicBuffer &buffer, MusicPipe &src,
+		  AudioFormat audio_format, SongTime where);
+};
+
+#endif
@@ -21,6 +21,7 @@
 #include "MusicPipe.hxx"
 #include "MusicBuffer.hxx"
 #include "MusicChunk.hxx"
+#include "AudioFormat.hxx"
 
 #ifndef NDEBUG
 
@@ -104,3 +105,64 @@ MusicPipe::Push(MusicChunk *chunk)
 
 	++size;
 }
+
+void
+MusicPipe::Prepend(MusicPipe &other)
+{
+	assert(&other != this);
+
+	const ScopeLock protect(mutex);
+	const ScopeLock protect_other(other.mutex);
+
+	if (other.head == nullptr)
+		return;
+
+	assert(!audio_format.IsDefined() ||
+	       other.CheckFormat(audio_format));
+
+	*other.tail_r = head;
+	if (head == nullptr)
+		tail_r = other.tail_r;
+
+	head = other.head;
+	size += other.size;
+
+#ifndef NDEBUG
+	if (!audio_format.IsDefined())
+		audio_format = other.audio_format;
+	other.audio_format.Clear();
+#endif
+
+	other.head = nullptr;
+	other.tail_r = &other.head;
+	other.size = 0;
+}
+
+SignedSongTime
+MusicPipe::GetStartTime() const
+{
+	const ScopeLock protect(mutex);
+
+	for (const MusicChunk *i = head; i != nullptr; i = i->next)
+		if (i->length > 0 && !i->time.IsNegative())
+			return i->time;
+
+	return SignedSongTime::Negative();
+}
+
+SignedSongTime
+MusicPipe::GetEndTime(const AudioFormat af) const
+{
+	const ScopeLock protect(mutex);
+
+	const MusicChunk *last = nullptr;
+	for (const MusicChunk *i = head; i != nullptr; i = i->next)
+		if (i->length > 0 && !i->time.IsNegative())
+			last = i;
+
+	if (last == nullptr)
+		return SignedSongTime::Negative();
+
+	return last->time +
+		SignedSongTime::FromS(last->length / af.GetTimeToSize());
+}
@@ -21,6 +21,7 @@
 #define MPD_PIPE_H
 
 #include "thread/Mutex.hxx"
+#include "Chrono.hxx"
 #include "Compiler.h"
 
 #ifndef NDEBUG
@@ -30,6 +31,7 @@
 #include <assert.h>
 
 struct MusicChunk;
+struct AudioFormat;
 class MusicBuffer;
 
 /**
@@ -116,6 +118,29 @@ public:
 	 */
 	void Push(MusicChunk *chunk);
 
+	/**
+	 * Moves all chunks from the other pipe to the head of this
+	 * one, preserving their order.  The other pipe is empty
+	 * afterwards.
+	 */
+	void Prepend(MusicPipe &other);
+
+	/**
+	 * Returns the time stamp of the first chunk which contains
+	 * audio data with a defined time stamp, or a negative value
+	 * if there is none.
+	 */
+	gcc_pure
+	SignedSongTime GetStartTime() const;
+
+	/**
+	 * Returns the time stamp of the end of the last chunk which
+	 * contains audio data with a defined time stamp, or a
+	 * negative value if there is none.
+	 */
+	gcc_pure
+	SignedSongTime GetEndTime(AudioFormat audio_format) const;
+
 	/**
 	 * Returns the number of chunks currently in this pipe.
 	 */
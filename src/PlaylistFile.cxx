@@ -33,6 +33,8 @@
 #include "config/ConfigOption.hxx"
 #include "config/ConfigDefaults.hxx"
 #include "Idle.hxx"
+#include "Log.hxx"
+#include "event/TimeoutMonitor.hxx"
 #include "fs/Limits.hxx"
 #include "fs/AllocatedPath.hxx"
 #include "fs/Traits.hxx"
@@ -44,21 +46,207 @@
 #include "util/StringCompare.hxx"
 #include "util/UriUtil.hxx"
 #include "util/Error.hxx"
+#include "util/Domain.hxx"
+
+#if defined(ENABLE_DATABASE) && defined(ENABLE_INOTIFY)
+#include "db/update/InotifySource.hxx"
+#include <sys/inotify.h>
+#endif
 
 #include <memory>
+#include <list>
+#include <exception>
 
 #include <assert.h>
 #include <sys/stat.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
+
+static constexpr Domain playlist_file_domain("playlist_file");
 
 static const char PLAYLIST_COMMENT = '#';
 
 static unsigned playlist_max_length;
 bool playlist_saveAbsolutePaths = DEFAULT_PLAYLIST_SAVE_ABSOLUTE_PATHS;
 
+/**
+ * An in-memory copy of a stored playlist file.
+ */
+struct CachedPlaylistFile {
+	std::string name;
+
+	PlaylistFileContents contents;
+
+	/**
+	 * The modification time of the file when it was last loaded
+	 * or saved.  Used to detect modifications by other programs.
+	 */
+	time_t mtime;
+
+	/**
+	 * Does #contents have modifications which have not yet been
+	 * written to disk?
+	 */
+	bool dirty;
+
+	template<typename N>
+	CachedPlaylistFile(N &&_name, PlaylistFileContents &&_contents,
+			   time_t _mtime)
+		:name(std::forward<N>(_name)), contents(std::move(_contents)),
+		 mtime(_mtime), dirty(false) {}
+};
+
+/**
+ * Keeps recently used stored playlists in memory, so editing one
+ * does not need to parse the whole file each time.  Modifications
+ * are collected and written back after #FLUSH_DELAY_MS, i.e. a burst
+ * of edits results in just one file rewrite.
+ *
+ * The result of ListPlaylistFiles() is cached as well, and is
+ * validated with the modification time of the playlist directory.
+ * Rewriting a file in place does not modify the directory, so MPD's
+ * own writes update the file's modification time in the cached
+ * listing.  With inotify, writes by other programs do the same;
+ * without it, they are only noticed when the directory changes.
+ */
+class PlaylistFileCache final : TimeoutMonitor {
+	static constexpr unsigned FLUSH_DELAY_MS = 1000;
+
+	/**
+	 * If writing a playlist fails, try again after this
+	 * duration.
+	 */
+	static constexpr unsigned RETRY_DELAY_MS = 30000;
+
+	/**
+	 * The maximum number of playlists kept in memory.  Only
+	 * clean items are evicted.
+	 */
+	static constexpr size_t MAX_FILES = 8;
+
+	/**
+	 * The cached playlists, the most recently used one first.
+	 */
+	std::list<CachedPlaylistFile> files;
+
+	std::list<PlaylistInfo> listing;
+
+	/**
+	 * The modification time of the playlist directory when
+	 * #listing was obtained.
+	 */
+	time_t listing_mtime;
+
+	/**
+	 * The time when #listing was obtained.  The listing is only
+	 * trusted if this is later than #listing_mtime, because the
+	 * directory may have been modified again within the same
+	 * second.
+	 */
+	time_t listing_time;
+
+	bool listing_valid = false;
+
+#if defined(ENABLE_DATABASE) && defined(ENABLE_INOTIFY)
+	/**
+	 * Watches the playlist directory for files written by other
+	 * programs.  It is created with the first listing.
+	 */
+	std::unique_ptr<InotifySource> inotify;
+
+	bool inotify_failed = false;
+#endif
+
+public:
+	explicit PlaylistFileCache(EventLoop &_loop)
+		:TimeoutMonitor(_loop) {}
+
+	/**
+	 * Obtain the (cached) contents of a playlist, loading it
+	 * from disk if necessary.  Throws on error.
+	 */
+	CachedPlaylistFile &Get(const char *name_utf8);
+
+	/**
+	 * Look up a playlist without loading it.
+	 */
+	gcc_pure
+	CachedPlaylistFile *Find(const char *name_utf8);
+
+	/**
+	 * The caller has modified the given item; schedule writing
+	 * it back to disk.
+	 */
+	void Modified(CachedPlaylistFile &file) {
+		file.dirty = true;
+		if (!IsActive())
+			Schedule(FLUSH_DELAY_MS);
+	}
+
+	/**
+	 * Write the specified playlist to disk if it is dirty.
+	 * Throws on error.
+	 */
+	void Flush(const char *name_utf8);
+
+	/**
+	 * Write all dirty playlists to disk, logging errors.  The
+	 * playlists which could not be written stay dirty, and
+	 * another attempt is made after #RETRY_DELAY_MS.
+	 */
+	void FlushAll();
+
+	/**
+	 * Discard the specified playlist from the cache, including
+	 * pending modifications.
+	 */
+	void Remove(const char *name_utf8);
+
+	/**
+	 * The playlist directory has been modified by MPD; discard
+	 * the cached listing.
+	 */
+	void InvalidateListing() {
+		listing_valid = false;
+	}
+
+	/**
+	 * A playlist file has been written; store its new
+	 * modification time in the cached listing.
+	 */
+	void UpdateListing(const char *name_utf8, time_t mtime);
+
+	PlaylistVector List();
+
+private:
+	void Save(CachedPlaylistFile &file);
+
+#if defined(ENABLE_DATABASE) && defined(ENABLE_INOTIFY)
+	void WatchDirectory(Path path_fs);
+
+	static void InotifyCallback(int wd, unsigned mask,
+				    const char *name, void *ctx);
+
+	void OnFileWritten(const char *name_fs);
+#endif
+
+	/**
+	 * Evict clean items until there are at most #MAX_FILES
+	 * items.
+	 */
+	void Shrink();
+
+	/* virtual methods from TimeoutMonitor */
+	void OnTimeout() override {
+		FlushAll();
+	}
+};
+
+static PlaylistFileCache *playlist_file_cache;
+
 void
-spl_global_init(void)
+spl_global_init(EventLoop &loop)
 {
 	playlist_max_length =
 		config_get_positive(ConfigOption::MAX_PLAYLIST_LENGTH,
@@ -67,6 +255,44 @@ spl_global_init(void)
 	playlist_saveAbsolutePaths =
 		config_get_bool(ConfigOption::SAVE_ABSOLUTE_PATHS,
 				DEFAULT_PLAYLIST_SAVE_ABSOLUTE_PATHS);
+
+	playlist_file_cache = new PlaylistFileCache(loop);
+}
+
+void
+spl_global_finish()
+{
+	playlist_file_cache->FlushAll();
+	delete playlist_file_cache;
+	playlist_file_cache = nullptr;
+}
+
+/**
+ * Discard cached information about the playlist directory and emit
+ * an "idle" event.  Call this after modifying a playlist file.
+ */
+static void
+spl_modified()
+{
+	playlist_file_cache->InvalidateListing();
+	idle_add(IDLE_STORED_PLAYLIST);
+}
+
+/**
+ * Like spl_modified(), but for a file which was written in place:
+ * only its entry in the cached listing is updated.
+ */
+static void
+spl_file_modified(const char *name_utf8, Path path_fs)
+{
+	FileInfo fi;
+	if (GetFileInfo(path_fs, fi))
+		playlist_file_cache->UpdateListing(name_utf8,
+						   fi.GetModificationTime());
+	else
+		playlist_file_cache->InvalidateListing();
+
+	idle_add(IDLE_STORED_PLAYLIST);
 }
 
 bool
@@ -173,14 +399,11 @@ LoadPlaylistFileInfo(PlaylistInfo &info,
 	return true;
 }
 
-PlaylistVector
-ListPlaylistFiles()
+static PlaylistVector
+ReadPlaylistDirectory(Path parent_path_fs)
 {
 	PlaylistVector list;
 
-	const auto &parent_path_fs = spl_map();
-	assert(!parent_path_fs.IsNull());
-
 	DirectoryReader reader(parent_path_fs);
 
 	PlaylistInfo info;
@@ -193,14 +416,15 @@ ListPlaylistFiles()
 	return list;
 }
 
-static void
-SavePlaylistFile(const PlaylistFileContents &contents, const char *utf8path)
+PlaylistVector
+ListPlaylistFiles()
 {
-	assert(utf8path != nullptr);
-
-	const auto path_fs = spl_map_to_fs(utf8path);
-	assert(!path_fs.IsNull());
+	return playlist_file_cache->List();
+}
 
+static void
+SavePlaylistFile(const PlaylistFileContents &contents, Path path_fs)
+{
 	FileOutputStream fos(path_fs);
 
 	BufferedOutputStream bos(fos);
@@ -213,14 +437,11 @@ SavePlaylistFile(const PlaylistFileContents &contents, const char *utf8path)
 	fos.Commit();
 }
 
-PlaylistFileContents
-LoadPlaylistFile(const char *utf8path)
-try {
+static PlaylistFileContents
+ReadPlaylistFile(Path path_fs)
+{
 	PlaylistFileContents contents;
 
-	const auto path_fs = spl_map_to_fs(utf8path);
-	assert(!path_fs.IsNull());
-
 	TextFile file(path_fs);
 
 	char *s;
@@ -268,12 +489,262 @@ try {
 	}
 
 	return contents;
+}
+
+/**
+ * Determine the modification time of a stored playlist file.
+ * Throws PlaylistError::NoSuchList() if it does not exist.
+ */
+static time_t
+GetPlaylistFileMTime(Path path_fs)
+{
+	FileInfo fi;
+	if (!GetFileInfo(path_fs, fi) || !fi.IsRegular())
+		throw PlaylistError::NoSuchList();
+
+	return fi.GetModificationTime();
+}
+
+CachedPlaylistFile *
+PlaylistFileCache::Find(const char *name_utf8)
+{
+	for (auto &i : files)
+		if (i.name == name_utf8)
+			return &i;
+
+	return nullptr;
+}
+
+CachedPlaylistFile &
+PlaylistFileCache::Get(const char *name_utf8)
+try {
+	const auto path_fs = spl_map_to_fs(name_utf8);
+	assert(!path_fs.IsNull());
+
+	auto i = files.begin();
+	while (i != files.end() && i->name != name_utf8)
+		++i;
+
+	if (i != files.end()) {
+		/* move to the front of the list */
+		files.splice(files.begin(), files, i);
+
+		if (i->dirty)
+			/* our own modifications override
+			   anything on disk */
+			return *i;
+
+		if (GetPlaylistFileMTime(path_fs) == i->mtime)
+			return *i;
+
+		/* modified by somebody else: reload */
+		files.erase(i);
+	}
+
+	const time_t mtime = GetPlaylistFileMTime(path_fs);
+	files.emplace_front(name_utf8, ReadPlaylistFile(path_fs), mtime);
+	UpdateListing(name_utf8, mtime);
+	Shrink();
+	return files.front();
 } catch (const std::system_error &e) {
 	if (IsFileNotFound(e))
 		throw PlaylistError::NoSuchList();
 	throw;
 }
 
+void
+PlaylistFileCache::Save(CachedPlaylistFile &file)
+{
+	assert(file.dirty);
+
+	const auto path_fs = spl_map_to_fs(file.name.c_str());
+	assert(!path_fs.IsNull());
+
+	SavePlaylistFile(file.contents, path_fs);
+
+	file.dirty = false;
+	file.mtime = GetPlaylistFileMTime(path_fs);
+
+	UpdateListing(file.name.c_str(), file.mtime);
+}
+
+void
+PlaylistFileCache::Flush(const char *name_utf8)
+{
+	auto *file = Find(name_utf8);
+	if (file != nullptr && file->dirty)
+		Save(*file);
+}
+
+void
+PlaylistFileCache::FlushAll()
+{
+	Cancel();
+
+	bool failed = false;
+	for (auto &i : files) {
+		if (!i.dirty)
+			continue;
+
+		try {
+			Save(i);
+		} catch (const std::exception &e) {
+			FormatError(playlist_file_domain,
+				    "Failed to save playlist \"%s\"",
+				    i.name.c_str());
+			LogError(e);
+
+			/* keep the modifications; Shrink() does not
+			   evict dirty items */
+			failed = true;
+		}
+	}
+
+	if (failed)
+		Schedule(RETRY_DELAY_MS);
+
+	Shrink();
+}
+
+void
+PlaylistFileCache::Remove(const char *name_utf8)
+{
+	files.remove_if([name_utf8](const CachedPlaylistFile &file){
+			return file.name == name_utf8;
+		});
+}
+
+void
+PlaylistFileCache::Shrink()
+{
+	auto i = files.end();
+	while (files.size() > MAX_FILES && i != files.begin()) {
+		--i;
+		if (!i->dirty)
+			i = files.erase(i);
+	}
+}
+
+void
+PlaylistFileCache::UpdateListing(const char *name_utf8, time_t mtime)
+{
+	if (!listing_valid)
+		return;
+
+	for (auto &i : listing) {
+		if (i.name == name_utf8) {
+			i.mtime = mtime;
+			return;
+		}
+	}
+
+	/* a new file; the directory will be read again */
+	listing_valid = false;
+}
+
+#if defined(ENABLE_DATABASE) && defined(ENABLE_INOTIFY)
+
+void
+PlaylistFileCache::WatchDirectory(Path path_fs)
+{
+	Error error;
+	inotify.reset(InotifySource::Create(GetEventLoop(),
+					    InotifyCallback, this,
+					    error));
+	if (inotify == nullptr ||
+	    inotify->Add(path_fs.c_str(), IN_ATTRIB|IN_CLOSE_WRITE,
+			 error) < 0) {
+		LogError(error,
+			 "Failed to watch the playlist directory");
+		inotify.reset();
+		inotify_failed = true;
+	}
+}
+
+void
+PlaylistFileCache::InotifyCallback(gcc_unused int wd,
+				   gcc_unused unsigned mask,
+				   const char *name, void *ctx)
+{
+	auto &cache = *(PlaylistFileCache *)ctx;
+	if (name != nullptr)
+		cache.OnFileWritten(name);
+}
+
+void
+PlaylistFileCache::OnFileWritten(const char *name_fs)
+{
+	if (!listing_valid)
+		return;
+
+	const auto &parent_path_fs = map_spl_path();
+	if (parent_path_fs.IsNull())
+		return;
+
+	PlaylistInfo info;
+	if (LoadPlaylistFileInfo(info, parent_path_fs,
+				 Path::FromFS(name_fs)))
+		UpdateListing(info.name.c_str(), info.mtime);
+}
+
+#endif
+
+PlaylistVector
+PlaylistFileCache::List()
+{
+	const auto &parent_path_fs = spl_map();
+	assert(!parent_path_fs.IsNull());
+
+	FileInfo fi;
+	if (listing_valid &&
+	    (!GetFileInfo(parent_path_fs, fi) ||
+	     fi.GetModificationTime() != listing_mtime ||
+	     listing_time <= listing_mtime))
+		listing_valid = false;
+
+	if (!listing_valid) {
+		/* obtain the directory's time stamp before reading
+		   it, so a concurrent modification invalidates the
+		   new listing */
+		const time_t now = time(nullptr);
+		if (!GetFileInfo(parent_path_fs, fi))
+			ThrowPlaylistErrno();
+
+		auto list = ReadPlaylistDirectory(parent_path_fs);
+
+		listing.clear();
+		for (auto &i : list)
+			listing.emplace_back(std::move(i.name), i.mtime);
+
+		listing_mtime = fi.GetModificationTime();
+		listing_time = now;
+		listing_valid = true;
+
+#if defined(ENABLE_DATABASE) && defined(ENABLE_INOTIFY)
+		if (inotify == nullptr && !inotify_failed)
+			WatchDirectory(parent_path_fs);
+#endif
+	}
+
+	PlaylistVector result;
+	for (const auto &i : listing)
+		result.push_back(PlaylistInfo(i.name, i.mtime));
+
+	return result;
+}
+
+PlaylistFileContents
+LoadPlaylistFile(const char *utf8path)
+{
+	return playlist_file_cache->Get(utf8path).contents;
+}
+
+void
+spl_flush(const char *name_utf8)
+{
+	playlist_file_cache->Flush(name_utf8);
+}
+
 void
 spl_move_index(const char *utf8path, unsigned src, unsigned dest)
 {
@@ -282,7 +753,8 @@ spl_move_index(const char *utf8path, unsigned src, unsigned dest)
 		   what the hell.. */
 		return;
 
-	auto contents = LoadPlaylistFile(utf8path);
+	auto &file = playlist_file_cache->Get(utf8path);
+	auto &contents = file.contents;
 
 	if (src >= contents.size() || dest >= contents.size())
 		throw PlaylistError(PlaylistResult::BAD_RANGE, "Bad range");
@@ -294,7 +766,7 @@ spl_move_index(const char *utf8path, unsigned src, unsigned dest)
 	const auto dest_i = std::next(contents.begin(), dest);
 	contents.insert(dest_i, std::move(value));
 
-	SavePlaylistFile(contents, utf8path);
+	playlist_file_cache->Modified(file);
 
 	idle_add(IDLE_STORED_PLAYLIST);
 }
@@ -305,13 +777,15 @@ spl_clear(const char *utf8path)
 	const auto path_fs = spl_map_to_fs(utf8path);
 	assert(!path_fs.IsNull());
 
+	playlist_file_cache->Remove(utf8path);
+
 	FILE *file = FOpen(path_fs, FOpenMode::WriteText);
 	if (file == nullptr)
 		ThrowPlaylistErrno();
 
 	fclose(file);
 
-	idle_add(IDLE_STORED_PLAYLIST);
+	spl_file_modified(utf8path, path_fs);
 }
 
 void
@@ -320,23 +794,26 @@ spl_delete(const char *name_utf8)
 	const auto path_fs = spl_map_to_fs(name_utf8);
 	assert(!path_fs.IsNull());
 
+	playlist_file_cache->Remove(name_utf8);
+
 	if (!RemoveFile(path_fs))
 		ThrowPlaylistErrno();
 
-	idle_add(IDLE_STORED_PLAYLIST);
+	spl_modified();
 }
 
 void
 spl_remove_index(const char *utf8path, unsigned pos)
 {
-	auto contents = LoadPlaylistFile(utf8path);
+	auto &file = playlist_file_cache->Get(utf8path);
+	auto &contents = file.contents;
 
 	if (pos >= contents.size())
 		throw PlaylistError(PlaylistResult::BAD_RANGE, "Bad range");
 
 	contents.erase(std::next(contents.begin(), pos));
 
-	SavePlaylistFile(contents, utf8path);
+	playlist_file_cache->Modified(file);
 	idle_add(IDLE_STORED_PLAYLIST);
 }
 
@@ -346,6 +823,21 @@ try {
 	const auto path_fs = spl_map_to_fs(utf8path);
 	assert(!path_fs.IsNull());
 
+	auto *cached = playlist_file_cache->Find(utf8path);
+	if (cached != nullptr) {
+		/* edit the in-memory copy instead of appending to
+		   the file, which would invalidate it */
+		auto &file = playlist_file_cache->Get(utf8path);
+		if (file.contents.size() >= playlist_max_length)
+			throw PlaylistError(PlaylistResult::TOO_LARGE,
+					    "Stored playlist is too large");
+
+		file.contents.emplace_back(song.GetURI());
+		playlist_file_cache->Modified(file);
+		idle_add(IDLE_STORED_PLAYLIST);
+		return;
+	}
+
 	AppendFileOutputStream fos(path_fs);
 
 	if (fos.Tell() / (MPD_PATH_MAX + 1) >= playlist_max_length)
@@ -359,7 +851,7 @@ try {
 	bos.Flush();
 	fos.Commit();
 
-	idle_add(IDLE_STORED_PLAYLIST);
+	spl_file_modified(utf8path, path_fs);
 } catch (const std::system_error &e) {
 	if (IsFileNotFound(e))
 		throw PlaylistError::NoSuchList();
@@ -393,7 +885,7 @@ spl_rename_internal(Path from_path_fs, Path to_path_fs)
 	if (!RenameFile(from_path_fs, to_path_fs))
 		ThrowPlaylistErrno();
 
-	idle_add(IDLE_STORED_PLAYLIST);
+	spl_modified();
 }
 
 void
@@ -405,5 +897,9 @@ spl_rename(const char *utf8from, const char *utf8to)
 	const auto to_path_fs = spl_map_to_fs(utf8to);
 	assert(!to_path_fs.IsNull());
 
+	playlist_file_cache->Flush(utf8from);
+	playlist_file_cache->Remove(utf8from);
+	playlist_file_cache->Remove(utf8to);
+
 	spl_rename_internal(from_path_fs, to_path_fs);
 }
@@ -23,6 +23,7 @@
 #include <vector>
 #include <string>
 
+class EventLoop;
 class DetachedSong;
 class SongLoader;
 class PlaylistVector;
@@ -35,9 +36,27 @@ extern bool playlist_saveAbsolutePaths;
 
 /**
  * Perform some global initialization, e.g. load configuration values.
+ *
+ * @param loop the #EventLoop which flushes modified stored playlists
+ * to disk
+ */
+void
+spl_global_init(EventLoop &loop);
+
+/**
+ * Write all pending modifications to disk and free the stored
+ * playlist cache.
+ */
+void
+spl_global_finish();
+
+/**
+ * Write pending modifications of the specified stored playlist to
+ * disk.  Call this before reading the playlist file directly,
+ * bypassing LoadPlaylistFile().
  */
 void
-spl_global_init();
+spl_flush(const char *name_utf8);
 
 /**
  * Determines whether the specified string is a valid name for a
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_SONG_ANALYSIS_HXX
+#define MPD_SONG_ANALYSIS_HXX
+
+#include "check.h"
+#include "ReplayGainInfo.hxx"
+#include "MixRampInfo.hxx"
+
+/**
+ * The results of the background loudness analysis of a song, see
+ * #UpdateAnalysis.  They are used during playback if the file itself
+ * does not contain ReplayGain or MixRamp tags.
+ */
+struct SongAnalysis {
+	/**
+	 * The EBU R128 track and album gain.  Undefined if the song
+	 * could not be decoded or if it is silent.
+	 */
+	ReplayGainInfo replay_gain;
+
+	MixRampInfo mix_ramp;
+
+	SongAnalysis() {
+		replay_gain.Clear();
+	}
+};
+
+#endif
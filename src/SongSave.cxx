@@ -21,6 +21,7 @@
 #include "SongSave.hxx"
 #include "db/plugins/simple/Song.hxx"
 #include "DetachedSong.hxx"
+#include "SongAnalysis.hxx"
 #include "TagSave.hxx"
 #include "fs/io/TextFile.hxx"
 #include "fs/io/BufferedOutputStream.hxx"
@@ -32,9 +33,13 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
 
 #define SONG_MTIME "mtime"
 #define SONG_END "song_end"
+#define SONG_ANALYSIS "Analysis"
+#define SONG_MIXRAMP_START "AnalysisMixRampStart"
+#define SONG_MIXRAMP_END "AnalysisMixRampEnd"
 
 static constexpr Domain song_save_domain("song_save");
 
@@ -47,6 +52,33 @@ range_save(BufferedOutputStream &os, unsigned start_ms, unsigned end_ms)
 		os.Format("Range: %u-\n", start_ms);
 }
 
+static void
+analysis_save(BufferedOutputStream &os, const SongAnalysis &analysis)
+{
+	const auto &track = analysis.replay_gain.tuples[REPLAY_GAIN_TRACK];
+	const auto &album = analysis.replay_gain.tuples[REPLAY_GAIN_ALBUM];
+	os.Format(SONG_ANALYSIS ": %.2f %f %.2f %f\n",
+		  track.gain, track.peak, album.gain, album.peak);
+
+	const char *mixramp = analysis.mix_ramp.GetStart();
+	if (mixramp != nullptr)
+		os.Format(SONG_MIXRAMP_START ": %s\n", mixramp);
+
+	mixramp = analysis.mix_ramp.GetEnd();
+	if (mixramp != nullptr)
+		os.Format(SONG_MIXRAMP_END ": %s\n", mixramp);
+}
+
+static bool
+analysis_load(SongAnalysis &analysis, const char *value)
+{
+	auto &track = analysis.replay_gain.tuples[REPLAY_GAIN_TRACK];
+	auto &album = analysis.replay_gain.tuples[REPLAY_GAIN_ALBUM];
+	return sscanf(value, "%f %f %f %f",
+		      &track.gain, &track.peak,
+		      &album.gain, &album.peak) == 4;
+}
+
 void
 song_save(BufferedOutputStream &os, const Song &song)
 {
@@ -56,6 +88,9 @@ song_save(BufferedOutputStream &os, const Song &song)
 
 	tag_save(os, song.tag);
 
+	if (song.analysis != nullptr)
+		analysis_save(os, *song.analysis);
+
 	os.Format(SONG_MTIME ": %li\n", (long)song.mtime);
 	os.Format(SONG_END "\n");
 }
@@ -81,6 +116,8 @@ song_load(TextFile &file, const char *uri,
 
 	TagBuilder tag;
 
+	std::shared_ptr<SongAnalysis> analysis;
+
 	char *line;
 	while ((line = file.ReadLine()) != nullptr &&
 	       strcmp(line, SONG_END) != 0) {
@@ -115,6 +152,22 @@ song_load(TextFile &file, const char *uri,
 
 			song->SetStartTime(SongTime::FromMS(start_ms));
 			song->SetEndTime(SongTime::FromMS(end_ms));
+		} else if (strcmp(line, SONG_ANALYSIS) == 0) {
+			analysis = std::make_shared<SongAnalysis>();
+			if (!analysis_load(*analysis, value)) {
+				delete song;
+
+				error.Format(song_save_domain,
+					     "malformed analysis in db: %s",
+					     value);
+				return nullptr;
+			}
+		} else if (analysis != nullptr &&
+			   strcmp(line, SONG_MIXRAMP_START) == 0) {
+			analysis->mix_ramp.SetStart(value);
+		} else if (analysis != nullptr &&
+			   strcmp(line, SONG_MIXRAMP_END) == 0) {
+			analysis->mix_ramp.SetEnd(value);
 		} else {
 			delete song;
 
@@ -125,5 +178,6 @@ song_load(TextFile &file, const char *uri,
 	}
 
 	song->SetTag(tag.Commit());
+	song->SetAnalysis(std::move(analysis));
 	return song;
 }
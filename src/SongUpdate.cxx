@@ -90,6 +90,9 @@ Song::UpdateFile(Storage &storage)
 
 	mtime = info.mtime;
 	tag_builder.Commit(tag);
+
+	/* the file has changed; analyze it again */
+	analysis.reset();
 	return true;
 }
 
@@ -135,6 +138,7 @@ Song::UpdateFileInArchive(ArchiveFile &archive)
 		return false;
 
 	tag_builder.Commit(tag);
+	analysis.reset();
 	return true;
 }
 
@@ -21,6 +21,7 @@
 #include "StateFile.hxx"
 #include "output/OutputState.hxx"
 #include "queue/PlaylistState.hxx"
+#include "queue/QueueSnapshot.hxx"
 #include "fs/io/TextFile.hxx"
 #include "fs/io/FileOutputStream.hxx"
 #include "fs/io/BufferedOutputStream.hxx"
@@ -29,23 +30,40 @@
 #include "mixer/Volume.hxx"
 #include "SongLoader.hxx"
 #include "fs/FileSystem.hxx"
+#include "fs/Traits.hxx"
 #include "util/Domain.hxx"
 #include "Log.hxx"
 
+#ifdef ENABLE_DATABASE
+#include "db/Interface.hxx"
+#endif
+
 #include <exception>
 
 #include <string.h>
 
 static constexpr Domain state_file_domain("state_file");
 
+gcc_pure
+static AllocatedPath
+MakeSnapshotPath(const AllocatedPath &path)
+{
+	return AllocatedPath::FromFS(PathTraitsFS::string(path.c_str()) +
+				     PATH_LITERAL(".queue"));
+}
+
 StateFile::StateFile(AllocatedPath &&_path, unsigned _interval,
+		     bool _queue_snapshot,
 		     Partition &_partition, EventLoop &_loop)
 	:TimeoutMonitor(_loop),
 	 path(std::move(_path)), path_utf8(path.ToUTF8()),
+	 snapshot_path(MakeSnapshotPath(path)),
+	 queue_snapshot(_queue_snapshot),
 	 interval(_interval),
 	 partition(_partition),
 	 prev_volume_version(0), prev_output_version(0),
-	 prev_playlist_version(0)
+	 prev_playlist_version(0),
+	 snapshot_version(0)
 {
 }
 
@@ -68,30 +86,71 @@ StateFile::IsModified() const
 }
 
 inline void
-StateFile::Write(BufferedOutputStream &os)
+StateFile::Write(BufferedOutputStream &os, bool snapshot)
 {
 	save_sw_volume_state(os);
 	audio_output_state_save(os, partition.outputs);
-	playlist_state_save(os, partition.playlist, partition.pc);
+	playlist_state_save(os, partition.playlist, partition.pc, snapshot);
 }
 
 inline void
-StateFile::Write(OutputStream &os)
+StateFile::Write(OutputStream &os, bool snapshot)
 {
 	BufferedOutputStream bos(os);
-	Write(bos);
+	Write(bos, snapshot);
 	bos.Flush();
 }
 
+time_t
+StateFile::GetDatabaseStamp() const
+{
+#ifdef ENABLE_DATABASE
+	const Database *db = partition.instance.database;
+	if (db != nullptr)
+		return db->GetUpdateStamp();
+#endif
+
+	return 0;
+}
+
+bool
+StateFile::WriteQueueSnapshot()
+{
+	if (!queue_snapshot)
+		return false;
+
+	const Queue &queue = partition.playlist.queue;
+	if (queue.version == snapshot_version)
+		/* only the playback state has changed */
+		return true;
+
+	FormatDebug(state_file_domain, "Saving queue snapshot");
+
+	try {
+		queue_snapshot_save(snapshot_path, queue, GetDatabaseStamp());
+	} catch (const std::exception &e) {
+		LogError(e);
+
+		/* fall back to the text format */
+		snapshot_version = 0;
+		return false;
+	}
+
+	snapshot_version = queue.version;
+	return true;
+}
+
 void
 StateFile::Write()
 {
 	FormatDebug(state_file_domain,
 		    "Saving state file %s", path_utf8.c_str());
 
+	const bool snapshot = WriteQueueSnapshot();
+
 	try {
 		FileOutputStream fos(path);
-		Write(fos);
+		Write(fos, snapshot);
 		fos.Commit();
 	} catch (const std::exception &e) {
 		LogError(e);
@@ -116,11 +175,15 @@ try {
 	const SongLoader song_loader(nullptr, nullptr);
 #endif
 
+	bool snapshot_restored = false;
+
 	const char *line;
 	while ((line = file.ReadLine()) != nullptr) {
 		success = read_sw_volume_state(line, partition.outputs) ||
 			audio_output_state_read(line, partition.outputs) ||
 			playlist_state_restore(line, file, song_loader,
+					       snapshot_path,
+					       snapshot_restored,
 					       partition.playlist,
 					       partition.pc);
 		if (!success)
@@ -129,6 +192,10 @@ try {
 				    line);
 	}
 
+	if (snapshot_restored)
+		/* no need to write the same snapshot again */
+		snapshot_version = partition.playlist.queue.version;
+
 	RememberVersions();
 } catch (const std::exception &e) {
 	LogError(e);
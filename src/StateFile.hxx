@@ -26,6 +26,9 @@
 
 #include <string>
 
+#include <stdint.h>
+#include <time.h>
+
 struct Partition;
 class OutputStream;
 class BufferedOutputStream;
@@ -34,6 +37,19 @@ class StateFile final : private TimeoutMonitor {
 	const AllocatedPath path;
 	const std::string path_utf8;
 
+	/**
+	 * The path of the binary queue snapshot.  It is loaded if the
+	 * state file refers to it, even if #queue_snapshot is
+	 * disabled.
+	 */
+	const AllocatedPath snapshot_path;
+
+	/**
+	 * Save the queue in #snapshot_path instead of the state
+	 * file?
+	 */
+	const bool queue_snapshot;
+
 	const unsigned interval;
 
 	Partition &partition;
@@ -45,10 +61,23 @@ class StateFile final : private TimeoutMonitor {
 	unsigned prev_volume_version, prev_output_version,
 		prev_playlist_version;
 
+	/**
+	 * The queue version which has been written to
+	 * #snapshot_path.  If it is still current, only the (small)
+	 * state file needs to be rewritten.  0 means the snapshot is
+	 * not up to date.
+	 */
+	uint32_t snapshot_version;
+
 public:
 	static constexpr unsigned DEFAULT_INTERVAL = 2 * 60;
 
+	/**
+	 * @param queue_snapshot save the queue in a binary snapshot
+	 * file next to the state file?
+	 */
 	StateFile(AllocatedPath &&path, unsigned interval,
+		  bool _queue_snapshot,
 		  Partition &partition, EventLoop &loop);
 
 	void Read();
@@ -60,8 +89,19 @@ public:
 	void CheckModified();
 
 private:
-	void Write(OutputStream &os);
-	void Write(BufferedOutputStream &os);
+	void Write(OutputStream &os, bool snapshot);
+	void Write(BufferedOutputStream &os, bool snapshot);
+
+	gcc_pure
+	time_t GetDatabaseStamp() const;
+
+	/**
+	 * Write the queue snapshot file unless it is up to date.
+	 *
+	 * @return true if the snapshot file contains the current
+	 * queue, false if the queue must be saved in the state file
+	 */
+	bool WriteQueueSnapshot();
 
 	/**
 	 * Save the current state versions for use with IsModified().
@@ -26,10 +26,22 @@
 #include "db/Selection.hxx"
 #include "db/Interface.hxx"
 #include "db/Stats.hxx"
+#include "tag/TagPool.hxx"
+#include "util/SlabAllocator.hxx"
 #include "util/Error.hxx"
 #include "system/Clock.hxx"
 #include "Log.hxx"
 
+#ifdef ENABLE_DATABASE
+#include "db/plugins/simple/Song.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#endif
+
+#ifdef __linux__
+#include <stdio.h>
+#include <unistd.h>
+#endif
+
 #ifndef WIN32
 /**
  * The monotonic time stamp when MPD was started.  It is used to
@@ -137,3 +149,69 @@ stats_print(Response &r, const Partition &partition)
 		db_stats_print(r, *db);
 #endif
 }
+
+static void
+slab_stats_print(Response &r, const char *name, const char *bytes_name,
+		 const SlabAllocatorStats &slab)
+{
+	r.Format("%s: %lu\n"
+		 "%s: %lu\n",
+		 name, (unsigned long)slab.n_allocated,
+		 bytes_name, (unsigned long)slab.allocated_bytes);
+}
+
+#ifdef __linux__
+
+/**
+ * Determine the resident set size of this process.
+ *
+ * @return the size in bytes or 0 on error
+ */
+static unsigned long
+GetResidentBytes()
+{
+	FILE *file = fopen("/proc/self/statm", "r");
+	if (file == nullptr)
+		return 0;
+
+	unsigned long size, resident;
+	if (fscanf(file, "%lu %lu", &size, &resident) != 2)
+		resident = 0;
+
+	fclose(file);
+	return resident * sysconf(_SC_PAGESIZE);
+}
+
+#endif
+
+void
+memory_print(Response &r)
+{
+	SlabAllocatorStats total;
+
+#ifdef ENABLE_DATABASE
+	const auto songs = Song::GetMemoryStats();
+	slab_stats_print(r, "songs", "song_bytes", songs);
+	total += songs;
+
+	const auto directories = Directory::GetMemoryStats();
+	slab_stats_print(r, "directories", "directory_bytes",
+			 directories);
+	total += directories;
+#endif
+
+	SlabAllocatorStats tag_items, tag_arrays;
+	tag_pool_get_stats(tag_items, tag_arrays);
+	slab_stats_print(r, "tag_items", "tag_item_bytes", tag_items);
+	slab_stats_print(r, "tag_arrays", "tag_array_bytes", tag_arrays);
+	total += tag_items;
+	total += tag_arrays;
+
+	r.Format("slab_bytes: %lu\n", (unsigned long)total.reserved_bytes);
+
+#ifdef __linux__
+	const unsigned long resident = GetResidentBytes();
+	if (resident > 0)
+		r.Format("rss_bytes: %lu\n", resident);
+#endif
+}
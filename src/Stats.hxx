@@ -32,4 +32,10 @@ stats_invalidate();
 void
 stats_print(Response &r, const Partition &partition);
 
+/**
+ * Print a breakdown of MPD's memory usage.
+ */
+void
+memory_print(Response &r);
+
 #endif
@@ -23,6 +23,7 @@
 #include "check.h"
 #include "ClientMessage.hxx"
 #include "command/CommandListBuilder.hxx"
+#include "command/CommandResult.hxx"
 #include "event/FullyBufferedSocket.hxx"
 #include "event/TimeoutMonitor.hxx"
 #include "Compiler.h"
@@ -42,10 +43,26 @@ class Path;
 struct Partition;
 class Database;
 class Storage;
+class ClientCompression;
 
 class Client final
 	: FullyBufferedSocket, TimeoutMonitor,
 	  public boost::intrusive::list_base_hook<boost::intrusive::link_mode<boost::intrusive::normal_link>> {
+	friend class ClientCompression;
+
+#ifdef ENABLE_ZLIB
+	/**
+	 * Non-null after the client has sent the "compress" command.
+	 */
+	ClientCompression *compression;
+
+	/**
+	 * Set by RequestCompression(); compression begins after the
+	 * response to the "compress" command has been sent.
+	 */
+	bool compress_requested;
+#endif
+
 public:
 	Partition &partition;
 	struct playlist &playlist;
@@ -63,6 +80,14 @@ public:
 	/** is this client waiting for an "idle" response? */
 	bool idle_waiting;
 
+	/**
+	 * Is a command being executed by the #ClientWorkerPool?
+	 * While this flag is set, no more input is processed, and
+	 * the object must not be deleted, because the worker thread
+	 * still uses it.
+	 */
+	bool background;
+
 	/** idle flags pending on this client, to be sent as soon as
 	    the client enters "idle" */
 	unsigned idle_flags;
@@ -89,10 +114,7 @@ public:
 	Client(EventLoop &loop, Partition &partition,
 	       int fd, int uid, int num);
 
-	~Client() {
-		if (FullyBufferedSocket::IsDefined())
-			FullyBufferedSocket::Close();
-	}
+	~Client();
 
 	bool IsConnected() const {
 		return FullyBufferedSocket::IsDefined();
@@ -106,8 +128,40 @@ public:
 	void Close();
 	void SetExpired();
 
+	/**
+	 * Does the socket's output buffer still contain data?  The
+	 * #ClientWorkerPool waits until it has been sent before
+	 * submitting more output.
+	 */
+	gcc_pure
+	bool IsCongested() const {
+		return !IsExpired() && !FullyBufferedSocket::IsOutputEmpty();
+	}
+
+	/**
+	 * The #ClientWorkerPool has finished the command which was
+	 * submitted by command_process().  Sends the "OK" and
+	 * continues processing input.  The object may be deleted by
+	 * this method.
+	 */
+	void OnBackgroundFinished(CommandResult result);
+
 	bool Write(const void *data, size_t length);
 
+#ifdef ENABLE_ZLIB
+	bool IsCompressed() const {
+		return compression != nullptr || compress_requested;
+	}
+
+	/**
+	 * Switch both directions of the connection to gzip after
+	 * the current command has finished.
+	 */
+	void RequestCompression() {
+		compress_requested = true;
+	}
+#endif
+
 	/**
 	 * returns the uid of the client process, or a negative value
 	 * if the uid is unknown
@@ -185,10 +239,37 @@ public:
 	const Storage *GetStorage() const;
 
 private:
+	/**
+	 * Write to the socket's output buffer, bypassing the
+	 * compression.
+	 */
+	bool WriteRaw(const void *data, size_t length);
+
+	/**
+	 * Execute one line which has been removed from the input
+	 * buffer already.
+	 *
+	 * @param newline the end of the line
+	 */
+	InputResult ProcessLine(char *line, char *newline);
+
+#ifdef ENABLE_ZLIB
+	void StartCompression();
+
+	/**
+	 * Execute all complete lines in the decompressed input
+	 * buffer.
+	 *
+	 * @return MORE if no complete line is left
+	 */
+	InputResult ProcessCompressedInput();
+#endif
+
 	/* virtual methods from class BufferedSocket */
 	virtual InputResult OnSocketInput(void *data, size_t length) override;
 	virtual void OnSocketError(Error &&error) override;
 	virtual void OnSocketClosed() override;
+	virtual void OnSocketDrained() override;
 
 	/* virtual methods from class TimeoutMonitor */
 	virtual void OnTimeout() override;
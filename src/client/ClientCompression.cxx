@@ -0,0 +1,109 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+#include "ClientCompression.hxx"
+#include "Client.hxx"
+#include "Log.hxx"
+
+#include <stdexcept>
+
+void
+ClientCompression::Sink::Write(const void *data, size_t size)
+{
+	/* errors are handled by FullyBufferedSocket, which expires
+	   the client */
+	client.WriteRaw(data, size);
+}
+
+ClientCompression::ClientCompression(EventLoop &_loop,
+				     Client &_client)
+	:IdleMonitor(_loop), sink(_client),
+	 /* fast compression, because this runs in the main thread;
+	    tag text compresses well even at this level */
+	 deflate(sink, Z_BEST_SPEED),
+	 input_finished(false)
+{
+	inflate_z.next_in = nullptr;
+	inflate_z.avail_in = 0;
+	inflate_z.zalloc = Z_NULL;
+	inflate_z.zfree = Z_NULL;
+	inflate_z.opaque = Z_NULL;
+
+	int result = inflateInit2(&inflate_z, 16 + MAX_WBITS);
+	if (result != Z_OK)
+		throw ZlibError(result);
+}
+
+ClientCompression::~ClientCompression()
+{
+	inflateEnd(&inflate_z);
+}
+
+void
+ClientCompression::Write(const void *data, size_t length)
+{
+	deflate.Write(data, length);
+	IdleMonitor::Schedule();
+}
+
+void
+ClientCompression::Flush()
+{
+	IdleMonitor::Cancel();
+
+	try {
+		deflate.SyncFlush();
+	} catch (const std::exception &e) {
+		LogError(e);
+	}
+}
+
+void
+ClientCompression::OnIdle()
+{
+	Flush();
+}
+
+size_t
+ClientCompression::Feed(const void *data, size_t length)
+{
+	if (input_finished)
+		throw std::runtime_error("Data after the end of the compressed stream");
+
+	auto w = input.Write();
+	if (w.IsEmpty())
+		return 0;
+
+	/* zlib's API requires non-const input pointer */
+	inflate_z.next_in = (Bytef *)const_cast<void *>(data);
+	inflate_z.avail_in = length;
+	inflate_z.next_out = (Bytef *)w.data;
+	inflate_z.avail_out = w.size;
+
+	int result = inflate(&inflate_z, Z_SYNC_FLUSH);
+	if (result == Z_STREAM_END)
+		input_finished = true;
+	else if (result != Z_OK && result != Z_BUF_ERROR)
+		throw ZlibError(result);
+
+	input.Append(w.size - inflate_z.avail_out);
+	return length - inflate_z.avail_in;
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_CLIENT_COMPRESSION_HXX
+#define MPD_CLIENT_COMPRESSION_HXX
+
+#include "check.h"
+#include "event/IdleMonitor.hxx"
+#include "fs/io/OutputStream.hxx"
+#include "fs/io/GzipOutputStream.hxx"
+#include "lib/zlib/Error.hxx"
+#include "util/StaticFifoBuffer.hxx"
+
+#include <zlib.h>
+
+class Client;
+
+/**
+ * The state of a client connection which has been switched to gzip
+ * compression with the "compress" command.  Responses are compressed
+ * and flushed (Z_SYNC_FLUSH) when the #EventLoop becomes idle;
+ * requests are decompressed into a separate input buffer.
+ */
+class ClientCompression final : IdleMonitor {
+	/**
+	 * Passes compressed data to the client's output buffer.
+	 */
+	class Sink final : public OutputStream {
+		Client &client;
+
+	public:
+		explicit Sink(Client &_client):client(_client) {}
+
+		/* virtual methods from class OutputStream */
+		void Write(const void *data, size_t size) override;
+	};
+
+	Sink sink;
+
+	GzipOutputStream deflate;
+
+	z_stream inflate_z;
+
+	/**
+	 * Set when the client has finished its gzip stream; no more
+	 * input is accepted.
+	 */
+	bool input_finished;
+
+	/**
+	 * Decompressed input which has not yet been processed.
+	 */
+	StaticFifoBuffer<char, 8192> input;
+
+public:
+	typedef StaticFifoBuffer<char, 8192>::Range Range;
+
+	/**
+	 * Throws #ZlibError on error.
+	 */
+	ClientCompression(EventLoop &_loop, Client &_client);
+	~ClientCompression();
+
+	ClientCompression(const ClientCompression &) = delete;
+	ClientCompression &operator=(const ClientCompression &) = delete;
+
+	/**
+	 * Compress data for the client.  It will be sent when the
+	 * #EventLoop becomes idle, or when Flush() is called.
+	 */
+	void Write(const void *data, size_t length);
+
+	/**
+	 * Pass all pending compressed data to the client's output
+	 * buffer.
+	 */
+	void Flush();
+
+	/**
+	 * Decompress data received from the client into the input
+	 * buffer.  Throws on error.
+	 *
+	 * @return the number of bytes consumed; less than #length if
+	 * the input buffer is full
+	 */
+	size_t Feed(const void *data, size_t length);
+
+	Range ReadInput() {
+		return input.Read();
+	}
+
+	void ConsumeInput(size_t nbytes) {
+		input.Consume(nbytes);
+	}
+
+	bool IsInputFull() const {
+		return input.IsFull();
+	}
+
+private:
+	/* virtual methods from class IdleMonitor */
+	void OnIdle() override;
+};
+
+#endif
@@ -21,6 +21,12 @@
 #include "Client.hxx"
 #include "Log.hxx"
 
+#ifdef ENABLE_DATABASE
+#include "Partition.hxx"
+#include "Instance.hxx"
+#include "ClientWorker.hxx"
+#endif
+
 void
 Client::OnSocketError(Error &&error)
 {
@@ -34,3 +40,13 @@ Client::OnSocketClosed()
 {
 	SetExpired();
 }
+
+void
+Client::OnSocketDrained()
+{
+#ifdef ENABLE_DATABASE
+	if (background)
+		/* the worker may have more output for us */
+		partition.instance.client_workers->Wake();
+#endif
+}
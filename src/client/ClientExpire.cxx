@@ -21,6 +21,12 @@
 #include "ClientInternal.hxx"
 #include "Log.hxx"
 
+#ifdef ENABLE_DATABASE
+#include "Partition.hxx"
+#include "Instance.hxx"
+#include "ClientWorker.hxx"
+#endif
+
 void
 Client::SetExpired()
 {
@@ -29,12 +35,26 @@ Client::SetExpired()
 
 	FullyBufferedSocket::Close();
 	TimeoutMonitor::Schedule(0);
+
+#ifdef ENABLE_DATABASE
+	if (background)
+		/* the pending output of the worker can now be
+		   discarded */
+		partition.instance.client_workers->Wake();
+#endif
 }
 
 void
 Client::OnTimeout()
 {
 	if (!IsExpired()) {
+		if (background) {
+			/* not idle; a query is being executed for
+			   this client */
+			TimeoutMonitor::ScheduleSeconds(client_timeout);
+			return;
+		}
+
 		assert(!idle_waiting);
 		FormatDebug(client_domain, "[%u] timeout", num);
 	}
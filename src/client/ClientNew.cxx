@@ -20,6 +20,9 @@
 #include "config.h"
 #include "ClientInternal.hxx"
 #include "ClientList.hxx"
+#ifdef ENABLE_ZLIB
+#include "ClientCompression.hxx"
+#endif
 #include "Partition.hxx"
 #include "Instance.hxx"
 #include "system/fd_util.h"
@@ -46,12 +49,15 @@ Client::Client(EventLoop &_loop, Partition &_partition,
 	       int _fd, int _uid, int _num)
 	:FullyBufferedSocket(_fd, _loop, 16384, client_max_output_buffer_size),
 	 TimeoutMonitor(_loop),
+#ifdef ENABLE_ZLIB
+	 compression(nullptr), compress_requested(false),
+#endif
 	 partition(_partition),
 	 playlist(partition.playlist), player_control(partition.pc),
 	 permission(getDefaultPermissions()),
 	 uid(_uid),
 	 num(_num),
-	 idle_waiting(false), idle_flags(0),
+	 idle_waiting(false), background(false), idle_flags(0),
 	 num_subscriptions(0)
 {
 	TimeoutMonitor::ScheduleSeconds(client_timeout);
@@ -106,9 +112,27 @@ client_new(EventLoop &loop, Partition &partition,
 		   client->num, remote.c_str());
 }
 
+Client::~Client()
+{
+#ifdef ENABLE_ZLIB
+	delete compression;
+#endif
+
+	if (FullyBufferedSocket::IsDefined())
+		FullyBufferedSocket::Close();
+}
+
 void
 Client::Close()
 {
+	if (background) {
+		/* a ClientWorkerPool thread still uses this object;
+		   OnBackgroundFinished() will call this method
+		   again */
+		SetExpired();
+		return;
+	}
+
 	partition.instance.client_list->Remove(*this);
 
 	SetExpired();
@@ -21,6 +21,7 @@
 #include "ClientInternal.hxx"
 #include "protocol/Result.hxx"
 #include "command/AllCommands.hxx"
+#include "BulkEdit.hxx"
 #include "Log.hxx"
 #include "util/StringAPI.hxx"
 
@@ -28,28 +29,121 @@
 #define CLIENT_LIST_OK_MODE_BEGIN "command_list_ok_begin"
 #define CLIENT_LIST_MODE_END "command_list_end"
 
+/**
+ * Execute one command of a command list.
+ */
 static CommandResult
-client_process_command_list(Client &client, bool list_ok,
-			    std::list<std::string> &&list)
+client_process_list_command(Client &client, char *cmd)
+{
+	FormatDebug(client_domain, "process command \"%s\"", cmd);
+	CommandResult ret =
+		command_process(client, client.cmd_list.NextCommandNumber(),
+				cmd, false);
+	FormatDebug(client_domain, "command returned %i", int(ret));
+
+	if (ret == CommandResult::OK && !client.IsExpired() &&
+	    client.cmd_list.IsOKMode())
+		client_puts(client, "list_OK\n");
+
+	return ret;
+}
+
+static CommandResult
+client_process_command_list(Client &client, std::list<std::string> &&list)
 {
 	CommandResult ret = CommandResult::OK;
-	unsigned num = 0;
 
 	for (auto &&i : list) {
 		char *cmd = &*i.begin();
 
-		FormatDebug(client_domain, "process command \"%s\"", cmd);
-		ret = command_process(client, num++, cmd);
-		FormatDebug(client_domain, "command returned %i", int(ret));
+		ret = client_process_list_command(client, cmd);
 		if (ret != CommandResult::OK || client.IsExpired())
 			break;
-		else if (list_ok)
-			client_puts(client, "list_OK\n");
 	}
 
 	return ret;
 }
 
+/**
+ * Handle one line of a command list which is too large to be
+ * buffered: execute it right away, unless a previous command has
+ * failed.  The caller commits the queue modifications at the end of
+ * each input batch, so other clients see the progress of the list.
+ */
+static CommandResult
+client_stream_command(Client &client, char *line)
+{
+	CommandListBuilder &cmd_list = client.cmd_list;
+	CommandResult ret = CommandResult::OK;
+
+	if (!cmd_list.IsStreaming()) {
+		FormatDebug(client_domain,
+			    "[%u] command list is larger than %lu bytes, "
+			    "executing it while it is being received",
+			    client.num,
+			    (unsigned long)client_max_command_list_size);
+
+		const ScopeBulkEdit bulk_edit(client.partition);
+		ret = client_process_command_list(client,
+						  cmd_list.BeginStreaming());
+		if (ret == CommandResult::CLOSE || client.IsExpired())
+			return CommandResult::CLOSE;
+
+		if (ret != CommandResult::OK)
+			cmd_list.SetFailed();
+	}
+
+	if (cmd_list.HasFailed())
+		/* ignore the rest of the list */
+		return CommandResult::OK;
+
+	ret = client_process_list_command(client, line);
+	if (ret == CommandResult::CLOSE || client.IsExpired())
+		return CommandResult::CLOSE;
+
+	if (ret != CommandResult::OK)
+		cmd_list.SetFailed();
+
+	return CommandResult::OK;
+}
+
+/**
+ * Handle "command_list_end".
+ */
+static CommandResult
+client_finish_command_list(Client &client)
+{
+	CommandListBuilder &cmd_list = client.cmd_list;
+	CommandResult ret;
+
+	if (cmd_list.IsStreaming()) {
+		ret = cmd_list.HasFailed()
+			? CommandResult::ERROR
+			: CommandResult::OK;
+	} else {
+		FormatDebug(client_domain,
+			    "[%u] process command list",
+			    client.num);
+
+		const ScopeBulkEdit bulk_edit(client.partition);
+		ret = client_process_command_list(client,
+						  cmd_list.Commit());
+		FormatDebug(client_domain,
+			    "[%u] process command "
+			    "list returned %i", client.num, int(ret));
+
+		if (ret == CommandResult::CLOSE ||
+		    client.IsExpired())
+			return CommandResult::CLOSE;
+	}
+
+	if (ret == CommandResult::OK)
+		command_success(client);
+
+	cmd_list.Reset();
+	return ret;
+}
+
 CommandResult
 client_process_line(Client &client, char *line)
 {
@@ -77,40 +171,13 @@ client_process_line(Client &client, char *line)
 	}
 
 	if (client.cmd_list.IsActive()) {
-		if (StringIsEqual(line, CLIENT_LIST_MODE_END)) {
-			FormatDebug(client_domain,
-				    "[%u] process command list",
-				    client.num);
-
-			auto &&cmd_list = client.cmd_list.Commit();
-
-			ret = client_process_command_list(client,
-							  client.cmd_list.IsOKMode(),
-							  std::move(cmd_list));
-			FormatDebug(client_domain,
-				    "[%u] process command "
-				    "list returned %i", client.num, int(ret));
-
-			if (ret == CommandResult::CLOSE ||
-			    client.IsExpired())
-				return CommandResult::CLOSE;
-
-			if (ret == CommandResult::OK)
-				command_success(client);
-
-			client.cmd_list.Reset();
-		} else {
-			if (!client.cmd_list.Add(line)) {
-				FormatWarning(client_domain,
-					      "[%u] command list size "
-					      "is larger than the max (%lu)",
-					      client.num,
-					      (unsigned long)client_max_command_list_size);
-				return CommandResult::CLOSE;
-			}
-
+		if (StringIsEqual(line, CLIENT_LIST_MODE_END))
+			ret = client_finish_command_list(client);
+		else if (client.cmd_list.IsStreaming() ||
+			 !client.cmd_list.Add(line))
+			ret = client_stream_command(client, line);
+		else
 			ret = CommandResult::OK;
-		}
 	} else {
 		if (StringIsEqual(line, CLIENT_LIST_MODE_BEGIN)) {
 			client.cmd_list.Begin(false);
@@ -122,7 +189,7 @@ client_process_line(Client &client, char *line)
 			FormatDebug(client_domain,
 				    "[%u] process command \"%s\"",
 				    client.num, line);
-			ret = command_process(client, 0, line);
+			ret = command_process(client, 0, line, true);
 			FormatDebug(client_domain,
 				    "[%u] command returned %i",
 				    client.num, int(ret));
@@ -21,22 +21,131 @@
 #include "ClientInternal.hxx"
 #include "Partition.hxx"
 #include "Instance.hxx"
+#include "protocol/Result.hxx"
 #include "event/Loop.hxx"
+#include "BulkEdit.hxx"
 #include "util/StringUtil.hxx"
 
+#ifdef ENABLE_ZLIB
+#include "ClientCompression.hxx"
+#include "Log.hxx"
+#endif
+
+#include <assert.h>
 #include <string.h>
 
 BufferedSocket::InputResult
 Client::OnSocketInput(void *data, size_t length)
 {
+	if (background)
+		/* wait for OnBackgroundFinished() */
+		return InputResult::PAUSE;
+
+#ifdef ENABLE_ZLIB
+	if (compression != nullptr) {
+		size_t nbytes;
+		try {
+			nbytes = compression->Feed(data, length);
+		} catch (const std::exception &e) {
+			FormatError(client_domain,
+				    "[%u] malformed compressed input: %s",
+				    num, e.what());
+			Close();
+			return InputResult::CLOSED;
+		}
+
+		BufferedSocket::ConsumeInput(nbytes);
+
+		const auto result = ProcessCompressedInput();
+		if (result == InputResult::MORE && nbytes < length)
+			/* there was not enough room for all of the
+			   input */
+			return InputResult::AGAIN;
+
+		return result;
+	}
+#endif
+
+	/* the commands of a streamed command list which arrived
+	   in this batch are committed to the queue at once */
+	LazyBulkEdit bulk_edit(partition);
+
 	char *p = (char *)data;
-	char *newline = (char *)memchr(p, '\n', length);
-	if (newline == nullptr)
-		return InputResult::MORE;
+	char *const end = p + length;
+	while (true) {
+		char *newline = (char *)memchr(p, '\n', end - p);
+		if (newline == nullptr)
+			return InputResult::MORE;
 
-	TimeoutMonitor::ScheduleSeconds(client_timeout);
+		BufferedSocket::ConsumeInput(newline + 1 - p);
+
+		if (cmd_list.IsStreaming())
+			bulk_edit.Begin();
+
+		const auto result = ProcessLine(p, newline);
+		if (result != InputResult::AGAIN || !cmd_list.IsStreaming())
+			return result;
+
+		p = newline + 1;
+	}
+}
+
+#ifdef ENABLE_ZLIB
+
+void
+Client::StartCompression()
+{
+	assert(compression == nullptr);
+
+	compress_requested = false;
+
+	try {
+		compression = new ClientCompression(TimeoutMonitor::GetEventLoop(),
+						    *this);
+	} catch (const std::exception &e) {
+		FormatError(client_domain,
+			    "[%u] failed to enable compression: %s",
+			    num, e.what());
+		SetExpired();
+	}
+}
+
+BufferedSocket::InputResult
+Client::ProcessCompressedInput()
+{
+	LazyBulkEdit bulk_edit(partition);
+
+	while (true) {
+		const auto r = compression->ReadInput();
+		char *newline = (char *)memchr(r.data, '\n', r.size);
+		if (newline == nullptr) {
+			if (compression->IsInputFull()) {
+				FormatError(client_domain,
+					    "[%u] input buffer is full", num);
+				Close();
+				return InputResult::CLOSED;
+			}
+
+			return InputResult::MORE;
+		}
+
+		compression->ConsumeInput(newline + 1 - r.data);
 
-	BufferedSocket::ConsumeInput(newline + 1 - p);
+		if (cmd_list.IsStreaming())
+			bulk_edit.Begin();
+
+		const auto result = ProcessLine(r.data, newline);
+		if (result != InputResult::AGAIN)
+			return result;
+	}
+}
+
+#endif
+
+BufferedSocket::InputResult
+Client::ProcessLine(char *p, char *newline)
+{
+	TimeoutMonitor::ScheduleSeconds(client_timeout);
 
 	/* skip whitespace at the end of the line */
 	char *end = StripRight(p, newline);
@@ -51,12 +160,27 @@ Client::OnSocketInput(void *data, size_t length)
 	case CommandResult::ERROR:
 		break;
 
+	case CommandResult::BACKGROUND:
+		assert(background);
+
+		if (IsExpired()) {
+			Close();
+			return InputResult::CLOSED;
+		}
+
+		return InputResult::PAUSE;
+
 	case CommandResult::KILL:
 		Close();
 		partition.instance.event_loop->Break();
 		return InputResult::CLOSED;
 
 	case CommandResult::FINISH:
+#ifdef ENABLE_ZLIB
+		if (compression != nullptr)
+			compression->Flush();
+#endif
+
 		if (Flush())
 			Close();
 		return InputResult::CLOSED;
@@ -66,6 +190,13 @@ Client::OnSocketInput(void *data, size_t length)
 		return InputResult::CLOSED;
 	}
 
+#ifdef ENABLE_ZLIB
+	if (compress_requested)
+		/* the "OK" has been sent uncompressed; from now on,
+		   both directions are compressed */
+		StartCompression();
+#endif
+
 	if (IsExpired()) {
 		Close();
 		return InputResult::CLOSED;
@@ -73,3 +204,35 @@ Client::OnSocketInput(void *data, size_t length)
 
 	return InputResult::AGAIN;
 }
+
+void
+Client::OnBackgroundFinished(CommandResult result)
+{
+	assert(background);
+
+	background = false;
+
+	if (result == CommandResult::CLOSE || IsExpired()) {
+		Close();
+		return;
+	}
+
+	if (result == CommandResult::OK)
+		command_success(*this);
+
+	/* process the lines which were received while the command
+	   was running */
+	TimeoutMonitor::ScheduleSeconds(client_timeout);
+
+#ifdef ENABLE_ZLIB
+	if (compression != nullptr) {
+		/* lines which have been decompressed already are not
+		   seen by ResumeInput() */
+		const auto input_result = ProcessCompressedInput();
+		if (input_result != InputResult::MORE)
+			return;
+	}
+#endif
+
+	ResumeInput();
+}
@@ -0,0 +1,264 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "ClientWorker.hxx"
+#include "ClientInternal.hxx"
+#include "Response.hxx"
+#include "command/Request.hxx"
+#include "command/CommandError.hxx"
+#include "db/Interface.hxx"
+#include "thread/Name.hxx"
+#include "util/Error.hxx"
+#include "Log.hxx"
+
+#include <assert.h>
+
+ClientWorkerJob::ClientWorkerJob(ClientWorkerPool &_pool, Client &_client,
+				 unsigned _list_index, const char *_command,
+				 ClientWorkerHandler _handler, Request _args)
+	:pool(_pool), client(_client),
+	 list_index(_list_index), command(_command), handler(_handler),
+	 args(_args.begin(), _args.end()),
+	 result(CommandResult::ERROR), finished(false),
+	 overflow(false), discard(false)
+{
+}
+
+inline void
+ClientWorkerJob::Execute()
+{
+	std::vector<const char *> argv;
+	argv.reserve(args.size());
+	for (const auto &i : args)
+		argv.push_back(i.c_str());
+
+	Response r(client, list_index, this);
+	r.SetCommand(command);
+
+	/* this thread may block, so let the query wait for the
+	   database instead of failing while it is being loaded */
+	const Database *db = client.GetDatabase(IgnoreError());
+	if (db != nullptr)
+		db->WaitLoaded();
+
+	try {
+		result = handler(client, Request(argv.data(), argv.size()), r);
+	} catch (...) {
+		PrintError(r, std::current_exception());
+		result = CommandResult::ERROR;
+	}
+}
+
+inline void
+ClientWorkerJob::Submit()
+{
+	if (buffer.empty())
+		return;
+
+	if (discard) {
+		buffer.clear();
+		return;
+	}
+
+	if (output.empty())
+		output.swap(buffer);
+	else {
+		output.append(buffer);
+		buffer.clear();
+	}
+
+	if (output.length() > client_max_output_buffer_size) {
+		/* the client doesn't read fast enough; give up
+		   instead of waiting, because this thread holds the
+		   database lock */
+		std::string().swap(output);
+		overflow = discard = true;
+	}
+
+	pool.Schedule();
+}
+
+bool
+ClientWorkerJob::Write(const void *data, size_t length)
+{
+	buffer.append((const char *)data, length);
+	if (buffer.length() < ClientWorkerPool::FLUSH_SIZE)
+		return true;
+
+	const ScopeLock protect(pool.mutex);
+
+	if (pool.quit)
+		/* MPD is shutting down; nobody will read this */
+		discard = true;
+
+	Submit();
+	return !discard;
+}
+
+ClientWorkerPool::ClientWorkerPool(EventLoop &_loop)
+	:DeferredMonitor(_loop), quit(false) {}
+
+ClientWorkerPool::~ClientWorkerPool()
+{
+	mutex.lock();
+	quit = true;
+	cond.broadcast();
+	mutex.unlock();
+
+	for (auto &i : threads)
+		if (i.IsDefined())
+			i.Join();
+
+	Cancel();
+
+	for (auto i : queue)
+		delete i;
+
+	for (auto i : running)
+		delete i;
+}
+
+bool
+ClientWorkerPool::Start(Error &error)
+{
+	for (auto &i : threads)
+		if (!i.Start(Run, this, error))
+			return false;
+
+	return true;
+}
+
+void
+ClientWorkerPool::Submit(Client &client, unsigned list_index,
+			 const char *command, ClientWorkerHandler handler,
+			 Request args)
+{
+	auto *job = new ClientWorkerJob(*this, client, list_index,
+					command, handler, args);
+
+	const ScopeLock protect(mutex);
+	queue.push_back(job);
+	cond.signal();
+}
+
+inline void
+ClientWorkerPool::Run()
+{
+	SetThreadName("client_worker");
+
+	const ScopeLock protect(mutex);
+
+	while (true) {
+		if (quit)
+			break;
+
+		if (queue.empty()) {
+			cond.wait(mutex);
+			continue;
+		}
+
+		ClientWorkerJob *job = queue.front();
+		queue.pop_front();
+		running.push_back(job);
+
+		{
+			const ScopeUnlock unlock(mutex);
+			job->Execute();
+		}
+
+		job->Submit();
+		job->finished = true;
+		Schedule();
+	}
+}
+
+void
+ClientWorkerPool::Run(void *ctx)
+{
+	ClientWorkerPool &pool = *(ClientWorkerPool *)ctx;
+	pool.Run();
+}
+
+void
+ClientWorkerPool::RunDeferred()
+{
+	struct Portion {
+		ClientWorkerJob *job;
+		std::string output;
+		bool finished, overflow;
+	};
+
+	std::vector<Portion> portions;
+
+	{
+		const ScopeLock protect(mutex);
+
+		for (auto i = running.begin(); i != running.end();) {
+			ClientWorkerJob &job = **i;
+
+			if (job.client.IsExpired())
+				/* let the worker skip the rest of the
+				   response */
+				job.discard = true;
+
+			if ((job.output.empty() && !job.finished &&
+			     !job.overflow) ||
+			    (!job.output.empty() && job.client.IsCongested())) {
+				/* nothing to do, or the client hasn't
+				   received the previous portion yet; this
+				   will be called again by
+				   Client::OnSocketDrained() */
+				++i;
+				continue;
+			}
+
+			portions.push_back({&job, std::move(job.output),
+					    job.finished, job.overflow});
+			job.output.clear();
+			job.overflow = false;
+
+			if (job.finished)
+				i = running.erase(i);
+			else
+				++i;
+		}
+	}
+
+	for (auto &i : portions) {
+		ClientWorkerJob &job = *i.job;
+		job.client.Write(i.output.data(), i.output.length());
+
+		if (i.overflow && !job.client.IsExpired()) {
+			FormatError(client_domain,
+				    "[%u] output buffer is full", job.client.num);
+			job.client.SetExpired();
+		}
+
+		if (i.finished) {
+			/* the job has been removed from the "running"
+			   list; nobody else refers to it */
+			Client &client = job.client;
+			const CommandResult result = job.result;
+			delete &job;
+
+			client.OnBackgroundFinished(result);
+		}
+	}
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_CLIENT_WORKER_HXX
+#define MPD_CLIENT_WORKER_HXX
+
+#include "check.h"
+#include "command/CommandResult.hxx"
+#include "event/DeferredMonitor.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+
+class Error;
+class Client;
+class Request;
+class Response;
+
+typedef CommandResult (*ClientWorkerHandler)(Client &client, Request request,
+					     Response &response);
+
+class ClientWorkerPool;
+
+/**
+ * A command which is executed by a #ClientWorkerPool.
+ */
+class ClientWorkerJob {
+	friend class ClientWorkerPool;
+
+	ClientWorkerPool &pool;
+
+	Client &client;
+
+	/**
+	 * See Response::list_index.
+	 */
+	const unsigned list_index;
+
+	/**
+	 * The command name (from the static command table).
+	 */
+	const char *const command;
+
+	const ClientWorkerHandler handler;
+
+	/**
+	 * Copies of the arguments; the original pointers refer to
+	 * the client's input buffer, which may be overwritten while
+	 * the job runs.
+	 */
+	std::vector<std::string> args;
+
+	/**
+	 * Output which has not yet been submitted to #output.  Only
+	 * accessed by the worker thread.
+	 */
+	std::string buffer;
+
+	/**
+	 * Output waiting to be written to the socket by the main
+	 * thread.  Protected by ClientWorkerPool::mutex.
+	 */
+	std::string output;
+
+	CommandResult result;
+
+	/**
+	 * Has the worker thread finished this job?  Protected by
+	 * ClientWorkerPool::mutex.
+	 */
+	bool finished;
+
+	/**
+	 * Has #output grown beyond the client's output buffer limit?
+	 * The main thread then expires the client.  Protected by
+	 * ClientWorkerPool::mutex.
+	 */
+	bool overflow;
+
+	/**
+	 * Discard all further output, because the client has expired
+	 * or #overflow was set.  Protected by
+	 * ClientWorkerPool::mutex.
+	 */
+	bool discard;
+
+	ClientWorkerJob(ClientWorkerPool &_pool, Client &_client,
+			unsigned _list_index, const char *_command,
+			ClientWorkerHandler _handler, Request _args);
+
+	void Execute();
+
+	/**
+	 * Move #buffer to #output.  Caller must lock the pool's
+	 * mutex.
+	 */
+	void Submit();
+
+public:
+	/**
+	 * Append data to the response.  Called by Response::Write()
+	 * in the worker thread.
+	 */
+	bool Write(const void *data, size_t length);
+};
+
+/**
+ * A small pool of threads which execute database queries on behalf
+ * of clients, so a slow "listallinfo" or "search" doesn't block the
+ * main thread.  The response is collected in memory by the worker
+ * thread and passed to the main thread in portions, which writes it
+ * to the client's socket.
+ *
+ * The worker never waits for the main thread, because it holds the
+ * database lock, which the main thread may be waiting for.  Instead,
+ * a client which falls behind by more than its output buffer limit
+ * is expired.
+ *
+ * While a query is being executed, the client doesn't process more
+ * input; this preserves the order of responses.
+ */
+class ClientWorkerPool final : DeferredMonitor {
+	friend class ClientWorkerJob;
+
+	static constexpr unsigned N_THREADS = 2;
+
+	/**
+	 * Pass the output to the main thread when the worker has
+	 * collected this many bytes.
+	 */
+	static constexpr size_t FLUSH_SIZE = 16384;
+
+	Mutex mutex;
+
+	/**
+	 * Signalled when a new job is queued, or when the pool shall
+	 * quit.
+	 */
+	Cond cond;
+
+	/**
+	 * Jobs which have not yet been started.
+	 */
+	std::list<ClientWorkerJob *> queue;
+
+	/**
+	 * Jobs which have been started, but have not yet been
+	 * completed by the main thread.
+	 */
+	std::list<ClientWorkerJob *> running;
+
+	bool quit;
+
+	Thread threads[N_THREADS];
+
+public:
+	explicit ClientWorkerPool(EventLoop &_loop);
+
+	/**
+	 * Waits for the running jobs and discards all pending ones.
+	 * Must be called before the clients are deleted.
+	 */
+	~ClientWorkerPool();
+
+	ClientWorkerPool(const ClientWorkerPool &) = delete;
+	ClientWorkerPool &operator=(const ClientWorkerPool &) = delete;
+
+	bool Start(Error &error);
+
+	/**
+	 * Submit a command to the pool.  When it finishes, the main
+	 * thread calls Client::OnBackgroundFinished().
+	 */
+	void Submit(Client &client, unsigned list_index,
+		    const char *command, ClientWorkerHandler handler,
+		    Request args);
+
+	/**
+	 * A client's socket is ready for more output, or the client
+	 * has expired.  Check the running jobs again.
+	 */
+	void Wake() {
+		DeferredMonitor::Schedule();
+	}
+
+private:
+	void Run();
+	static void Run(void *ctx);
+
+	/* virtual methods from class DeferredMonitor */
+	void RunDeferred() override;
+};
+
+#endif
@@ -21,15 +21,43 @@
 #include "Client.hxx"
 #include "util/FormatString.hxx"
 
+#ifdef ENABLE_ZLIB
+#include "ClientCompression.hxx"
+#include "Log.hxx"
+#endif
+
 #include <string.h>
 
 bool
-Client::Write(const void *data, size_t length)
+Client::WriteRaw(const void *data, size_t length)
 {
 	/* if the client is going to be closed, do nothing */
 	return !IsExpired() && FullyBufferedSocket::Write(data, length);
 }
 
+bool
+Client::Write(const void *data, size_t length)
+{
+#ifdef ENABLE_ZLIB
+	if (compression != nullptr) {
+		if (IsExpired())
+			return false;
+
+		try {
+			compression->Write(data, length);
+		} catch (const std::exception &e) {
+			LogError(e);
+			SetExpired();
+			return false;
+		}
+
+		return !IsExpired();
+	}
+#endif
+
+	return WriteRaw(data, length);
+}
+
 void
 client_puts(Client &client, const char *s)
 {
@@ -20,6 +20,7 @@
 #include "config.h"
 #include "Response.hxx"
 #include "Client.hxx"
+#include "ClientWorker.hxx"
 #include "util/FormatString.hxx"
 
 #include <string.h>
@@ -27,6 +28,9 @@
 bool
 Response::Write(const void *data, size_t length)
 {
+	if (job != nullptr)
+		return job->Write(data, length);
+
 	return client.Write(data, length);
 }
 
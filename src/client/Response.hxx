@@ -27,6 +27,7 @@
 #include <stdarg.h>
 
 class Client;
+class ClientWorkerJob;
 
 class Response {
 	Client &client;
@@ -42,9 +43,18 @@ class Response {
 	 */
 	const char *command;
 
+	/**
+	 * If not nullptr, then the command is being executed by a
+	 * #ClientWorkerPool thread, and the output is collected
+	 * there instead of being written to the client.
+	 */
+	ClientWorkerJob *const job;
+
 public:
-	Response(Client &_client, unsigned _list_index)
-		:client(_client), list_index(_list_index), command("") {}
+	Response(Client &_client, unsigned _list_index,
+		 ClientWorkerJob *_job=nullptr)
+		:client(_client), list_index(_list_index), command(""),
+		 job(_job) {}
 
 	Response(const Response &) = delete;
 	Response &operator=(const Response &) = delete;
@@ -35,6 +35,7 @@
 #include "Permission.hxx"
 #include "tag/TagType.h"
 #include "Partition.hxx"
+#include "Instance.hxx"
 #include "client/Client.hxx"
 #include "client/Response.hxx"
 #include "util/Macros.hxx"
@@ -48,6 +49,10 @@
 #include "sticker/StickerDatabase.hxx"
 #endif
 
+#ifdef ENABLE_DATABASE
+#include "client/ClientWorker.hxx"
+#endif
+
 #include <assert.h>
 #include <string.h>
 
@@ -90,6 +95,9 @@ static constexpr struct command commands[] = {
 	{ "cleartagid", PERMISSION_ADD, 1, 2, handle_cleartagid },
 	{ "close", PERMISSION_NONE, -1, -1, handle_close },
 	{ "commands", PERMISSION_NONE, 0, 0, handle_commands },
+#ifdef ENABLE_ZLIB
+	{ "compress", PERMISSION_NONE, 1, 1, handle_compress },
+#endif
 	{ "config", PERMISSION_ADMIN, 0, 0, handle_config },
 	{ "consume", PERMISSION_CONTROL, 1, 1, handle_consume },
 #ifdef ENABLE_DATABASE
@@ -125,6 +133,7 @@ static constexpr struct command commands[] = {
 	{ "listplaylists", PERMISSION_READ, 0, 0, handle_listplaylists },
 	{ "load", PERMISSION_ADD, 1, 2, handle_load },
 	{ "lsinfo", PERMISSION_READ, 0, 1, handle_lsinfo },
+	{ "memory", PERMISSION_READ, 0, 0, handle_memory },
 	{ "mixrampdb", PERMISSION_CONTROL, 1, 1, handle_mixrampdb },
 	{ "mixrampdelay", PERMISSION_CONTROL, 1, 1, handle_mixrampdelay },
 #ifdef ENABLE_DATABASE
@@ -306,6 +315,28 @@ command_lookup(const char *name)
 	return nullptr;
 }
 
+#ifdef ENABLE_DATABASE
+
+/**
+ * May this command be executed by a #ClientWorkerPool thread?  This
+ * is only allowed for commands which read the database and write a
+ * response, without touching the queue, the player or any other
+ * state owned by the main thread.
+ */
+gcc_pure
+static bool
+command_is_background(const struct command &cmd)
+{
+	return cmd.handler == handle_count ||
+		cmd.handler == handle_find ||
+		cmd.handler == handle_list ||
+		cmd.handler == handle_listall ||
+		cmd.handler == handle_listallinfo ||
+		cmd.handler == handle_search;
+}
+
+#endif
+
 static bool
 command_check_request(const struct command *cmd, Response &r,
 		      unsigned permission, Request args)
@@ -360,7 +391,7 @@ command_checked_lookup(Response &r, unsigned permission,
 }
 
 CommandResult
-command_process(Client &client, unsigned num, char *line)
+command_process(Client &client, unsigned num, char *line, bool background)
 try {
 	Response r(client, num);
 	Error error;
@@ -411,11 +442,23 @@ try {
 		command_checked_lookup(r, client.GetPermission(),
 				       cmd_name, args);
 
-	CommandResult ret = cmd
-		? cmd->handler(client, args, r)
-		: CommandResult::ERROR;
+	if (cmd == nullptr)
+		return CommandResult::ERROR;
+
+#ifdef ENABLE_DATABASE
+	ClientWorkerPool *const workers =
+		client.partition.instance.client_workers;
+	if (background && workers != nullptr &&
+	    command_is_background(*cmd)) {
+		client.background = true;
+		workers->Submit(client, num, cmd->cmd, cmd->handler, args);
+		return CommandResult::BACKGROUND;
+	}
+#else
+	(void)background;
+#endif
 
-	return ret;
+	return cmd->handler(client, args, r);
 } catch (const std::exception &e) {
 	Response r(client, num);
 	PrintError(r, std::current_exception());
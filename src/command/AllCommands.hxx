@@ -30,7 +30,14 @@ command_init();
 void
 command_finish();
 
+/**
+ * Parse and execute a command line.
+ *
+ * @param background may the command be submitted to the
+ * #ClientWorkerPool?  If it was, CommandResult::BACKGROUND is
+ * returned
+ */
 CommandResult
-command_process(Client &client, unsigned num, char *line);
+command_process(Client &client, unsigned num, char *line, bool background);
 
 #endif
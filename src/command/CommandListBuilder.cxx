@@ -28,6 +28,7 @@ CommandListBuilder::Reset()
 {
 	list.clear();
 	mode = Mode::DISABLED;
+	streaming = false;
 }
 
 bool
@@ -56,9 +56,28 @@ class CommandListBuilder {
 	 */
 	size_t size;
 
+	/**
+	 * The list has become too large to be buffered, and each
+	 * command is now executed as soon as it is received.  See
+	 * BeginStreaming().
+	 */
+	bool streaming;
+
+	/**
+	 * In streaming mode: a command has failed, and all further
+	 * commands until "command_list_end" are ignored.
+	 */
+	bool failed;
+
+	/**
+	 * The number of commands executed so far; this is the
+	 * "command_listNum" in the next error response.
+	 */
+	unsigned n_executed;
+
 public:
 	CommandListBuilder()
-		:mode(Mode::DISABLED) {}
+		:mode(Mode::DISABLED), streaming(false) {}
 
 	/**
 	 * Is a command list currently being built?
@@ -90,6 +109,50 @@ public:
 
 		mode = (Mode)ok;
 		size = 0;
+		streaming = false;
+		failed = false;
+		n_executed = 0;
+	}
+
+	/**
+	 * Is the list being executed while it is received?
+	 */
+	bool IsStreaming() const {
+		return streaming;
+	}
+
+	/**
+	 * Switch to streaming mode, because Add() has failed.  The
+	 * caller is responsible for executing the commands which
+	 * have been buffered so far; they are returned.
+	 */
+	std::list<std::string> BeginStreaming() {
+		assert(IsActive());
+		assert(!streaming);
+
+		streaming = true;
+		return std::move(list);
+	}
+
+	bool HasFailed() const {
+		assert(streaming);
+
+		return failed;
+	}
+
+	void SetFailed() {
+		assert(streaming);
+
+		failed = true;
+	}
+
+	/**
+	 * Allocate the number of the next command being executed.
+	 */
+	unsigned NextCommandNumber() {
+		assert(IsActive());
+
+		return n_executed++;
 	}
 
 	/**
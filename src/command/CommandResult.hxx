@@ -47,6 +47,13 @@ enum class CommandResult {
 	 */
 	ERROR,
 
+	/**
+	 * The command has been submitted to the #ClientWorkerPool.
+	 * The response will be sent when it has finished; until
+	 * then, the client must not process more input.
+	 */
+	BACKGROUND,
+
 	/**
 	 * The client has asked MPD to close the connection.  MPD will
 	 * flush the remaining output buffer first.
@@ -110,6 +110,34 @@ handle_close(gcc_unused Client &client, gcc_unused Request args,
 	return CommandResult::FINISH;
 }
 
+#ifdef ENABLE_ZLIB
+
+CommandResult
+handle_compress(Client &client, Request args, Response &r)
+{
+	if (!StringIsEqual(args.front(), "gzip")) {
+		r.FormatError(ACK_ERROR_ARG,
+			      "Unsupported compression: %s", args.front());
+		return CommandResult::ERROR;
+	}
+
+	if (client.cmd_list.IsActive()) {
+		r.Error(ACK_ERROR_ARG,
+			"Not allowed in a command list");
+		return CommandResult::ERROR;
+	}
+
+	if (client.IsCompressed()) {
+		r.Error(ACK_ERROR_ARG, "Already compressed");
+		return CommandResult::ERROR;
+	}
+
+	client.RequestCompression();
+	return CommandResult::OK;
+}
+
+#endif
+
 static void
 print_tag(TagType type, const char *value, void *ctx)
 {
@@ -397,6 +425,14 @@ handle_stats(Client &client, gcc_unused Request args, Response &r)
 	return CommandResult::OK;
 }
 
+CommandResult
+handle_memory(gcc_unused Client &client, gcc_unused Request args,
+	      Response &r)
+{
+	memory_print(r);
+	return CommandResult::OK;
+}
+
 CommandResult
 handle_ping(gcc_unused Client &client, gcc_unused Request args,
 	    gcc_unused Response &r)
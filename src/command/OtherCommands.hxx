@@ -41,6 +41,11 @@ handle_kill(Client &client, Request request, Response &response);
 CommandResult
 handle_close(Client &client, Request request, Response &response);
 
+#ifdef ENABLE_ZLIB
+CommandResult
+handle_compress(Client &client, Request request, Response &response);
+#endif
+
 CommandResult
 handle_listfiles(Client &client, Request request, Response &response);
 
@@ -62,6 +67,9 @@ handle_volume(Client &client, Request request, Response &response);
 CommandResult
 handle_stats(Client &client, Request request, Response &response);
 
+CommandResult
+handle_memory(Client &client, Request request, Response &response);
+
 CommandResult
 handle_ping(Client &client, Request request, Response &response);
 
@@ -35,16 +35,21 @@ enum class ConfigOption {
 	FOLLOW_OUTSIDE_SYMLINKS,
 	DB_FILE,
 	STICKER_FILE,
+	SEEK_CACHE_DIR,
 	LOG_FILE,
 	PID_FILE,
 	STATE_FILE,
 	STATE_FILE_INTERVAL,
+	STATE_FILE_QUEUE_SNAPSHOT,
 	RESTORE_PAUSED,
 	USER,
 	GROUP,
 	BIND_TO_ADDRESS,
 	PORT,
 	LOG_LEVEL,
+	LOG_ASYNC,
+	LOG_OVERFLOW,
+	LOG_RATE_LIMIT,
 	ZEROCONF_NAME,
 	ZEROCONF_ENABLED,
 	PASSWORD,
@@ -57,8 +62,10 @@ enum class ConfigOption {
 	REPLAYGAIN_LIMIT,
 	VOLUME_NORMALIZATION,
 	SAMPLERATE_CONVERTER,
+	DSD_FILTER,
 	AUDIO_BUFFER_SIZE,
 	BUFFER_BEFORE_PLAY,
+	SEEK_HISTORY,
 	HTTP_PROXY_HOST,
 	HTTP_PROXY_PORT,
 	HTTP_PROXY_USER,
@@ -75,6 +82,7 @@ enum class ConfigOption {
 	GAPLESS_MP3_PLAYBACK,
 	AUTO_UPDATE,
 	AUTO_UPDATE_DEPTH,
+	ANALYZE_LOUDNESS,
 	DESPOTIFY_USER,
 	DESPOTIFY_PASSWORD,
 	DESPOTIFY_HIGH_BITRATE,
@@ -30,16 +30,21 @@ const ConfigTemplate config_param_templates[] = {
 	{ "follow_outside_symlinks" },
 	{ "db_file" },
 	{ "sticker_file" },
+	{ "seek_cache_directory" },
 	{ "log_file" },
 	{ "pid_file" },
 	{ "state_file" },
 	{ "state_file_interval" },
+	{ "state_file_queue_snapshot" },
 	{ "restore_paused" },
 	{ "user" },
 	{ "group" },
 	{ "bind_to_address", true },
 	{ "port" },
 	{ "log_level" },
+	{ "log_async" },
+	{ "log_overflow" },
+	{ "log_rate_limit" },
 	{ "zeroconf_name" },
 	{ "zeroconf_enabled" },
 	{ "password", true },
@@ -52,8 +57,10 @@ const ConfigTemplate config_param_templates[] = {
 	{ "replaygain_limit" },
 	{ "volume_normalization" },
 	{ "samplerate_converter" },
+	{ "dsd_filter" },
 	{ "audio_buffer_size" },
 	{ "buffer_before_play" },
+	{ "seek_history" },
 	{ "http_proxy_host", false, true },
 	{ "http_proxy_port", false, true },
 	{ "http_proxy_user", false, true },
@@ -70,6 +77,7 @@ const ConfigTemplate config_param_templates[] = {
 	{ "gapless_mp3_playback" },
 	{ "auto_update" },
 	{ "auto_update_depth" },
+	{ "analyze_loudness" },
 	{ "despotify_user", false, true },
 	{ "despotify_password", false, true },
 	{ "despotify_high_bitrate", false, true },
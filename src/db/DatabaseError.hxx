@@ -34,6 +34,12 @@ enum class DatabaseErrorCode {
 	NOT_FOUND,
 
 	CONFLICT,
+
+	/**
+	 * The database is still being loaded from disk, and the
+	 * operation cannot wait for it.
+	 */
+	LOADING,
 };
 
 class DatabaseError final : public std::runtime_error {
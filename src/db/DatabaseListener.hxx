@@ -36,6 +36,24 @@ public:
 	 */
 	virtual void OnDatabaseModified() = 0;
 
+	/**
+	 * Open() has finished loading the database in the
+	 * background.  Called in the same thread as
+	 * OnDatabaseModified().
+	 *
+	 * @param success false if the database file could not be
+	 * loaded; the database is empty
+	 */
+	virtual void OnDatabaseLoaded(bool success) = 0;
+
+	/**
+	 * The loudness analysis has stored new results in the
+	 * database.  They are not visible to clients, so this is not
+	 * a modification.  Called in the same thread as
+	 * OnDatabaseModified().
+	 */
+	virtual void OnDatabaseAnalyzed() = 0;
+
 	/**
 	 * During database update, a song is about to be removed from
 	 * the database because the file has disappeared.
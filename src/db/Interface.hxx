@@ -65,6 +65,22 @@ public:
 	 */
 	virtual void Close() {}
 
+	/**
+	 * Is the database still being loaded by Open() in the
+	 * background?  Until it is finished, queries from the main
+	 * thread fail with DatabaseErrorCode::LOADING.
+	 */
+	gcc_pure
+	virtual bool IsLoading() const {
+		return false;
+	}
+
+	/**
+	 * Wait until the database has finished loading.  Must not be
+	 * called from the main thread.
+	 */
+	virtual void WaitLoaded() const {}
+
 	/**
          * Look up a song (including tag data) in the database.  When
          * you don't need this anymore, call ReturnSong().
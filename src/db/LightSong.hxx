@@ -28,6 +28,7 @@
 #include <time.h>
 
 struct Tag;
+struct SongAnalysis;
 
 /**
  * A reference to a song file.  Unlike the other "Song" classes in the
@@ -75,6 +76,12 @@ struct LightSong {
 	 */
 	SongTime end_time;
 
+	/**
+	 * The results of the loudness analysis; nullptr if not
+	 * available.
+	 */
+	const SongAnalysis *analysis;
+
 	gcc_pure
 	std::string GetURI() const {
 		if (directory == nullptr)
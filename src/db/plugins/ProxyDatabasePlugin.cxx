@@ -194,6 +194,7 @@ ProxySong::ProxySong(const mpd_song *song)
 	uri = mpd_song_get_uri(song);
 	real_uri = nullptr;
 	tag = &tag2;
+	analysis = nullptr;
 	mtime = mpd_song_get_last_modified(song);
 
 #if LIBMPDCLIENT_CHECK_VERSION(2,3,0)
@@ -29,6 +29,7 @@
 #include "tag/Settings.hxx"
 #include "fs/Charset.hxx"
 #include "util/StringCompare.hxx"
+#include "util/NumberParser.hxx"
 #include "util/Error.hxx"
 #include "Log.hxx"
 
@@ -41,8 +42,9 @@
 #define DIRECTORY_MPD_VERSION "mpd_version: "
 #define DIRECTORY_FS_CHARSET "fs_charset: "
 #define DB_TAG_PREFIX "tag: "
+#define JOURNAL_BASE "journal_base: "
 
-static constexpr unsigned DB_FORMAT = 2;
+static constexpr unsigned DB_FORMAT = 3;
 
 /**
  * The oldest database format understood by this MPD version.
@@ -154,3 +156,61 @@ db_load_internal(TextFile &file, Directory &music_root, Error &error)
 	const ScopeDatabaseLock protect;
 	return directory_load(file, music_root, error);
 }
+
+void
+db_journal_save_header(BufferedOutputStream &os,
+		       time_t base_mtime, uint64_t base_size)
+{
+	os.Format(JOURNAL_BASE "%lu %llu\n",
+		  (unsigned long)base_mtime, (unsigned long long)base_size);
+}
+
+void
+db_journal_save(BufferedOutputStream &os, Directory &directory)
+{
+	if (directory.dirty) {
+		directory_save_record(os, directory);
+		directory.dirty = false;
+	}
+
+	for (auto &child : directory.children)
+		db_journal_save(os, child);
+}
+
+bool
+db_journal_load(TextFile &file, Directory &root,
+		time_t base_mtime, uint64_t base_size,
+		Error &error)
+{
+	const char *line = file.ReadLine();
+	const char *p;
+	if (line == nullptr ||
+	    (p = StringAfterPrefix(line, JOURNAL_BASE)) == nullptr) {
+		error.Set(db_domain, "Journal corrupted");
+		return false;
+	}
+
+	char *endptr;
+	const time_t mtime = ParseUint64(p, &endptr);
+	const uint64_t size = ParseUint64(endptr);
+	if (mtime != base_mtime || size != base_size) {
+		error.Set(db_domain,
+			  "Journal does not belong to the database file");
+		return false;
+	}
+
+	const ScopeDatabaseLock protect;
+
+	while ((line = file.ReadLine()) != nullptr) {
+		if ((p = StringAfterPrefix(line,
+					   DIRECTORY_RECORD_BEGIN)) == nullptr) {
+			error.Format(db_domain, "Malformed line: %s", line);
+			return false;
+		}
+
+		if (!directory_load_record(file, root, p, error))
+			return false;
+	}
+
+	return true;
+}
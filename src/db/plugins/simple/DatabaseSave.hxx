@@ -20,6 +20,9 @@
 #ifndef MPD_DATABASE_SAVE_HXX
 #define MPD_DATABASE_SAVE_HXX
 
+#include <stdint.h>
+#include <time.h>
+
 struct Directory;
 class BufferedOutputStream;
 class TextFile;
@@ -31,4 +34,32 @@ db_save_internal(BufferedOutputStream &os, const Directory &root);
 bool
 db_load_internal(TextFile &file, Directory &root, Error &error);
 
+/**
+ * Write the header of a new journal file.
+ *
+ * @param base_mtime the modification time of the database file
+ * this journal belongs to
+ * @param base_size the size of the database file
+ */
+void
+db_journal_save_header(BufferedOutputStream &os,
+		       time_t base_mtime, uint64_t base_size);
+
+/**
+ * Write a journal record for each dirty directory and clear the
+ * "dirty" flags.
+ */
+void
+db_journal_save(BufferedOutputStream &os, Directory &root);
+
+/**
+ * Replay a journal file.  Fails if the journal does not belong to
+ * the given database file.  If a record is broken, the records before
+ * it remain applied.
+ */
+bool
+db_journal_load(TextFile &file, Directory &root,
+		time_t base_mtime, uint64_t base_size,
+		Error &error);
+
 #endif
@@ -30,27 +30,103 @@
 #include "SongFilter.hxx"
 #include "lib/icu/Collate.hxx"
 #include "fs/Traits.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
 #include "util/Alloc.hxx"
+#include "util/SlabAllocator.hxx"
 #include "util/DeleteDisposer.hxx"
 #include "util/Error.hxx"
 
+#include <unordered_map>
+
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
 
+/**
+ * FNV-1a hash of a null-terminated string.
+ */
+struct CStringHash {
+	gcc_pure
+	size_t operator()(const char *p) const {
+		size_t hash = 2166136261u;
+		while (*p != 0)
+			hash = (hash ^ (unsigned char)*p++) * 16777619u;
+		return hash;
+	}
+};
+
+struct CStringEqual {
+	gcc_pure
+	bool operator()(const char *a, const char *b) const {
+		return strcmp(a, b) == 0;
+	}
+};
+
+/**
+ * The keys point to Directory::path (the base name portion), which
+ * lives as long as the child.
+ */
+struct Directory::ChildIndex
+	: std::unordered_map<const char *, Directory *,
+			     CStringHash, CStringEqual> {};
+
+/**
+ * The keys point to Song::uri.
+ */
+struct Directory::SongIndex
+	: std::unordered_map<const char *, Song *,
+			     CStringHash, CStringEqual> {};
+
+static Mutex directory_allocator_mutex;
+static SlabAllocator directory_allocator;
+
+void *
+Directory::operator new(size_t size)
+{
+	const ScopeLock protect(directory_allocator_mutex);
+	return directory_allocator.Allocate(size);
+}
+
+void
+Directory::operator delete(void *p, size_t size)
+{
+	const ScopeLock protect(directory_allocator_mutex);
+	directory_allocator.Free(p, size);
+}
+
+SlabAllocatorStats
+Directory::GetMemoryStats()
+{
+	const ScopeLock protect(directory_allocator_mutex);
+	return directory_allocator.GetStats();
+}
+
 Directory::Directory(std::string &&_path_utf8, Directory *_parent)
 	:parent(_parent),
 	 mtime(0),
 	 inode(0), device(0),
 	 path(std::move(_path_utf8)),
-	 mounted_database(nullptr)
+	 mounted_database(nullptr), mount_users(0),
+	 dirty(true),
+	 child_index(nullptr), song_index(nullptr)
 {
 }
 
+/**
+ * Signalled when Directory::mount_users drops to zero.
+ */
+static Cond mount_cond;
+
 Directory::~Directory()
 {
+	assert(mount_users == 0);
+
 	delete mounted_database;
 
+	delete child_index;
+	delete song_index;
+
 	songs.clear_and_dispose(Song::Disposer());
 	children.clear_and_dispose(DeleteDisposer());
 }
@@ -61,6 +137,8 @@ Directory::Delete()
 	assert(holding_db_lock());
 	assert(parent != nullptr);
 
+	parent->MarkDirty();
+	parent->UnindexChild(*this);
 	parent->children.erase_and_dispose(parent->children.iterator_to(*this),
 					   DeleteDisposer());
 }
@@ -86,19 +164,63 @@ Directory::CreateChild(const char *name_utf8)
 
 	Directory *child = new Directory(std::move(path_utf8), this);
 	children.push_back(*child);
+	if (child_index != nullptr)
+		child_index->emplace(child->GetName(), child);
+	MarkDirty();
 	return child;
 }
 
+void
+Directory::BuildChildIndex() const
+{
+	assert(child_index == nullptr);
+
+	child_index = new ChildIndex();
+	for (const auto &child : children)
+		child_index->emplace(child.GetName(),
+				     const_cast<Directory *>(&child));
+}
+
+void
+Directory::UnindexChild(const Directory &child)
+{
+	if (child_index == nullptr)
+		return;
+
+	auto i = child_index->find(child.GetName());
+	if (i != child_index->end() && i->second == &child)
+		child_index->erase(i);
+}
+
 const Directory *
 Directory::FindChild(const char *name) const
 {
 	assert(holding_db_lock());
 
-	for (const auto &child : children)
-		if (strcmp(child.GetName(), name) == 0)
-			return &child;
+	if (child_index != nullptr) {
+		auto i = child_index->find(name);
+		return i != child_index->end()
+			? i->second
+			: nullptr;
+	}
+
+	const Directory *found = nullptr;
+	unsigned n = 0;
+	for (const auto &child : children) {
+		if (strcmp(child.GetName(), name) == 0) {
+			found = &child;
+			break;
+		}
+
+		++n;
+	}
 
-	return nullptr;
+	if (n > INDEX_THRESHOLD)
+		/* this directory is large; the next lookup will use
+		   a hash table */
+		BuildChildIndex();
+
+	return found;
 }
 
 void
@@ -110,10 +232,12 @@ Directory::PruneEmpty()
 	     child != end;) {
 		child->PruneEmpty();
 
-		if (child->IsEmpty())
+		if (child->IsEmpty()) {
+			UnindexChild(*child);
 			child = children.erase_and_dispose(child,
 							   DeleteDisposer());
-		else
+			MarkDirty();
+		} else
 			++child;
 	}
 }
@@ -171,6 +295,9 @@ Directory::AddSong(Song *song)
 	assert(song->parent == this);
 
 	songs.push_back(*song);
+	if (song_index != nullptr)
+		song_index->emplace(song->uri, song);
+	MarkDirty();
 }
 
 void
@@ -180,7 +307,36 @@ Directory::RemoveSong(Song *song)
 	assert(song != nullptr);
 	assert(song->parent == this);
 
+	if (song_index != nullptr) {
+		auto i = song_index->find(song->uri);
+		if (i != song_index->end() && i->second == song)
+			song_index->erase(i);
+	}
+
 	songs.erase(songs.iterator_to(*song));
+	MarkDirty();
+}
+
+void
+Directory::ClearSongs()
+{
+	assert(holding_db_lock());
+
+	delete song_index;
+	song_index = nullptr;
+
+	songs.clear_and_dispose(Song::Disposer());
+	MarkDirty();
+}
+
+void
+Directory::BuildSongIndex() const
+{
+	assert(song_index == nullptr);
+
+	song_index = new SongIndex();
+	for (const auto &song : songs)
+		song_index->emplace(song.uri, const_cast<Song *>(&song));
 }
 
 const Song *
@@ -189,14 +345,32 @@ Directory::FindSong(const char *name_utf8) const
 	assert(holding_db_lock());
 	assert(name_utf8 != nullptr);
 
+	if (song_index != nullptr) {
+		auto i = song_index->find(name_utf8);
+		return i != song_index->end()
+			? i->second
+			: nullptr;
+	}
+
+	const Song *found = nullptr;
+	unsigned n = 0;
 	for (auto &song : songs) {
 		assert(song.parent == this);
 
-		if (strcmp(song.uri, name_utf8) == 0)
-			return &song;
+		if (strcmp(song.uri, name_utf8) == 0) {
+			found = &song;
+			break;
+		}
+
+		++n;
 	}
 
-	return nullptr;
+	if (n > INDEX_THRESHOLD)
+		/* this directory is large; the next lookup will use
+		   a hash table */
+		BuildSongIndex();
+
+	return found;
 }
 
 gcc_pure
@@ -211,13 +385,60 @@ Directory::Sort()
 {
 	assert(holding_db_lock());
 
-	children.sort(directory_cmp);
-	song_list_sort(songs);
+	if (dirty) {
+		children.sort(directory_cmp);
+		song_list_sort(songs);
+	}
 
 	for (auto &child : children)
 		child.Sort();
 }
 
+void
+Directory::ClearDirty()
+{
+	dirty = false;
+
+	for (auto &child : children)
+		child.ClearDirty();
+}
+
+/**
+ * Announces a Walk() into Directory::mounted_database while in
+ * scope.  The #db_mutex must be locked during construction and
+ * destruction.
+ */
+class ScopeMountUser {
+	const Directory &directory;
+
+public:
+	explicit ScopeMountUser(const Directory &_directory)
+		:directory(_directory) {
+		++directory.mount_users;
+	}
+
+	~ScopeMountUser() {
+		if (--directory.mount_users == 0)
+			mount_cond.broadcast();
+	}
+};
+
+void
+Directory::WaitMountUnused() const
+{
+	assert(holding_db_lock());
+
+	while (mount_users > 0) {
+#ifndef NDEBUG
+		db_mutex_holder = ThreadId::Null();
+#endif
+		mount_cond.wait(db_mutex);
+#ifndef NDEBUG
+		db_mutex_holder = ThreadId::GetCurrent();
+#endif
+	}
+}
+
 bool
 Directory::Walk(bool recursive, const SongFilter *filter,
 		VisitDirectory visit_directory, VisitSong visit_song,
@@ -232,6 +453,7 @@ Directory::Walk(bool recursive, const SongFilter *filter,
 		/* TODO: eliminate this unlock/lock; it is necessary
 		   because the child's SimpleDatabasePlugin::Visit()
 		   call will lock it again */
+		const ScopeMountUser user(*this);
 		const ScopeDatabaseUnlock unlock;
 		return WalkMount(GetPath(), *mounted_database,
 				 recursive, filter,
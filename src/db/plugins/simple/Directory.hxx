@@ -44,11 +44,21 @@ static constexpr unsigned DEVICE_INARCHIVE = -1;
 static constexpr unsigned DEVICE_CONTAINER = -2;
 
 struct db_visitor;
+struct SlabAllocatorStats;
 class SongFilter;
 class Error;
 class Database;
 
 struct Directory {
+	/**
+	 * Build a hash index of #children or #songs when a lookup has
+	 * to scan more than this number of entries.
+	 */
+	static constexpr unsigned INDEX_THRESHOLD = 32;
+
+	struct ChildIndex;
+	struct SongIndex;
+
 	static constexpr auto link_mode = boost::intrusive::normal_link;
 	typedef boost::intrusive::link_mode<link_mode> LinkMode;
 	typedef boost::intrusive::list_member_hook<LinkMode> Hook;
@@ -98,10 +108,58 @@ struct Directory {
 	 */
 	Database *mounted_database;
 
+	/**
+	 * The number of Walk() calls which have unlocked the
+	 * #db_mutex to visit #mounted_database.  While this is
+	 * non-zero, the #Database must not be unmounted.
+	 *
+	 * This attribute is protected with the global #db_mutex.
+	 */
+	mutable unsigned mount_users;
+	friend class ScopeMountUser;
+
+	/**
+	 * Has this directory been modified since the database was
+	 * saved?  This includes its attributes, its songs, its
+	 * playlists and the list of child directory names, but not
+	 * the contents of child directories.  It is used to sort only
+	 * modified directories, and to write only those to the
+	 * database journal.
+	 *
+	 * This attribute is protected with the global #db_mutex.
+	 * Read access in the update thread does not need protection.
+	 */
+	bool dirty;
+
+	/**
+	 * Hash indexes of #children (by base name) and #songs (by
+	 * file name).  They are created by FindChild() and
+	 * FindSong() when a directory becomes large (see
+	 * #INDEX_THRESHOLD), and are then kept up to date by all
+	 * methods which add or remove entries.
+	 *
+	 * These attributes are protected with the global #db_mutex.
+	 */
+	mutable ChildIndex *child_index;
+	mutable SongIndex *song_index;
+
 public:
 	Directory(std::string &&_path_utf8, Directory *_parent);
 	~Directory();
 
+	/**
+	 * #Directory objects are allocated from a #SlabAllocator.
+	 */
+	static void *operator new(size_t size);
+	static void operator delete(void *p, size_t size);
+
+	/**
+	 * Returns statistics about the memory used by all #Directory
+	 * objects (not including their paths and playlists).
+	 */
+	gcc_pure
+	static SlabAllocatorStats GetMemoryStats();
+
 	/**
 	 * Create a new root #Directory object.
 	 */
@@ -114,6 +172,24 @@ public:
 		return mounted_database != nullptr;
 	}
 
+	/**
+	 * Wait until no other thread visits #mounted_database.  This
+	 * must be called before unmounting it.
+	 *
+	 * Caller must lock the #db_mutex.
+	 */
+	void WaitMountUnused() const;
+
+	void MarkDirty() {
+		dirty = true;
+	}
+
+	/**
+	 * Clear the #dirty flag of this directory and all of its
+	 * descendants.
+	 */
+	void ClearDirty();
+
 	/**
 	 * Remove this #Directory object from its parent and free it.  This
 	 * must not be called with the root Directory.
@@ -134,11 +210,11 @@ public:
 
 	/**
 	 * Caller must lock the #db_mutex.
+	 *
+	 * This is not "pure": it may create #child_index.
 	 */
-	gcc_pure
 	const Directory *FindChild(const char *name) const;
 
-	gcc_pure
 	Directory *FindChild(const char *name) {
 		const Directory *cthis = this;
 		return const_cast<Directory *>(cthis->FindChild(name));
@@ -178,7 +254,6 @@ public:
 	 * @param uri the relative URI
 	 * @return the Directory, or nullptr if none was found
 	 */
-	gcc_pure
 	LookupResult LookupDirectory(const char *uri);
 
 	gcc_pure
@@ -229,11 +304,11 @@ public:
 	 * Look up a song in this directory by its name.
 	 *
 	 * Caller must lock the #db_mutex.
+	 *
+	 * This is not "pure": it may create #song_index.
 	 */
-	gcc_pure
 	const Song *FindSong(const char *name_utf8) const;
 
-	gcc_pure
 	Song *FindSong(const char *name_utf8) {
 		const Directory *cthis = this;
 		return const_cast<Song *>(cthis->FindSong(name_utf8));
@@ -252,13 +327,22 @@ public:
 	 */
 	void RemoveSong(Song *song);
 
+	/**
+	 * Remove and free all songs of this directory.
+	 *
+	 * Caller must lock the #db_mutex.
+	 */
+	void ClearSongs();
+
 	/**
 	 * Caller must lock the #db_mutex.
 	 */
 	void PruneEmpty();
 
 	/**
-	 * Sort all directory entries recursively.
+	 * Sort the entries of all dirty directories recursively.
+	 * Directories which have not been modified are assumed to be
+	 * sorted already.
 	 *
 	 * Caller must lock the #db_mutex.
 	 */
@@ -274,6 +358,12 @@ public:
 
 	gcc_pure
 	LightDirectory Export() const;
+
+private:
+	void BuildChildIndex() const;
+	void BuildSongIndex() const;
+
+	void UnindexChild(const Directory &child);
 };
 
 #endif
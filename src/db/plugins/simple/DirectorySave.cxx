@@ -30,6 +30,12 @@
 #include "util/NumberParser.hxx"
 #include "util/Error.hxx"
 #include "util/Domain.hxx"
+#include "db/Uri.hxx"
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <algorithm>
 
 #include <stddef.h>
 #include <string.h>
@@ -39,6 +45,7 @@
 #define DIRECTORY_MTIME "mtime: "
 #define DIRECTORY_BEGIN "begin: "
 #define DIRECTORY_END "end: "
+#define DIRECTORY_RECORD_END "record_end"
 
 static constexpr Domain directory_domain("directory");
 
@@ -201,3 +208,145 @@ directory_load(TextFile &file, Directory &directory, Error &error)
 
 	return true;
 }
+
+void
+directory_save_record(BufferedOutputStream &os, const Directory &directory)
+{
+	os.Format(DIRECTORY_RECORD_BEGIN "%s\n",
+		  directory.IsRoot() ? "/" : directory.GetPath());
+
+	if (!directory.IsRoot()) {
+		const char *type = DeviceToTypeString(directory.device);
+		if (type != nullptr)
+			os.Format(DIRECTORY_TYPE "%s\n", type);
+
+		if (directory.mtime != 0)
+			os.Format(DIRECTORY_MTIME "%lu\n",
+				  (unsigned long)directory.mtime);
+	}
+
+	for (const auto &child : directory.children)
+		if (!child.IsMount())
+			os.Format(DIRECTORY_DIR "%s\n", child.GetName());
+
+	for (const auto &song : directory.songs)
+		song_save(os, song);
+
+	playlist_vector_save(os, directory.playlists);
+
+	os.Format("%s\n", DIRECTORY_RECORD_END);
+}
+
+/**
+ * Look up a directory, and create it (and all missing parents) if it
+ * does not exist.
+ *
+ * Caller must lock the #db_mutex.
+ *
+ * @return the directory or nullptr if the URI refers to something
+ * below a mount point
+ */
+static Directory *
+MakeDirectory(Directory &root, const char *uri)
+{
+	auto r = root.LookupDirectory(uri);
+	Directory *directory = r.directory;
+
+	const char *name = r.uri;
+	while (name != nullptr) {
+		if (directory->IsMount())
+			return nullptr;
+
+		const char *slash = strchr(name, '/');
+		if (slash == nullptr) {
+			directory = directory->MakeChild(name);
+			break;
+		}
+
+		if (slash > name) {
+			const std::string child_name(name, slash);
+			directory = directory->MakeChild(child_name.c_str());
+		}
+
+		name = slash + 1;
+	}
+
+	return directory;
+}
+
+bool
+directory_load_record(TextFile &file, Directory &root, const char *uri,
+		      Error &error)
+{
+	Directory *const directory = isRootDirectory(uri)
+		? &root
+		: MakeDirectory(root, uri);
+	if (directory == nullptr) {
+		error.Format(directory_domain,
+			     "Journal record inside mount point: %s", uri);
+		return false;
+	}
+
+	/* parse the whole record before applying it, to leave the
+	   tree alone if it is truncated */
+	Directory tmp(std::string(), nullptr);
+	std::vector<std::string> child_names;
+	std::vector<std::unique_ptr<Song, Song::Disposer>> songs;
+
+	const char *line;
+	while (true) {
+		line = file.ReadLine();
+		if (line == nullptr) {
+			error.Set(directory_domain, "Unexpected end of file");
+			return false;
+		}
+
+		if (strcmp(line, DIRECTORY_RECORD_END) == 0)
+			break;
+
+		const char *p;
+		if ((p = StringAfterPrefix(line, DIRECTORY_DIR))) {
+			child_names.emplace_back(p);
+		} else if ((p = StringAfterPrefix(line, SONG_BEGIN))) {
+			DetachedSong *song = song_load(file, p, error);
+			if (song == nullptr)
+				return false;
+
+			songs.emplace_back(Song::NewFrom(std::move(*song),
+							 *directory));
+			delete song;
+		} else if ((p = StringAfterPrefix(line, PLAYLIST_META_BEGIN))) {
+			if (!playlist_metadata_load(file, tmp.playlists,
+						    p, error))
+				return false;
+		} else if (!ParseLine(tmp, line)) {
+			error.Format(directory_domain,
+				     "Malformed line: %s", line);
+			return false;
+		}
+	}
+
+	std::sort(child_names.begin(), child_names.end());
+
+	if (!directory->IsRoot()) {
+		directory->mtime = tmp.mtime;
+		directory->device = tmp.device;
+	}
+
+	directory->ForEachChildSafe([&child_names](Directory &child){
+			if (!std::binary_search(child_names.begin(),
+						child_names.end(),
+						child.GetName()))
+				child.Delete();
+		});
+
+	for (const auto &name : child_names)
+		directory->MakeChild(name.c_str());
+
+	directory->ClearSongs();
+	for (auto &song : songs)
+		directory->AddSong(song.release());
+
+	directory->playlists = std::move(tmp.playlists);
+	return true;
+}
@@ -20,6 +20,8 @@
 #ifndef MPD_DIRECTORY_SAVE_HXX
 #define MPD_DIRECTORY_SAVE_HXX
 
+#define DIRECTORY_RECORD_BEGIN "record_begin: "
+
 struct Directory;
 class TextFile;
 class BufferedOutputStream;
@@ -31,4 +33,27 @@ directory_save(BufferedOutputStream &os, const Directory &directory);
 bool
 directory_load(TextFile &file, Directory &directory, Error &error);
 
+/**
+ * Write a journal record describing the given directory: its
+ * attributes, the names of its children, its songs and its
+ * playlists (but not the contents of its children).
+ */
+void
+directory_save_record(BufferedOutputStream &os, const Directory &directory);
+
+/**
+ * Load one journal record (after its #DIRECTORY_RECORD_BEGIN line)
+ * and apply it to the tree, replacing the old state of the
+ * directory.  Children which are not mentioned in the record are
+ * deleted, new ones are created empty.  Nothing is modified if the
+ * record is incomplete.
+ *
+ * Caller must lock the #db_mutex.
+ *
+ * @param uri the URI of the directory, as found in the record
+ */
+bool
+directory_load_record(TextFile &file, Directory &root, const char *uri,
+		      Error &error);
+
 #endif
@@ -31,15 +31,18 @@
 #include "DatabaseSave.hxx"
 #include "db/DatabaseLock.hxx"
 #include "db/DatabaseError.hxx"
+#include "db/DatabaseListener.hxx"
 #include "fs/io/TextFile.hxx"
 #include "fs/io/BufferedOutputStream.hxx"
 #include "fs/io/FileOutputStream.hxx"
 #include "fs/FileInfo.hxx"
 #include "config/Block.hxx"
 #include "fs/FileSystem.hxx"
+#include "fs/Traits.hxx"
 #include "util/CharUtil.hxx"
 #include "util/Error.hxx"
 #include "util/Domain.hxx"
+#include "thread/Name.hxx"
 #include "Log.hxx"
 
 #ifdef ENABLE_ZLIB
@@ -47,41 +50,71 @@
 #endif
 
 #include <memory>
+#include <algorithm>
 
 #include <errno.h>
 
 static constexpr Domain simple_db_domain("simple_db");
 
-inline SimpleDatabase::SimpleDatabase()
+/**
+ * The journal is merged into the database file when it grows larger
+ * than the database file, but not below this size.
+ */
+static constexpr uint64_t MIN_JOURNAL_LIMIT = 1024 * 1024;
+
+gcc_pure
+static AllocatedPath
+MakeJournalPath(const AllocatedPath &path)
+{
+	if (path.IsNull())
+		return AllocatedPath::Null();
+
+	return AllocatedPath::FromFS(PathTraitsFS::string(path.c_str()) +
+				     PATH_LITERAL(".journal"));
+}
+
+inline SimpleDatabase::SimpleDatabase(EventLoop &_loop,
+				      DatabaseListener &_listener)
 	:Database(simple_db_plugin),
+	 DeferredMonitor(_loop),
+	 listener(_listener),
 	 path(AllocatedPath::Null()),
 #ifdef ENABLE_ZLIB
 	 compress(true),
 #endif
+	 journal(true),
+	 journal_path(AllocatedPath::Null()),
 	 cache_path(AllocatedPath::Null()),
+	 background_load(true), loading(false),
 	 prefixed_light_song(nullptr) {}
 
-inline SimpleDatabase::SimpleDatabase(AllocatedPath &&_path,
+inline SimpleDatabase::SimpleDatabase(EventLoop &_loop,
+				      DatabaseListener &_listener,
+				      AllocatedPath &&_path,
 #ifndef ENABLE_ZLIB
 				      gcc_unused
 #endif
 				      bool _compress)
 	:Database(simple_db_plugin),
+	 DeferredMonitor(_loop),
+	 listener(_listener),
 	 path(std::move(_path)),
 	 path_utf8(path.ToUTF8()),
 #ifdef ENABLE_ZLIB
 	 compress(_compress),
 #endif
+	 journal(true),
+	 journal_path(MakeJournalPath(path)),
 	 cache_path(AllocatedPath::Null()),
+	 background_load(false), loading(false),
 	 prefixed_light_song(nullptr) {
 }
 
 Database *
-SimpleDatabase::Create(gcc_unused EventLoop &loop,
-		       gcc_unused DatabaseListener &listener,
+SimpleDatabase::Create(EventLoop &loop, DatabaseListener &listener,
 		       const ConfigBlock &block, Error &error)
 {
-	SimpleDatabase *db = new SimpleDatabase();
+	SimpleDatabase *db = new SimpleDatabase(loop, listener);
 	if (!db->Configure(block, error)) {
 		delete db;
 		db = nullptr;
@@ -111,6 +144,9 @@ SimpleDatabase::Configure(const ConfigBlock &block, Error &error)
 	compress = block.GetBlockValue("compress", compress);
 #endif
 
+	journal = block.GetBlockValue("journal", journal);
+	journal_path = MakeJournalPath(path);
+
 	return true;
 }
 
@@ -190,53 +226,158 @@ SimpleDatabase::Load(Error &error)
 		return false;
 
 	FileInfo fi;
-	if (GetFileInfo(path, fi))
-		mtime = fi.GetModificationTime();
+	if (GetFileInfo(path, fi)) {
+		mtime = snapshot_mtime = fi.GetModificationTime();
+		snapshot_size = fi.GetSize();
+		snapshot_needed = false;
+	}
 
+	root->ClearDirty();
+
+	LoadJournal();
 	return true;
 }
 
-bool
-SimpleDatabase::Open(Error &error)
+void
+SimpleDatabase::LoadJournal()
 {
-	assert(prefixed_light_song == nullptr);
+	FileInfo fi;
+	if (!GetFileInfo(journal_path, fi))
+		/* no journal */
+		return;
+
+	if (!journal) {
+		/* the journal was disabled after it had been
+		   written; replay it anyway and merge it */
+		snapshot_needed = true;
+	}
 
-	root = Directory::NewRoot();
-	mtime = 0;
+	FormatDebug(simple_db_domain, "replaying database journal");
 
-#ifndef NDEBUG
-	borrowed_song_count = 0;
-#endif
+	Error error;
 
 	try {
-		Error error2;
-		if (!Load(error2)) {
-			LogError(error2);
-
-			delete root;
+		TextFile file(journal_path);
+		if (db_journal_load(file, *root,
+				    snapshot_mtime, snapshot_size, error)) {
+			journal_size = fi.GetSize();
+			if (fi.GetModificationTime() > mtime)
+				mtime = fi.GetModificationTime();
+		} else {
+			LogError(error);
+			snapshot_needed = true;
+		}
+	} catch (const std::exception &e) {
+		LogError(e);
+		snapshot_needed = true;
+	}
 
-			if (!Check(error))
-				return false;
+	/* directories modified by the journal may be out of order,
+	   and are now consistent with the files on disk */
+	const ScopeDatabaseLock protect;
+	root->Sort();
+	root->ClearDirty();
+}
 
-			root = Directory::NewRoot();
+bool
+SimpleDatabase::TryLoad(Error &error)
+{
+	try {
+		Error error2;
+		if (Load(error2)) {
+			load_success = true;
+			return true;
 		}
+
+		LogError(error2);
 	} catch (const std::exception &e) {
 		LogError(e);
+	}
+
+	delete root;
+	root = Directory::NewRoot();
+
+	return Check(error);
+}
+
+inline void
+SimpleDatabase::LoadThread()
+{
+	SetThreadName("db_load");
 
-		delete root;
+	Error error;
+	if (!TryLoad(error))
+		LogError(error);
 
-		if (!Check(error))
+	{
+		const ScopeLock protect(load_mutex);
+		loading = false;
+		load_cond.broadcast();
+	}
+
+	DeferredMonitor::Schedule();
+}
+
+void
+SimpleDatabase::LoadThread(void *ctx)
+{
+	SimpleDatabase &db = *(SimpleDatabase *)ctx;
+	db.LoadThread();
+}
+
+void
+SimpleDatabase::RunDeferred()
+{
+	FormatDebug(simple_db_domain, "finished loading %s",
+		    path_utf8.c_str());
+
+	listener.OnDatabaseLoaded(load_success);
+}
+
+bool
+SimpleDatabase::Open(Error &error)
+{
+	assert(prefixed_light_song == nullptr);
+	assert(!load_thread.IsDefined());
+
+	root = Directory::NewRoot();
+	mtime = 0;
+	snapshot_mtime = 0;
+	snapshot_size = 0;
+	snapshot_needed = true;
+	journal_size = 0;
+	journal_limit = MIN_JOURNAL_LIMIT;
+
+	load_success = false;
+
+#ifndef NDEBUG
+	borrowed_song_count = 0;
+#endif
+
+	if (background_load && PathExists(path)) {
+		/* a large database file takes a while to parse; do
+		   it in a separate thread, so clients can connect
+		   and the state file can be restored meanwhile */
+		loading = true;
+		if (!load_thread.Start(LoadThread, this, error)) {
+			loading = false;
 			return false;
+		}
 
-		root = Directory::NewRoot();
+		return true;
 	}
 
-	return true;
+	return TryLoad(error);
 }
 
 void
 SimpleDatabase::Close()
 {
+	if (load_thread.IsDefined())
+		load_thread.Join();
+
+	DeferredMonitor::Cancel();
+
 	assert(root != nullptr);
 	assert(prefixed_light_song == nullptr);
 	assert(borrowed_song_count == 0);
@@ -244,9 +385,28 @@ SimpleDatabase::Close()
 	delete root;
 }
 
+bool
+SimpleDatabase::IsLoading() const
+{
+	const ScopeLock protect(load_mutex);
+	return loading;
+}
+
+void
+SimpleDatabase::WaitLoaded() const
+{
+	const ScopeLock protect(load_mutex);
+	while (loading)
+		load_cond.wait(load_mutex);
+}
+
 const LightSong *
 SimpleDatabase::GetSong(const char *uri, Error &error) const
 {
+	if (IsLoading())
+		throw DatabaseError(DatabaseErrorCode::LOADING,
+				    "Database is loading");
+
 	assert(root != nullptr);
 	assert(prefixed_light_song == nullptr);
 	assert(borrowed_song_count == 0);
@@ -318,6 +478,10 @@ SimpleDatabase::Visit(const DatabaseSelection &selection,
 		      VisitPlaylist visit_playlist,
 		      Error &error) const
 {
+	if (IsLoading())
+		throw DatabaseError(DatabaseErrorCode::LOADING,
+				    "Database is loading");
+
 	ScopeDatabaseLock protect;
 
 	auto r = root->LookupDirectory(selection.uri.c_str());
@@ -380,6 +544,48 @@ SimpleDatabase::Save()
 		root->Sort();
 	}
 
+	if (journal && !snapshot_needed && journal_size < journal_limit) {
+		try {
+			SaveJournal();
+			return;
+		} catch (const std::exception &e) {
+			LogError(e);
+		}
+	}
+
+	SaveSnapshot();
+}
+
+void
+SimpleDatabase::SaveJournal()
+{
+	LogDebug(simple_db_domain, "writing DB journal");
+
+	if (journal_size == 0) {
+		FileOutputStream fos(journal_path);
+		BufferedOutputStream bos(fos);
+		db_journal_save_header(bos, snapshot_mtime, snapshot_size);
+		db_journal_save(bos, *root);
+		bos.Flush();
+		fos.Commit();
+	} else {
+		AppendFileOutputStream fos(journal_path);
+		BufferedOutputStream bos(fos);
+		db_journal_save(bos, *root);
+		bos.Flush();
+		fos.Commit();
+	}
+
+	FileInfo fi;
+	if (GetFileInfo(journal_path, fi)) {
+		journal_size = fi.GetSize();
+		mtime = fi.GetModificationTime();
+	}
+}
+
+void
+SimpleDatabase::SaveSnapshot()
+{
 	LogDebug(simple_db_domain, "writing DB");
 
 	FileOutputStream fos(path);
@@ -409,9 +615,19 @@ SimpleDatabase::Save()
 
 	fos.Commit();
 
+	root->ClearDirty();
+	snapshot_needed = false;
+
 	FileInfo fi;
-	if (GetFileInfo(path, fi))
-		mtime = fi.GetModificationTime();
+	if (GetFileInfo(path, fi)) {
+		mtime = snapshot_mtime = fi.GetModificationTime();
+		snapshot_size = fi.GetSize();
+		journal_limit = std::max(snapshot_size, MIN_JOURNAL_LIMIT);
+	}
+
+	/* the journal has been merged into the new database file */
+	RemoveFile(journal_path);
+	journal_size = 0;
 }
 
 void
@@ -459,6 +675,10 @@ SimpleDatabase::Mount(const char *local_uri, const char *storage_uri,
 		throw DatabaseError(DatabaseErrorCode::NOT_FOUND,
 				    "No 'cache_directory' configured");
 
+	if (IsLoading())
+		throw DatabaseError(DatabaseErrorCode::LOADING,
+				    "Database is loading");
+
 	std::string name(storage_uri);
 	std::replace_if(name.begin(), name.end(), IsUnsafeChar, '_');
 
@@ -469,7 +689,8 @@ SimpleDatabase::Mount(const char *local_uri, const char *storage_uri,
 #ifndef ENABLE_ZLIB
 	constexpr bool compress = false;
 #endif
-	auto db = new SimpleDatabase(AllocatedPath::Build(cache_path,
+	auto db = new SimpleDatabase(GetEventLoop(), listener,
+				     AllocatedPath::Build(cache_path,
 							  name_fs.c_str()),
 				     compress);
 	if (!db->Open(error)) {
@@ -493,12 +714,20 @@ SimpleDatabase::Mount(const char *local_uri, const char *storage_uri,
 Database *
 SimpleDatabase::LockUmountSteal(const char *uri)
 {
+	if (IsLoading())
+		/* nothing can be mounted yet */
+		return nullptr;
+
 	ScopeDatabaseLock protect;
 
 	auto r = root->LookupDirectory(uri);
 	if (r.uri != nullptr || !r.directory->IsMount())
 		return nullptr;
 
+	/* a client worker thread may be visiting the mounted
+	   database right now; don't pull it away */
+	r.directory->WaitMountUnused();
+
 	Database *db = r.directory->mounted_database;
 	r.directory->mounted_database = nullptr;
 	r.directory->Delete();
@@ -520,6 +749,7 @@ SimpleDatabase::Unmount(const char *uri)
 
 const DatabasePlugin simple_db_plugin = {
 	"simple",
-	DatabasePlugin::FLAG_REQUIRE_STORAGE,
+	DatabasePlugin::FLAG_REQUIRE_STORAGE |
+	DatabasePlugin::FLAG_THREAD_SAFE,
 	SimpleDatabase::Create,
 };
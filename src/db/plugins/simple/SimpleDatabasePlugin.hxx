@@ -24,10 +24,16 @@
 #include "db/Interface.hxx"
 #include "fs/AllocatedPath.hxx"
 #include "db/LightSong.hxx"
+#include "event/DeferredMonitor.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
 #include "Compiler.h"
 
 #include <cassert>
 
+#include <stdint.h>
+
 struct ConfigBlock;
 struct Directory;
 struct DatabasePlugin;
@@ -35,7 +41,9 @@ class EventLoop;
 class DatabaseListener;
 class PrefixedLightSong;
 
-class SimpleDatabase : public Database {
+class SimpleDatabase : public Database, DeferredMonitor {
+	DatabaseListener &listener;
+
 	AllocatedPath path;
 	std::string path_utf8;
 
@@ -43,11 +51,81 @@ class SimpleDatabase : public Database {
 	bool compress;
 #endif
 
+	/**
+	 * Append modified directories to a journal file instead of
+	 * rewriting the whole database after each update?
+	 */
+	bool journal;
+
+	/**
+	 * The path of the journal file, which is replayed after
+	 * loading the database file.
+	 */
+	AllocatedPath journal_path;
+
+	/**
+	 * The size of the current journal file.  Zero means there is
+	 * none yet.
+	 */
+	uint64_t journal_size;
+
+	/**
+	 * If the journal grows beyond this size, the next Save()
+	 * merges it into a new database file.
+	 */
+	uint64_t journal_limit;
+
+	/**
+	 * The modification time and size of the database file, which
+	 * identify it in the journal header.
+	 */
+	time_t snapshot_mtime;
+	uint64_t snapshot_size;
+
+	/**
+	 * If true, then the next Save() must write a full database
+	 * file, because the tree does not match the database file
+	 * plus the journal.
+	 */
+	bool snapshot_needed;
+
 	/**
 	 * The path where cache files for Mount() are located.
 	 */
 	AllocatedPath cache_path;
 
+	/**
+	 * Load the database file in a separate thread, so Open()
+	 * returns immediately?  This is disabled for the cache
+	 * databases of mounted storages.
+	 */
+	bool background_load;
+
+	/**
+	 * Protects #loading.
+	 */
+	mutable Mutex load_mutex;
+
+	/**
+	 * Signalled when #loading becomes false.
+	 */
+	mutable Cond load_cond;
+
+	/**
+	 * Is #load_thread still loading the database file?  While
+	 * this is set, the main thread must not lock the database,
+	 * because the loader holds the lock.
+	 */
+	bool loading;
+
+	/**
+	 * Was the database file loaded successfully?  Written by the
+	 * loader before it clears #loading.
+	 */
+	bool load_success;
+
+	Thread load_thread;
+
 	Directory *root;
 
 	time_t mtime;
@@ -67,9 +145,10 @@ class SimpleDatabase : public Database {
 	mutable unsigned borrowed_song_count;
 #endif
 
-	SimpleDatabase();
+	SimpleDatabase(EventLoop &_loop, DatabaseListener &_listener);
 
-	SimpleDatabase(AllocatedPath &&_path, bool _compress);
+	SimpleDatabase(EventLoop &_loop, DatabaseListener &_listener,
+		       AllocatedPath &&_path, bool _compress);
 
 public:
 	static Database *Create(EventLoop &loop, DatabaseListener &listener,
@@ -110,6 +189,9 @@ public:
 	virtual bool Open(Error &error) override;
 	virtual void Close() override;
 
+	bool IsLoading() const override;
+	void WaitLoaded() const override;
+
 	const LightSong *GetSong(const char *uri_utf8,
 				 Error &error) const override;
 	void ReturnSong(const LightSong *song) const override;
@@ -130,7 +212,7 @@ public:
 			      Error &error) const override;
 
 	virtual time_t GetUpdateStamp() const override {
-		return mtime;
+		return IsLoading() ? 0 : mtime;
 	}
 
 private:
@@ -141,7 +223,38 @@ private:
 
 	bool Load(Error &error);
 
+	/**
+	 * Load the database file.  On failure, the error is logged
+	 * and the database is left empty; the return value then
+	 * indicates whether the database file can be created.
+	 */
+	bool TryLoad(Error &error);
+
+	void LoadThread();
+	static void LoadThread(void *ctx);
+
+	/**
+	 * Replay the journal file after the database file has been
+	 * loaded.
+	 */
+	void LoadJournal();
+
+	/**
+	 * Write a new database file and delete the journal.  Throws
+	 * on error.
+	 */
+	void SaveSnapshot();
+
+	/**
+	 * Append all dirty directories to the journal.  Throws on
+	 * error.
+	 */
+	void SaveJournal();
+
 	Database *LockUmountSteal(const char *uri);
+
+	/* virtual methods from class DeferredMonitor */
+	void RunDeferred() override;
 };
 
 extern const DatabasePlugin simple_db_plugin;
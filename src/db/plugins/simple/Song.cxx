@@ -21,14 +21,20 @@
 #include "Song.hxx"
 #include "Directory.hxx"
 #include "tag/Tag.hxx"
-#include "util/VarSize.hxx"
+#include "thread/Mutex.hxx"
+#include "util/SlabAllocator.hxx"
 #include "DetachedSong.hxx"
 #include "db/LightSong.hxx"
 
+#include <type_traits>
+
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
 
+static Mutex song_allocator_mutex;
+static SlabAllocator song_allocator;
+
 inline Song::Song(const char *_uri, size_t uri_length, Directory &_parent)
 	:parent(&_parent), mtime(0),
 	 start_time(SongTime::zero()), end_time(SongTime::zero())
@@ -40,18 +46,32 @@ inline Song::~Song()
 {
 }
 
+static constexpr size_t
+song_size(size_t uri_length)
+{
+	return sizeof(Song) - sizeof(Song::uri) + uri_length + 1;
+}
+
 static Song *
 song_alloc(const char *uri, Directory &parent)
 {
+	static_assert(std::is_standard_layout<Song>::value,
+		      "Not standard-layout");
+
 	size_t uri_length;
 
 	assert(uri);
 	uri_length = strlen(uri);
 	assert(uri_length);
 
-	return NewVarSize<Song>(sizeof(Song::uri),
-				uri_length + 1,
-				uri, uri_length, parent);
+	void *p;
+
+	{
+		const ScopeLock protect(song_allocator_mutex);
+		p = song_allocator.Allocate(song_size(uri_length));
+	}
+
+	return ::new(p) Song(uri, uri_length, parent);
 }
 
 Song *
@@ -62,6 +82,7 @@ Song::NewFrom(DetachedSong &&other, Directory &parent)
 	song->mtime = other.GetLastModified();
 	song->start_time = other.GetStartTime();
 	song->end_time = other.GetEndTime();
+	song->analysis = other.GetSharedAnalysis();
 	return song;
 }
 
@@ -74,7 +95,19 @@ Song::NewFile(const char *path, Directory &parent)
 void
 Song::Free()
 {
-	DeleteVarSize(this);
+	const size_t size = song_size(strlen(uri));
+
+	this->~Song();
+
+	const ScopeLock protect(song_allocator_mutex);
+	song_allocator.Free(this, size);
+}
+
+SlabAllocatorStats
+Song::GetMemoryStats()
+{
+	const ScopeLock protect(song_allocator_mutex);
+	return song_allocator.GetStats();
 }
 
 std::string
@@ -108,5 +141,6 @@ Song::Export() const
 	dest.mtime = mtime;
 	dest.start_time = start_time;
 	dest.end_time = end_time;
+	dest.analysis = analysis.get();
 	return dest;
 }
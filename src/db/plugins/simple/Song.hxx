@@ -27,12 +27,15 @@
 
 #include <boost/intrusive/list.hpp>
 
+#include <memory>
 #include <string>
 
 #include <assert.h>
 #include <time.h>
 
 struct LightSong;
+struct SongAnalysis;
+struct SlabAllocatorStats;
 struct Directory;
 class DetachedSong;
 class Storage;
@@ -84,6 +87,15 @@ struct Song {
 	 */
 	SongTime end_time;
 
+	/**
+	 * The results of the loudness analysis; nullptr if this song
+	 * has not been analyzed yet.
+	 *
+	 * This attribute is protected with the global #db_mutex.
+	 * Read access in the update thread does not need protection.
+	 */
+	std::shared_ptr<const SongAnalysis> analysis;
+
 	/**
 	 * The file name.
 	 */
@@ -110,6 +122,13 @@ struct Song {
 
 	void Free();
 
+	/**
+	 * Returns statistics about the memory used by all #Song
+	 * objects.
+	 */
+	gcc_pure
+	static SlabAllocatorStats GetMemoryStats();
+
 	bool UpdateFile(Storage &storage);
 
 #ifdef ENABLE_ARCHIVE
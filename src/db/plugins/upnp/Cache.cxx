@@ -0,0 +1,269 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "Cache.hxx"
+#include "system/Clock.hxx"
+
+#include <algorithm>
+#include <vector>
+
+static std::string
+MakeSearchKey(const char *objid, const char *criteria)
+{
+	std::string key(objid);
+	key.push_back('\n');
+	key.append(criteria);
+	return key;
+}
+
+template<typename M>
+void
+UpnpCache::Purge(M &map, size_t max, unsigned now_ms)
+{
+	if (map.size() < max)
+		return;
+
+	for (auto i = map.begin(), end = map.end(); i != end;) {
+		if (IsExpired(i->second.time_ms, now_ms))
+			i = map.erase(i);
+		else
+			++i;
+	}
+
+	if (map.size() < max)
+		return;
+
+	/* still too large: evict the oldest items */
+
+	std::vector<typename M::iterator> items;
+	items.reserve(map.size());
+	for (auto i = map.begin(), end = map.end(); i != end; ++i)
+		items.push_back(i);
+
+	const size_t n = map.size() - max * 3 / 4;
+	std::nth_element(items.begin(), items.begin() + n, items.end(),
+			 [now_ms](typename M::iterator a,
+				  typename M::iterator b){
+				 return now_ms - a->second.time_ms >
+					 now_ms - b->second.time_ms;
+			 });
+
+	for (size_t i = 0; i < n; ++i)
+		map.erase(items[i]);
+}
+
+template<typename M>
+UpnpCache::ContentPtr
+UpnpCache::Lookup(const M &map, const std::string &key) const
+{
+	auto i = map.find(key);
+	if (i == map.end() ||
+	    IsExpired(i->second.time_ms, MonotonicClockMS()))
+		return nullptr;
+
+	return i->second.value;
+}
+
+bool
+UpnpCache::CheckUpdateId(const std::string &server)
+{
+	if (!IsEnabled())
+		return false;
+
+	const unsigned now_ms = MonotonicClockMS();
+
+	const ScopeLock protect(mutex);
+	auto &s = servers[server];
+	if (s.update_id_checked &&
+	    now_ms - s.update_id_time_ms < UPDATE_ID_INTERVAL_MS)
+		return false;
+
+	s.update_id_checked = true;
+	s.update_id_time_ms = now_ms;
+	return true;
+}
+
+bool
+UpnpCache::SetUpdateId(const std::string &server, std::string &&id)
+{
+	const ScopeLock protect(mutex);
+	auto &s = servers[server];
+	if (s.update_id == id)
+		return false;
+
+	s.Clear();
+	s.update_id = std::move(id);
+	return true;
+}
+
+void
+UpnpCache::Flush(const std::string &server)
+{
+	const ScopeLock protect(mutex);
+	auto i = servers.find(server);
+	if (i != servers.end())
+		i->second.Clear();
+}
+
+UpnpCache::ContentPtr
+UpnpCache::GetListing(const std::string &server, const char *objid) const
+{
+	if (!IsEnabled())
+		return nullptr;
+
+	const ScopeLock protect(mutex);
+	auto i = servers.find(server);
+	if (i == servers.end())
+		return nullptr;
+
+	return Lookup(i->second.listings, objid);
+}
+
+void
+UpnpCache::AddObjects(Server &s, const UPnPDirContent &content,
+		      unsigned now_ms)
+{
+	Purge(s.objects, MAX_OBJECTS, now_ms);
+
+	for (const auto &object : content.objects) {
+		auto i = s.objects.find(object.id);
+		if (i != s.objects.end()) {
+			i->second.time_ms = now_ms;
+			i->second.value = UPnPDirObject(object);
+		} else
+			s.objects.emplace(std::piecewise_construct,
+					  std::forward_as_tuple(object.id),
+					  std::forward_as_tuple(now_ms,
+								object));
+	}
+}
+
+UpnpCache::ContentPtr
+UpnpCache::PutListing(const std::string &server, const char *objid,
+		      UPnPDirContent &&content)
+{
+	ContentPtr result = std::make_shared<const UPnPDirContent>(std::move(content));
+	if (!IsEnabled())
+		return result;
+
+	const unsigned now_ms = MonotonicClockMS();
+
+	const ScopeLock protect(mutex);
+	auto &s = servers[server];
+	Purge(s.listings, MAX_LISTINGS, now_ms);
+
+	auto i = s.listings.find(objid);
+	if (i != s.listings.end()) {
+		i->second.time_ms = now_ms;
+		i->second.value = result;
+	} else
+		s.listings.emplace(std::piecewise_construct,
+				   std::forward_as_tuple(objid),
+				   std::forward_as_tuple(now_ms, result));
+
+	AddObjects(s, *result, now_ms);
+	return result;
+}
+
+UpnpCache::ContentPtr
+UpnpCache::GetSearch(const std::string &server, const char *objid,
+		     const char *criteria) const
+{
+	if (!IsEnabled())
+		return nullptr;
+
+	const ScopeLock protect(mutex);
+	auto i = servers.find(server);
+	if (i == servers.end())
+		return nullptr;
+
+	return Lookup(i->second.searches, MakeSearchKey(objid, criteria));
+}
+
+UpnpCache::ContentPtr
+UpnpCache::PutSearch(const std::string &server, const char *objid,
+		     const char *criteria, UPnPDirContent &&content)
+{
+	ContentPtr result = std::make_shared<const UPnPDirContent>(std::move(content));
+	if (!IsEnabled())
+		return result;
+
+	const unsigned now_ms = MonotonicClockMS();
+
+	const ScopeLock protect(mutex);
+	auto &s = servers[server];
+	Purge(s.searches, MAX_LISTINGS, now_ms);
+
+	auto key = MakeSearchKey(objid, criteria);
+	auto i = s.searches.find(key);
+	if (i != s.searches.end()) {
+		i->second.time_ms = now_ms;
+		i->second.value = result;
+	} else
+		s.searches.emplace(std::piecewise_construct,
+				   std::forward_as_tuple(std::move(key)),
+				   std::forward_as_tuple(now_ms, result));
+
+	AddObjects(s, *result, now_ms);
+	return result;
+}
+
+bool
+UpnpCache::GetObject(const std::string &server, const char *objid,
+		     UPnPDirObject &dest) const
+{
+	if (!IsEnabled())
+		return false;
+
+	const ScopeLock protect(mutex);
+	auto i = servers.find(server);
+	if (i == servers.end())
+		return false;
+
+	auto j = i->second.objects.find(objid);
+	if (j == i->second.objects.end() ||
+	    IsExpired(j->second.time_ms, MonotonicClockMS()))
+		return false;
+
+	dest = UPnPDirObject(j->second.value);
+	return true;
+}
+
+void
+UpnpCache::PutObject(const std::string &server, const UPnPDirObject &object)
+{
+	if (!IsEnabled())
+		return;
+
+	const unsigned now_ms = MonotonicClockMS();
+
+	const ScopeLock protect(mutex);
+	auto &s = servers[server];
+	Purge(s.objects, MAX_OBJECTS, now_ms);
+
+	auto i = s.objects.find(object.id);
+	if (i != s.objects.end()) {
+		i->second.time_ms = now_ms;
+		i->second.value = UPnPDirObject(object);
+	} else
+		s.objects.emplace(std::piecewise_construct,
+				  std::forward_as_tuple(object.id),
+				  std::forward_as_tuple(now_ms, object));
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_UPNP_CACHE_HXX
+#define MPD_UPNP_CACHE_HXX
+
+#include "Directory.hxx"
+#include "thread/Mutex.hxx"
+#include "Compiler.h"
+
+#include <string>
+#include <map>
+#include <memory>
+#include <tuple>
+
+/**
+ * A cache for the responses of UPnP media servers: container
+ * listings, search results and object metadata.  Each item expires
+ * after a configurable time, and all items of a server are discarded
+ * as soon as its "SystemUpdateID" changes.
+ *
+ * This class is thread-safe.
+ */
+class UpnpCache {
+public:
+	typedef std::shared_ptr<const UPnPDirContent> ContentPtr;
+
+private:
+	/**
+	 * The maximum number of listings (container listings plus
+	 * search results) per server.  When this is exceeded, expired
+	 * items are purged, and if that does not help, the oldest
+	 * items are evicted.
+	 */
+	static constexpr size_t MAX_LISTINGS = 256;
+
+	/**
+	 * The maximum number of object metadata items per server.
+	 */
+	static constexpr size_t MAX_OBJECTS = 16384;
+
+	/**
+	 * The minimum interval between two "SystemUpdateID" queries
+	 * to the same server [ms].
+	 */
+	static constexpr unsigned UPDATE_ID_INTERVAL_MS = 5000;
+
+	template<typename T>
+	struct Item {
+		unsigned time_ms;
+
+		T value;
+
+		template<typename U>
+		Item(unsigned _time_ms, U &&_value)
+			:time_ms(_time_ms), value(std::forward<U>(_value)) {}
+	};
+
+	struct Server {
+		/**
+		 * The "SystemUpdateID" which was valid when the items
+		 * were added.
+		 */
+		std::string update_id;
+
+		/**
+		 * Was "SystemUpdateID" ever queried?
+		 */
+		bool update_id_checked = false;
+
+		/**
+		 * The time of the last "SystemUpdateID" query.
+		 */
+		unsigned update_id_time_ms;
+
+		/**
+		 * Container listings, indexed by ObjectId.
+		 */
+		std::map<std::string, Item<ContentPtr>> listings;
+
+		/**
+		 * Search results, indexed by ObjectId and search
+		 * criteria.
+		 */
+		std::map<std::string, Item<ContentPtr>> searches;
+
+		/**
+		 * Object metadata, indexed by ObjectId.
+		 */
+		std::map<std::string, Item<UPnPDirObject>> objects;
+
+		void Clear() {
+			listings.clear();
+			searches.clear();
+			objects.clear();
+		}
+	};
+
+	const unsigned ttl_ms;
+
+	mutable Mutex mutex;
+
+	/**
+	 * Indexed by ContentDirectoryService::GetURI().
+	 */
+	std::map<std::string, Server> servers;
+
+public:
+	/**
+	 * @param ttl_s the lifetime of cached items [s]; 0 disables
+	 * the cache
+	 */
+	explicit UpnpCache(unsigned ttl_s)
+		:ttl_ms(ttl_s * 1000) {}
+
+	UpnpCache(const UpnpCache &) = delete;
+	UpnpCache &operator=(const UpnpCache &) = delete;
+
+	bool IsEnabled() const {
+		return ttl_ms > 0;
+	}
+
+	/**
+	 * Shall the caller query the server's "SystemUpdateID" now
+	 * and pass it to SetUpdateId()?  This rate-limits the
+	 * queries, and marks the query as done.
+	 */
+	bool CheckUpdateId(const std::string &server);
+
+	/**
+	 * Submit the current "SystemUpdateID" of a server.  If it
+	 * differs from the one seen previously, all items of this
+	 * server are discarded.
+	 *
+	 * @return true if the cache was flushed
+	 */
+	bool SetUpdateId(const std::string &server, std::string &&id);
+
+	/**
+	 * Discard all items of the specified server.
+	 */
+	void Flush(const std::string &server);
+
+	/**
+	 * Look up a container listing.
+	 *
+	 * @return the listing or nullptr if it is not cached (or
+	 * expired)
+	 */
+	gcc_pure
+	ContentPtr GetListing(const std::string &server,
+			      const char *objid) const;
+
+	/**
+	 * Add a container listing.  The metadata of all children is
+	 * added as well.
+	 *
+	 * @return a pointer to the cached listing
+	 */
+	ContentPtr PutListing(const std::string &server, const char *objid,
+			      UPnPDirContent &&content);
+
+	gcc_pure
+	ContentPtr GetSearch(const std::string &server, const char *objid,
+			     const char *criteria) const;
+
+	ContentPtr PutSearch(const std::string &server, const char *objid,
+			     const char *criteria, UPnPDirContent &&content);
+
+	/**
+	 * Look up an object's metadata.
+	 *
+	 * @return true if the object was found and copied to #dest
+	 */
+	bool GetObject(const std::string &server, const char *objid,
+		       UPnPDirObject &dest) const;
+
+	void PutObject(const std::string &server, const UPnPDirObject &object);
+
+private:
+	gcc_pure
+	bool IsExpired(unsigned time_ms, unsigned now_ms) const {
+		return now_ms - time_ms >= ttl_ms;
+	}
+
+	/**
+	 * Make room for a new item if the map has reached the given
+	 * size: remove all expired items, and if that is not enough,
+	 * the oldest ones until three quarters of the maximum are
+	 * left.
+	 */
+	template<typename M>
+	void Purge(M &map, size_t max, unsigned now_ms);
+
+	template<typename M>
+	gcc_pure
+	ContentPtr Lookup(const M &map, const std::string &key) const;
+
+	void AddObjects(Server &s, const UPnPDirContent &content,
+			unsigned now_ms);
+};
+
+#endif
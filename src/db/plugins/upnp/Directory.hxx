@@ -50,6 +50,15 @@ public:
 		return nullptr;
 	}
 
+	gcc_pure
+	const UPnPDirObject *FindObject(const char *name) const {
+		for (const auto &o : objects)
+			if (o.name == name)
+				return &o;
+
+		return nullptr;
+	}
+
 	/**
 	 * Parse from DIDL-Lite XML data.
 	 *
@@ -20,12 +20,15 @@
 #include "config.h"
 #include "UpnpDatabasePlugin.hxx"
 #include "Directory.hxx"
+#include "Cache.hxx"
 #include "Tags.hxx"
 #include "lib/upnp/Domain.hxx"
 #include "lib/upnp/ClientInit.hxx"
 #include "lib/upnp/Discovery.hxx"
 #include "lib/upnp/ContentDirectoryService.hxx"
 #include "lib/upnp/Util.hxx"
+#include "lib/upnp/WorkQueue.hxx"
+#include "thread/Mutex.hxx"
 #include "db/Interface.hxx"
 #include "db/DatabasePlugin.hxx"
 #include "db/Selection.hxx"
@@ -45,12 +48,30 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <memory>
 
 #include <assert.h>
 #include <string.h>
 
 static const char *const rootid = "0";
 
+/**
+ * The default lifetime of cached server responses [s].
+ */
+static constexpr unsigned DEFAULT_CACHE_TTL = 60;
+
+/**
+ * The maximum number of sub-containers of a listed container whose
+ * listings are prefetched.
+ */
+static constexpr unsigned MAX_PREFETCH = 16;
+
+/**
+ * The maximum number of prefetch tasks waiting for the prefetch
+ * thread.
+ */
+static constexpr size_t MAX_PREFETCH_QUEUE = 64;
+
 class UpnpSong : public LightSong {
 	std::string uri2, real_uri2;
 
@@ -67,6 +88,7 @@ public:
 		tag = &tag2;
 		mtime = 0;
 		start_time = end_time = SongTime::zero();
+		analysis = nullptr;
 	}
 };
 
@@ -74,8 +96,42 @@ class UpnpDatabase : public Database {
 	UpnpClient_Handle handle;
 	UPnPDeviceDirectory *discovery;
 
+	std::unique_ptr<UpnpCache> cache;
+
+	/**
+	 * A container listing to be loaded into the #cache by the
+	 * prefetch thread.
+	 */
+	struct PrefetchTask {
+		ContentDirectoryService server;
+		std::string objid;
+	};
+
+	mutable WorkQueue<PrefetchTask> prefetch_queue;
+
+	/**
+	 * Is the prefetch thread running?  If not, nothing is added
+	 * to #prefetch_queue.
+	 */
+	bool prefetch_running;
+
+	/**
+	 * Protects #prefetch_pending.
+	 */
+	mutable Mutex prefetch_mutex;
+
+	/**
+	 * The tasks in #prefetch_queue or being executed by the
+	 * prefetch thread (see PrefetchKey()).  Used to avoid
+	 * duplicate tasks and to limit the queue's size.
+	 */
+	mutable std::set<std::string> prefetch_pending;
+
 public:
-	UpnpDatabase():Database(upnp_db_plugin) {}
+	UpnpDatabase()
+		:Database(upnp_db_plugin),
+		 prefetch_queue("UpnpPrefetchQueue"),
+		 prefetch_running(false) {}
 
 	static Database *Create(EventLoop &loop, DatabaseListener &listener,
 				const ConfigBlock &block,
@@ -127,9 +183,9 @@ private:
 			 VisitSong visit_song,
 			 Error &error) const;
 
-	UPnPDirContent SearchSongs(const ContentDirectoryService &server,
-				   const char *objid,
-				   const DatabaseSelection &selection) const;
+	UpnpCache::ContentPtr SearchSongs(const ContentDirectoryService &server,
+					  const char *objid,
+					  const DatabaseSelection &selection) const;
 
 	UPnPDirObject Namei(const ContentDirectoryService &server,
 			    const std::list<std::string> &vpath) const;
@@ -140,6 +196,29 @@ private:
 	UPnPDirObject ReadNode(const ContentDirectoryService &server,
 			       const char *objid) const;
 
+	/**
+	 * Read a container's children list, preferably from the
+	 * #cache.
+	 */
+	UpnpCache::ContentPtr ReadDir(const ContentDirectoryService &server,
+				      const char *objid) const;
+
+	/**
+	 * Query the server's "SystemUpdateID" (rate-limited) and
+	 * flush its #cache if it has changed.
+	 */
+	void CheckUpdateId(const ContentDirectoryService &server) const;
+
+	/**
+	 * Schedule loading the listings of the given container's
+	 * sub-containers into the #cache.
+	 */
+	void Prefetch(const ContentDirectoryService &server,
+		      const UPnPDirContent &content) const;
+
+	void RunPrefetch();
+	static void *RunPrefetch(void *ctx);
+
 	/**
 	 * Get the path for an object Id. This works much like pwd,
 	 * except easier cause our inodes have a parent id. Not used
@@ -167,8 +246,10 @@ UpnpDatabase::Create(gcc_unused EventLoop &loop,
 }
 
 inline bool
-UpnpDatabase::Configure(const ConfigBlock &, Error &)
+UpnpDatabase::Configure(const ConfigBlock &block, Error &)
 {
+	cache.reset(new UpnpCache(block.GetBlockValue("cache_ttl",
+						      DEFAULT_CACHE_TTL)));
 	return true;
 }
 
@@ -186,16 +267,144 @@ UpnpDatabase::Open(gcc_unused Error &error)
 		throw;
 	}
 
+	if (cache->IsEnabled()) {
+		prefetch_running = prefetch_queue.start(1, RunPrefetch, this);
+		if (!prefetch_running)
+			LogError(upnp_domain,
+				 "Failed to start the prefetch thread");
+	}
+
 	return true;
 }
 
 void
 UpnpDatabase::Close()
 {
+	prefetch_running = false;
+	prefetch_queue.setTerminateAndWait();
+	prefetch_pending.clear();
 	delete discovery;
 	UpnpClientGlobalFinish();
 }
 
+static std::string
+PrefetchKey(const std::string &uri, const std::string &objid)
+{
+	std::string key(uri);
+	key.push_back('\n');
+	key.append(objid);
+	return key;
+}
+
+inline void
+UpnpDatabase::RunPrefetch()
+{
+	for (;;) {
+		PrefetchTask task;
+		if (!prefetch_queue.take(task)) {
+			prefetch_queue.workerExit();
+			return;
+		}
+
+		const auto uri = task.server.GetURI();
+		const char *objid = task.objid.c_str();
+		if (cache->GetListing(uri, objid) == nullptr) {
+			try {
+				cache->PutListing(uri, objid,
+						  task.server.readDir(handle,
+								      objid));
+			} catch (const std::runtime_error &e) {
+				FormatDebug(upnp_domain,
+					    "Prefetch of %s failed: %s",
+					    objid, e.what());
+			}
+		}
+
+		/* remove it only now, so the listing isn't queued
+		   again while it is being loaded */
+		const ScopeLock protect(prefetch_mutex);
+		prefetch_pending.erase(PrefetchKey(uri, task.objid));
+	}
+}
+
+void *
+UpnpDatabase::RunPrefetch(void *ctx)
+{
+	UpnpDatabase &db = *(UpnpDatabase *)ctx;
+	db.RunPrefetch();
+	return (void *)1;
+}
+
+void
+UpnpDatabase::CheckUpdateId(const ContentDirectoryService &server) const
+{
+	const auto uri = server.GetURI();
+	if (!cache->CheckUpdateId(uri))
+		return;
+
+	std::string id;
+	try {
+		id = server.getSystemUpdateID(handle);
+	} catch (const std::runtime_error &e) {
+		/* rely on the TTL only */
+		FormatDebug(upnp_domain,
+			    "Failed to query SystemUpdateID of %s: %s",
+			    server.getFriendlyName(), e.what());
+		return;
+	}
+
+	if (cache->SetUpdateId(uri, std::move(id)))
+		FormatDebug(upnp_domain, "SystemUpdateID of %s changed",
+			    server.getFriendlyName());
+}
+
+UpnpCache::ContentPtr
+UpnpDatabase::ReadDir(const ContentDirectoryService &server,
+		      const char *objid) const
+{
+	CheckUpdateId(server);
+
+	const auto uri = server.GetURI();
+	auto content = cache->GetListing(uri, objid);
+	if (content == nullptr)
+		content = cache->PutListing(uri, objid,
+					    server.readDir(handle, objid));
+
+	return content;
+}
+
+void
+UpnpDatabase::Prefetch(const ContentDirectoryService &server,
+		       const UPnPDirContent &content) const
+{
+	if (!prefetch_running)
+		return;
+
+	const auto uri = server.GetURI();
+	unsigned n = 0;
+	for (const auto &object : content.objects) {
+		if (object.type != UPnPDirObject::Type::CONTAINER ||
+		    cache->GetListing(uri, object.id.c_str()) != nullptr)
+			continue;
+
+		{
+			const ScopeLock protect(prefetch_mutex);
+			if (prefetch_pending.size() >= MAX_PREFETCH_QUEUE)
+				/* the prefetch thread is behind; don't
+				   let the queue grow */
+				return;
+
+			if (!prefetch_pending.insert(PrefetchKey(uri, object.id)).second)
+				/* already queued */
+				continue;
+		}
+
+		prefetch_queue.put(PrefetchTask{server, object.id});
+		if (++n >= MAX_PREFETCH)
+			break;
+	}
+}
+
 void
 UpnpDatabase::ReturnSong(const LightSong *_song) const
 {
@@ -253,18 +462,18 @@ dquote(std::string &out, const char *in)
 
 // Run an UPnP search, according to MPD parameters. Return results as
 // UPnP items
-UPnPDirContent
+UpnpCache::ContentPtr
 UpnpDatabase::SearchSongs(const ContentDirectoryService &server,
 			  const char *objid,
 			  const DatabaseSelection &selection) const
 {
 	const SongFilter *filter = selection.filter;
 	if (selection.filter == nullptr)
-		return UPnPDirContent();
+		return std::make_shared<const UPnPDirContent>();
 
 	const auto searchcaps = server.getSearchCapabilities(handle);
 	if (searchcaps.empty())
-		return UPnPDirContent();
+		return std::make_shared<const UPnPDirContent>();
 
 	std::string cond;
 	for (const auto &item : filter->GetItems()) {
@@ -327,7 +536,16 @@ UpnpDatabase::SearchSongs(const ContentDirectoryService &server,
 		}
 	}
 
-	return server.search(handle, objid, cond.c_str());
+	CheckUpdateId(server);
+
+	const auto uri = server.GetURI();
+	auto content = cache->GetSearch(uri, objid, cond.c_str());
+	if (content == nullptr)
+		content = cache->PutSearch(uri, objid, cond.c_str(),
+					   server.search(handle, objid,
+							 cond.c_str()));
+
+	return content;
 }
 
 static bool
@@ -345,6 +563,7 @@ visitSong(const UPnPDirObject &meta, const char *path,
 	song.tag = &meta.tag;
 	song.mtime = 0;
 	song.start_time = song.end_time = SongTime::zero();
+	song.analysis = nullptr;
 
 	return !selection.Match(song) || visit_song(song, error);
 }
@@ -371,7 +590,8 @@ UpnpDatabase::SearchSongs(const ContentDirectoryService &server,
 	if (!visit_song)
 		return true;
 
-	for (auto &dirent : SearchSongs(server, objid, selection).objects) {
+	const auto content = SearchSongs(server, objid, selection);
+	for (const auto &dirent : content->objects) {
 		if (dirent.type != UPnPDirObject::Type::ITEM ||
 		    dirent.item_class != UPnPDirObject::ItemClass::MUSIC)
 			continue;
@@ -394,7 +614,7 @@ UpnpDatabase::SearchSongs(const ContentDirectoryService &server,
 		// which we later have to detect.
 		const std::string path = songPath(server.getFriendlyName(),
 						  dirent.id);
-		if (!visitSong(std::move(dirent), path.c_str(),
+		if (!visitSong(dirent, path.c_str(),
 			       selection, visit_song,
 			       error))
 			return false;
@@ -407,10 +627,18 @@ UPnPDirObject
 UpnpDatabase::ReadNode(const ContentDirectoryService &server,
 		       const char *objid) const
 {
+	CheckUpdateId(server);
+
+	const auto uri = server.GetURI();
+	UPnPDirObject object;
+	if (cache->GetObject(uri, objid, object))
+		return object;
+
 	auto dirbuf = server.getMetadata(handle, objid);
 	if (dirbuf.objects.size() != 1)
 		throw std::runtime_error("Bad resource");
 
+	cache->PutObject(uri, dirbuf.objects.front());
 	return std::move(dirbuf.objects.front());
 }
 
@@ -448,22 +676,22 @@ UpnpDatabase::Namei(const ContentDirectoryService &server,
 
 	// Walk the path elements, read each directory and try to find the next one
 	for (auto i = vpath.begin(), last = std::prev(vpath.end());; ++i) {
-		auto dirbuf = server.readDir(handle, objid.c_str());
+		const auto dirbuf = ReadDir(server, objid.c_str());
 
 		// Look for the name in the sub-container list
-		UPnPDirObject *child = dirbuf.FindObject(i->c_str());
+		const UPnPDirObject *child = dirbuf->FindObject(i->c_str());
 		if (child == nullptr)
 			throw DatabaseError(DatabaseErrorCode::NOT_FOUND,
 					    "No such object");
 
 		if (i == last)
-			return std::move(*child);
+			return *child;
 
 		if (child->type != UPnPDirObject::Type::CONTAINER)
 			throw DatabaseError(DatabaseErrorCode::NOT_FOUND,
 					    "Not a container");
 
-		objid = std::move(child->id);
+		objid = child->id;
 	}
 }
 
@@ -570,7 +798,7 @@ UpnpDatabase::VisitServer(const ContentDirectoryService &server,
 
 			std::string path = songPath(server.getFriendlyName(),
 						    dirent.id);
-			if (!visitSong(std::move(dirent), path.c_str(),
+			if (!visitSong(dirent, path.c_str(),
 				       selection,
 				       visit_song, error))
 				return false;
@@ -603,7 +831,10 @@ UpnpDatabase::VisitServer(const ContentDirectoryService &server,
 	/* Target was a a container. Visit it. We could read slices
 	   and loop here, but it's not useful as mpd will only return
 	   data to the client when we're done anyway. */
-	for (const auto &dirent : server.readDir(handle, tdirent.id.c_str()).objects) {
+	const auto content = ReadDir(server, tdirent.id.c_str());
+	Prefetch(server, *content);
+
+	for (const auto &dirent : content->objects) {
 		const std::string uri = PathTraitsUTF8::Build(base_uri,
 							      dirent.name.c_str());
 		if (!VisitObject(dirent, uri.c_str(),
@@ -668,7 +899,7 @@ UpnpDatabase::VisitUniqueTags(const DatabaseSelection &selection,
 	for (auto& server : discovery->GetDirectories()) {
 		const auto dirbuf = SearchSongs(server, rootid, selection);
 
-		for (const auto &dirent : dirbuf.objects) {
+		for (const auto &dirent : dirbuf->objects) {
 			if (dirent.type != UPnPDirObject::Type::ITEM ||
 			    dirent.item_class != UPnPDirObject::ItemClass::MUSIC)
 				continue;
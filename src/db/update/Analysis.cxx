@@ -0,0 +1,495 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h" /* must be first for large file support */
+#include "Analysis.hxx"
+#include "UpdateDomain.hxx"
+#include "db/DatabaseLock.hxx"
+#include "db/DatabaseSong.hxx"
+#include "db/LightSong.hxx"
+#include "db/plugins/simple/SimpleDatabasePlugin.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "decoder/DecoderControl.hxx"
+#include "decoder/DecoderThread.hxx"
+#include "pcm/LoudnessMeter.hxx"
+#include "pcm/MixRampMeter.hxx"
+#include "system/Clock.hxx"
+#include "thread/Thread.hxx"
+#include "thread/Name.hxx"
+#include "thread/Util.hxx"
+#include "DetachedSong.hxx"
+#include "SongAnalysis.hxx"
+#include "MusicBuffer.hxx"
+#include "MusicPipe.hxx"
+#include "MusicChunk.hxx"
+#include "AudioFormat.hxx"
+#include "util/Error.hxx"
+#include "Log.hxx"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+
+#include <assert.h>
+
+/**
+ * The ReplayGain 2.0 reference level [LUFS].
+ */
+static constexpr double REFERENCE_LOUDNESS = -18;
+
+/**
+ * Loudness values below this one are the result of silence [LUFS].
+ */
+static constexpr double MIN_LOUDNESS = -70;
+
+/**
+ * The size of the #MusicBuffer of each worker.
+ */
+static constexpr unsigned ANALYSIS_BUFFER_CHUNKS = 64;
+
+/**
+ * Save the database at least this often while the analysis is
+ * running, so a long analysis run does not lose all its results
+ * when MPD is killed [seconds].
+ */
+static constexpr unsigned SAVE_INTERVAL = 600;
+
+/**
+ * Decodes songs with a private #DecoderControl and feeds the
+ * samples into a #LoudnessMeter and a #MixRampMeter.
+ */
+class SongAnalyzer {
+	Mutex mutex;
+	Cond cond;
+
+	DecoderControl dc;
+
+	MusicBuffer buffer;
+	MusicPipe pipe;
+
+	std::unique_ptr<LoudnessMeter> loudness;
+	std::unique_ptr<MixRampMeter> mix_ramp;
+
+public:
+	SongAnalyzer()
+		:dc(mutex, cond), buffer(ANALYSIS_BUFFER_CHUNKS) {
+		dc.idle_priority = true;
+
+		/* the meters need floating point samples */
+		dc.configured_audio_format =
+			AudioFormat(0, SampleFormat::FLOAT, 0);
+
+		decoder_thread_start(dc);
+	}
+
+	~SongAnalyzer() {
+		dc.Quit();
+	}
+
+	/**
+	 * Decode the song.  On success, the results can be obtained
+	 * with GetLoudness() and GetMixRamp().
+	 *
+	 * @param song the song; it will be owned and freed by the
+	 * decoder
+	 * @return false on error, if the song is empty or if the
+	 * analysis was cancelled
+	 */
+	bool Analyze(DetachedSong *song, const volatile bool &cancel);
+
+	const LoudnessMeter &GetLoudness() const {
+		return *loudness;
+	}
+
+	const MixRampMeter &GetMixRamp() const {
+		return *mix_ramp;
+	}
+
+private:
+	/**
+	 * Wait for the decoder thread.  This has a timeout, because
+	 * the decoder may miss Signal() while it is about to wait for
+	 * a free chunk.
+	 *
+	 * Caller must hold the lock.
+	 */
+	void WaitForDecoder() {
+		dc.client_is_waiting = true;
+		cond.timed_wait(mutex, 100);
+		dc.client_is_waiting = false;
+	}
+};
+
+bool
+SongAnalyzer::Analyze(DetachedSong *song, const volatile bool &cancel)
+{
+	loudness.reset();
+	mix_ramp.reset();
+
+	dc.Start(song, song->GetStartTime(), song->GetEndTime(),
+		 buffer, pipe);
+
+	AudioFormat audio_format = AudioFormat::Undefined();
+
+	const ScopeLock protect(mutex);
+
+	while (true) {
+		if (cancel) {
+			const ScopeUnlock unlock(mutex);
+			dc.Stop();
+			pipe.Clear(buffer);
+			return false;
+		}
+
+		if (dc.IsStarting()) {
+			WaitForDecoder();
+			continue;
+		}
+
+		MusicChunk *chunk = pipe.Shift();
+		if (chunk == nullptr) {
+			if (dc.IsIdle())
+				/* the decoder has finished and all
+				   chunks have been consumed */
+				break;
+
+			WaitForDecoder();
+			continue;
+		}
+
+		if (!audio_format.IsDefined()) {
+			audio_format = dc.out_audio_format;
+			assert(audio_format.format == SampleFormat::FLOAT);
+
+			loudness.reset(new LoudnessMeter(audio_format.sample_rate,
+							 audio_format.channels));
+			mix_ramp.reset(new MixRampMeter(audio_format.sample_rate,
+							audio_format.channels));
+		}
+
+		{
+			const ScopeUnlock unlock(mutex);
+
+			const size_t n_frames =
+				chunk->length / audio_format.GetFrameSize();
+			const float *data = (const float *)chunk->data;
+			loudness->Feed(data, n_frames);
+			mix_ramp->Feed(data, n_frames);
+
+			buffer.Return(chunk);
+		}
+
+		/* wake up the decoder if it waits for a free chunk */
+		dc.Signal();
+	}
+
+	/* errors have already been logged by the decoder thread */
+	return !dc.HasFailed() && loudness != nullptr;
+}
+
+UpdateAnalysis::UpdateAnalysis(SimpleDatabase &_db, const Storage &_storage)
+	:db(_db), storage(_storage), cancel(false),
+	 next_group(0), n_running(0)
+{
+}
+
+UpdateAnalysis::~UpdateAnalysis()
+{
+	assert(n_running == 0);
+}
+
+gcc_pure
+static const char *
+GetAlbum(const Song &song)
+{
+	const char *album = song.tag.GetValue(TAG_ALBUM);
+	return album != nullptr ? album : "";
+}
+
+void
+UpdateAnalysis::Collect(const Directory &directory)
+{
+	if (directory.IsMount())
+		/* mounted databases are not analyzed */
+		return;
+
+	/* the albums which need a new album gain; songs without an
+	   album tag are not in this set */
+	std::set<std::string> albums;
+	bool missing = false;
+
+	for (const Song &song : directory.songs) {
+		if (song.analysis == nullptr) {
+			missing = true;
+
+			const char *album = GetAlbum(song);
+			if (*album != 0)
+				albums.emplace(album);
+		}
+	}
+
+	if (missing) {
+		Group group;
+		group.directory = directory.GetPath();
+
+		/* songs which have already been analyzed are
+		   analyzed again if they belong to one of these
+		   albums, because the album gain needs all of
+		   them */
+		for (const Song &song : directory.songs) {
+			const char *album = GetAlbum(song);
+			if (song.analysis == nullptr ||
+			    albums.find(album) != albums.end())
+				group.songs.push_back({song.uri, album,
+							song.mtime});
+		}
+
+		groups.emplace_back(std::move(group));
+	}
+
+	for (const auto &child : directory.children)
+		Collect(child);
+}
+
+Song *
+UpdateAnalysis::FindSong(const Group &group, const Item &item)
+{
+	const auto r = db.GetRoot().LookupDirectory(group.directory.c_str());
+	if (r.uri != nullptr || r.directory->IsMount())
+		/* the directory has been deleted */
+		return nullptr;
+
+	Song *song = r.directory->FindSong(item.name.c_str());
+	if (song == nullptr || song->mtime != item.mtime)
+		return nullptr;
+
+	return song;
+}
+
+namespace {
+
+struct AlbumLoudness {
+	LoudnessHistogram histogram;
+	float peak = 0;
+};
+
+}
+
+void
+UpdateAnalysis::AnalyzeGroup(SongAnalyzer &analyzer, const Group &group)
+{
+	std::map<std::string, AlbumLoudness> albums;
+	std::vector<std::pair<AlbumLoudness *, SongAnalysis *>> tracks;
+	std::vector<Result> group_results;
+
+	for (const Item &item : group.songs) {
+		DetachedSong *detached;
+
+		{
+			const ScopeDatabaseLock protect;
+			const Song *song = FindSong(group, item);
+			if (song == nullptr)
+				continue;
+
+			detached = new DetachedSong(DatabaseDetachSong(storage,
+								       song->Export()));
+		}
+
+		FormatDebug(update_domain, "analyzing %s",
+			    detached->GetURI());
+
+		auto *analysis = new SongAnalysis();
+		group_results.push_back({&group, &item,
+				std::shared_ptr<const SongAnalysis>(analysis)});
+
+		if (!analyzer.Analyze(detached, cancel)) {
+			if (cancel)
+				/* discard the incomplete album */
+				return;
+
+			/* store an empty result, so this song will
+			   not be tried again until it is modified */
+			continue;
+		}
+
+		const auto &meter = analyzer.GetLoudness();
+		const double loudness = meter.GetHistogram().GetIntegrated();
+		if (loudness >= MIN_LOUDNESS) {
+			auto &track =
+				analysis->replay_gain.tuples[REPLAY_GAIN_TRACK];
+			track.gain = REFERENCE_LOUDNESS - loudness;
+			track.peak = meter.GetPeak();
+		}
+
+		analysis->mix_ramp = analyzer.GetMixRamp().GetInfo();
+
+		if (!item.album.empty()) {
+			auto &album = albums[item.album];
+			album.histogram.Merge(meter.GetHistogram());
+			album.peak = std::max(album.peak, meter.GetPeak());
+			tracks.emplace_back(&album, analysis);
+		}
+	}
+
+	for (const auto &i : tracks) {
+		const AlbumLoudness &album = *i.first;
+		const double loudness = album.histogram.GetIntegrated();
+		if (loudness >= MIN_LOUDNESS) {
+			auto &tuple =
+				i.second->replay_gain.tuples[REPLAY_GAIN_ALBUM];
+			tuple.gain = REFERENCE_LOUDNESS - loudness;
+			tuple.peak = album.peak;
+		}
+	}
+
+	const ScopeLock protect(mutex);
+	for (auto &i : group_results)
+		results.emplace_back(std::move(i));
+	cond.signal();
+}
+
+void
+UpdateAnalysis::ApplyResults()
+{
+	const ScopeDatabaseLock protect;
+
+	for (auto &i : results) {
+		Song *song = FindSong(*i.group, *i.item);
+		if (song == nullptr)
+			/* deleted or modified meanwhile; the result
+			   is obsolete */
+			continue;
+
+		song->analysis = std::move(i.analysis);
+		song->parent->MarkDirty();
+	}
+
+	results.clear();
+}
+
+inline void
+UpdateAnalysis::Worker()
+{
+	SetThreadName("analysis");
+	SetThreadIdlePriority();
+
+	SongAnalyzer analyzer;
+
+	const ScopeLock protect(mutex);
+
+	while (!cancel && next_group < groups.size()) {
+		const Group &group = groups[next_group++];
+
+		const ScopeUnlock unlock(mutex);
+		AnalyzeGroup(analyzer, group);
+	}
+
+	--n_running;
+	cond.signal();
+}
+
+void
+UpdateAnalysis::Worker(void *ctx)
+{
+	UpdateAnalysis &analysis = *(UpdateAnalysis *)ctx;
+	analysis.Worker();
+}
+
+bool
+UpdateAnalysis::Run()
+{
+	{
+		const ScopeDatabaseLock protect;
+		Collect(db.GetRoot());
+	}
+
+	if (groups.empty())
+		return false;
+
+	size_t n_songs = 0;
+	for (const auto &i : groups)
+		n_songs += i.songs.size();
+
+	FormatDefault(update_domain, "analyzing %u songs", (unsigned)n_songs);
+
+	/* leave one core for the rest of MPD */
+	unsigned n_threads = std::thread::hardware_concurrency();
+	n_threads = n_threads > 1 ? n_threads - 1 : 1;
+	n_threads = std::min<size_t>(n_threads, groups.size());
+
+	std::unique_ptr<Thread[]> threads(new Thread[n_threads]);
+
+	bool modified = false;
+	unsigned last_save = MonotonicClockS();
+
+	{
+		const ScopeLock protect(mutex);
+
+		for (unsigned i = 0; i < n_threads; ++i) {
+			Error error;
+			if (!threads[i].Start(Worker, this, error)) {
+				LogError(error);
+				break;
+			}
+
+			++n_running;
+		}
+
+		while (true) {
+			if (!results.empty()) {
+				ApplyResults();
+				modified = true;
+
+				if (MonotonicClockS() >= last_save + SAVE_INTERVAL) {
+					const ScopeUnlock unlock(mutex);
+
+					try {
+						db.Save();
+					} catch (const std::exception &e) {
+						LogError(e, "Failed to save database");
+					}
+
+					last_save = MonotonicClockS();
+				}
+
+				continue;
+			}
+
+			if (n_running == 0)
+				break;
+
+			cond.wait(mutex);
+		}
+	}
+
+	for (unsigned i = 0; i < n_threads; ++i)
+		if (threads[i].IsDefined())
+			threads[i].Join();
+
+	if (cancel)
+		LogDebug(update_domain, "analysis cancelled");
+	else
+		LogDebug(update_domain, "analysis finished");
+
+	return modified;
+}
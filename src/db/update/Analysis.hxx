@@ -0,0 +1,166 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_UPDATE_ANALYSIS_HXX
+#define MPD_UPDATE_ANALYSIS_HXX
+
+#include "check.h"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "Compiler.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <time.h>
+
+struct Song;
+struct SongAnalysis;
+struct Directory;
+class SimpleDatabase;
+class Storage;
+class SongAnalyzer;
+
+/**
+ * Decode all songs which have not been analyzed yet, measure their
+ * EBU R128 loudness and their MixRamp profile, and store the results
+ * in the database (#Song::analysis).
+ *
+ * Run() is called in the update thread while no update is running,
+ * and all modifications of the database are done in that thread.
+ * The decoders run in worker threads with "idle" priority, one for
+ * each spare CPU core.
+ */
+class UpdateAnalysis final {
+	/**
+	 * A song collected by Collect().  It is identified by its
+	 * name and not by a #Song pointer, because the song may be
+	 * deleted or modified before its result gets applied.
+	 */
+	struct Item {
+		std::string name;
+		std::string album;
+		time_t mtime;
+	};
+
+	/**
+	 * The songs of one directory.  They are analyzed by one
+	 * worker, because the album gain can only be calculated
+	 * after all songs of the album have been decoded.
+	 */
+	struct Group {
+		/**
+		 * The URI of the directory.
+		 */
+		std::string directory;
+
+		std::vector<Item> songs;
+	};
+
+	struct Result {
+		const Group *group;
+		const Item *item;
+		std::shared_ptr<const SongAnalysis> analysis;
+	};
+
+	SimpleDatabase &db;
+	const Storage &storage;
+
+	/**
+	 * Set to true by the main thread when the analysis shall be
+	 * cancelled as quickly as possible.  Access to this flag is
+	 * unprotected.
+	 */
+	volatile bool cancel;
+
+	std::vector<Group> groups;
+
+	Mutex mutex;
+	Cond cond;
+
+	/**
+	 * The index of the next #Group to be picked up by a worker.
+	 * Protected by #mutex.
+	 */
+	size_t next_group;
+
+	/**
+	 * The number of worker threads which are still running.
+	 * Protected by #mutex.
+	 */
+	unsigned n_running;
+
+	/**
+	 * Results of finished groups which have not yet been
+	 * applied to the database.  Protected by #mutex.
+	 */
+	std::vector<Result> results;
+
+public:
+	UpdateAnalysis(SimpleDatabase &_db, const Storage &_storage);
+	~UpdateAnalysis();
+
+	UpdateAnalysis(const UpdateAnalysis &) = delete;
+	UpdateAnalysis &operator=(const UpdateAnalysis &) = delete;
+
+	/**
+	 * Cancel the analysis and quit the Run() method as soon as
+	 * possible.  Results which are already available will still
+	 * be stored.
+	 */
+	void Cancel() {
+		cancel = true;
+	}
+
+	/**
+	 * Returns true if the database was modified.
+	 */
+	bool Run();
+
+private:
+	/**
+	 * Caller must hold the database lock.
+	 */
+	void Collect(const Directory &directory);
+
+	/**
+	 * Look up the #Song of an #Item.  Returns nullptr if the song
+	 * has been deleted or modified since Collect().
+	 *
+	 * Caller must hold the database lock.
+	 */
+	Song *FindSong(const Group &group, const Item &item);
+
+	/**
+	 * Apply all pending results to the database.
+	 *
+	 * Caller must hold #mutex.
+	 */
+	void ApplyResults();
+
+	void AnalyzeGroup(SongAnalyzer &analyzer, const Group &group);
+
+	/* the worker threads */
+	void Worker();
+	static void Worker(void *ctx);
+};
+
+#endif
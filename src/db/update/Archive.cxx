@@ -101,7 +101,8 @@ UpdateWalk::UpdateArchiveTree(ArchiveFile &archive, Directory &directory,
 					    "deleting unrecognized file %s/%s",
 					    directory.GetPath(), name);
 				editor.LockDeleteSong(directory, song);
-			}
+			} else
+				directory.MarkDirty();
 		}
 	}
 }
@@ -174,6 +175,7 @@ UpdateWalk::UpdateArchiveFile(Directory &parent, const char *name,
 	}
 
 	directory->mtime = info.mtime;
+	directory->MarkDirty();
 
 	UpdateArchiveVisitor visitor(*this, *file, directory);
 	file->Visit(visitor);
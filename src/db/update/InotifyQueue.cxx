@@ -22,8 +22,11 @@
 #include "InotifyDomain.hxx"
 #include "Service.hxx"
 #include "Log.hxx"
+#include "system/Clock.hxx"
 #include "util/StringCompare.hxx"
 
+#include <string.h>
+
 /**
  * Wait this long after the last change before calling
  * update_enqueue().  This increases the probability that updates can
@@ -31,6 +34,18 @@
  */
 static constexpr unsigned INOTIFY_UPDATE_DELAY_S = 5;
 
+/**
+ * Don't postpone updates longer than this, even if new events keep
+ * arriving.
+ */
+static constexpr unsigned INOTIFY_MAX_DELAY_S = 60;
+
+/**
+ * If more than this number of files in one directory are queued,
+ * update the whole directory instead.
+ */
+static constexpr unsigned INOTIFY_MAX_FILES_PER_DIRECTORY = 32;
+
 void
 InotifyQueue::OnTimeout()
 {
@@ -53,11 +68,16 @@ InotifyQueue::OnTimeout()
 	}
 }
 
+/**
+ * Is the given path inside the given directory (or the same)?  An
+ * empty string refers to the music directory, which contains
+ * everything.
+ */
 gcc_pure
 static bool
 path_in(const char *path, const char *possible_parent)
 {
-	if (StringIsEmpty(path))
+	if (StringIsEmpty(possible_parent))
 		return true;
 
 	auto rest = StringAfterPrefix(path, possible_parent);
@@ -65,11 +85,54 @@ path_in(const char *path, const char *possible_parent)
 		(StringIsEmpty(rest) || rest[0] == '/');
 }
 
+/**
+ * Is the given path directly inside the given directory?
+ */
+gcc_pure
+static bool
+path_is_direct_child(const char *path, const char *directory)
+{
+	const char *slash = strrchr(path, '/');
+	if (slash == nullptr)
+		return StringIsEmpty(directory);
+
+	const size_t length = slash - path;
+	return strlen(directory) == length &&
+		memcmp(path, directory, length) == 0;
+}
+
 void
 InotifyQueue::Enqueue(const char *uri_utf8)
 {
-	ScheduleSeconds(INOTIFY_UPDATE_DELAY_S);
+	const unsigned now_s = MonotonicClockS();
+	if (queue.empty())
+		oldest_s = now_s;
+
+	if (now_s - oldest_s < INOTIFY_MAX_DELAY_S || !IsActive())
+		ScheduleSeconds(INOTIFY_UPDATE_DELAY_S);
+
+	const char *slash = strrchr(uri_utf8, '/');
+	const std::string parent = slash != nullptr
+		? std::string(uri_utf8, slash)
+		: std::string();
 
+	unsigned n_siblings = 0;
+	for (const auto &i : queue)
+		if (path_is_direct_child(i.c_str(), parent.c_str()))
+			++n_siblings;
+
+	if (n_siblings >= INOTIFY_MAX_FILES_PER_DIRECTORY)
+		/* too many files in this directory; update the
+		   whole directory, which replaces all queued items
+		   inside it */
+		uri_utf8 = parent.c_str();
+
+	Insert(uri_utf8);
+}
+
+void
+InotifyQueue::Insert(const char *uri_utf8)
+{
 	for (auto i = queue.begin(), end = queue.end(); i != end;) {
 		const char *current_uri = i->c_str();
 
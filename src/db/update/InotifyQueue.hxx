@@ -28,18 +28,41 @@
 
 class UpdateService;
 
+/**
+ * Collects paths modified according to inotify, and submits them to
+ * the #UpdateService after things have calmed down.  Nested paths are
+ * merged, and many modified files in one directory are merged into
+ * one update of that directory.
+ */
 class InotifyQueue final : private TimeoutMonitor {
 	UpdateService &update;
 
 	std::list<std::string> queue;
 
+	/**
+	 * The time (MonotonicClockS()) when the oldest item in
+	 * #queue was added.  Used to limit how long a stream of
+	 * events can postpone the update.
+	 */
+	unsigned oldest_s;
+
 public:
 	InotifyQueue(EventLoop &_loop, UpdateService &_update)
 		:TimeoutMonitor(_loop), update(_update) {}
 
+	/**
+	 * @param uri_utf8 the URI of a modified file or directory,
+	 * relative to the music directory; an empty string refers
+	 * to the music directory itself
+	 */
 	void Enqueue(const char *uri_utf8);
 
 private:
+	/**
+	 * Add the URI to #queue, merging it with the existing items.
+	 */
+	void Insert(const char *uri_utf8);
+
 	virtual void OnTimeout() override;
 };
 
@@ -237,9 +237,32 @@ WatchDirectory::GetDepth() const
 	return depth;
 }
 
+/**
+ * Queue an update of the given directory, or just of the given child
+ * if its name is known.
+ */
+static void
+EnqueueChild(const AllocatedPath &uri_fs, const char *name)
+{
+	const auto child_uri_fs = name == nullptr || *name == 0
+		? uri_fs
+		: (uri_fs.IsNull()
+		   ? AllocatedPath::FromFS(name)
+		   : AllocatedPath::Build(uri_fs, name));
+
+	if (child_uri_fs.IsNull()) {
+		inotify_queue->Enqueue("");
+		return;
+	}
+
+	const std::string uri_utf8 = child_uri_fs.ToUTF8();
+	if (!uri_utf8.empty())
+		inotify_queue->Enqueue(uri_utf8.c_str());
+}
+
 static void
 mpd_inotify_callback(int wd, unsigned mask,
-		     gcc_unused const char *name, gcc_unused void *ctx)
+		     const char *name, gcc_unused void *ctx)
 {
 	WatchDirectory *directory;
 
@@ -276,15 +299,10 @@ mpd_inotify_callback(int wd, unsigned mask,
 	    (directory->GetDepth() == inotify_max_depth &&
 	     (mask & (IN_CREATE|IN_ISDIR)) == (IN_CREATE|IN_ISDIR))) {
 		/* a file was changed, or a directory was
-		   moved/deleted: queue a database update */
+		   moved/deleted: queue a database update of just
+		   this file or directory */
 
-		if (!uri_fs.IsNull()) {
-			const std::string uri_utf8 = uri_fs.ToUTF8();
-			if (!uri_utf8.empty())
-				inotify_queue->Enqueue(uri_utf8.c_str());
-		}
-		else
-			inotify_queue->Enqueue("");
+		EnqueueChild(uri_fs, name);
 	}
 }
 
@@ -19,16 +19,49 @@
 
 #include "config.h"
 #include "Queue.hxx"
+#include "util/UriUtil.hxx"
 
-bool
+/**
+ * Does an update of the URI #a include the URI #b?
+ */
+gcc_pure
+static bool
+UpdateIncludes(const char *a, const char *b)
+{
+	return *a == 0 || uri_is_child_or_same(a, b);
+}
+
+/**
+ * Does job #a do everything job #b would do?
+ */
+gcc_pure
+static bool
+UpdateIncludes(const UpdateQueueItem &a, const UpdateQueueItem &b)
+{
+	return a.db == b.db && a.storage == b.storage &&
+		(a.discard || !b.discard) &&
+		UpdateIncludes(a.path_utf8.c_str(), b.path_utf8.c_str());
+}
+
+unsigned
 UpdateQueue::Push(SimpleDatabase &db, Storage &storage,
 		  const char *path, bool discard, unsigned id)
 {
-	if (update_queue.size() >= MAX_UPDATE_QUEUE_SIZE)
-		return false;
+	UpdateQueueItem item(db, storage, path, discard, id);
+
+	for (auto i = update_queue.begin(), end = update_queue.end();
+	     i != end;) {
+		if (UpdateIncludes(*i, item))
+			return i->id;
+
+		if (UpdateIncludes(item, *i))
+			i = update_queue.erase(i);
+		else
+			++i;
+	}
 
-	update_queue.emplace_back(db, storage, path, discard, id);
-	return true;
+	update_queue.emplace_back(std::move(item));
+	return id;
 }
 
 UpdateQueueItem
@@ -52,14 +52,22 @@ struct UpdateQueueItem {
 };
 
 class UpdateQueue {
-	static constexpr unsigned MAX_UPDATE_QUEUE_SIZE = 32;
-
 	std::list<UpdateQueueItem> update_queue;
 
 public:
+	/**
+	 * Add a job to the queue.  If a queued job already covers the
+	 * given path (same path or a parent directory), nothing is
+	 * added.  Queued jobs covered by the new one are removed.
+	 * This keeps the queue small without limiting its size.
+	 *
+	 * @param id the id for the new job
+	 * @return the id of the job which will update the path;
+	 * either the given one or the one of an existing job
+	 */
 	gcc_nonnull_all
-	bool Push(SimpleDatabase &db, Storage &storage,
-		  const char *path, bool discard, unsigned id);
+	unsigned Push(SimpleDatabase &db, Storage &storage,
+		      const char *path, bool discard, unsigned id);
 
 	UpdateQueueItem Pop();
 
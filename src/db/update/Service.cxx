@@ -20,12 +20,15 @@
 #include "config.h"
 #include "Service.hxx"
 #include "Walk.hxx"
+#include "Analysis.hxx"
 #include "UpdateDomain.hxx"
 #include "db/DatabaseListener.hxx"
 #include "db/DatabaseLock.hxx"
 #include "db/plugins/simple/SimpleDatabasePlugin.hxx"
 #include "db/plugins/simple/Directory.hxx"
 #include "storage/CompositeStorage.hxx"
+#include "config/ConfigGlobal.hxx"
+#include "config/ConfigOption.hxx"
 #include "Idle.hxx"
 #include "util/Error.hxx"
 #include "Log.hxx"
@@ -49,7 +52,11 @@ UpdateService::UpdateService(EventLoop &_loop, SimpleDatabase &_db,
 	 listener(_listener),
 	 progress(UPDATE_PROGRESS_IDLE),
 	 update_task_id(0),
-	 walk(nullptr)
+	 walk(nullptr),
+	 analysis_enabled(config_get_bool(ConfigOption::ANALYZE_LOUDNESS,
+					  false)),
+	 analysis_pending(false),
+	 analysis(nullptr)
 {
 }
 
@@ -61,6 +68,7 @@ UpdateService::~UpdateService()
 		update_thread.Join();
 
 	delete walk;
+	delete analysis;
 }
 
 void
@@ -72,11 +80,18 @@ UpdateService::CancelAllAsync()
 
 	if (walk != nullptr)
 		walk->Cancel();
+
+	if (analysis != nullptr)
+		analysis->Cancel();
 }
 
 void
 UpdateService::CancelMount(const char *uri)
 {
+	if (db.IsLoading())
+		/* nothing can be mounted yet */
+		return;
+
 	/* determine which (mounted) database will be updated and what
 	   storage will be scanned */
 
@@ -125,6 +140,8 @@ UpdateService::Task()
 
 	SetThreadIdlePriority();
 
+	next.db->WaitLoaded();
+
 	modified = walk->Walk(next.db->GetRoot(), next.path_utf8.c_str(),
 			      next.discard);
 
@@ -173,6 +190,71 @@ UpdateService::StartThread(UpdateQueueItem &&i)
 		    "spawned thread for update job id %i", next.id);
 }
 
+inline void
+UpdateService::AnalysisTask()
+{
+	assert(analysis != nullptr);
+
+	SetThreadIdlePriority();
+
+	db.WaitLoaded();
+
+	modified = analysis->Run();
+
+	if (modified) {
+		try {
+			db.Save();
+		} catch (const std::exception &e) {
+			LogError(e, "Failed to save database");
+		}
+	}
+
+	progress = UPDATE_PROGRESS_DONE;
+	DeferredMonitor::Schedule();
+}
+
+void
+UpdateService::AnalysisTask(void *ctx)
+{
+	UpdateService &service = *(UpdateService *)ctx;
+	return service.AnalysisTask();
+}
+
+void
+UpdateService::StartAnalysisThread()
+{
+	assert(GetEventLoop().IsInsideOrNull());
+	assert(progress == UPDATE_PROGRESS_IDLE);
+	assert(analysis == nullptr);
+	assert(analysis_pending);
+
+	progress = UPDATE_PROGRESS_RUNNING;
+	modified = false;
+	analysis_pending = false;
+
+	analysis = new UpdateAnalysis(db, storage);
+
+	Error error;
+	if (!update_thread.Start(AnalysisTask, this, error))
+		FatalError(error);
+
+	LogDebug(update_domain, "spawned thread for the analysis");
+}
+
+void
+UpdateService::StartAnalysis()
+{
+	assert(GetEventLoop().IsInsideOrNull());
+
+	if (!analysis_enabled)
+		return;
+
+	analysis_pending = true;
+
+	if (progress == UPDATE_PROGRESS_IDLE)
+		StartAnalysisThread();
+}
+
 unsigned
 UpdateService::GenerateId()
 {
@@ -189,43 +271,44 @@ UpdateService::Enqueue(const char *path, bool discard)
 
 	/* determine which (mounted) database will be updated and what
 	   storage will be scanned */
-	SimpleDatabase *db2;
-	Storage *storage2;
-
-	Directory::LookupResult lr;
-	{
-		const ScopeDatabaseLock protect;
-		lr = db.GetRoot().LookupDirectory(path);
-	}
-
-	if (lr.directory->IsMount()) {
-		/* follow the mountpoint, update the mounted
-		   database */
-
-		Database &_db2 = *lr.directory->mounted_database;
-		if (!_db2.IsPlugin(simple_db_plugin))
-			/* cannot update this type of database */
-			return 0;
-
-		db2 = static_cast<SimpleDatabase *>(&_db2);
-
-		if (lr.uri == nullptr) {
-			storage2 = storage.GetMount(path);
-			path = "";
-		} else {
-			assert(lr.uri > path);
-			assert(lr.uri < path + strlen(path));
-			assert(lr.uri[-1] == '/');
-
-			const std::string mountpoint(path, lr.uri - 1);
-			storage2 = storage.GetMount(mountpoint.c_str());
-			path = lr.uri;
+	/* use the "root" database/storage by default */
+	SimpleDatabase *db2 = &db;
+	Storage *storage2 = storage.GetMount("");
+
+	/* while the database is being loaded, nothing can be mounted
+	   yet, and the lookup would block until loading is finished;
+	   the update thread waits for it */
+	if (!db.IsLoading()) {
+		Directory::LookupResult lr;
+		{
+			const ScopeDatabaseLock protect;
+			lr = db.GetRoot().LookupDirectory(path);
 		}
-	} else {
-		/* use the "root" database/storage */
 
-		db2 = &db;
-		storage2 = storage.GetMount("");
+		if (lr.directory->IsMount()) {
+			/* follow the mountpoint, update the mounted
+			   database */
+
+			Database &_db2 = *lr.directory->mounted_database;
+			if (!_db2.IsPlugin(simple_db_plugin))
+				/* cannot update this type of database */
+				return 0;
+
+			db2 = static_cast<SimpleDatabase *>(&_db2);
+
+			if (lr.uri == nullptr) {
+				storage2 = storage.GetMount(path);
+				path = "";
+			} else {
+				assert(lr.uri > path);
+				assert(lr.uri < path + strlen(path));
+				assert(lr.uri[-1] == '/');
+
+				const std::string mountpoint(path, lr.uri - 1);
+				storage2 = storage.GetMount(mountpoint.c_str());
+				path = lr.uri;
+			}
+		}
 	}
 
 	if (storage2 == nullptr)
@@ -234,11 +317,18 @@ UpdateService::Enqueue(const char *path, bool discard)
 		return 0;
 
 	if (progress != UPDATE_PROGRESS_IDLE) {
-		const unsigned id = GenerateId();
-		if (!queue.Push(*db2, *storage2, path, discard, id))
-			return 0;
+		if (analysis != nullptr) {
+			/* updates have precedence; the analysis will
+			   be resumed afterwards */
+			analysis->Cancel();
+			analysis_pending = true;
+		}
 
-		update_task_id = id;
+		const unsigned new_id = GenerateId();
+		const unsigned id = queue.Push(*db2, *storage2, path, discard,
+					       new_id);
+		if (id == new_id)
+			update_task_id = id;
 		return id;
 	}
 
@@ -257,24 +347,36 @@ void
 UpdateService::RunDeferred()
 {
 	assert(progress == UPDATE_PROGRESS_DONE);
-	assert(next.IsDefined());
-	assert(walk != nullptr);
+	assert(next.IsDefined() == (walk != nullptr));
+	assert((walk != nullptr) != (analysis != nullptr));
 
 	/* wait for thread to finish only if it wasn't cancelled by
 	   CancelMount() */
 	if (update_thread.IsDefined())
 		update_thread.Join();
 
-	delete walk;
-	walk = nullptr;
+	if (walk != nullptr) {
+		delete walk;
+		walk = nullptr;
 
-	next = UpdateQueueItem();
+		next = UpdateQueueItem();
 
-	idle_add(IDLE_UPDATE);
+		idle_add(IDLE_UPDATE);
+
+		if (modified) {
+			/* send "idle" events */
+			listener.OnDatabaseModified();
+
+			/* new songs may need to be analyzed */
+			analysis_pending = analysis_enabled;
+		}
+	} else {
+		delete analysis;
+		analysis = nullptr;
 
-	if (modified)
-		/* send "idle" events */
-		listener.OnDatabaseModified();
+		if (modified)
+			listener.OnDatabaseAnalyzed();
+	}
 
 	auto i = queue.Pop();
 	if (i.IsDefined()) {
@@ -282,5 +384,8 @@ UpdateService::RunDeferred()
 		StartThread(std::move(i));
 	} else {
 		progress = UPDATE_PROGRESS_IDLE;
+
+		if (analysis_pending)
+			StartAnalysisThread();
 	}
 }
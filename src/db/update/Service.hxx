@@ -29,6 +29,7 @@
 class SimpleDatabase;
 class DatabaseListener;
 class UpdateWalk;
+class UpdateAnalysis;
 class CompositeStorage;
 
 /**
@@ -62,6 +63,23 @@ class UpdateService final : DeferredMonitor {
 
 	UpdateWalk *walk;
 
+	/**
+	 * Shall songs be analyzed when no update is running?  See
+	 * the "analyze_loudness" setting.
+	 */
+	const bool analysis_enabled;
+
+	/**
+	 * Are there (possibly) songs which need to be analyzed?
+	 */
+	bool analysis_pending;
+
+	/**
+	 * The analysis which is currently running in the update
+	 * thread, or nullptr.
+	 */
+	UpdateAnalysis *analysis;
+
 public:
 	UpdateService(EventLoop &_loop, SimpleDatabase &_db,
 		      CompositeStorage &_storage,
@@ -100,6 +118,14 @@ public:
 	 */
 	void CancelMount(const char *uri);
 
+	/**
+	 * Analyze all songs which have not been analyzed yet.  This
+	 * is a no-op if the analysis is disabled.  It runs in the
+	 * update thread when there is no update, and it is cancelled
+	 * by new updates (and resumed afterwards).
+	 */
+	void StartAnalysis();
+
 private:
 	/* virtual methods from class DeferredMonitor */
 	virtual void RunDeferred() override;
@@ -110,6 +136,11 @@ private:
 
 	void StartThread(UpdateQueueItem &&i);
 
+	void AnalysisTask();
+	static void AnalysisTask(void *ctx);
+
+	void StartAnalysisThread();
+
 	unsigned GenerateId();
 };
 
@@ -87,7 +87,8 @@ UpdateWalk::UpdateSongFile2(Directory &directory,
 				    "deleting unrecognized file %s/%s",
 				    directory.GetPath(), name);
 			editor.LockDeleteSong(directory, song);
-		}
+		} else
+			directory.MarkDirty();
 
 		modified = true;
 	}
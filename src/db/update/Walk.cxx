@@ -49,6 +49,7 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <memory>
+#include <iterator>
 
 UpdateWalk::UpdateWalk(EventLoop &_loop, DatabaseListener &_listener,
 		       Storage &_storage)
@@ -129,6 +130,7 @@ UpdateWalk::PurgeDeletedFromDirectory(Directory &directory)
 						i->name.c_str())) {
 			const ScopeDatabaseLock protect;
 			i = directory.playlists.erase(i);
+			directory.MarkDirty();
 		} else
 			++i;
 	}
@@ -196,8 +198,10 @@ UpdateWalk::UpdatePlaylistFile(Directory &directory,
 	PlaylistInfo pi(name, info.mtime);
 
 	const ScopeDatabaseLock protect;
-	if (directory.playlists.UpdateOrInsert(std::move(pi)))
+	if (directory.playlists.UpdateOrInsert(std::move(pi))) {
+		directory.MarkDirty();
 		modified = true;
+	}
 	return true;
 }
 
@@ -383,11 +387,26 @@ UpdateWalk::UpdateDirectory(Directory &directory,
 		UpdateDirectoryChild(directory, child_exclude_list, name_utf8, info2);
 	}
 
-	directory.mtime = info.mtime;
+	if (directory.mtime != info.mtime) {
+		directory.mtime = info.mtime;
+		directory.MarkDirty();
+	}
 
 	return true;
 }
 
+void
+UpdateWalk::PushExcludeList(std::forward_list<ExcludeList> &exclude_lists,
+			    const Directory &directory)
+{
+	exclude_lists.emplace_front(exclude_lists.front());
+
+	const auto exclude_path_fs =
+		storage.MapChildFS(directory.GetPath(), ".mpdignore");
+	if (!exclude_path_fs.IsNull())
+		exclude_lists.front().LoadFile(exclude_path_fs);
+}
+
 inline Directory *
 UpdateWalk::DirectoryMakeChildChecked(Directory &parent,
 				      const char *uri_utf8,
@@ -430,7 +449,8 @@ UpdateWalk::DirectoryMakeChildChecked(Directory &parent,
 }
 
 inline Directory *
-UpdateWalk::DirectoryMakeUriParentChecked(Directory &root, const char *uri)
+UpdateWalk::DirectoryMakeUriParentChecked(Directory &root, const char *uri,
+					  std::forward_list<ExcludeList> &exclude_lists)
 {
 	Directory *directory = &root;
 	char *duplicated = xstrdup(uri);
@@ -442,6 +462,19 @@ UpdateWalk::DirectoryMakeUriParentChecked(Directory &root, const char *uri)
 		if (StringIsEmpty(name_utf8))
 			continue;
 
+		/* apply the .mpdignore files of all ancestors, just
+		   like the recursive walk does */
+		PushExcludeList(exclude_lists, *directory);
+
+		const auto name_fs = AllocatedPath::FromUTF8(name_utf8);
+		if (name_fs.IsNull() ||
+		    exclude_lists.front().Check(name_fs)) {
+			modified |= editor.DeleteNameIn(*directory,
+							name_utf8);
+			directory = nullptr;
+			break;
+		}
+
 		directory = DirectoryMakeChildChecked(*directory,
 						      duplicated,
 						      name_utf8);
@@ -451,6 +484,9 @@ UpdateWalk::DirectoryMakeUriParentChecked(Directory &root, const char *uri)
 		name_utf8 = slash + 1;
 	}
 
+	if (directory != nullptr)
+		PushExcludeList(exclude_lists, *directory);
+
 	free(duplicated);
 	return directory;
 }
@@ -458,11 +494,37 @@ UpdateWalk::DirectoryMakeUriParentChecked(Directory &root, const char *uri)
 inline void
 UpdateWalk::UpdateUri(Directory &root, const char *uri)
 try {
-	Directory *parent = DirectoryMakeUriParentChecked(root, uri);
+	std::forward_list<ExcludeList> exclude_lists;
+	exclude_lists.emplace_front();
+
+	Directory *parent = DirectoryMakeUriParentChecked(root, uri,
+							  exclude_lists);
 	if (parent == nullptr)
 		return;
 
 	const char *name = PathTraitsUTF8::GetBase(uri);
+	if (skip_path(name))
+		return;
+
+	const ExcludeList &exclude_list = exclude_lists.front();
+
+	const auto name_fs = AllocatedPath::FromUTF8(name);
+	if (name_fs.IsNull())
+		return;
+
+	if (strcmp(name, ".mpdignore") == 0 || exclude_list.Check(name_fs)) {
+		/* the .mpdignore file has been modified, or this
+		   child is excluded by it: update the whole parent
+		   directory, which applies the .mpdignore file to all
+		   of its children */
+		StorageFileInfo info;
+		if (GetInfo(storage, parent->GetPath(), info) &&
+		    info.IsDirectory())
+			UpdateDirectory(*parent,
+					*std::next(exclude_lists.begin()),
+					info);
+		return;
+	}
 
 	if (SkipSymlink(parent, name)) {
 		modified |= editor.DeleteNameIn(*parent, name);
@@ -475,8 +537,6 @@ try {
 		return;
 	}
 
-	ExcludeList exclude_list;
-
 	UpdateDirectoryChild(*parent, exclude_list, name, info);
 } catch (const std::exception &e) {
 	LogError(e);
@@ -24,6 +24,8 @@
 #include "Editor.hxx"
 #include "Compiler.h"
 
+#include <forward_list>
+
 #include <sys/stat.h>
 
 struct stat;
@@ -150,12 +152,32 @@ private:
 	Directory *MakeDirectoryIfModified(Directory &parent, const char *name,
 					   const StorageFileInfo &info);
 
+	/**
+	 * Create a new #ExcludeList at the front of the given list,
+	 * which inherits the patterns of the previous front and
+	 * loads the .mpdignore file of the given directory.
+	 */
+	void PushExcludeList(std::forward_list<ExcludeList> &exclude_lists,
+			     const Directory &directory);
+
 	Directory *DirectoryMakeChildChecked(Directory &parent,
 					     const char *uri_utf8,
 					     const char *name_utf8);
 
+	/**
+	 * Find or create the parent directory of the given URI.
+	 *
+	 * @param exclude_lists a list which contains one (empty)
+	 * #ExcludeList; on return, its front contains the
+	 * .mpdignore patterns of the parent directory and all its
+	 * ancestors, and the second item lacks the patterns of the
+	 * parent directory itself
+	 * @return the parent directory, or nullptr if it is not
+	 * available or if it is excluded by a .mpdignore file
+	 */
 	Directory *DirectoryMakeUriParentChecked(Directory &root,
-						 const char *uri);
+						 const char *uri,
+						 std::forward_list<ExcludeList> &exclude_lists);
 
 	void UpdateUri(Directory &root, const char *uri);
 };
@@ -58,6 +58,7 @@ decoder_initialized(Decoder &decoder,
 
 	dc.in_audio_format = audio_format;
 	dc.out_audio_format = getOutputAudioFormat(audio_format);
+	dc.out_audio_format.ApplyMask(dc.configured_audio_format);
 
 	dc.seekable = seekable;
 	dc.total_time = duration;
@@ -71,12 +72,15 @@ decoder_initialized(Decoder &decoder,
 			    audio_format_to_string(dc.out_audio_format,
 						   &af_string));
 
-		decoder.convert = new PcmConvert();
+		if (dc.convert == nullptr)
+			dc.convert = new PcmConvert();
 
 		Error error;
-		if (!decoder.convert->Open(dc.in_audio_format,
-					   dc.out_audio_format,
-					   error))
+		if (dc.convert->Open(dc.in_audio_format,
+				     dc.out_audio_format,
+				     error))
+			decoder.convert = dc.convert;
+		else
 			decoder.error = std::move(error);
 	}
 
@@ -448,6 +452,90 @@ update_stream_tag(Decoder &decoder, InputStream *is)
 	return true;
 }
 
+/**
+ * Submits the stream tag (merged with the decoder tag) to the music
+ * pipe if it has changed since the last call.
+ */
+static DecoderCommand
+send_stream_tag(Decoder &decoder, InputStream *is)
+{
+	if (!update_stream_tag(decoder, is))
+		return DecoderCommand::NONE;
+
+	DecoderCommand cmd;
+	if (decoder.decoder_tag != nullptr) {
+		/* merge with tag from decoder plugin */
+		Tag *tag = Tag::Merge(*decoder.decoder_tag,
+				      *decoder.stream_tag);
+		cmd = do_send_tag(decoder, *tag);
+		delete tag;
+	} else
+		/* send only the stream tag */
+		cmd = do_send_tag(decoder, *decoder.stream_tag);
+
+	return cmd;
+}
+
+/**
+ * Returns a writable region of the current chunk (allocating a new
+ * one if necessary).
+ *
+ * @return the region, or an empty buffer if we have received a
+ * decoder command while waiting for a free chunk
+ */
+static WritableBuffer<void>
+get_chunk_tail(Decoder &decoder, uint16_t kbit_rate)
+{
+	DecoderControl &dc = decoder.dc;
+
+	while (true) {
+		MusicChunk *chunk = decoder.GetChunk();
+		if (chunk == nullptr) {
+			assert(dc.command != DecoderCommand::NONE);
+			return nullptr;
+		}
+
+		const auto dest =
+			chunk->Write(dc.out_audio_format,
+				     SongTime::FromS(decoder.timestamp) -
+				     dc.song->GetStartTime(),
+				     kbit_rate);
+		if (!dest.IsEmpty())
+			return dest;
+
+		/* the chunk is full, flush it */
+		decoder.FlushChunk();
+	}
+}
+
+/**
+ * Accounts for #nbytes which have been written to the region
+ * returned by get_chunk_tail(): expands the chunk, flushes it if it
+ * is full and advances the time stamp.
+ */
+static DecoderCommand
+expand_chunk(Decoder &decoder, size_t nbytes)
+{
+	DecoderControl &dc = decoder.dc;
+
+	bool full = decoder.chunk->Expand(dc.out_audio_format, nbytes);
+	if (full) {
+		/* the chunk is full, flush it */
+		decoder.FlushChunk();
+	}
+
+	decoder.timestamp += (double)nbytes /
+		dc.out_audio_format.GetTimeToSize();
+
+	if (dc.end_time.IsPositive() &&
+	    decoder.timestamp >= dc.end_time.ToDoubleS())
+		/* the end of this range has been reached:
+		   stop decoding */
+		return DecoderCommand::STOP;
+
+	return DecoderCommand::NONE;
+}
+
 DecoderCommand
 decoder_data(Decoder &decoder,
 	     InputStream *is,
@@ -471,20 +559,9 @@ decoder_data(Decoder &decoder,
 
 	/* send stream tags */
 
-	if (update_stream_tag(decoder, is)) {
-		if (decoder.decoder_tag != nullptr) {
-			/* merge with tag from decoder plugin */
-			Tag *tag = Tag::Merge(*decoder.decoder_tag,
-					      *decoder.stream_tag);
-			cmd = do_send_tag(decoder, *tag);
-			delete tag;
-		} else
-			/* send only the stream tag */
-			cmd = do_send_tag(decoder, *decoder.stream_tag);
-
-		if (cmd != DecoderCommand::NONE)
-			return cmd;
-	}
+	cmd = send_stream_tag(decoder, is);
+	if (cmd != DecoderCommand::NONE)
+		return cmd;
 
 	if (decoder.convert != nullptr) {
 		assert(dc.in_audio_format != dc.out_audio_format);
@@ -492,7 +569,7 @@ decoder_data(Decoder &decoder,
 		Error error;
 		auto result = decoder.convert->Convert({data, length},
 						       error);
-		if (data == nullptr) {
+		if (result.IsNull()) {
 			/* the PCM conversion has failed - stop
 			   playback, since we have no better way to
 			   bail out */
@@ -507,25 +584,9 @@ decoder_data(Decoder &decoder,
 	}
 
 	while (length > 0) {
-		MusicChunk *chunk;
-		bool full;
-
-		chunk = decoder.GetChunk();
-		if (chunk == nullptr) {
-			assert(dc.command != DecoderCommand::NONE);
+		const auto dest = get_chunk_tail(decoder, kbit_rate);
+		if (dest.IsNull())
 			return dc.command;
-		}
-
-		const auto dest =
-			chunk->Write(dc.out_audio_format,
-				     SongTime::FromS(decoder.timestamp) -
-				     dc.song->GetStartTime(),
-				     kbit_rate);
-		if (dest.IsEmpty()) {
-			/* the chunk is full, flush it */
-			decoder.FlushChunk();
-			continue;
-		}
 
 		const size_t nbytes = std::min(dest.size, length);
 
@@ -533,30 +594,98 @@ decoder_data(Decoder &decoder,
 
 		memcpy(dest.data, data, nbytes);
 
-		/* expand the music pipe chunk */
-
-		full = chunk->Expand(dc.out_audio_format, nbytes);
-		if (full) {
-			/* the chunk is full, flush it */
-			decoder.FlushChunk();
-		}
-
 		data = (const uint8_t *)data + nbytes;
 		length -= nbytes;
 
-		decoder.timestamp += (double)nbytes /
-			dc.out_audio_format.GetTimeToSize();
+		cmd = expand_chunk(decoder, nbytes);
+		if (cmd != DecoderCommand::NONE)
+			return cmd;
+	}
+
+	return DecoderCommand::NONE;
+}
 
-		if (dc.end_time.IsPositive() &&
-		    decoder.timestamp >= dc.end_time.ToDoubleS())
-			/* the end of this range has been reached:
-			   stop decoding */
-			return DecoderCommand::STOP;
+DecoderCommand
+decoder_data_begin(Decoder &decoder, InputStream *is,
+		   WritableBuffer<void> &dest)
+{
+	DecoderControl &dc = decoder.dc;
+
+	assert(dc.state == DecoderState::DECODE);
+	assert(dc.pipe != nullptr);
+
+	dest = nullptr;
+
+	DecoderCommand cmd = decoder_lock_get_virtual_command(decoder);
+	if (cmd == DecoderCommand::STOP || cmd == DecoderCommand::SEEK)
+		return cmd;
+
+	assert(!decoder.initial_seek_pending);
+	assert(!decoder.initial_seek_running);
+
+	cmd = send_stream_tag(decoder, is);
+	if (cmd != DecoderCommand::NONE)
+		return cmd;
+
+	if (decoder.convert != nullptr) {
+		/* the data needs to be converted before it can be
+		   submitted to the music pipe: let the plugin write
+		   into a temporary buffer, and let decoder_data()
+		   do the rest in decoder_data_commit() */
+		assert(dc.in_audio_format != dc.out_audio_format);
+
+		const size_t frame_size = dc.in_audio_format.GetFrameSize();
+		const size_t size = (CHUNK_SIZE / frame_size) *
+			frame_size;
+		dest = { decoder.convert_buffer, size };
+		return DecoderCommand::NONE;
 	}
 
+	assert(dc.in_audio_format == dc.out_audio_format);
+
+	/* the bit rate is not known yet; decoder_data_commit() will
+	   set it */
+	dest = get_chunk_tail(decoder, 0);
+	if (dest.IsNull())
+		return dc.command;
+
 	return DecoderCommand::NONE;
 }
 
+DecoderCommand
+decoder_data_commit(Decoder &decoder, size_t length, uint16_t kbit_rate)
+{
+	gcc_unused const DecoderControl &dc = decoder.dc;
+
+	assert(dc.state == DecoderState::DECODE);
+	assert(length % dc.in_audio_format.GetFrameSize() == 0);
+
+	if (decoder.convert != nullptr) {
+		if (length == 0)
+			return DecoderCommand::NONE;
+
+		/* the stream tag has already been sent by
+		   decoder_data_begin() */
+		return decoder_data(decoder, nullptr,
+				    decoder.convert_buffer, length,
+				    kbit_rate);
+	}
+
+	MusicChunk *chunk = decoder.chunk;
+	assert(chunk != nullptr);
+
+	if (length == 0)
+		return DecoderCommand::NONE;
+
+	if (chunk->length == 0)
+		/* this is the first data in the chunk; the bit rate
+		   was not known when decoder_data_begin() was
+		   called */
+		chunk->bit_rate = kbit_rate;
+
+	return expand_chunk(decoder, length);
+}
+
 DecoderCommand
 decoder_tag(Decoder &decoder, InputStream *is,
 	    Tag &&tag)
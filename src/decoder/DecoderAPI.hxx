@@ -39,6 +39,7 @@
 #include "MixRampInfo.hxx"
 #include "config/Block.hxx"
 #include "Chrono.hxx"
+#include "util/WritableBuffer.hxx"
 
 // IWYU pragma: end_exports
 
@@ -194,6 +195,51 @@ decoder_data(Decoder &decoder, InputStream &is,
 	return decoder_data(decoder, &is, data, length, kbit_rate);
 }
 
+/**
+ * Obtains a buffer which the decoder plugin may decode into directly.
+ * If no PCM conversion is necessary, this is the unused tail of the
+ * current #MusicChunk, and the data will be submitted to the music
+ * pipe without copying it.  Otherwise, it is a temporary buffer, and
+ * decoder_data_commit() falls back to decoder_data().
+ *
+ * The size of the buffer is always a multiple of the frame size, but
+ * it may be smaller than what the plugin has to submit; in that case,
+ * the plugin needs to call this function again after
+ * decoder_data_commit().
+ *
+ * @param decoder the decoder object
+ * @param is an input stream which is buffering while we are waiting
+ * for the player
+ * @param dest receives the writable buffer; it is only valid if
+ * DecoderCommand::NONE is returned
+ * @return the current command, or DecoderCommand::NONE if there is no
+ * command pending
+ */
+DecoderCommand
+decoder_data_begin(Decoder &decoder, InputStream *is,
+		   WritableBuffer<void> &dest);
+
+static inline DecoderCommand
+decoder_data_begin(Decoder &decoder, InputStream &is,
+		   WritableBuffer<void> &dest)
+{
+	return decoder_data_begin(decoder, &is, dest);
+}
+
+/**
+ * Submits data which was written to the buffer returned by
+ * decoder_data_begin().  There must be exactly one call for each
+ * successful decoder_data_begin() call.
+ *
+ * @param length the number of bytes which were written; must be a
+ * multiple of the frame size, and may be zero
+ * @param kbit_rate the current bit rate of the source file
+ * @return the current command, or DecoderCommand::NONE if there is no
+ * command pending
+ */
+DecoderCommand
+decoder_data_commit(Decoder &decoder, size_t length, uint16_t kbit_rate);
+
 /**
  * This function is called by the decoder plugin when it has
  * successfully decoded a tag.
@@ -22,6 +22,7 @@
 #include "DecoderError.hxx"
 #include "MusicPipe.hxx"
 #include "DetachedSong.hxx"
+#include "pcm/PcmConvert.hxx"
 
 #include <assert.h>
 
@@ -29,7 +30,10 @@ DecoderControl::DecoderControl(Mutex &_mutex, Cond &_client_cond)
 	:mutex(_mutex), client_cond(_client_cond),
 	 state(DecoderState::STOP),
 	 command(DecoderCommand::NONE),
+	 idle_priority(false),
 	 client_is_waiting(false),
+	 configured_audio_format(AudioFormat::Undefined()),
+	 convert(nullptr),
 	 song(nullptr),
 	 replay_gain_db(0), replay_gain_prev_db(0) {}
 
@@ -38,6 +42,7 @@ DecoderControl::~DecoderControl()
 	ClearError();
 
 	delete song;
+	delete convert;
 }
 
 void
@@ -40,6 +40,7 @@
 class DetachedSong;
 class MusicBuffer;
 class MusicPipe;
+class PcmConvert;
 
 enum class DecoderState : uint8_t {
 	STOP = 0,
@@ -99,6 +100,12 @@ struct DecoderControl {
 
 	bool quit;
 
+	/**
+	 * Shall the decoder thread run with "idle" priority?  Must be
+	 * set before decoder_thread_start() is called.
+	 */
+	bool idle_priority;
+
 	/**
 	 * Is the client currently waiting for the DecoderThread?  If
 	 * false, the DecoderThread may omit invoking Cond::signal(),
@@ -116,6 +123,20 @@ struct DecoderControl {
 	/** the format being sent to the music pipe */
 	AudioFormat out_audio_format;
 
+	/**
+	 * A mask applied to #out_audio_format.  The client may set
+	 * this if it needs a certain format, e.g. floating point
+	 * samples.
+	 */
+	AudioFormat configured_audio_format;
+
+	/**
+	 * The #PcmConvert instance used by the decoder thread.  It is
+	 * created on demand and kept across songs, so its resamplers
+	 * can be reused.  Only the decoder thread may access it.
+	 */
+	PcmConvert *convert;
+
 	/**
 	 * The song currently being decoded.  This attribute is set by
 	 * the player thread, when it sends the #DecoderCommand::START
@@ -33,10 +33,8 @@ Decoder::~Decoder()
 	/* caller must flush the chunk */
 	assert(chunk == nullptr);
 
-	if (convert != nullptr) {
+	if (convert != nullptr)
 		convert->Close();
-		delete convert;
-	}
 
 	delete song_tag;
 	delete stream_tag;
@@ -21,10 +21,12 @@
 #define MPD_DECODER_INTERNAL_HXX
 
 #include "ReplayGainInfo.hxx"
+#include "MusicChunk.hxx"
 #include "util/Error.hxx"
 
+#include <stdint.h>
+
 class PcmConvert;
-struct MusicChunk;
 struct DecoderControl;
 struct Tag;
 
@@ -33,7 +35,8 @@ struct Decoder {
 
 	/**
 	 * For converting input data to the configured audio format.
-	 * nullptr means no conversion necessary.
+	 * nullptr means no conversion necessary.  This points to
+	 * DecoderControl::convert, which owns the object.
 	 */
 	PcmConvert *convert;
 
@@ -79,6 +82,13 @@ struct Decoder {
 	/** the chunk currently being written to */
 	MusicChunk *chunk;
 
+	/**
+	 * The region handed out by decoder_data_begin() when
+	 * #convert is set: the plugin cannot write into the chunk
+	 * directly, because the data needs to be converted first.
+	 */
+	uint8_t convert_buffer[CHUNK_SIZE];
+
 	ReplayGainInfo replay_gain_info;
 
 	/**
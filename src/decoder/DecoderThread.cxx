@@ -24,6 +24,7 @@
 #include "DecoderError.hxx"
 #include "DecoderPlugin.hxx"
 #include "DetachedSong.hxx"
+#include "SongAnalysis.hxx"
 #include "system/FatalError.hxx"
 #include "MusicPipe.hxx"
 #include "fs/Traits.hxx"
@@ -36,6 +37,7 @@
 #include "util/Error.hxx"
 #include "util/Domain.hxx"
 #include "thread/Name.hxx"
+#include "thread/Util.hxx"
 #include "tag/ApeReplayGain.hxx"
 #include "Log.hxx"
 
@@ -338,6 +340,24 @@ decoder_run_file(Decoder &decoder, const char *uri_utf8, Path path_fs)
 				   });
 }
 
+/**
+ * Submit the results of the loudness analysis stored in the
+ * database.  Tags found in the file itself will override them.
+ */
+static void
+LoadSongAnalysis(Decoder &decoder, const DetachedSong &song)
+{
+	const SongAnalysis *analysis = song.GetAnalysis();
+	if (analysis == nullptr)
+		return;
+
+	if (analysis->replay_gain.IsDefined())
+		decoder_replay_gain(decoder, &analysis->replay_gain);
+
+	if (analysis->mix_ramp.IsDefined())
+		decoder_mixramp(decoder, MixRampInfo(analysis->mix_ramp));
+}
+
 /**
  * Decode a song addressed by a #DetachedSong.
  *
@@ -361,6 +381,8 @@ decoder_run_song(DecoderControl &dc,
 	{
 		const ScopeUnlock unlock(dc.mutex);
 
+		LoadSongAnalysis(decoder, song);
+
 		success = !path_fs.IsNull()
 			? decoder_run_file(decoder, uri, path_fs)
 			: decoder_run_stream(decoder, uri);
@@ -431,6 +453,9 @@ decoder_task(void *arg)
 
 	SetThreadName("decoder");
 
+	if (dc.idle_priority)
+		SetThreadIdlePriority();
+
 	const ScopeLock protect(dc.mutex);
 
 	do {
@@ -0,0 +1,327 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "SeekTable.hxx"
+#include "input/InputStream.hxx"
+#include "config/ConfigGlobal.hxx"
+#include "config/ConfigOption.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/Traits.hxx"
+#include "fs/FileInfo.hxx"
+#include "fs/io/FileReader.hxx"
+#include "fs/io/FileOutputStream.hxx"
+#include "system/ByteOrder.hxx"
+#include "util/Domain.hxx"
+#include "util/Error.hxx"
+#include "Log.hxx"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+static constexpr Domain seek_table_domain("seek_table");
+
+static constexpr char SEEK_TABLE_MAGIC[8] = {
+	'M', 'P', 'D', 'S', 'E', 'E', 'K', '1',
+};
+
+/**
+ * Refuse to load tables larger than this; they are corrupt.
+ */
+static constexpr uint32_t MAX_ENTRIES = 1024 * 1024;
+
+static AllocatedPath seek_cache_directory = AllocatedPath::Null();
+
+bool
+seek_table_global_init(Error &error)
+{
+	seek_cache_directory =
+		config_get_path(ConfigOption::SEEK_CACHE_DIR, error);
+	return !error.IsDefined();
+}
+
+void
+seek_table_global_finish()
+{
+	seek_cache_directory = AllocatedPath::Null();
+}
+
+/**
+ * FNV-1a, used to derive a file name from the URI.
+ */
+gcc_pure
+static uint64_t
+HashString(const char *p, size_t length)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < length; ++i) {
+		hash ^= (uint8_t)p[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+/**
+ * Determine the modification time of a local file.  Returns 0 for
+ * remote URIs; the file size must be good enough for them.
+ */
+gcc_pure
+static int64_t
+GetLocalModificationTime(const char *uri)
+{
+	if (!PathTraitsUTF8::IsAbsolute(uri))
+		return 0;
+
+	const auto path = AllocatedPath::FromUTF8(uri);
+	FileInfo info;
+	if (path.IsNull() || !GetFileInfo(path, info))
+		return 0;
+
+	return info.GetModificationTime();
+}
+
+static void
+ReadFull(Reader &reader, void *_data, size_t size)
+{
+	uint8_t *data = (uint8_t *)_data;
+
+	while (size > 0) {
+		size_t nbytes = reader.Read(data, size);
+		if (nbytes == 0)
+			throw std::runtime_error("Truncated seek table");
+
+		data += nbytes;
+		size -= nbytes;
+	}
+}
+
+static uint32_t
+ReadUint32(Reader &reader)
+{
+	uint32_t value;
+	ReadFull(reader, &value, sizeof(value));
+	return FromLE32(value);
+}
+
+static uint64_t
+ReadUint64(Reader &reader)
+{
+	uint64_t value;
+	ReadFull(reader, &value, sizeof(value));
+	return FromLE64(value);
+}
+
+static void
+WriteUint32(OutputStream &os, uint32_t value)
+{
+	value = ToLE32(value);
+	os.Write(&value, sizeof(value));
+}
+
+static void
+WriteUint64(OutputStream &os, uint64_t value)
+{
+	value = ToLE64(value);
+	os.Write(&value, sizeof(value));
+}
+
+void
+SeekTable::SetFile(const char *plugin, const char *_uri,
+		   uint64_t _size, int64_t _mtime)
+{
+	uri = plugin;
+	uri.push_back(' ');
+	uri.append(_uri);
+	size = _size;
+	mtime = _mtime;
+}
+
+void
+SeekTable::Load(const char *plugin, const InputStream &is)
+{
+	assert(name.empty());
+
+	if (seek_cache_directory.IsNull() || !is.KnownSize())
+		return;
+
+	SetFile(plugin, is.GetURI(), is.GetSize(),
+		GetLocalModificationTime(is.GetURI()));
+
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%016llx.seek",
+		 (unsigned long long)HashString(uri.data(), uri.length()));
+	name = buffer;
+
+	const auto path = AllocatedPath::Build(seek_cache_directory,
+					       name.c_str());
+	FileInfo info;
+	if (!GetFileInfo(path, info))
+		/* not cached yet */
+		return;
+
+	try {
+		FileReader reader(path);
+		if (Read(reader) && !entries.empty())
+			FormatDebug(seek_table_domain,
+				    "loaded %u entries for %s",
+				    unsigned(entries.size()), is.GetURI());
+	} catch (const std::exception &e) {
+		LogError(e);
+	}
+}
+
+void
+SeekTable::Save()
+{
+	if (name.empty() || !modified || entries.empty())
+		return;
+
+	const auto path = AllocatedPath::Build(seek_cache_directory,
+					       name.c_str());
+
+	try {
+		FileOutputStream fos(path);
+		Write(fos);
+		fos.Commit();
+
+		modified = false;
+	} catch (const std::exception &e) {
+		LogError(e);
+	}
+}
+
+bool
+SeekTable::Read(Reader &reader)
+{
+	char magic[sizeof(SEEK_TABLE_MAGIC)];
+	ReadFull(reader, magic, sizeof(magic));
+	if (memcmp(magic, SEEK_TABLE_MAGIC, sizeof(magic)) != 0)
+		throw std::runtime_error("Malformed seek table");
+
+	const auto uri_length = ReadUint32(reader);
+	if (uri_length != uri.length())
+		/* hash collision */
+		return false;
+
+	std::string stored_uri(uri_length, '\0');
+	ReadFull(reader, &stored_uri.front(), uri_length);
+	if (stored_uri != uri ||
+	    ReadUint64(reader) != size ||
+	    int64_t(ReadUint64(reader)) != mtime ||
+	    ReadUint64(reader) != interval)
+		/* a different or modified file; this table will be
+		   overwritten by Save() */
+		return false;
+
+	const auto n = ReadUint32(reader);
+	if (n > MAX_ENTRIES)
+		throw std::runtime_error("Malformed seek table");
+
+	std::vector<Entry> v;
+	v.reserve(n);
+
+	for (uint32_t i = 0; i < n; ++i) {
+		Entry e;
+		e.position = ReadUint64(reader);
+		e.offset = ReadUint64(reader);
+
+		/* positions and offsets grow together, and no
+		   offset may be beyond the end of the file */
+		if (e.offset > size ||
+		    (!v.empty() && (e.position <= v.back().position ||
+				    e.offset < v.back().offset)))
+			throw std::runtime_error("Malformed seek table");
+
+		v.push_back(e);
+	}
+
+	entries = std::move(v);
+	modified = false;
+	return true;
+}
+
+void
+SeekTable::Write(OutputStream &os) const
+{
+	os.Write(SEEK_TABLE_MAGIC, sizeof(SEEK_TABLE_MAGIC));
+	WriteUint32(os, uri.length());
+	os.Write(uri.data(), uri.length());
+	WriteUint64(os, size);
+	WriteUint64(os, mtime);
+	WriteUint64(os, interval);
+	WriteUint32(os, entries.size());
+
+	for (const auto &e : entries) {
+		WriteUint64(os, e.position);
+		WriteUint64(os, e.offset);
+	}
+}
+
+void
+SeekTable::Add(uint64_t position, offset_type offset)
+{
+	if (!entries.empty() &&
+	    position >= entries.back().position) {
+		/* fast path: appending */
+		if (position - entries.back().position < interval)
+			return;
+
+		if (entries.size() >= MAX_ENTRIES)
+			return;
+
+		entries.push_back({position, offset});
+		modified = true;
+		return;
+	}
+
+	/* insert only if this closes a gap */
+	auto i = std::upper_bound(entries.begin(), entries.end(), position,
+				  [](uint64_t p, const Entry &e){
+					  return p < e.position;
+				  });
+	if (i != entries.begin() && position - i[-1].position < interval)
+		return;
+
+	if (i != entries.end() && i->position - position < interval)
+		return;
+
+	if (entries.size() >= MAX_ENTRIES)
+		return;
+
+	entries.insert(i, {position, offset});
+	modified = true;
+}
+
+const SeekTable::Entry *
+SeekTable::Find(uint64_t position) const
+{
+	auto i = std::upper_bound(entries.begin(), entries.end(), position,
+				  [](uint64_t p, const Entry &e){
+					  return p < e.position;
+				  });
+	if (i == entries.begin())
+		return nullptr;
+
+	return &i[-1];
+}
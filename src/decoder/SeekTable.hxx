@@ -0,0 +1,164 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_SEEK_TABLE_HXX
+#define MPD_SEEK_TABLE_HXX
+
+#include "check.h"
+#include "input/Offset.hxx"
+#include "Compiler.h"
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+class Error;
+class InputStream;
+class Reader;
+class OutputStream;
+
+/**
+ * Load the "seek_cache_directory" setting.  Without it, seek tables
+ * are not persisted, but #SeekTable still works in memory.
+ */
+bool
+seek_table_global_init(Error &error);
+
+void
+seek_table_global_finish();
+
+/**
+ * A sparse table which maps stream positions to file offsets.  The
+ * unit of a "position" is chosen by the decoder plugin (e.g. MP3
+ * frames or Ogg granules); all that matters is that it grows
+ * monotonically with the file offset.
+ *
+ * A decoder plugin records positions while it decodes, and uses the
+ * table to jump close to a seek destination without having to scan
+ * or bisect the file.  The table is stored in the seek cache
+ * directory, so subsequent playbacks of the same file can seek right
+ * away.
+ */
+class SeekTable {
+public:
+	struct Entry {
+		uint64_t position;
+		offset_type offset;
+	};
+
+private:
+	/**
+	 * The cache file name; empty if the table shall not be
+	 * persisted.
+	 */
+	std::string name;
+
+	/**
+	 * The identity of the file this table was built for: its URI
+	 * (including the plugin name), its size and its modification
+	 * time (zero for remote files).
+	 */
+	std::string uri;
+	uint64_t size;
+	int64_t mtime;
+
+	/**
+	 * The minimum distance between two entries.
+	 */
+	const uint64_t interval;
+
+	std::vector<Entry> entries;
+
+	/**
+	 * Has the table been modified since it was loaded?
+	 */
+	bool modified;
+
+public:
+	explicit SeekTable(uint64_t _interval)
+		:size(0), mtime(0), interval(_interval), modified(false) {}
+
+	SeekTable(const SeekTable &) = delete;
+	SeekTable &operator=(const SeekTable &) = delete;
+
+	bool IsEmpty() const {
+		return entries.empty();
+	}
+
+	size_t GetSize() const {
+		return entries.size();
+	}
+
+	/**
+	 * Attach the table to the given file, without loading it.
+	 * Load() calls this.
+	 */
+	void SetFile(const char *plugin, const char *_uri,
+		     uint64_t _size, int64_t _mtime);
+
+	/**
+	 * Attach the table to the given file, and load it from the
+	 * cache.  This is a no-op if the cache is disabled or the
+	 * file's size is unknown.
+	 *
+	 * @param plugin the name of the decoder plugin; tables created
+	 * by different plugins use different units
+	 */
+	void Load(const char *plugin, const InputStream &is);
+
+	/**
+	 * Write the table to the cache if it has been modified.
+	 * Errors are logged.
+	 */
+	void Save();
+
+	/**
+	 * Load the table from a stream created by Write().  Throws
+	 * std::exception if it is truncated or malformed.
+	 *
+	 * @return false if the stream belongs to a different file (or
+	 * a different version of it); the table is left unchanged
+	 */
+	bool Read(Reader &reader);
+
+	/**
+	 * Serialize the table.  All numbers are stored in
+	 * little-endian byte order, so the file does not depend on
+	 * the host.  Throws std::exception on error.
+	 */
+	void Write(OutputStream &os) const;
+
+	/**
+	 * Record a position.  It is ignored if there is already an
+	 * entry closer than the interval passed to the constructor.
+	 */
+	void Add(uint64_t position, offset_type offset);
+
+	/**
+	 * Find the last entry whose position is not greater than the
+	 * given one.
+	 *
+	 * @return the entry or nullptr if there is none
+	 */
+	gcc_pure
+	const Entry *Find(uint64_t position) const;
+};
+
+#endif
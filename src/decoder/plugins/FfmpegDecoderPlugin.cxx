@@ -27,7 +27,6 @@
 #include "lib/ffmpeg/Error.hxx"
 #include "lib/ffmpeg/LogError.hxx"
 #include "lib/ffmpeg/Init.hxx"
-#include "lib/ffmpeg/Buffer.hxx"
 #include "../DecoderAPI.hxx"
 #include "FfmpegMetaData.hxx"
 #include "FfmpegIo.hxx"
@@ -39,6 +38,7 @@
 #include "input/InputStream.hxx"
 #include "CheckAudioFormat.hxx"
 #include "util/ConstBuffer.hxx"
+#include "util/WritableBuffer.hxx"
 #include "util/Error.hxx"
 #include "util/Domain.hxx"
 #include "LogV.hxx"
@@ -55,9 +55,17 @@ extern "C" {
 #endif
 }
 
+#include <algorithm>
+
 #include <assert.h>
 #include <string.h>
 
+/**
+ * The number of threads libavcodec may use to decode one stream; 0
+ * lets libavcodec choose.
+ */
+static unsigned ffmpeg_threads;
+
 static AVFormatContext *
 FfmpegOpenInput(AVIOContext *pb,
 		const char *filename,
@@ -74,9 +82,11 @@ FfmpegOpenInput(AVIOContext *pb,
 }
 
 static bool
-ffmpeg_init(gcc_unused const ConfigBlock &block)
+ffmpeg_init(const ConfigBlock &block)
 {
 	FfmpegInit();
+
+	ffmpeg_threads = block.GetBlockValue("threads", 0u);
 	return true;
 }
 
@@ -105,48 +115,76 @@ start_time_fallback(const AVStream &stream)
 }
 
 /**
- * Copy PCM data from a non-empty AVFrame to an interleaved buffer.
+ * Interleave PCM data from a non-empty AVFrame directly into the
+ * buffer obtained from decoder_data_begin().
+ *
+ * @param skip_frames the number of PCM frames to be skipped before
+ * submitting data; it is decremented by the number of frames which
+ * were skipped
  */
-static ConstBuffer<void>
-copy_interleave_frame(const AVCodecContext &codec_context,
-		      const AVFrame &frame,
-		      FfmpegBuffer &global_buffer,
-		      Error &error)
+static DecoderCommand
+FfmpegSendFrame(Decoder &decoder, InputStream &is,
+		const AVCodecContext &codec_context,
+		const AVFrame &frame, size_t pcm_frame_size,
+		uint64_t &skip_frames)
 {
 	assert(frame.nb_samples > 0);
 
-	int plane_size;
-	const int data_size =
-		av_samples_get_buffer_size(&plane_size,
-					   codec_context.channels,
-					   frame.nb_samples,
-					   codec_context.sample_fmt, 1);
-	assert(data_size != 0);
-	if (data_size < 0) {
-		SetFfmpegError(error, data_size);
-		return 0;
-	}
+	size_t position = 0;
+	const size_t end = frame.nb_samples;
 
-	void *output_buffer;
-	if (av_sample_fmt_is_planar(codec_context.sample_fmt) &&
-	    codec_context.channels > 1) {
-		output_buffer = global_buffer.GetT<uint8_t>(data_size);
-		if (output_buffer == nullptr) {
-			/* Not enough memory - shouldn't happen */
-			error.SetErrno(ENOMEM);
-			return 0;
+	if (skip_frames > 0) {
+		if (skip_frames >= end) {
+			skip_frames -= end;
+			return DecoderCommand::NONE;
 		}
 
-		PcmInterleave(output_buffer,
-			      ConstBuffer<const void *>((const void *const*)frame.extended_data,
-							codec_context.channels),
-			      frame.nb_samples,
-			      av_get_bytes_per_sample(codec_context.sample_fmt));
-	} else {
-		output_buffer = frame.extended_data[0];
+		position = skip_frames;
+		skip_frames = 0;
+	}
+
+	const unsigned channels = codec_context.channels;
+	const size_t sample_size =
+		av_get_bytes_per_sample(codec_context.sample_fmt);
+	const bool planar =
+		av_sample_fmt_is_planar(codec_context.sample_fmt) &&
+		channels > 1;
+	const uint16_t kbit_rate = codec_context.bit_rate / 1000;
+
+	while (position < end) {
+		WritableBuffer<void> dest;
+		DecoderCommand cmd = decoder_data_begin(decoder, is, dest);
+		if (cmd != DecoderCommand::NONE)
+			return cmd;
+
+		const size_t n_frames =
+			std::min(dest.size / pcm_frame_size, end - position);
+
+		if (planar) {
+			const void *planes[MAX_CHANNELS];
+			for (unsigned i = 0; i < channels; ++i)
+				planes[i] = frame.extended_data[i] +
+					position * sample_size;
+
+			PcmInterleave(dest.data,
+				      ConstBuffer<const void *>(planes,
+								channels),
+				      n_frames, sample_size);
+		} else
+			memcpy(dest.data,
+			       frame.extended_data[0] +
+			       position * pcm_frame_size,
+			       n_frames * pcm_frame_size);
+
+		position += n_frames;
+
+		cmd = decoder_data_commit(decoder, n_frames * pcm_frame_size,
+					  kbit_rate);
+		if (cmd != DecoderCommand::NONE)
+			return cmd;
 	}
 
-	return { output_buffer, (size_t)data_size };
+	return DecoderCommand::NONE;
 }
 
 /**
@@ -184,6 +222,9 @@ PtsToPcmFrame(uint64_t pts, const AVStream &stream,
  * @param min_frame skip all data before this PCM frame number; this
  * is used after seeking to skip data in an AVPacket until the exact
  * desired time stamp has been reached
+ * @param skip_frames the number of PCM frames which are still to be
+ * skipped; it is calculated from the first packet after seeking,
+ * but the data may be delayed by the codec (e.g. by frame threading)
  */
 static DecoderCommand
 ffmpeg_send_packet(Decoder &decoder, InputStream &is,
@@ -192,25 +233,22 @@ ffmpeg_send_packet(Decoder &decoder, InputStream &is,
 		   const AVStream &stream,
 		   AVFrame &frame,
 		   uint64_t min_frame, size_t pcm_frame_size,
-		   FfmpegBuffer &buffer)
+		   uint64_t &skip_frames)
 {
-	size_t skip_bytes = 0;
-
 	const auto pts = StreamRelativePts(packet, stream);
 	if (pts >= 0) {
 		if (min_frame > 0) {
 			auto cur_frame = PtsToPcmFrame(pts, stream,
 						       codec_context);
-			if (cur_frame < min_frame)
-				skip_bytes = pcm_frame_size * (min_frame - cur_frame);
+			skip_frames = cur_frame < min_frame
+				? min_frame - cur_frame
+				: 0;
 		} else
 			decoder_timestamp(decoder,
 					  FfmpegTimeToDouble(pts,
 							     stream.time_base));
 	}
 
-	Error error;
-
 	DecoderCommand cmd = DecoderCommand::NONE;
 	while (packet.size > 0 && cmd == DecoderCommand::NONE) {
 		int got_frame = 0;
@@ -229,33 +267,41 @@ ffmpeg_send_packet(Decoder &decoder, InputStream &is,
 		if (!got_frame || frame.nb_samples <= 0)
 			continue;
 
-		auto output_buffer =
-			copy_interleave_frame(codec_context, frame,
-					      buffer, error);
-		if (output_buffer.IsNull()) {
-			/* this must be a serious error,
-			   e.g. OOM */
-			LogError(error);
-			return DecoderCommand::STOP;
-		}
-
-		if (skip_bytes > 0) {
-			if (skip_bytes >= output_buffer.size) {
-				skip_bytes -= output_buffer.size;
-				continue;
-			}
+		cmd = FfmpegSendFrame(decoder, is, codec_context, frame,
+				      pcm_frame_size, skip_frames);
+	}
+	return cmd;
+}
 
-			output_buffer.data =
-				(const uint8_t *)output_buffer.data + skip_bytes;
-			output_buffer.size -= skip_bytes;
-			skip_bytes = 0;
-		}
+/**
+ * Obtain the frames which are still buffered inside the codec at the
+ * end of the stream (e.g. by codecs with a delay or by frame
+ * threading), and send them to the decoder API.
+ */
+static DecoderCommand
+FfmpegFlush(Decoder &decoder, InputStream &is,
+	    AVCodecContext &codec_context, AVFrame &frame,
+	    size_t pcm_frame_size, uint64_t &skip_frames)
+{
+	AVPacket packet;
+	av_init_packet(&packet);
+	packet.data = nullptr;
+	packet.size = 0;
 
-		cmd = decoder_data(decoder, is,
-				   output_buffer.data, output_buffer.size,
-				   codec_context.bit_rate / 1000);
+	while (true) {
+		int got_frame = 0;
+		int len = avcodec_decode_audio4(&codec_context,
+						&frame, &got_frame,
+						&packet);
+		if (len < 0 || !got_frame || frame.nb_samples <= 0)
+			return DecoderCommand::NONE;
+
+		DecoderCommand cmd =
+			FfmpegSendFrame(decoder, is, codec_context, frame,
+					pcm_frame_size, skip_frames);
+		if (cmd != DecoderCommand::NONE)
+			return cmd;
 	}
-	return cmd;
 }
 
 gcc_const
@@ -502,6 +548,12 @@ FfmpegDecode(Decoder &decoder, InputStream &input,
 	   values into AVCodecContext.channels - a change that will be
 	   reverted later by avcodec_decode_audio3() */
 
+	/* let libavcodec use multiple threads if the codec supports
+	   it; the frames delayed by frame threading are obtained by
+	   FfmpegFlush() at the end of the stream */
+	codec_context.thread_count = ffmpeg_threads;
+	codec_context.thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
 	const int open_result = avcodec_open2(&codec_context, codec, nullptr);
 	if (open_result < 0) {
 		LogError(ffmpeg_domain, "Could not open codec");
@@ -526,9 +578,9 @@ FfmpegDecode(Decoder &decoder, InputStream &input,
 		return;
 	}
 
-	FfmpegBuffer interleaved_buffer;
+	const size_t pcm_frame_size = audio_format.GetFrameSize();
 
-	uint64_t min_frame = 0;
+	uint64_t min_frame = 0, skip_frames = 0;
 
 	DecoderCommand cmd = decoder_get_command(decoder);
 	while (cmd != DecoderCommand::STOP) {
@@ -547,14 +599,26 @@ FfmpegDecode(Decoder &decoder, InputStream &input,
 			else {
 				avcodec_flush_buffers(&codec_context);
 				min_frame = decoder_seek_where_frame(decoder);
+				skip_frames = 0;
 				decoder_command_finished(decoder);
 			}
 		}
 
 		AVPacket packet;
-		if (av_read_frame(&format_context, &packet) < 0)
-			/* end of file */
+		if (av_read_frame(&format_context, &packet) < 0) {
+			/* end of file, or the read was cancelled by a
+			   decoder command */
+			cmd = decoder_get_command(decoder);
+			if (cmd == DecoderCommand::NONE)
+				cmd = FfmpegFlush(decoder, input,
+						  codec_context, *frame,
+						  pcm_frame_size, skip_frames);
+
+			if (cmd == DecoderCommand::SEEK)
+				continue;
+
 			break;
+		}
 
 #if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(56, 1, 0)
 		FfmpegCheckTag(decoder, input, format_context, audio_stream);
@@ -565,8 +629,8 @@ FfmpegDecode(Decoder &decoder, InputStream &input,
 						 packet, codec_context,
 						 av_stream,
 						 *frame,
-						 min_frame, audio_format.GetFrameSize(),
-						 interleaved_buffer);
+						 min_frame, pcm_frame_size,
+						 skip_frames);
 			min_frame = 0;
 		} else
 			cmd = decoder_get_command(decoder);
@@ -29,6 +29,8 @@
 #include "util/Error.hxx"
 #include "Log.hxx"
 
+#include <algorithm>
+
 flac_data::flac_data(Decoder &_decoder,
 		     InputStream &_input_stream)
 	:FlacInput(_input_stream, &_decoder),
@@ -154,28 +156,42 @@ flac_common_write(struct flac_data *data, const FLAC__Frame * frame,
 		  const FLAC__int32 *const buf[],
 		  FLAC__uint64 nbytes)
 {
-	void *buffer;
 	unsigned bit_rate;
 
 	if (!data->initialized && !flac_got_first_frame(data, &frame->header))
 		return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
 
-	size_t buffer_size = frame->header.blocksize * data->frame_size;
-	buffer = data->buffer.Get(buffer_size);
-
-	flac_convert(buffer, frame->header.channels,
-		     data->audio_format.format, buf,
-		     0, frame->header.blocksize);
-
 	if (nbytes > 0)
 		bit_rate = nbytes * 8 * frame->header.sample_rate /
 			(1000 * frame->header.blocksize);
 	else
 		bit_rate = 0;
 
-	auto cmd = decoder_data(data->decoder, data->input_stream,
-				buffer, buffer_size,
-				bit_rate);
+	/* convert straight into the music chunk; a FLAC block may
+	   span more than one chunk */
+	DecoderCommand cmd = DecoderCommand::NONE;
+	for (unsigned position = 0, end = frame->header.blocksize;
+	     position < end && cmd == DecoderCommand::NONE;) {
+		WritableBuffer<void> dest;
+		cmd = decoder_data_begin(data->decoder, data->input_stream,
+					 dest);
+		if (cmd != DecoderCommand::NONE)
+			break;
+
+		const unsigned n_frames =
+			std::min<size_t>(dest.size / data->frame_size,
+					 end - position);
+
+		flac_convert(dest.data, frame->header.channels,
+			     data->audio_format.format, buf,
+			     position, position + n_frames);
+		position += n_frames;
+
+		cmd = decoder_data_commit(data->decoder,
+					  n_frames * data->frame_size,
+					  bit_rate);
+	}
+
 	data->next_frame += frame->header.blocksize;
 	switch (cmd) {
 	case DecoderCommand::NONE:
@@ -20,6 +20,7 @@
 #include "config.h"
 #include "MadDecoderPlugin.hxx"
 #include "../DecoderAPI.hxx"
+#include "../SeekTable.hxx"
 #include "input/InputStream.hxx"
 #include "config/ConfigGlobal.hxx"
 #include "tag/TagId3.hxx"
@@ -47,6 +48,12 @@
 
 static constexpr unsigned long FRAMES_CUSHION = 2000;
 
+/**
+ * The distance between two #SeekTable entries [MP3 frames].  At
+ * 44.1 kHz, this is roughly one second.
+ */
+static constexpr unsigned long SEEK_TABLE_INTERVAL = 38;
+
 enum mp3_action {
 	DECODE_SKIP = -3,
 	DECODE_BREAK = -2,
@@ -116,14 +123,12 @@ mp3_plugin_init(gcc_unused const ConfigBlock &block)
 
 struct MadDecoder {
 	static constexpr size_t READ_BUFFER_SIZE = 40960;
-	static constexpr size_t MP3_DATA_OUTPUT_BUFFER_SIZE = 2048;
 
 	struct mad_stream stream;
 	struct mad_frame frame;
 	struct mad_synth synth;
 	mad_timer_t timer;
 	unsigned char input_buffer[READ_BUFFER_SIZE];
-	int32_t output_buffer[MP3_DATA_OUTPUT_BUFFER_SIZE];
 	SignedSongTime total_time;
 	SongTime elapsed_time;
 	SongTime seek_time;
@@ -145,6 +150,13 @@ struct MadDecoder {
 	InputStream &input_stream;
 	enum mad_layer layer;
 
+	/**
+	 * Frame offsets beyond #highest_frame, persisted in the seek
+	 * table cache.  Unlike #frame_offsets, this is sparse, and
+	 * it survives the end of this object.
+	 */
+	SeekTable seek_table;
+
 	MadDecoder(Decoder *decoder, InputStream &input_stream);
 	~MadDecoder();
 
@@ -182,7 +194,13 @@ struct MadDecoder {
 	void UpdateTimerNextFrame();
 
 	/**
-	 * Sends the synthesized current frame via decoder_data().
+	 * Handle a SEEK command.
+	 */
+	void HandleSeek(SongTime t);
+
+	/**
+	 * Sends the synthesized current frame via
+	 * decoder_data_begin() and decoder_data_commit().
 	 */
 	DecoderCommand SendPCM(unsigned i, unsigned pcm_length);
 
@@ -206,7 +224,8 @@ MadDecoder::MadDecoder(Decoder *_decoder,
 	 found_replay_gain(false),
 	 found_first_frame(false), decoded_first_frame(false),
 	 decoder(_decoder), input_stream(_input_stream),
-	 layer(mad_layer(0))
+	 layer(mad_layer(0)),
+	 seek_table(SEEK_TABLE_INTERVAL)
 {
 	mad_stream_init(&stream);
 	mad_stream_options(&stream, MAD_OPTION_IGNORECRC);
@@ -868,7 +887,15 @@ MadDecoder::TimeToFrame(SongTime t) const
 void
 MadDecoder::UpdateTimerNextFrame()
 {
-	if (current_frame >= highest_frame) {
+	if (current_frame > highest_frame) {
+		/* we have jumped ahead using the seek table;
+		   frame_offsets and times must not have gaps, so
+		   only the seek table learns about this frame */
+		bit_rate = frame.header.bitrate;
+
+		seek_table.Add(current_frame, ThisFrameOffset());
+		mad_timer_add(&timer, frame.header.duration);
+	} else if (current_frame == highest_frame) {
 		/* record this frame's properties in frame_offsets
 		   (for seeking) and times */
 		bit_rate = frame.header.bitrate;
@@ -880,6 +907,7 @@ MadDecoder::UpdateTimerNextFrame()
 			highest_frame++;
 
 		frame_offsets[current_frame] = ThisFrameOffset();
+		seek_table.Add(current_frame, frame_offsets[current_frame]);
 
 		mad_timer_add(&timer, frame.header.duration);
 		times[current_frame] = timer;
@@ -894,25 +922,29 @@ MadDecoder::UpdateTimerNextFrame()
 DecoderCommand
 MadDecoder::SendPCM(unsigned i, unsigned pcm_length)
 {
-	unsigned max_samples = sizeof(output_buffer) /
-		sizeof(output_buffer[0]) /
-		MAD_NCHANNELS(&frame.header);
+	const unsigned num_channels = MAD_NCHANNELS(&frame.header);
+	const size_t frame_size = sizeof(int32_t) * num_channels;
 
 	while (i < pcm_length) {
+		/* convert straight into the music chunk */
+		WritableBuffer<void> dest;
+		auto cmd = decoder_data_begin(*decoder, input_stream, dest);
+		if (cmd != DecoderCommand::NONE)
+			return cmd;
+
 		unsigned int num_samples = pcm_length - i;
+		const size_t max_samples = dest.size / frame_size;
 		if (num_samples > max_samples)
 			num_samples = max_samples;
 
 		i += num_samples;
 
-		mad_fixed_to_24_buffer(output_buffer, &synth,
+		mad_fixed_to_24_buffer((int32_t *)dest.data, &synth,
 				       i - num_samples, i,
-				       MAD_NCHANNELS(&frame.header));
-		num_samples *= MAD_NCHANNELS(&frame.header);
+				       num_channels);
 
-		auto cmd = decoder_data(*decoder, input_stream, output_buffer,
-					sizeof(output_buffer[0]) * num_samples,
-					bit_rate / 1000);
+		cmd = decoder_data_commit(*decoder, frame_size * num_samples,
+					  bit_rate / 1000);
 		if (cmd != DecoderCommand::NONE)
 			return cmd;
 	}
@@ -972,6 +1004,71 @@ MadDecoder::SyncAndSend()
 	return DecoderCommand::NONE;
 }
 
+void
+MadDecoder::HandleSeek(SongTime t)
+{
+	unsigned long j = TimeToFrame(t);
+	if (j < highest_frame) {
+		if (Seek(frame_offsets[j])) {
+			current_frame = j;
+			decoder_command_finished(*decoder);
+		} else
+			decoder_seek_error(*decoder);
+		return;
+	}
+
+	/* the destination has not been decoded yet; find the
+	   closest frame we know about: the last one recorded in
+	   frame_offsets, one from the seek table or the current
+	   one */
+
+	const unsigned samples_per_frame = 32 * MAD_NSBSAMPLES(&frame.header);
+	const unsigned long target_frame =
+		t.ToScale<uint64_t>(frame.header.samplerate) /
+		samples_per_frame;
+
+	unsigned long start_frame = current_frame <= target_frame
+		? current_frame
+		: 0;
+	offset_type start_offset = 0;
+	bool found = current_frame <= target_frame;
+
+	if (highest_frame > 0 &&
+	    (!found || highest_frame - 1 > start_frame)) {
+		start_frame = highest_frame - 1;
+		start_offset = frame_offsets[start_frame];
+		found = true;
+	}
+
+	const auto *e = seek_table.Find(target_frame);
+	if (e != nullptr && (!found || e->position > start_frame)) {
+		start_frame = e->position;
+		start_offset = e->offset;
+		found = true;
+	}
+
+	if (found && start_frame != current_frame) {
+		if (!Seek(start_offset)) {
+			decoder_seek_error(*decoder);
+			return;
+		}
+
+		current_frame = start_frame;
+		if (current_frame > highest_frame) {
+			/* frame durations are constant within one
+			   file */
+			timer = frame.header.duration;
+			mad_timer_multiply(&timer, current_frame);
+		}
+	}
+
+	/* skip the remaining frames until the destination is
+	   reached */
+	seek_time = t;
+	mute_frame = MUTEFRAME_SEEK;
+	decoder_command_finished(*decoder);
+}
+
 inline bool
 MadDecoder::Read()
 {
@@ -992,19 +1089,7 @@ MadDecoder::Read()
 		if (cmd == DecoderCommand::SEEK) {
 			assert(input_stream.IsSeekable());
 
-			unsigned long j =
-				TimeToFrame(decoder_seek_time(*decoder));
-			if (j < highest_frame) {
-				if (Seek(frame_offsets[j])) {
-					current_frame = j;
-					decoder_command_finished(*decoder);
-				} else
-					decoder_seek_error(*decoder);
-			} else {
-				seek_time = decoder_seek_time(*decoder);
-				mute_frame = MUTEFRAME_SEEK;
-				decoder_command_finished(*decoder);
-			}
+			HandleSeek(decoder_seek_time(*decoder));
 		} else if (cmd != DecoderCommand::NONE)
 			return false;
 	}
@@ -1078,7 +1163,12 @@ mp3_decode(Decoder &decoder, InputStream &input_stream)
 		delete tag;
 	}
 
+	if (input_stream.IsSeekable())
+		data.seek_table.Load("mad", input_stream);
+
 	while (data.Read()) {}
+
+	data.seek_table.Save();
 }
 
 static bool
@@ -50,6 +50,14 @@ public:
 		ogg_sync_reset(&oy);
 	}
 
+	/**
+	 * Returns the number of bytes which have been read from the
+	 * #InputStream, but have not been returned as a page yet.
+	 */
+	size_t GetBuffered() const {
+		return oy.fill - oy.returned;
+	}
+
 	bool Feed(size_t size) {
 		return OggFeed(oy, decoder, is, size);
 	}
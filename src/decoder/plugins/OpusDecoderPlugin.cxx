@@ -25,6 +25,7 @@
 #include "OggFind.hxx"
 #include "OggSyncState.hxx"
 #include "../DecoderAPI.hxx"
+#include "../SeekTable.hxx"
 #include "OggCodec.hxx"
 #include "tag/TagHandler.hxx"
 #include "tag/TagBuilder.hxx"
@@ -46,6 +47,12 @@ static constexpr opus_int32 opus_sample_rate = 48000;
  */
 static constexpr unsigned opus_output_buffer_frames = opus_sample_rate / 4;
 
+/**
+ * The distance between two #SeekTable entries [granules]; this is one
+ * second.
+ */
+static constexpr uint64_t SEEK_TABLE_INTERVAL = opus_sample_rate;
+
 gcc_pure
 static bool
 IsOpusHead(const ogg_packet &packet)
@@ -93,6 +100,12 @@ class MPDOpusDecoder {
 
 	size_t frame_size;
 
+	/**
+	 * Maps granule positions to page offsets; see
+	 * #SEEK_TABLE_INTERVAL.
+	 */
+	SeekTable seek_table;
+
 public:
 	MPDOpusDecoder(Decoder &_decoder,
 		       InputStream &_input_stream)
@@ -100,7 +113,8 @@ public:
 		 opus_decoder(nullptr),
 		 output_buffer(nullptr),
 		 previous_channels(0),
-		 os_initialized(false) {}
+		 os_initialized(false),
+		 seek_table(SEEK_TABLE_INTERVAL) {}
 	~MPDOpusDecoder();
 
 	bool ReadFirstPage(OggSyncState &oy);
@@ -114,6 +128,14 @@ public:
 	DecoderCommand HandleAudio(const ogg_packet &packet);
 
 	bool Seek(OggSyncState &oy, uint64_t where_frame);
+
+	void LoadSeekTable() {
+		seek_table.Load("opus", input_stream);
+	}
+
+	void SaveSeekTable() {
+		seek_table.Save();
+	}
 };
 
 MPDOpusDecoder::~MPDOpusDecoder()
@@ -152,6 +174,14 @@ MPDOpusDecoder::ReadNextPage(OggSyncState &oy)
 	if (page_serialno != os.serialno)
 		ogg_stream_reset_serialno(&os, page_serialno);
 
+	const auto granulepos = ogg_page_granulepos(&page);
+	if (opus_decoder != nullptr && eos_granulepos > 0 &&
+	    previous_channels == 0 && page_serialno == opus_serialno &&
+	    granulepos > 0)
+		/* the next page begins at this granule position */
+		seek_table.Add(granulepos,
+			       input_stream.GetOffset() - oy.GetBuffered());
+
 	ogg_stream_pagein(&os, &page);
 	return true;
 }
@@ -386,6 +416,13 @@ MPDOpusDecoder::Seek(OggSyncState &oy, uint64_t where_frame)
 
 	const ogg_int64_t where_granulepos(where_frame);
 
+	const auto *e = seek_table.Find(where_granulepos);
+	if (e != nullptr &&
+	    where_frame - e->position < 4 * SEEK_TABLE_INTERVAL)
+		/* we know where this page is from a previous
+		   playback */
+		return OggSeekPageAtOffset(oy, os, input_stream, e->offset);
+
 	/* interpolate the file offset where we expect to find the
 	   given granule position */
 	/* TODO: implement binary search */
@@ -412,6 +449,9 @@ mpd_opus_stream_decode(Decoder &decoder,
 	if (!d.ReadFirstPage(oy))
 		return;
 
+	if (input_stream.IsSeekable())
+		d.LoadSeekTable();
+
 	while (true) {
 		auto cmd = d.HandlePackets();
 		if (cmd == DecoderCommand::SEEK) {
@@ -429,6 +469,8 @@ mpd_opus_stream_decode(Decoder &decoder,
 		if (!d.ReadNextPage(oy))
 			break;
 	}
+
+	d.SaveSeekTable();
 }
 
 static bool
@@ -75,6 +75,7 @@ FullyBufferedSocket::Flush()
 	if (output.IsEmpty()) {
 		IdleMonitor::Cancel();
 		CancelWrite();
+		OnSocketDrained();
 	}
 
 	return true;
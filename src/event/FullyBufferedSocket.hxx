@@ -40,6 +40,14 @@ public:
 
 	using BufferedSocket::IsDefined;
 
+	/**
+	 * Has all output been sent to the socket?
+	 */
+	gcc_pure
+	bool IsOutputEmpty() const {
+		return output.IsEmpty();
+	}
+
 	void Close() {
 		IdleMonitor::Cancel();
 		BufferedSocket::Close();
@@ -61,6 +69,12 @@ protected:
 	 */
 	bool Write(const void *data, size_t length);
 
+	/**
+	 * The output buffer has become empty after having been
+	 * filled.  May be overridden to submit more data.
+	 */
+	virtual void OnSocketDrained() {}
+
 	virtual bool OnSocketReady(unsigned flags) override;
 	virtual void OnIdle() override;
 };
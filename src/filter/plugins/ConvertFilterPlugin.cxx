@@ -23,7 +23,6 @@
 #include "filter/FilterInternal.hxx"
 #include "filter/FilterRegistry.hxx"
 #include "pcm/PcmConvert.hxx"
-#include "util/Manual.hxx"
 #include "util/ConstBuffer.hxx"
 #include "AudioFormat.hxx"
 #include "poison.h"
@@ -47,11 +46,21 @@ class ConvertFilter final : public Filter {
 	 */
 	AudioFormat out_audio_format;
 
-	Manual<PcmConvert> state;
+	/**
+	 * This object lives as long as the filter (and not just while
+	 * it is open), so it can reuse its resamplers when the output
+	 * is reopened with a different input format.
+	 */
+	PcmConvert state;
 
 public:
 	bool Set(const AudioFormat &_out_audio_format, Error &error);
 
+	void Prepare(AudioFormat _in_audio_format,
+		     AudioFormat _out_audio_format) {
+		state.Prepare(_in_audio_format, _out_audio_format);
+	}
+
 	virtual AudioFormat Open(AudioFormat &af, Error &error) override;
 	virtual void Close() override;
 	virtual ConstBuffer<void> FilterPCM(ConstBuffer<void> src,
@@ -77,14 +86,14 @@ ConvertFilter::Set(const AudioFormat &_out_audio_format, Error &error)
 
 	if (out_audio_format.IsValid()) {
 		out_audio_format.Clear();
-		state->Close();
+		state.Close();
 	}
 
 	if (_out_audio_format == in_audio_format)
 		/* optimized special case: no-op */
 		return true;
 
-	if (!state->Open(in_audio_format, _out_audio_format, error))
+	if (!state.Open(in_audio_format, _out_audio_format, error))
 		return false;
 
 	out_audio_format = _out_audio_format;
@@ -99,8 +108,6 @@ ConvertFilter::Open(AudioFormat &audio_format, gcc_unused Error &error)
 	in_audio_format = audio_format;
 	out_audio_format.Clear();
 
-	state.Construct();
-
 	return in_audio_format;
 }
 
@@ -110,9 +117,7 @@ ConvertFilter::Close()
 	assert(in_audio_format.IsValid());
 
 	if (out_audio_format.IsValid())
-		state->Close();
-
-	state.Destruct();
+		state.Close();
 
 	poison_undefined(&in_audio_format, sizeof(in_audio_format));
 	poison_undefined(&out_audio_format, sizeof(out_audio_format));
@@ -127,7 +132,7 @@ ConvertFilter::FilterPCM(ConstBuffer<void> src, Error &error)
 		/* optimized special case: no-op */
 		return src;
 
-	return state->Convert(src, error);
+	return state.Convert(src, error);
 }
 
 const struct filter_plugin convert_filter_plugin = {
@@ -143,3 +148,12 @@ convert_filter_set(Filter *_filter, AudioFormat out_audio_format,
 
 	return filter->Set(out_audio_format, error);
 }
+
+void
+convert_filter_prepare(Filter *_filter, AudioFormat in_audio_format,
+		       AudioFormat out_audio_format)
+{
+	ConvertFilter *filter = (ConvertFilter *)_filter;
+
+	filter->Prepare(in_audio_format, out_audio_format);
+}
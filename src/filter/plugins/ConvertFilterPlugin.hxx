@@ -34,4 +34,14 @@ bool
 convert_filter_set(Filter *filter, AudioFormat out_audio_format,
 		   Error &error);
 
+/**
+ * Prepare the filter for a conversion which will probably be
+ * requested soon, e.g. by creating a resampler.  Unlike all other
+ * functions, this may be called from any thread, even while the
+ * filter is being used.
+ */
+void
+convert_filter_prepare(Filter *filter, AudioFormat in_audio_format,
+		       AudioFormat out_audio_format);
+
 #endif
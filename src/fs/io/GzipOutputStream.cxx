@@ -22,7 +22,8 @@
 #include "lib/zlib/Domain.hxx"
 #include "lib/zlib/Error.hxx"
 
-GzipOutputStream::GzipOutputStream(OutputStream &_next) throw(ZlibError)
+GzipOutputStream::GzipOutputStream(OutputStream &_next,
+				   int level) throw(ZlibError)
 	:next(_next)
 {
 	z.next_in = nullptr;
@@ -34,7 +35,7 @@ GzipOutputStream::GzipOutputStream(OutputStream &_next) throw(ZlibError)
 	constexpr int windowBits = 15;
 	constexpr int gzip_encoding = 16;
 
-	int result = deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+	int result = deflateInit2(&z, level, Z_DEFLATED,
 				  windowBits | gzip_encoding,
 				  8, Z_DEFAULT_STRATEGY);
 	if (result != Z_OK)
@@ -69,6 +70,27 @@ GzipOutputStream::Flush()
 	}
 }
 
+void
+GzipOutputStream::SyncFlush()
+{
+	z.next_in = nullptr;
+	z.avail_in = 0;
+
+	do {
+		Bytef output[4096];
+		z.next_out = output;
+		z.avail_out = sizeof(output);
+
+		/* Z_BUF_ERROR means there was nothing to flush */
+		int result = deflate(&z, Z_SYNC_FLUSH);
+		if (result != Z_OK && result != Z_BUF_ERROR)
+			throw ZlibError(result);
+
+		if (z.next_out > output)
+			next.Write(output, z.next_out - output);
+	} while (z.avail_out == 0);
+}
+
 void
 GzipOutputStream::Write(const void *_data, size_t size)
 {
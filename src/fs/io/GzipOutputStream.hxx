@@ -42,8 +42,11 @@ class GzipOutputStream final : public OutputStream {
 public:
 	/**
 	 * Construct the filter.
+	 *
+	 * @param level the zlib compression level
 	 */
-	GzipOutputStream(OutputStream &_next) throw(ZlibError);
+	GzipOutputStream(OutputStream &_next,
+			 int level=Z_DEFAULT_COMPRESSION) throw(ZlibError);
 	~GzipOutputStream();
 
 	/**
@@ -52,6 +55,13 @@ public:
 	 */
 	void Flush();
 
+	/**
+	 * Write all data which has been passed to Write() so far,
+	 * without finishing the stream (Z_SYNC_FLUSH), so the
+	 * receiver can decompress it.
+	 */
+	void SyncFlush();
+
 	/* virtual methods from class OutputStream */
 	void Write(const void *data, size_t size) override;
 };
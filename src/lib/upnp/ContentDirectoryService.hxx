@@ -114,6 +114,16 @@ public:
 	 */
 	std::list<std::string> getSearchCapabilities(UpnpClient_Handle handle) const;
 
+	/** Retrieve the "SystemUpdateID" state variable
+	 *
+	 * The server changes this value whenever any object in the
+	 * content directory is modified; clients may use it to
+	 * invalidate cached data.
+	 *
+	 * Throws std::runtime_error on error.
+	 */
+	std::string getSystemUpdateID(UpnpClient_Handle handle) const;
+
 	gcc_pure
 	std::string GetURI() const {
 		return "upnp://" + m_deviceId + "/" + m_serviceType;
@@ -105,6 +105,10 @@ public:
 			if ((err = pthread_create(&threads[i], 0, workproc, arg))) {
 				LOGERR(("WorkQueue:%s: pthread_create failed, err %d\n",
 					name.c_str(), err));
+
+				/* let setTerminateAndWait() wait only
+				   for the threads which were created */
+				n_threads = i;
 				return false;
 			}
 		}
@@ -59,7 +59,8 @@ AudioOutput::AudioOutput(const AudioOutputPlugin &_plugin)
 	 filter(nullptr),
 	 replay_gain_filter(nullptr),
 	 other_replay_gain_filter(nullptr),
-	 command(Command::NONE)
+	 command(Command::NONE),
+	 open_pending(false)
 {
 	assert(plugin.finish != nullptr);
 	assert(plugin.open != nullptr);
@@ -269,6 +269,12 @@ struct AudioOutput {
 	 */
 	bool current_chunk_finished;
 
+	/**
+	 * Has OpenAsync() submitted a command which has not yet been
+	 * completed by FinishOpen()?  Protected by #mutex.
+	 */
+	bool open_pending;
+
 	AudioOutput(const AudioOutputPlugin &_plugin);
 	~AudioOutput();
 
@@ -343,18 +349,46 @@ struct AudioOutput {
 	void SetReplayGainMode(ReplayGainMode mode);
 
 	/**
+	 * Submit the OPEN or REOPEN command, but don't wait for the
+	 * output thread to finish it; FinishOpen() does that.  This
+	 * allows opening several devices concurrently.
+	 *
 	 * Caller must lock the mutex.
 	 */
-	bool Open(const AudioFormat audio_format, const MusicPipe &mp);
+	void OpenAsync(const AudioFormat audio_format, const MusicPipe &mp);
+
+	/**
+	 * Wait for the command submitted by OpenAsync(), and open the
+	 * mixer.
+	 *
+	 * Caller must lock the mutex.
+	 *
+	 * @return true if the device is open
+	 */
+	bool FinishOpen();
 
 	/**
 	 * Opens or closes the device, depending on the "enabled"
-	 * flag.
+	 * flag.  Opening is only started; the caller must call
+	 * LockFinishUpdate() afterwards.
+	 */
+	void LockUpdateAsync(const AudioFormat audio_format,
+			     const MusicPipe &mp);
+
+	/**
+	 * Finish the operation started by LockUpdateAsync().
 	 *
 	 * @return true if the device is open
 	 */
-	bool LockUpdate(const AudioFormat audio_format,
-			const MusicPipe &mp);
+	bool LockFinishUpdate();
+
+	/**
+	 * The player expects that this output will soon be opened
+	 * with the given input format: let the convert filter create
+	 * its resampler now, so the song border doesn't have to wait
+	 * for it.  May be called while the output is playing.
+	 */
+	void Prepare(AudioFormat audio_format);
 
 	void LockPlay();
 
@@ -31,14 +31,24 @@
 #include "config/ConfigGlobal.hxx"
 #include "config/ConfigOption.hxx"
 #include "notify.hxx"
+#include "Log.hxx"
+
+#include <algorithm>
 
 #include <assert.h>
 #include <string.h>
 
+/**
+ * The default maximum duration of the playback history [seconds].
+ */
+static constexpr unsigned DEFAULT_SEEK_HISTORY = 5;
+
 MultipleOutputs::MultipleOutputs(MixerListener &_mixer_listener)
 	:mixer_listener(_mixer_listener),
 	 input_audio_format(AudioFormat::Undefined()),
 	 buffer(nullptr), pipe(nullptr),
+	 history_seconds(DEFAULT_SEEK_HISTORY),
+	 use_shared_filter(false),
 	 elapsed_time(SignedSongTime::Negative())
 {
 }
@@ -92,6 +102,9 @@ MultipleOutputs::Configure(EventLoop &event_loop, PlayerControl &pc)
 					 pc, empty);
 		outputs.push_back(output);
 	}
+
+	history_seconds = config_get_unsigned(ConfigOption::SEEK_HISTORY,
+					      DEFAULT_SEEK_HISTORY);
 }
 
 AudioOutput *
@@ -168,13 +181,26 @@ bool
 MultipleOutputs::Update()
 {
 	bool ret = false;
+	unsigned n_shared = 0;
 
 	if (!input_audio_format.IsDefined())
 		return false;
 
+	/* submit all OPEN commands before waiting for them, so slow
+	   devices are opened concurrently */
 	for (auto ao : outputs)
-		ret = ao->LockUpdate(input_audio_format, *pipe)
-			|| ret;
+		ao->LockUpdateAsync(input_audio_format, *pipe);
+
+	for (auto ao : outputs) {
+		if (ao->LockFinishUpdate()) {
+			ret = true;
+
+			if (ao->replay_gain_filter != nullptr)
+				++n_shared;
+		}
+	}
+
+	use_shared_filter = n_shared >= 2 && shared_filter.IsOpen();
 
 	return ret;
 }
@@ -184,6 +210,15 @@ MultipleOutputs::SetReplayGainMode(ReplayGainMode mode)
 {
 	for (auto ao : outputs)
 		ao->SetReplayGainMode(mode);
+
+	shared_filter.SetReplayGainMode(mode);
+}
+
+void
+MultipleOutputs::Prepare(AudioFormat audio_format)
+{
+	for (auto ao : outputs)
+		ao->Prepare(audio_format);
 }
 
 bool
@@ -200,6 +235,9 @@ MultipleOutputs::Play(MusicChunk *chunk, Error &error)
 		return false;
 	}
 
+	if (use_shared_filter)
+		shared_filter.Prepare(*chunk);
+
 	pipe->Push(chunk);
 
 	for (auto ao : outputs)
@@ -226,13 +264,37 @@ MultipleOutputs::Open(const AudioFormat audio_format,
 
 	if (pipe == nullptr)
 		pipe = new MusicPipe();
-	else
+	else {
 		/* if the pipe hasn't been cleared, the the audio
 		   format must not have changed */
 		assert(pipe->IsEmpty() || audio_format == input_audio_format);
 
+		if (audio_format != input_audio_format)
+			ClearHistory();
+	}
+
+	if (audio_format != input_audio_format)
+		shared_filter.Close();
+
 	input_audio_format = audio_format;
 
+	if (!shared_filter.IsOpen()) {
+		Error filter_error;
+		if (!shared_filter.Open(audio_format, filter_error))
+			/* not fatal: each output applies its own
+			   filters */
+			FormatDebug(output_domain,
+				    "Shared filter disabled: %s",
+				    filter_error.GetMessage());
+	}
+
+	/* keep a few seconds, but don't occupy more than a quarter
+	   of the buffer */
+	history.SetMaxSize(std::min<unsigned>(buffer->GetSize() / 4,
+					      history_seconds *
+					      audio_format.GetTimeToSize() /
+					      CHUNK_SIZE));
+
 	ResetReopen();
 	EnableDisable();
 	Update();
@@ -363,8 +425,10 @@ MultipleOutputs::Check()
 				if (locked[i])
 					outputs[i]->mutex.unlock();
 
-		/* return the chunk to the buffer */
-		buffer->Return(shifted);
+		shared_filter.Release(*shifted);
+
+		/* keep the chunk for Rewind() */
+		history.Push(*buffer, shifted);
 	}
 
 	return 0;
@@ -418,8 +482,10 @@ MultipleOutputs::Cancel()
 
 	/* clear the music pipe and return all chunks to the buffer */
 
-	if (pipe != nullptr)
-		pipe->Clear(*buffer);
+	if (pipe != nullptr) {
+		ClearPipe();
+		ClearHistory();
+	}
 
 	/* the audio outputs are now waiting for a signal, to
 	   synchronize the cleared music pipe */
@@ -437,13 +503,7 @@ MultipleOutputs::Close()
 	for (auto ao : outputs)
 		ao->LockCloseWait();
 
-	if (pipe != nullptr) {
-		assert(buffer != nullptr);
-
-		pipe->Clear(*buffer);
-		delete pipe;
-		pipe = nullptr;
-	}
+	DeletePipe();
 
 	buffer = nullptr;
 
@@ -458,24 +518,92 @@ MultipleOutputs::Release()
 	for (auto ao : outputs)
 		ao->LockRelease();
 
+	DeletePipe();
+
+	buffer = nullptr;
+
+	input_audio_format.Clear();
+
+	elapsed_time = SignedSongTime::Negative();
+}
+
+void
+MultipleOutputs::Rewind(MusicPipe &dest)
+{
+	if (pipe == nullptr) {
+		Cancel();
+		return;
+	}
+
+	/* move the chunks which have been played completely to the
+	   history */
+	Check();
+
+	for (auto ao : outputs)
+		ao->LockCancelAsync();
+
+	WaitAll();
+
+	MusicPipe queued;
+	MusicChunk *chunk;
+	while ((chunk = pipe->Shift()) != nullptr) {
+		shared_filter.Release(*chunk);
+		queued.Push(chunk);
+	}
+
+	history.Rewind(*buffer, queued, dest);
+
+	AllowPlay();
+
+	elapsed_time = SignedSongTime::Negative();
+}
+
+bool
+MultipleOutputs::CanRewind(const MusicPipe &dest, SongTime where) const
+{
+	return pipe != nullptr &&
+		history.Contains(dest, input_audio_format, where);
+}
+
+void
+MultipleOutputs::SkipTo(MusicPipe &dest, SongTime where)
+{
+	history.Skip(*buffer, dest, input_audio_format, where);
+}
+
+void
+MultipleOutputs::ClearPipe()
+{
+	MusicChunk *chunk;
+	while ((chunk = pipe->Shift()) != nullptr) {
+		shared_filter.Release(*chunk);
+		buffer->Return(chunk);
+	}
+}
+
+void
+MultipleOutputs::DeletePipe()
+{
 	if (pipe != nullptr) {
 		assert(buffer != nullptr);
 
-		pipe->Clear(*buffer);
+		ClearPipe();
 		delete pipe;
 		pipe = nullptr;
-	}
-
-	buffer = nullptr;
 
-	input_audio_format.Clear();
+		ClearHistory();
+	}
 
-	elapsed_time = SignedSongTime::Negative();
+	shared_filter.Close();
+	use_shared_filter = false;
 }
 
 void
 MultipleOutputs::SongBorder()
 {
+	/* the history belongs to the previous song */
+	ClearHistory();
+
 	/* clear the elapsed_time pointer at the beginning of a new
 	   song */
 	elapsed_time = SignedSongTime::zero();
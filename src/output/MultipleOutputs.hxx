@@ -26,8 +26,10 @@
 #ifndef OUTPUT_ALL_H
 #define OUTPUT_ALL_H
 
+#include "SharedFilter.hxx"
 #include "AudioFormat.hxx"
 #include "ReplayGainInfo.hxx"
+#include "MusicHistory.hxx"
 #include "Chrono.hxx"
 #include "Compiler.h"
 
@@ -63,6 +65,29 @@ class MultipleOutputs {
 	 */
 	MusicPipe *pipe;
 
+	/**
+	 * Chunks which have been played already; see Rewind().
+	 */
+	MusicHistory history;
+
+	/**
+	 * The configured maximum duration of #history [seconds].
+	 */
+	unsigned history_seconds;
+
+	/**
+	 * Applies replay gain and cross-fading once for all audio
+	 * outputs.
+	 */
+	SharedFilter shared_filter;
+
+	/**
+	 * Shall Play() run #shared_filter?  This is only worth it if
+	 * at least two open outputs can use the result.  Updated by
+	 * Update().
+	 */
+	bool use_shared_filter;
+
 	/**
 	 * The "elapsed_time" stamp of the most recently finished
 	 * chunk.
@@ -140,6 +165,13 @@ public:
 
 	void SetReplayGainMode(ReplayGainMode mode);
 
+	/**
+	 * Announce the audio format of the next song, so the outputs
+	 * can prepare their format conversion.  See
+	 * AudioOutput::Prepare().
+	 */
+	void Prepare(AudioFormat audio_format);
+
 	/**
 	 * Enqueue a #MusicChunk object for playing, i.e. pushes it to a
 	 * #MusicPipe.
@@ -184,6 +216,28 @@ public:
 	 */
 	void Cancel();
 
+	/**
+	 * Cancel playback like Cancel(), but instead of discarding
+	 * the chunks which have been played recently (#history) or
+	 * have not been played yet, move them to the head of the
+	 * given pipe.  The caller is then expected to call SkipTo().
+	 */
+	void Rewind(MusicPipe &dest);
+
+	/**
+	 * Can Rewind() and SkipTo() reach the given position, i.e. is
+	 * it in #history or in the given pipe (which continues
+	 * #pipe)?
+	 */
+	gcc_pure
+	bool CanRewind(const MusicPipe &dest, SongTime where) const;
+
+	/**
+	 * After Rewind(), skip the chunks before the given position.
+	 * They become part of the history.
+	 */
+	void SkipTo(MusicPipe &dest, SongTime where);
+
 	/**
 	 * Indicate that a new song will begin now.
 	 */
@@ -230,6 +284,13 @@ public:
 	 */
 	void SetSoftwareVolume(unsigned volume);
 
+	/**
+	 * Resets the "reopen" flag on all audio devices.  MPD should
+	 * immediately retry to open the device instead of waiting for
+	 * the timeout when the user wants to start playback.
+	 */
+	void ResetReopen();
+
 private:
 	/**
 	 * Determine if all (active) outputs have finished the current
@@ -245,12 +306,19 @@ private:
 	 */
 	void AllowPlay();
 
+	void ClearHistory() {
+		history.Clear(*buffer);
+	}
+
 	/**
-	 * Resets the "reopen" flag on all audio devices.  MPD should
-	 * immediately retry to open the device instead of waiting for
-	 * the timeout when the user wants to start playback.
+	 * Return all chunks in #pipe to the buffer.
 	 */
-	void ResetReopen();
+	void ClearPipe();
+
+	/**
+	 * Clear and free #pipe, and clear #history.
+	 */
+	void DeletePipe();
 
 	/**
 	 * Opens all output devices which are enabled, but closed.
@@ -24,6 +24,7 @@
 #include "mixer/MixerControl.hxx"
 #include "notify.hxx"
 #include "filter/plugins/ReplayGainFilterPlugin.hxx"
+#include "filter/plugins/ConvertFilterPlugin.hxx"
 #include "util/Error.hxx"
 #include "Log.hxx"
 
@@ -112,11 +113,12 @@ AudioOutput::LockDisableWait()
 	LockCommandWait(Command::DISABLE);
 }
 
-inline bool
-AudioOutput::Open(const AudioFormat audio_format, const MusicPipe &mp)
+inline void
+AudioOutput::OpenAsync(const AudioFormat audio_format, const MusicPipe &mp)
 {
 	assert(allow_play);
 	assert(audio_format.IsValid());
+	assert(!open_pending);
 
 	fail_timer.Reset();
 
@@ -137,7 +139,7 @@ AudioOutput::Open(const AudioFormat audio_format, const MusicPipe &mp)
 			CommandWait(Command::CANCEL);
 		}
 
-		return true;
+		return;
 	}
 
 	in_audio_format = audio_format;
@@ -148,9 +150,21 @@ AudioOutput::Open(const AudioFormat audio_format, const MusicPipe &mp)
 	if (!thread.IsDefined())
 		StartThread();
 
-	CommandWait(open
-		    ? Command::REOPEN
-		    : Command::OPEN);
+	CommandAsync(open
+		     ? Command::REOPEN
+		     : Command::OPEN);
+	open_pending = true;
+}
+
+inline bool
+AudioOutput::FinishOpen()
+{
+	if (!open_pending)
+		return open;
+
+	WaitForCommand();
+	open_pending = false;
+
 	const bool open2 = open;
 
 	if (open2 && mixer != nullptr) {
@@ -179,21 +193,43 @@ AudioOutput::CloseWait()
 		fail_timer.Reset();
 }
 
-bool
-AudioOutput::LockUpdate(const AudioFormat audio_format,
-			const MusicPipe &mp)
+void
+AudioOutput::LockUpdateAsync(const AudioFormat audio_format,
+			     const MusicPipe &mp)
 {
 	const ScopeLock protect(mutex);
 
 	if (enabled && really_enabled) {
 		if (!fail_timer.IsDefined() ||
-		    fail_timer.Check(REOPEN_AFTER * 1000)) {
-			return Open(audio_format, mp);
-		}
+		    fail_timer.Check(REOPEN_AFTER * 1000))
+			OpenAsync(audio_format, mp);
 	} else if (IsOpen())
 		CloseWait();
+}
+
+bool
+AudioOutput::LockFinishUpdate()
+{
+	const ScopeLock protect(mutex);
+	return FinishOpen();
+}
+
+void
+AudioOutput::Prepare(const AudioFormat audio_format)
+{
+	assert(audio_format.IsValid());
+
+	if (convert_filter == nullptr)
+		return;
+
+	/* this is what Open() will pass to the convert filter,
+	   unless the output plugin modifies the format */
+	AudioFormat filter_out_format = audio_format;
+	filter_out_format.ApplyMask(config_audio_format);
 
-	return false;
+	if (filter_out_format != audio_format)
+		convert_filter_prepare(convert_filter, audio_format,
+				       filter_out_format);
 }
 
 void
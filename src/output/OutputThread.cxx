@@ -387,8 +387,39 @@ ao_chunk_data(AudioOutput *ao, const MusicChunk *chunk,
 	return data;
 }
 
+/**
+ * Obtain the data which was prepared by #SharedFilter, i.e. with
+ * replay gain and cross-fading already applied.
+ *
+ * @return the data or nullptr if it is not available for this
+ * audio output
+ */
 static ConstBuffer<void>
-ao_filter_chunk(AudioOutput *ao, const MusicChunk *chunk)
+ao_prepared_data(AudioOutput *ao, const MusicChunk *chunk)
+{
+	if (chunk->prepared == nullptr ||
+	    ao->replay_gain_filter == nullptr)
+		return nullptr;
+
+	/* the filter does not process the data, but it needs the
+	   replay gain info anyway, in case it controls a hardware
+	   mixer */
+	if (chunk->replay_gain_serial != ao->replay_gain_serial) {
+		replay_gain_filter_set_info(ao->replay_gain_filter,
+					    chunk->replay_gain_serial != 0
+					    ? &chunk->replay_gain_info
+					    : nullptr);
+		ao->replay_gain_serial = chunk->replay_gain_serial;
+	}
+
+	return { chunk->prepared->data, chunk->prepared->length };
+}
+
+/**
+ * Apply replay gain and cross-fading to the chunk.
+ */
+static ConstBuffer<void>
+ao_mix_chunk(AudioOutput *ao, const MusicChunk *chunk)
 {
 	ConstBuffer<void> data =
 		ao_chunk_data(ao, chunk, ao->replay_gain_filter,
@@ -441,6 +472,19 @@ ao_filter_chunk(AudioOutput *ao, const MusicChunk *chunk)
 		data.size = other_data.size;
 	}
 
+	return data;
+}
+
+static ConstBuffer<void>
+ao_filter_chunk(AudioOutput *ao, const MusicChunk *chunk)
+{
+	ConstBuffer<void> data = ao_prepared_data(ao, chunk);
+	if (data.IsNull()) {
+		data = ao_mix_chunk(ao, chunk);
+		if (data.IsEmpty())
+			return data;
+	}
+
 	/* apply filter chain */
 
 	Error error;
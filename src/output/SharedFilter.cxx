@@ -0,0 +1,206 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "SharedFilter.hxx"
+#include "Domain.hxx"
+#include "MusicChunk.hxx"
+#include "filter/FilterPlugin.hxx"
+#include "filter/FilterRegistry.hxx"
+#include "filter/FilterInternal.hxx"
+#include "filter/plugins/ReplayGainFilterPlugin.hxx"
+#include "config/Block.hxx"
+#include "pcm/PcmMix.hxx"
+#include "util/ConstBuffer.hxx"
+#include "util/Error.hxx"
+#include "Log.hxx"
+
+#include <assert.h>
+#include <string.h>
+
+/**
+ * The number of chunks reserved for processed data.  This must be
+ * larger than the maximum length of the outputs' #MusicPipe (see
+ * Player::PlayNextChunk()); if it is exhausted nonetheless, the
+ * audio outputs do the work.
+ */
+static constexpr unsigned SHARED_FILTER_CHUNKS = 128;
+
+static Filter *
+CreateReplayGainFilter()
+{
+	const ConfigBlock empty;
+	Filter *filter = filter_new(&replay_gain_filter_plugin, empty,
+				    IgnoreError());
+	assert(filter != nullptr);
+	return filter;
+}
+
+SharedFilter::SharedFilter()
+	:buffer(SHARED_FILTER_CHUNKS),
+	 replay_gain_filter(CreateReplayGainFilter()),
+	 other_replay_gain_filter(CreateReplayGainFilter()),
+	 replay_gain_serial(0), other_replay_gain_serial(0),
+	 audio_format(AudioFormat::Undefined())
+{
+}
+
+SharedFilter::~SharedFilter()
+{
+	assert(!IsOpen());
+
+	delete replay_gain_filter;
+	delete other_replay_gain_filter;
+}
+
+bool
+SharedFilter::Open(const AudioFormat _audio_format, Error &error)
+{
+	assert(!IsOpen());
+	assert(_audio_format.IsValid());
+
+	AudioFormat af = _audio_format;
+	if (!replay_gain_filter->Open(af, error).IsDefined())
+		return false;
+
+	af = _audio_format;
+	if (!other_replay_gain_filter->Open(af, error).IsDefined()) {
+		replay_gain_filter->Close();
+		return false;
+	}
+
+	audio_format = _audio_format;
+	return true;
+}
+
+void
+SharedFilter::Close()
+{
+	if (!IsOpen())
+		return;
+
+	replay_gain_filter->Close();
+	other_replay_gain_filter->Close();
+	audio_format.Clear();
+}
+
+void
+SharedFilter::SetReplayGainMode(ReplayGainMode mode)
+{
+	replay_gain_filter_set_mode(replay_gain_filter, mode);
+	replay_gain_filter_set_mode(other_replay_gain_filter, mode);
+}
+
+/**
+ * Apply a replay gain filter to the chunk.  This is the same as
+ * ao_chunk_data() does for each audio output.
+ */
+static ConstBuffer<void>
+ApplyReplayGain(Filter *filter, unsigned &serial,
+		const MusicChunk &chunk, Error &error)
+{
+	ConstBuffer<void> data(chunk.data, chunk.length);
+	if (data.IsEmpty())
+		return data;
+
+	if (chunk.replay_gain_serial != serial) {
+		replay_gain_filter_set_info(filter,
+					    chunk.replay_gain_serial != 0
+					    ? &chunk.replay_gain_info
+					    : nullptr);
+		serial = chunk.replay_gain_serial;
+	}
+
+	return filter->FilterPCM(data, error);
+}
+
+void
+SharedFilter::Prepare(MusicChunk &chunk)
+{
+	assert(chunk.prepared == nullptr);
+
+	if (!IsOpen() || chunk.length == 0)
+		return;
+
+	Error error;
+	ConstBuffer<void> data =
+		ApplyReplayGain(replay_gain_filter, replay_gain_serial,
+				chunk, error);
+	if (data.IsNull()) {
+		LogError(error);
+		return;
+	}
+
+	ConstBuffer<void> other_data = nullptr;
+	if (chunk.other != nullptr) {
+		other_data = ApplyReplayGain(other_replay_gain_filter,
+					     other_replay_gain_serial,
+					     *chunk.other, error);
+		if (other_data.IsNull()) {
+			LogError(error);
+			return;
+		}
+	}
+
+	if (other_data.IsEmpty() && data.data == chunk.data)
+		/* the replay gain filter was a no-op and there's
+		   nothing to mix; the audio outputs can use the
+		   chunk as-is */
+		return;
+
+	MusicChunk *prepared = buffer.Allocate();
+	if (prepared == nullptr)
+		return;
+
+	if (!other_data.IsEmpty()) {
+		/* see ao_filter_chunk() */
+
+		if (data.size > other_data.size)
+			data.size = other_data.size;
+
+		float mix_ratio = chunk.mix_ratio;
+		if (mix_ratio >= 0)
+			mix_ratio = 1.0 - mix_ratio;
+
+		memcpy(prepared->data, other_data.data, other_data.size);
+		if (!pcm_mix(cross_fade_dither, prepared->data,
+			     data.data, data.size,
+			     audio_format.format, mix_ratio)) {
+			/* let the audio outputs report the error */
+			buffer.Return(prepared);
+			return;
+		}
+
+		prepared->length = other_data.size;
+	} else {
+		memcpy(prepared->data, data.data, data.size);
+		prepared->length = data.size;
+	}
+
+	chunk.prepared = prepared;
+}
+
+void
+SharedFilter::Release(MusicChunk &chunk)
+{
+	if (chunk.prepared != nullptr) {
+		buffer.Return(chunk.prepared);
+		chunk.prepared = nullptr;
+	}
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_OUTPUT_SHARED_FILTER_HXX
+#define MPD_OUTPUT_SHARED_FILTER_HXX
+
+#include "AudioFormat.hxx"
+#include "ReplayGainInfo.hxx"
+#include "MusicBuffer.hxx"
+#include "pcm/PcmDither.hxx"
+
+class Error;
+class Filter;
+struct MusicChunk;
+
+/**
+ * The part of the output filter chain which does not depend on the
+ * audio output: replay gain and cross-fading.  #MultipleOutputs runs
+ * it once per chunk (in the player thread) and attaches the result
+ * to the chunk as MusicChunk::prepared; all audio outputs with a
+ * software replay gain filter use it instead of doing the same work
+ * again.
+ *
+ * The result is optional: if the stage is closed, if the chunk
+ * needs no processing, or if there are no free chunks left, each
+ * audio output falls back to its own filters.
+ */
+class SharedFilter {
+	/**
+	 * Chunks holding the processed data.  The #MusicPipe feeding
+	 * the outputs is kept short, so this can be a lot smaller
+	 * than the player's buffer.
+	 */
+	MusicBuffer buffer;
+
+	Filter *const replay_gain_filter;
+	Filter *const other_replay_gain_filter;
+
+	unsigned replay_gain_serial, other_replay_gain_serial;
+
+	PcmDither cross_fade_dither;
+
+	AudioFormat audio_format;
+
+public:
+	SharedFilter();
+	~SharedFilter();
+
+	SharedFilter(const SharedFilter &) = delete;
+	SharedFilter &operator=(const SharedFilter &) = delete;
+
+	bool IsOpen() const {
+		return audio_format.IsDefined();
+	}
+
+	/**
+	 * Prepare the stage for the given audio format.  Failure is
+	 * not fatal; the audio outputs will then do all the work.
+	 */
+	bool Open(AudioFormat _audio_format, Error &error);
+
+	void Close();
+
+	void SetReplayGainMode(ReplayGainMode mode);
+
+	/**
+	 * Apply replay gain and cross-fading to the chunk, and store
+	 * the result in MusicChunk::prepared.  Must be called before
+	 * the chunk is made visible to the audio outputs.
+	 */
+	void Prepare(MusicChunk &chunk);
+
+	/**
+	 * Free MusicChunk::prepared.  Must be called before the chunk
+	 * leaves the pipe of the audio outputs.
+	 */
+	void Release(MusicChunk &chunk);
+};
+
+#endif
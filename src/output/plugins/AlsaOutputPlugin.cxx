@@ -71,6 +71,20 @@ struct AlsaOutput {
 	bool dop;
 #endif
 
+	/**
+	 * Shall the device's ring buffer be accessed directly
+	 * (SND_PCM_ACCESS_MMAP_INTERLEAVED)?  This saves a copy and
+	 * a system call per write.
+	 */
+	bool use_mmap;
+
+	/**
+	 * Was #use_mmap configured successfully on the open device?
+	 * If the device doesn't support it, this is false and we
+	 * fall back to snd_pcm_writei().
+	 */
+	bool mmap_access;
+
 	/** libasound's buffer_time setting (in microseconds) */
 	unsigned int buffer_time;
 
@@ -162,11 +176,41 @@ private:
 
 	int Recover(int err);
 
+	/**
+	 * The implementation of Play() for #mmap_access: export
+	 * directly into the device's ring buffer.
+	 */
+	size_t PlayMmap(ConstBuffer<void> src, Error &error);
+
+	/**
+	 * Export one block with PcmExport and write it with
+	 * snd_pcm_mmap_writei().  This is PlayMmap()'s fallback
+	 * when the block does not fit into the end of the ring
+	 * buffer.
+	 */
+	size_t WriteBlockMmap(ConstBuffer<void> src, snd_pcm_uframes_t frames,
+			      Error &error);
+
+	/**
+	 * Start the device if it is still in the "prepared" state.
+	 * This is needed in mmap mode, because
+	 * snd_pcm_mmap_commit(), unlike snd_pcm_writei(), does not
+	 * obey the start threshold.
+	 */
+	int StartIfPrepared() {
+		return snd_pcm_state(pcm) == SND_PCM_STATE_PREPARED
+			? snd_pcm_start(pcm)
+			: 0;
+	}
+
 	/**
 	 * Write silence to the ALSA device.
 	 */
 	void WriteSilence(snd_pcm_uframes_t nframes) {
-		snd_pcm_writei(pcm, silence, nframes);
+		if (mmap_access)
+			snd_pcm_mmap_writei(pcm, silence, nframes);
+		else
+			snd_pcm_writei(pcm, silence, nframes);
 	}
 
 };
@@ -187,6 +231,8 @@ AlsaOutput::Configure(const ConfigBlock &block, Error &error)
 		block.GetBlockValue("dsd_usb", false);
 #endif
 
+	use_mmap = block.GetBlockValue("use_mmap", false);
+
 	buffer_time = block.GetBlockValue("buffer_time",
 					  MPD_ALSA_BUFFER_TIME_US);
 	period_time = block.GetBlockValue("period_time", 0u);
@@ -508,11 +554,21 @@ configure_hw:
 	if (err < 0)
 		goto error;
 
-	cmd = "snd_pcm_hw_params_set_access";
-	err = snd_pcm_hw_params_set_access(ad->pcm, hwparams,
-					   SND_PCM_ACCESS_RW_INTERLEAVED);
-	if (err < 0)
-		goto error;
+	ad->mmap_access = ad->use_mmap &&
+		snd_pcm_hw_params_set_access(ad->pcm, hwparams,
+					     SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0;
+	if (ad->use_mmap && !ad->mmap_access)
+		FormatDebug(alsa_output_domain,
+			    "ALSA device \"%s\" does not support mmap",
+			    ad->GetDevice());
+
+	if (!ad->mmap_access) {
+		cmd = "snd_pcm_hw_params_set_access";
+		err = snd_pcm_hw_params_set_access(ad->pcm, hwparams,
+						   SND_PCM_ACCESS_RW_INTERLEAVED);
+		if (err < 0)
+			goto error;
+	}
 
 	err = AlsaSetupFormat(ad->pcm, hwparams, audio_format, params);
 	if (err < 0) {
@@ -832,6 +888,11 @@ AlsaOutput::Recover(int err)
 inline void
 AlsaOutput::Drain()
 {
+	if (mmap_access)
+		/* the buffer may not have been filled up to the
+		   start threshold yet */
+		StartIfPrepared();
+
 	if (snd_pcm_state(pcm) != SND_PCM_STATE_RUNNING)
 		return;
 
@@ -864,6 +925,139 @@ AlsaOutput::Close()
 	delete[] silence;
 }
 
+inline size_t
+AlsaOutput::WriteBlockMmap(ConstBuffer<void> src, snd_pcm_uframes_t frames,
+			   Error &error)
+{
+	const auto e = pcm_export->Export(src);
+	assert(e.size == frames * out_frame_size);
+
+	while (true) {
+		snd_pcm_sframes_t ret = snd_pcm_mmap_writei(pcm, e.data,
+							    frames);
+		if (ret > 0) {
+			period_position = (period_position + ret)
+				% period_frames;
+			return pcm_export->CalcSourceSize(ret * out_frame_size);
+		}
+
+		if (ret < 0 && ret != -EAGAIN && ret != -EINTR &&
+		    Recover(ret) < 0) {
+			error.Set(alsa_output_domain, ret, snd_strerror(-ret));
+			return 0;
+		}
+	}
+}
+
+inline size_t
+AlsaOutput::PlayMmap(ConstBuffer<void> src, Error &error)
+{
+	while (true) {
+		snd_pcm_sframes_t avail = snd_pcm_avail_update(pcm);
+		if (avail >= 0 && (snd_pcm_uframes_t)avail < period_frames) {
+			/* wait until at least one period is free; this
+			   way, we wake up only once per period */
+			int err = StartIfPrepared();
+			if (err == 0)
+				err = snd_pcm_wait(pcm, 1000);
+
+			avail = err < 0 ? err : 0;
+		}
+
+		if (avail < 0) {
+			if (Recover(avail) < 0) {
+				error.Set(alsa_output_domain, avail,
+					  snd_strerror(-avail));
+				return 0;
+			}
+
+			continue;
+		}
+
+		if (avail == 0)
+			continue;
+
+		const snd_pcm_channel_area_t *areas;
+		snd_pcm_uframes_t offset, frames = avail;
+		int err = snd_pcm_mmap_begin(pcm, &areas, &offset, &frames);
+		if (err < 0) {
+			if (Recover(err) < 0) {
+				error.Set(alsa_output_domain, err,
+					  snd_strerror(-err));
+				return 0;
+			}
+
+			continue;
+		}
+
+		/* convert whole blocks (e.g. DoP frame pairs), and
+		   only as much as fits into the contiguous part of the
+		   ring buffer */
+		const unsigned block_frames =
+			pcm_export->GetOutputBlockSize();
+		const size_t block_src_size =
+			pcm_export->CalcSourceSize(block_frames *
+						   out_frame_size);
+		if (src.size < block_src_size)
+			/* see the DoP comment in Play() */
+			return src.size;
+
+		frames -= frames % block_frames;
+		if (frames == 0)
+			/* the end of the ring buffer is smaller than
+			   one block; let libasound handle the
+			   wraparound */
+			return WriteBlockMmap({src.data, block_src_size},
+					      block_frames, error);
+
+		/* with interleaved access, all channels share one
+		   area */
+		uint8_t *dest = (uint8_t *)areas[0].addr +
+			(areas[0].first + offset * areas[0].step) / 8;
+
+		size_t src_size =
+			pcm_export->CalcSourceSize(frames * out_frame_size);
+		if (src_size > src.size)
+			src_size = src.size;
+		src_size -= src_size % block_src_size;
+
+		const size_t dest_size =
+			pcm_export->Export({src.data, src_size}, dest);
+		assert(dest_size % out_frame_size == 0);
+
+		const snd_pcm_uframes_t written = dest_size / out_frame_size;
+		snd_pcm_sframes_t ret = snd_pcm_mmap_commit(pcm, offset,
+							    written);
+		if (ret < 0 || (snd_pcm_uframes_t)ret != written) {
+			if (ret >= 0)
+				ret = -EPIPE;
+
+			if (Recover(ret) < 0) {
+				error.Set(alsa_output_domain, ret,
+					  snd_strerror(-ret));
+				return 0;
+			}
+
+			continue;
+		}
+
+		period_position = (period_position + written) % period_frames;
+
+		if ((snd_pcm_uframes_t)avail - written <= period_frames) {
+			/* the start threshold (buffer_size -
+			   period_size) has been reached */
+			err = StartIfPrepared();
+			if (err < 0 && Recover(err) < 0) {
+				error.Set(alsa_output_domain, err,
+					  snd_strerror(-err));
+				return 0;
+			}
+		}
+
+		return pcm_export->CalcSourceSize(dest_size);
+	}
+}
+
 inline size_t
 AlsaOutput::Play(const void *chunk, size_t size, Error &error)
 {
@@ -880,6 +1074,9 @@ AlsaOutput::Play(const void *chunk, size_t size, Error &error)
 		}
 	}
 
+	if (mmap_access)
+		return PlayMmap({chunk, size}, error);
+
 	const auto e = pcm_export->Export({chunk, size});
 	if (e.size == 0)
 		/* the DoP (DSD over PCM) filter converts two frames
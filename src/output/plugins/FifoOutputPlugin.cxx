@@ -26,6 +26,7 @@
 #include "fs/AllocatedPath.hxx"
 #include "fs/FileSystem.hxx"
 #include "fs/FileInfo.hxx"
+#include "system/FileDescriptor.hxx"
 #include "util/Error.hxx"
 #include "util/Domain.hxx"
 #include "Log.hxx"
@@ -211,6 +212,15 @@ FifoOutput::Create(const ConfigBlock &block, Error &error)
 bool
 FifoOutput::Open(AudioFormat &audio_format, gcc_unused Error &error)
 {
+	/* the timer paces the writes, so a larger buffer fills up
+	   only when the reader falls behind, and it takes longer
+	   until Play() has to discard its contents */
+	const int capacity = FileDescriptor(output)
+		.EnlargePipe(audio_format.GetTimeToSize() / 2);
+	if (capacity >= 0)
+		FormatDebug(fifo_output_domain, "FIFO buffer: %d bytes",
+			    capacity);
+
 	timer = new Timer(audio_format);
 	return true;
 }
@@ -22,12 +22,18 @@
 #include "../OutputAPI.hxx"
 #include "../Wrapper.hxx"
 #include "config/ConfigError.hxx"
+#include "system/FileDescriptor.hxx"
 #include "util/Error.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
 
 #include <string>
 
+#include <errno.h>
 #include <stdio.h>
 
+static constexpr Domain pipe_output_domain("pipe_output");
+
 class PipeOutput {
 	friend struct AudioOutputWrapper<PipeOutput>;
 
@@ -36,6 +42,12 @@ class PipeOutput {
 	std::string cmd;
 	FILE *fh;
 
+	/**
+	 * The file descriptor of #fh.  We write to it directly,
+	 * bypassing the stdio buffer.
+	 */
+	FileDescriptor fd;
+
 	PipeOutput()
 		:base(pipe_output_plugin) {}
 
@@ -83,7 +95,7 @@ PipeOutput::Create(const ConfigBlock &block, Error &error)
 }
 
 inline bool
-PipeOutput::Open(gcc_unused AudioFormat &audio_format, Error &error)
+PipeOutput::Open(AudioFormat &audio_format, Error &error)
 {
 	fh = popen(cmd.c_str(), "w");
 	if (fh == nullptr) {
@@ -92,17 +104,34 @@ PipeOutput::Open(gcc_unused AudioFormat &audio_format, Error &error)
 		return false;
 	}
 
+	fd = FileDescriptor(fileno(fh));
+
+	/* a larger pipe buffer means fewer wakeups of the output
+	   thread and the command; half a second should be enough
+	   to ride out scheduling hiccups */
+	const int capacity =
+		fd.EnlargePipe(audio_format.GetTimeToSize() / 2);
+	if (capacity >= 0)
+		FormatDebug(pipe_output_domain, "pipe buffer: %d bytes",
+			    capacity);
+
 	return true;
 }
 
 inline size_t
 PipeOutput::Play(const void *chunk, size_t size, Error &error)
 {
-	size_t nbytes = fwrite(chunk, 1, size, fh);
-	if (nbytes == 0)
-		error.SetErrno("Write error on pipe");
+	while (true) {
+		ssize_t nbytes = fd.Write(chunk, size);
+		if (nbytes > 0)
+			return nbytes;
+
+		if (nbytes < 0 && errno == EINTR)
+			continue;
 
-	return nbytes;
+		error.SetErrno("Write error on pipe");
+		return 0;
+	}
 }
 
 typedef AudioOutputWrapper<PipeOutput> Wrapper;
@@ -0,0 +1,368 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "Dsd2Pcm.hxx"
+#include "util/bit_reverse.h"
+
+#include <vector>
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+/*
+ * The 2nd half (48 coeffs) of the 96-tap symmetric lowpass filter
+ * from dsd2pcm.
+ *
+ * () flat response up to 48 kHz (at 44100*64 Hz)
+ *
+ * () if you downsample afterwards by a factor of 8, the
+ *    spectrum below 70 kHz is practically alias-free.
+ *
+ * () stopband rejection is about 160 dB
+ */
+static constexpr double dsd2pcm_htaps[] = {
+	0.09950731974056658,
+	0.09562845727714668,
+	0.08819647126516944,
+	0.07782552527068175,
+	0.06534876523171299,
+	0.05172629311427257,
+	0.0379429484910187,
+	0.02490921351762261,
+	0.0133774746265897,
+	0.003883043418804416,
+	-0.003284703416210726,
+	-0.008080250212687497,
+	-0.01067241812471033,
+	-0.01139427235000863,
+	-0.0106813877974587,
+	-0.009007905078766049,
+	-0.006828859761015335,
+	-0.004535184322001496,
+	-0.002425035959059578,
+	-0.0006922187080790708,
+	0.0005700762133516592,
+	0.001353838005269448,
+	0.001713709169690937,
+	0.001742046839472948,
+	0.001545601648013235,
+	0.001226696225277855,
+	0.0008704322683580222,
+	0.0005381636200535649,
+	0.000266446345425276,
+	7.002968738383528e-05,
+	-5.279407053811266e-05,
+	-0.0001140625650874684,
+	-0.0001304796361231895,
+	-0.0001189970287491285,
+	-9.396247155265073e-05,
+	-6.577634378272832e-05,
+	-4.07492895872535e-05,
+	-2.17407957554587e-05,
+	-9.163058931391722e-06,
+	-2.017460145032201e-06,
+	1.249721855219005e-06,
+	2.166655190537392e-06,
+	1.930520892991082e-06,
+	1.319400334374195e-06,
+	7.410039764949091e-07,
+	3.423230509967409e-07,
+	1.244182214744588e-07,
+	3.130441005359396e-08,
+};
+
+static constexpr unsigned HTAPS = sizeof(dsd2pcm_htaps) / sizeof(dsd2pcm_htaps[0]);
+
+/**
+ * The number of "8 MACs" lookup tables.
+ */
+static constexpr unsigned CTABLES = HTAPS / 8;
+
+static_assert(HTAPS % 8 == 0, "Wrong number of filter coefficients");
+
+/**
+ * Lookup tables for the dsd2pcm filter: each table contains the sum
+ * of 8 filter coefficients for each possible DSD byte.
+ */
+struct Dsd2PcmTables {
+	float tables[CTABLES][256];
+
+	Dsd2PcmTables() {
+		for (unsigned t = 0; t < CTABLES; ++t) {
+			for (unsigned e = 0; e < 256; ++e) {
+				double acc = 0.0;
+				for (unsigned m = 0; m < 8; ++m)
+					acc += ((e >> (7 - m)) & 1
+						? dsd2pcm_htaps[t * 8 + m]
+						: -dsd2pcm_htaps[t * 8 + m]);
+				tables[CTABLES - 1 - t][e] = (float)acc;
+			}
+		}
+	}
+};
+
+static const Dsd2PcmTables &
+GetTables()
+{
+	/* C++11 guarantees that this initialization is
+	   thread-safe */
+	static const Dsd2PcmTables tables;
+	return tables;
+}
+
+/**
+ * Coefficients of a half-band low-pass filter with 4*K-1 taps.
+ * Every second tap is zero, and the center tap is 0.5; only the
+ * K non-zero coefficients on one side of the center are stored.
+ */
+template<unsigned K>
+struct HalfBandFilter {
+	float coefficients[K];
+
+	/**
+	 * Design a Kaiser-windowed sinc filter.
+	 */
+	explicit HalfBandFilter(double beta) {
+		const double m = 2 * K - 1;
+		double sum = 0;
+		for (unsigned i = 0; i < K; ++i) {
+			const double n = 2 * i + 1;
+			const double h = sin(M_PI * n / 2) / (M_PI * n);
+			const double w = BesselI0(beta * sqrt(1 - (n / m) * (n / m)))
+				/ BesselI0(beta);
+			coefficients[i] = h * w;
+			sum += h * w;
+		}
+
+		/* normalize to unity gain */
+		for (auto &c : coefficients)
+			c *= 0.25 / sum;
+	}
+
+private:
+	gcc_const
+	static double BesselI0(double x) {
+		double sum = 1, term = 1;
+		for (unsigned k = 1; term > 1e-12 * sum; ++k) {
+			const double t = x / (2 * k);
+			term *= t * t;
+			sum += term;
+		}
+
+		return sum;
+	}
+};
+
+static constexpr unsigned SHORT_K = 12;
+static constexpr unsigned LONG_K = 24;
+
+/**
+ * Decimate by a factor of two with a half-band filter.
+ *
+ * The loops are written so the compiler can vectorize them: the
+ * input is split into even and odd samples, and the filter is
+ * applied to all output samples of a block, one coefficient at a
+ * time.
+ */
+class HalfBandDecimator {
+	const float *const coefficients;
+	const unsigned k;
+
+	/**
+	 * Input samples not yet consumed, beginning with the filter
+	 * history.
+	 */
+	std::vector<float> input;
+
+	std::vector<float> even, odd;
+
+public:
+	HalfBandDecimator(const float *_coefficients, unsigned _k)
+		:coefficients(_coefficients), k(_k) {
+		Reset();
+	}
+
+	void Reset() {
+		/* begin with a history of silence */
+		input.assign(4 * k - 2, 0.0f);
+	}
+
+	/**
+	 * @param dest the destination buffer; may be the same as
+	 * #src
+	 * @return the number of output samples
+	 */
+	size_t Process(const float *src, size_t n, float *dest);
+};
+
+size_t
+HalfBandDecimator::Process(const float *src, size_t n, float *dest)
+{
+	input.insert(input.end(), src, src + n);
+
+	const size_t window = 4 * k - 1;
+	if (input.size() < window)
+		return 0;
+
+	const size_t n_out = (input.size() - window) / 2 + 1;
+
+	even.resize(n_out + 2 * k - 1);
+	odd.resize(n_out + k - 1);
+
+	const float *in = input.data();
+	for (size_t i = 0; i < even.size(); ++i)
+		even[i] = in[2 * i];
+	for (size_t i = 0; i < odd.size(); ++i)
+		odd[i] = in[2 * i + 1];
+
+	const float *gcc_restrict o = odd.data() + k - 1;
+	for (size_t i = 0; i < n_out; ++i)
+		dest[i] = 0.5f * o[i];
+
+	for (unsigned m = 0; m < k; ++m) {
+		const float c = coefficients[m];
+		const float *gcc_restrict a = even.data() + k - 1 - m;
+		const float *gcc_restrict b = even.data() + k + m;
+
+		for (size_t i = 0; i < n_out; ++i)
+			dest[i] += c * (a[i] + b[i]);
+	}
+
+	input.erase(input.begin(), input.begin() + 2 * n_out);
+	return n_out;
+}
+
+static const float *
+GetHalfBandCoefficients(Dsd2Pcm::FilterLength length, unsigned &k)
+{
+	switch (length) {
+	case Dsd2Pcm::FilterLength::SHORT: {
+		static const HalfBandFilter<SHORT_K> filter(10);
+		k = SHORT_K;
+		return filter.coefficients;
+	}
+
+	case Dsd2Pcm::FilterLength::LONG: {
+		static const HalfBandFilter<LONG_K> filter(12);
+		k = LONG_K;
+		return filter.coefficients;
+	}
+	}
+
+	assert(false);
+	gcc_unreachable();
+}
+
+Dsd2Pcm::Dsd2Pcm(unsigned factor, FilterLength length)
+	:n_stages(0)
+{
+	assert(IsValidFactor(factor));
+
+	/* build the tables now, not in the first Translate() call */
+	GetTables();
+
+	for (; factor > 1; factor /= 2) {
+		unsigned k;
+		const float *coefficients = GetHalfBandCoefficients(length, k);
+		stages[n_stages++].reset(new HalfBandDecimator(coefficients, k));
+	}
+
+	Reset();
+}
+
+Dsd2Pcm::~Dsd2Pcm()
+{
+	/* this destructor exists here just so it won't get inlined */
+}
+
+void
+Dsd2Pcm::Reset()
+{
+	/* 0x69 = 01101001; this pattern "on repeat" makes a low
+	   energy 352.8 kHz tone and a high energy 1.0584 MHz tone
+	   which should be filtered out completely by any playback
+	   system --> silence */
+	memset(fifo, 0x69, sizeof(fifo));
+	position = 0;
+
+	for (unsigned i = 0; i < n_stages; ++i)
+		stages[i]->Reset();
+}
+
+inline void
+Dsd2Pcm::Filter(size_t n, const uint8_t *src, ptrdiff_t src_stride,
+		float *dest, ptrdiff_t dest_stride)
+{
+	const auto &tables = GetTables().tables;
+	constexpr unsigned mask = FIFO_SIZE - 1;
+	static_assert(FIFO_SIZE >= CTABLES * 2, "FIFO_SIZE too small");
+
+	unsigned pos = position;
+
+	for (; n > 0; --n, src += src_stride, dest += dest_stride) {
+		fifo[pos] = fifo[pos + FIFO_SIZE] = *src;
+
+		/* the older half of the window is stored
+		   bit-reversed, so the (symmetric) filter can use the
+		   same tables for it */
+		const unsigned r = (pos - CTABLES) & mask;
+		fifo[r] = fifo[r + FIFO_SIZE] = bit_reverse(fifo[r]);
+
+		const uint8_t *newer = fifo + pos + FIFO_SIZE;
+		const uint8_t *older = newer - (CTABLES * 2 - 1);
+
+		/* two independent accumulators allow more
+		   instruction-level parallelism */
+		float acc1 = 0, acc2 = 0;
+		for (unsigned i = 0; i < CTABLES; ++i) {
+			acc1 += tables[i][newer[-(int)i]];
+			acc2 += tables[i][older[i]];
+		}
+
+		*dest = acc1 + acc2;
+
+		pos = (pos + 1) & mask;
+	}
+
+	position = pos;
+}
+
+size_t
+Dsd2Pcm::Translate(size_t n,
+		   const uint8_t *src, ptrdiff_t src_stride,
+		   float *dest, ptrdiff_t dest_stride)
+{
+	if (n_stages == 0) {
+		Filter(n, src, src_stride, dest, dest_stride);
+		return n;
+	}
+
+	float *tmp = buffer.GetT<float>(n);
+	Filter(n, src, src_stride, tmp, 1);
+
+	for (unsigned i = 0; i < n_stages; ++i)
+		n = stages[i]->Process(tmp, n, tmp);
+
+	for (size_t i = 0; i < n; ++i, dest += dest_stride)
+		*dest = tmp[i];
+
+	return n;
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_DSD2PCM_HXX
+#define MPD_PCM_DSD2PCM_HXX
+
+#include "PcmBuffer.hxx"
+#include "Compiler.h"
+
+#include <memory>
+
+#include <stddef.h>
+#include <stdint.h>
+
+class HalfBandDecimator;
+
+/**
+ * Convert one channel of DSD to floating point PCM.
+ *
+ * The first stage is the 96-tap low-pass filter from the dsd2pcm
+ * library by Sebastian Gesemann, evaluated with lookup tables (8 DSD
+ * bits per lookup); it generates one sample per DSD byte, and its
+ * output is the same as dsd2pcm's.  Optionally, it is followed by
+ * up to three half-band decimation stages (each halving the sample
+ * rate), which allows landing directly on 176.4, 88.2 or 44.1 kHz
+ * without an expensive resampler.
+ */
+class Dsd2Pcm {
+public:
+	enum class FilterLength {
+		/**
+		 * 47 taps per decimation stage: flat up to 35% of the
+		 * output sample rate, 97 dB stopband attenuation.
+		 */
+		SHORT,
+
+		/**
+		 * 95 taps per decimation stage: flat up to 40% of
+		 * the output sample rate, 118 dB stopband
+		 * attenuation.
+		 */
+		LONG,
+	};
+
+	/**
+	 * The largest supported decimation factor.
+	 */
+	static constexpr unsigned MAX_FACTOR = 8;
+
+private:
+	static constexpr unsigned MAX_STAGES = 3;
+
+	/**
+	 * The size of the #fifo ring buffer; a power of two.
+	 */
+	static constexpr unsigned FIFO_SIZE = 16;
+
+	/**
+	 * The recent input bytes.  This ring buffer is stored twice
+	 * in a row, which allows the filter to read the whole window
+	 * without wrapping around.
+	 */
+	uint8_t fifo[FIFO_SIZE * 2];
+
+	unsigned position;
+
+	unsigned n_stages;
+
+	std::unique_ptr<HalfBandDecimator> stages[MAX_STAGES];
+
+	PcmBuffer buffer;
+
+public:
+	/**
+	 * @param factor the decimation factor; one output sample is
+	 * generated for every #factor input bytes; must be a value
+	 * accepted by IsValidFactor()
+	 * @param length the filter used by the decimation stages
+	 * (ignored if #factor is 1)
+	 */
+	Dsd2Pcm(unsigned factor, FilterLength length);
+	~Dsd2Pcm();
+
+	Dsd2Pcm(const Dsd2Pcm &) = delete;
+	Dsd2Pcm &operator=(const Dsd2Pcm &) = delete;
+
+	gcc_const
+	static bool IsValidFactor(unsigned factor) {
+		return factor == 1 || factor == 2 || factor == 4 ||
+			factor == 8;
+	}
+
+	void Reset();
+
+	/**
+	 * Convert DSD bytes (MSB first) to floating point samples.
+	 *
+	 * @param n the number of input bytes
+	 * @return the number of output samples
+	 */
+	size_t Translate(size_t n,
+			 const uint8_t *src, ptrdiff_t src_stride,
+			 float *dest, ptrdiff_t dest_stride);
+
+private:
+	/**
+	 * Run the dsd2pcm filter: one output sample per input byte.
+	 */
+	void Filter(size_t n, const uint8_t *src, ptrdiff_t src_stride,
+		    float *dest, ptrdiff_t dest_stride);
+};
+
+#endif
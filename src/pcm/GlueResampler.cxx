@@ -19,41 +19,41 @@
 
 #include "config.h"
 #include "GlueResampler.hxx"
-#include "ConfiguredResampler.hxx"
 #include "Resampler.hxx"
 
 #include <assert.h>
 
 GluePcmResampler::GluePcmResampler()
-	:resampler(pcm_resampler_create()) {}
+	:resampler(nullptr) {}
 
 GluePcmResampler::~GluePcmResampler()
 {
-	delete resampler;
+	assert(resampler == nullptr);
 }
 
 bool
-GluePcmResampler::Open(AudioFormat src_format, unsigned new_sample_rate,
+GluePcmResampler::Open(AudioFormat _src_format, unsigned new_sample_rate,
 		       Error &error)
 {
-	assert(src_format.IsValid());
+	assert(_src_format.IsValid());
 	assert(audio_valid_sample_rate(new_sample_rate));
+	assert(resampler == nullptr);
 
-	AudioFormat requested_format = src_format;
-	AudioFormat dest_format = resampler->Open(requested_format,
-						  new_sample_rate,
-						  error);
-	if (!dest_format.IsValid())
+	resampler = cache.Get(_src_format, new_sample_rate,
+			      requested_format, dest_format, error);
+	if (resampler == nullptr)
 		return false;
 
-	assert(requested_format.channels == src_format.channels);
-	assert(dest_format.channels == src_format.channels);
-	assert(dest_format.sample_rate == new_sample_rate);
+	src_format = _src_format;
 
 	if (requested_format.format != src_format.format &&
 	    !format_converter.Open(src_format.format, requested_format.format,
-				   error))
+				   error)) {
+		cache.Put(resampler, src_format, new_sample_rate,
+			  requested_format, dest_format);
+		resampler = nullptr;
 		return false;
+	}
 
 	src_sample_format = src_format.format;
 	requested_sample_format = requested_format.format;
@@ -64,10 +64,14 @@ GluePcmResampler::Open(AudioFormat src_format, unsigned new_sample_rate,
 void
 GluePcmResampler::Close()
 {
+	assert(resampler != nullptr);
+
 	if (requested_sample_format != src_sample_format)
 		format_converter.Close();
 
-	resampler->Close();
+	cache.Put(resampler, src_format, dest_format.sample_rate,
+		  requested_format, dest_format);
+	resampler = nullptr;
 }
 
 ConstBuffer<void>
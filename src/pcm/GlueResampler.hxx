@@ -23,6 +23,7 @@
 #include "check.h"
 #include "AudioFormat.hxx"
 #include "FormatConverter.hxx"
+#include "ResamplerCache.hxx"
 
 class Error;
 class PcmResampler;
@@ -32,9 +33,20 @@ template<typename T> struct ConstBuffer;
  * A glue class that integrates a #PcmResampler and automatically
  * converts source data to the sample format required by the
  * #PcmResampler instance.
+ *
+ * Closed #PcmResampler instances are kept in a #PcmResamplerCache,
+ * and are reused when the same conversion is requested again.
  */
 class GluePcmResampler {
-	PcmResampler *const resampler;
+	PcmResamplerCache cache;
+
+	/**
+	 * The resampler obtained from #cache; nullptr if this object
+	 * is closed.
+	 */
+	PcmResampler *resampler;
+
+	AudioFormat src_format, requested_format, dest_format;
 
 	SampleFormat src_sample_format, requested_sample_format;
 	SampleFormat output_sample_format;
@@ -53,6 +65,15 @@ public:
 		  Error &error);
 	void Close();
 
+	/**
+	 * Create a resampler for a later Open() call with the same
+	 * parameters ahead of time.  Unlike all other methods, this
+	 * may be called from any thread.
+	 */
+	void Prepare(AudioFormat _src_format, unsigned new_sample_rate) {
+		cache.Prepare(_src_format, new_sample_rate);
+	}
+
 	SampleFormat GetOutputSampleFormat() const {
 		return output_sample_format;
 	}
@@ -122,6 +122,13 @@ LibsampleratePcmResampler::Close()
 	state = src_delete(state);
 }
 
+void
+LibsampleratePcmResampler::Reset()
+{
+	src_reset(state);
+	src_set_ratio(state, data.src_ratio);
+}
+
 static bool
 src_process(SRC_STATE *state, SRC_DATA *data, Error &error)
 {
@@ -0,0 +1,236 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+#include "LoudnessMeter.hxx"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <math.h>
+
+/**
+ * The offset of the loudness scale, see ITU-R BS.1770.
+ */
+static constexpr double LOUDNESS_OFFSET = -0.691;
+
+static double
+EnergyToLoudness(double energy)
+{
+	return LOUDNESS_OFFSET + 10 * log10(energy);
+}
+
+void
+LoudnessHistogram::Clear()
+{
+	for (auto &i : bins)
+		i = {0, 0};
+}
+
+void
+LoudnessHistogram::Add(double energy)
+{
+	const double loudness = EnergyToLoudness(energy);
+	if (!(loudness >= MIN_LOUDNESS))
+		/* absolute gate */
+		return;
+
+	size_t i = (loudness - MIN_LOUDNESS) / BIN_WIDTH;
+	if (i >= N_BINS)
+		i = N_BINS - 1;
+
+	++bins[i].count;
+	bins[i].energy += energy;
+}
+
+void
+LoudnessHistogram::Merge(const LoudnessHistogram &other)
+{
+	for (size_t i = 0; i < N_BINS; ++i) {
+		bins[i].count += other.bins[i].count;
+		bins[i].energy += other.bins[i].energy;
+	}
+}
+
+double
+LoudnessHistogram::GetIntegrated() const
+{
+	uint64_t count = 0;
+	double energy = 0;
+	for (const auto &i : bins) {
+		count += i.count;
+		energy += i.energy;
+	}
+
+	if (count == 0)
+		return MIN_LOUDNESS - 1;
+
+	/* the relative gate: discard all blocks which are more than
+	   10 LU below the loudness of the blocks which passed the
+	   absolute gate */
+	const double relative_gate = EnergyToLoudness(energy / count) - 10;
+	const double first = ceil((relative_gate - MIN_LOUDNESS) / BIN_WIDTH);
+
+	count = 0;
+	energy = 0;
+	for (size_t i = std::max(first, 0.), end = N_BINS; i < end; ++i) {
+		count += bins[i].count;
+		energy += bins[i].energy;
+	}
+
+	if (count == 0)
+		return MIN_LOUDNESS - 1;
+
+	return EnergyToLoudness(energy / count);
+}
+
+LoudnessMeter::LoudnessMeter(unsigned sample_rate, unsigned _channels)
+	:state(new ChannelState[_channels]),
+	 channels(_channels),
+	 step_frames(std::max(sample_rate / 10, 1u)),
+	 step_position(0), step_energy(0), n_steps(0),
+	 peak(0)
+{
+	assert(sample_rate > 0);
+	assert(channels > 0);
+
+	/* the "K" frequency weighting: a high shelf which models the
+	   acoustic effects of the head, followed by a high-pass
+	   filter; these are the BS.1770 coefficients re-calculated
+	   for the given sample rate */
+
+	double f0 = 1681.974450955533;
+	const double G = 3.999843853973347;
+	double Q = 0.7071752369554196;
+
+	double K = tan(M_PI * f0 / sample_rate);
+	const double Vh = pow(10.0, G / 20.0);
+	const double Vb = pow(Vh, 0.4996667741545416);
+
+	double a0 = 1.0 + K / Q + K * K;
+	shelf.b0 = (Vh + Vb * K / Q + K * K) / a0;
+	shelf.b1 = 2.0 * (K * K - Vh) / a0;
+	shelf.b2 = (Vh - Vb * K / Q + K * K) / a0;
+	shelf.a1 = 2.0 * (K * K - 1.0) / a0;
+	shelf.a2 = (1.0 - K / Q + K * K) / a0;
+
+	f0 = 38.13547087602444;
+	Q = 0.5003270373238773;
+	K = tan(M_PI * f0 / sample_rate);
+
+	a0 = 1.0 + K / Q + K * K;
+	highpass.b0 = 1.0;
+	highpass.b1 = -2.0;
+	highpass.b2 = 1.0;
+	highpass.a1 = 2.0 * (K * K - 1.0) / a0;
+	highpass.a2 = (1.0 - K / Q + K * K) / a0;
+
+	for (unsigned c = 0; c < channels; ++c) {
+		auto &s = state[c];
+		s.z[0][0] = s.z[0][1] = s.z[1][0] = s.z[1][1] = 0;
+
+		/* the LFE channel is ignored, and the surround
+		   channels are weighted +1.5 dB (MPD uses the FLAC
+		   channel order) */
+		s.weight = 1.0;
+		if (channels == 6 || channels == 8) {
+			if (c == 3)
+				s.weight = 0;
+			else if (c >= 4)
+				s.weight = 1.41;
+		}
+	}
+}
+
+LoudnessMeter::~LoudnessMeter()
+{
+	delete[] state;
+}
+
+gcc_always_inline
+static inline double
+ApplyBiquad(const double b0, const double b1, const double b2,
+	    const double a1, const double a2,
+	    double *z, double x)
+{
+	const double y = b0 * x + z[0];
+	z[0] = b1 * x - a1 * y + z[1];
+	z[1] = b2 * x - a2 * y;
+	return y;
+}
+
+void
+LoudnessMeter::FinishStep()
+{
+	steps[n_steps % 4] = step_energy / step_frames;
+	++n_steps;
+
+	step_position = 0;
+	step_energy = 0;
+
+	if (n_steps >= 4)
+		/* a 400 ms gating block, overlapping the previous one
+		   by 75% */
+		histogram.Add((steps[0] + steps[1] + steps[2] + steps[3]) / 4);
+}
+
+void
+LoudnessMeter::Feed(const float *src, size_t n_frames)
+{
+	const auto &s = shelf, &h = highpass;
+
+	while (n_frames > 0) {
+		size_t n = std::min<size_t>(n_frames,
+					    step_frames - step_position);
+		n_frames -= n;
+		step_position += n;
+
+		float p = peak;
+		double e = 0;
+
+		for (unsigned c = 0; c < channels; ++c) {
+			auto &cs = state[c];
+			double sum = 0;
+
+			const float *i = src + c;
+			for (size_t f = 0; f < n; ++f, i += channels) {
+				const float x = *i;
+				p = std::max(p, fabsf(x));
+
+				double y = ApplyBiquad(s.b0, s.b1, s.b2,
+						       s.a1, s.a2,
+						       cs.z[0], x);
+				y = ApplyBiquad(h.b0, h.b1, h.b2,
+						h.a1, h.a2,
+						cs.z[1], y);
+				sum += y * y;
+			}
+
+			e += cs.weight * sum;
+		}
+
+		peak = p;
+		step_energy += e;
+		src += n * channels;
+
+		if (step_position == step_frames)
+			FinishStep();
+	}
+}
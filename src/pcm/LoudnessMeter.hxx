@@ -0,0 +1,161 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_PCM_LOUDNESS_METER_HXX
+#define MPD_PCM_LOUDNESS_METER_HXX
+
+#include "check.h"
+#include "Compiler.h"
+
+#include <array>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A histogram of EBU R128 gating block loudness values.  Histograms
+ * of several tracks can be merged to obtain the loudness of the
+ * whole album.
+ */
+class LoudnessHistogram {
+	/**
+	 * The lowest block loudness [LUFS]; quieter blocks are
+	 * discarded by the absolute gate.
+	 */
+	static constexpr double MIN_LOUDNESS = -70;
+
+	/**
+	 * The width of one bin [LU].
+	 */
+	static constexpr double BIN_WIDTH = 0.1;
+
+	static constexpr size_t N_BINS = 750;
+
+	struct Bin {
+		uint32_t count;
+
+		/**
+		 * The sum of the mean square values of all blocks in
+		 * this bin.
+		 */
+		double energy;
+	};
+
+	std::array<Bin, N_BINS> bins;
+
+public:
+	LoudnessHistogram() {
+		Clear();
+	}
+
+	void Clear();
+
+	/**
+	 * Add a gating block.
+	 *
+	 * @param energy the weighted mean square value of the block
+	 */
+	void Add(double energy);
+
+	void Merge(const LoudnessHistogram &other);
+
+	/**
+	 * Calculate the gated integrated loudness [LUFS].
+	 *
+	 * @return the loudness, or a value below -70 if no block
+	 * passed the absolute gate
+	 */
+	gcc_pure
+	double GetIntegrated() const;
+};
+
+/**
+ * Measure the integrated loudness of a signal according to EBU R128
+ * (ITU-R BS.1770).  The input is interleaved floating point samples.
+ */
+class LoudnessMeter {
+	/**
+	 * A biquad filter in "transposed direct form II".
+	 */
+	struct Biquad {
+		double b0, b1, b2, a1, a2;
+	};
+
+	struct ChannelState {
+		double z[2][2];
+		double weight;
+	};
+
+	Biquad shelf, highpass;
+
+	ChannelState *const state;
+
+	const unsigned channels;
+
+	/**
+	 * The number of frames in 100 ms, which is a quarter of a
+	 * gating block.
+	 */
+	const unsigned step_frames;
+
+	unsigned step_position;
+
+	double step_energy;
+
+	/**
+	 * The energy of the last four steps, which make up one
+	 * gating block.
+	 */
+	double steps[4];
+
+	unsigned n_steps;
+
+	float peak;
+
+	LoudnessHistogram histogram;
+
+public:
+	LoudnessMeter(unsigned sample_rate, unsigned _channels);
+	~LoudnessMeter();
+
+	LoudnessMeter(const LoudnessMeter &) = delete;
+	LoudnessMeter &operator=(const LoudnessMeter &) = delete;
+
+	/**
+	 * @param n_frames the number of frames (not samples)
+	 */
+	void Feed(const float *src, size_t n_frames);
+
+	/**
+	 * Returns the absolute sample peak.
+	 */
+	float GetPeak() const {
+		return peak;
+	}
+
+	const LoudnessHistogram &GetHistogram() const {
+		return histogram;
+	}
+
+private:
+	void FinishStep();
+};
+
+#endif
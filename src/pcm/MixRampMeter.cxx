@@ -0,0 +1,158 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+#include "MixRampMeter.hxx"
+#include "MixRampInfo.hxx"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+/**
+ * The profile contains one entry for each of these levels [dBFS], up
+ * to the loudest window.
+ */
+static constexpr int MIN_LEVEL = -90, LEVEL_STEP = 3;
+
+MixRampMeter::MixRampMeter(unsigned _sample_rate, unsigned _channels)
+	:sample_rate(_sample_rate), channels(_channels),
+	 window_frames(std::max(sample_rate / 10, 1u)),
+	 window_position(0), window_energy(0),
+	 total_frames(0)
+{
+	assert(sample_rate > 0);
+	assert(channels > 0);
+}
+
+void
+MixRampMeter::Feed(const float *src, size_t n_frames)
+{
+	total_frames += n_frames;
+
+	while (n_frames > 0) {
+		size_t n = std::min<size_t>(n_frames,
+					    window_frames - window_position);
+		n_frames -= n;
+		window_position += n;
+
+		double e = 0;
+		for (const float *end = src + n * channels; src != end; ++src)
+			e += double(*src) * double(*src);
+
+		window_energy += e;
+
+		if (window_position == window_frames) {
+			const double mean = window_energy
+				/ (window_frames * channels);
+			levels.push_back(mean > 0
+					 ? 10 * log10(mean)
+					 : MIN_LEVEL - 1);
+
+			window_position = 0;
+			window_energy = 0;
+		}
+	}
+}
+
+/**
+ * Format a profile, i.e. a list of levels with the time [centiseconds]
+ * it takes to reach them.  Within a run of entries with the same
+ * time, only the first and the last one are emitted; this is enough
+ * for mixramp_interpolate().
+ */
+static std::string
+FormatProfile(const std::vector<std::pair<int, unsigned>> &profile)
+{
+	std::string result;
+
+	for (size_t i = 0, n = profile.size(); i < n; ++i) {
+		const unsigned t = profile[i].second;
+		if (i > 0 && i + 1 < n &&
+		    profile[i - 1].second == t && profile[i + 1].second == t)
+			continue;
+
+		char buffer[32];
+		snprintf(buffer, sizeof(buffer), "%d.00 %u.%02u;",
+			 profile[i].first, t / 100, t % 100);
+		result.append(buffer);
+	}
+
+	return result;
+}
+
+static unsigned
+ToCentiseconds(double seconds)
+{
+	return unsigned(std::max(seconds, 0.) * 100 + 0.5);
+}
+
+std::string
+MixRampMeter::GetStart() const
+{
+	std::vector<std::pair<int, unsigned>> profile;
+
+	auto i = levels.begin();
+	for (int level = MIN_LEVEL; level <= 0; level += LEVEL_STEP) {
+		i = std::find_if(i, levels.end(),
+				 [level](float l){ return l >= level; });
+		if (i == levels.end())
+			break;
+
+		const double start = (i - levels.begin()) * GetWindowDuration();
+		profile.emplace_back(level, ToCentiseconds(start));
+	}
+
+	return FormatProfile(profile);
+}
+
+std::string
+MixRampMeter::GetEnd() const
+{
+	std::vector<std::pair<int, unsigned>> profile;
+
+	const double duration = double(total_frames) / sample_rate;
+
+	auto i = levels.rbegin();
+	for (int level = MIN_LEVEL; level <= 0; level += LEVEL_STEP) {
+		i = std::find_if(i, levels.rend(),
+				 [level](float l){ return l >= level; });
+		if (i == levels.rend())
+			break;
+
+		/* the time from the end of this window to the end of
+		   the song */
+		const double end = (levels.rend() - i) * GetWindowDuration();
+		profile.emplace_back(level, ToCentiseconds(duration - end));
+	}
+
+	return FormatProfile(profile);
+}
+
+MixRampInfo
+MixRampMeter::GetInfo() const
+{
+	MixRampInfo info;
+	info.SetStart(GetStart());
+	info.SetEnd(GetEnd());
+	return info;
+}
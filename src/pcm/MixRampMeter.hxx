@@ -0,0 +1,85 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_PCM_MIX_RAMP_METER_HXX
+#define MPD_PCM_MIX_RAMP_METER_HXX
+
+#include "check.h"
+#include "Compiler.h"
+
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+
+class MixRampInfo;
+
+/**
+ * Build the MixRamp volume profile of a signal: how long does it take
+ * from the start until a certain level is reached, and how long does
+ * the signal stay below that level before the end.  The input is
+ * interleaved floating point samples.
+ */
+class MixRampMeter {
+	const unsigned sample_rate, channels;
+
+	/**
+	 * The number of frames in one 100 ms window.
+	 */
+	const unsigned window_frames;
+
+	unsigned window_position;
+
+	double window_energy;
+
+	/**
+	 * The RMS level [dBFS] of each complete window.
+	 */
+	std::vector<float> levels;
+
+	size_t total_frames;
+
+public:
+	MixRampMeter(unsigned _sample_rate, unsigned _channels);
+
+	/**
+	 * @param n_frames the number of frames (not samples)
+	 */
+	void Feed(const float *src, size_t n_frames);
+
+	/**
+	 * Generate the "mixramp_start" and "mixramp_end" strings.
+	 */
+	gcc_pure
+	MixRampInfo GetInfo() const;
+
+private:
+	double GetWindowDuration() const {
+		return double(window_frames) / sample_rate;
+	}
+
+	gcc_pure
+	std::string GetStart() const;
+
+	gcc_pure
+	std::string GetEnd() const;
+};
+
+#endif
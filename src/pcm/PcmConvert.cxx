@@ -22,6 +22,9 @@
 #include "Domain.hxx"
 #include "ConfiguredResampler.hxx"
 #include "AudioFormat.hxx"
+#include "config/ConfigGlobal.hxx"
+#include "config/ConfigOption.hxx"
+#include "config/ConfigError.hxx"
 #include "util/ConstBuffer.hxx"
 #include "util/Error.hxx"
 #include "util/Domain.hxx"
@@ -29,10 +32,59 @@
 
 #include <assert.h>
 #include <math.h>
+#include <string.h>
+
+#ifdef ENABLE_DSD
+
+static Dsd2Pcm::FilterLength dsd_filter_length = Dsd2Pcm::FilterLength::LONG;
+
+static bool
+pcm_dsd_global_init(Error &error)
+{
+	const char *value = config_get_string(ConfigOption::DSD_FILTER);
+	if (value == nullptr)
+		return true;
+
+	if (strcmp(value, "short") == 0)
+		dsd_filter_length = Dsd2Pcm::FilterLength::SHORT;
+	else if (strcmp(value, "long") == 0)
+		dsd_filter_length = Dsd2Pcm::FilterLength::LONG;
+	else {
+		error.Format(config_domain,
+			     "Invalid \"dsd_filter\" setting: %s", value);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Choose the largest DSD decimation factor which does not drop below
+ * the requested sample rate.  This avoids resampling from the very
+ * high DSD rates (e.g. DSD256 to 176.4 kHz).
+ */
+gcc_const
+static unsigned
+ChooseDsdFactor(unsigned dsd_rate, unsigned dest_rate)
+{
+	unsigned factor = Dsd2Pcm::MAX_FACTOR;
+	while (factor > 1 &&
+	       (dsd_rate % factor != 0 || dsd_rate / factor < dest_rate))
+		factor /= 2;
+
+	return factor;
+}
+
+#endif
 
 bool
 pcm_convert_global_init(Error &error)
 {
+#ifdef ENABLE_DSD
+	if (!pcm_dsd_global_init(error))
+		return false;
+#endif
+
 	return pcm_resampler_global_init(error);
 }
 
@@ -60,9 +112,18 @@ PcmConvert::Open(const AudioFormat _src_format, const AudioFormat _dest_format,
 	assert(_dest_format.IsValid());
 
 	AudioFormat format = _src_format;
-	if (format.format == SampleFormat::DSD)
+	if (format.format == SampleFormat::DSD) {
 		format.format = SampleFormat::FLOAT;
 
+#ifdef ENABLE_DSD
+		const unsigned factor =
+			ChooseDsdFactor(format.sample_rate,
+					_dest_format.sample_rate);
+		dsd.Configure(factor, dsd_filter_length);
+		format.sample_rate /= factor;
+#endif
+	}
+
 	enable_resampler = format.sample_rate != _dest_format.sample_rate;
 	if (enable_resampler) {
 		if (!resampler.Open(format, _dest_format.sample_rate, error))
@@ -120,6 +181,30 @@ PcmConvert::Close()
 #endif
 }
 
+void
+PcmConvert::Prepare(const AudioFormat _src_format,
+		    const AudioFormat _dest_format)
+{
+	assert(_src_format.IsValid());
+	assert(_dest_format.IsValid());
+
+	/* this must calculate the resampler's input format just like
+	   Open() does */
+	AudioFormat format = _src_format;
+	if (format.format == SampleFormat::DSD) {
+		format.format = SampleFormat::FLOAT;
+
+#ifdef ENABLE_DSD
+		format.sample_rate /=
+			ChooseDsdFactor(format.sample_rate,
+					_dest_format.sample_rate);
+#endif
+	}
+
+	if (format.sample_rate != _dest_format.sample_rate)
+		resampler.Prepare(format, _dest_format.sample_rate);
+}
+
 ConstBuffer<void>
 PcmConvert::Convert(ConstBuffer<void> buffer, Error &error)
 {
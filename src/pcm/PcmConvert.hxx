@@ -71,6 +71,14 @@ public:
 	 */
 	void Close();
 
+	/**
+	 * Prepare a conversion which will probably be requested by a
+	 * later Open() call, so that Open() can be fast (e.g. by
+	 * designing the resampler filter).  Unlike all other methods,
+	 * this may be called from any thread.
+	 */
+	void Prepare(AudioFormat _src_format, AudioFormat _dest_format);
+
 	/**
 	 * Converts PCM data between two audio formats.
 	 *
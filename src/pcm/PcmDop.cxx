@@ -51,9 +51,11 @@ pcm_dsd_to_dop(PcmBuffer &buffer, unsigned channels,
 	const unsigned num_src_samples = _src.size;
 	const unsigned num_src_frames = num_src_samples / channels;
 
-	/* this rounds down and discards the last odd frame; not
-	   elegant, but good enough for now */
-	const unsigned num_frames = num_src_frames / 2;
+	/* DoP frames are generated in pairs (marker 0x05, then
+	   0xfa), and each one consumes two source frames; this
+	   rounds down and discards the rest; not elegant, but good
+	   enough for now */
+	const unsigned num_frames = num_src_frames / 4 * 2;
 	const unsigned num_samples = num_frames * channels;
 
 	uint32_t *const dest0 = (uint32_t *)buffer.GetT<uint32_t>(num_samples),
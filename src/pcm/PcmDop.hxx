@@ -32,6 +32,9 @@ template<typename T> struct ConstBuffer;
  * Pack DSD 1 bit samples into (padded) 24 bit PCM samples for
  * playback over USB, according to the DoP standard:
  * http://dsd-guide.com/dop-open-standard
+ *
+ * Only multiples of 4 source frames (2 DoP frames) are converted;
+ * the rest is discarded.
  */
 ConstBuffer<uint32_t>
 pcm_dsd_to_dop(PcmBuffer &buffer, unsigned channels,
@@ -19,21 +19,157 @@
 
 #include "config.h"
 #include "PcmDsd.hxx"
-#include "dsd2pcm/dsd2pcm.h"
+#include "thread/Thread.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
 #include "util/ConstBuffer.hxx"
+#include "util/Error.hxx"
+
+#include <algorithm>
 
 #include <assert.h>
 
+/**
+ * Convert the channels [first, last) of an interleaved DSD buffer.
+ *
+ * @return the number of output frames
+ */
+static size_t
+ConvertChannels(Dsd2Pcm *const*dsd2pcm, unsigned first, unsigned last,
+		unsigned channels, const uint8_t *src, size_t num_frames,
+		float *dest)
+{
+	size_t out_frames = 0;
+	for (unsigned c = first; c < last; ++c)
+		out_frames = dsd2pcm[c]->Translate(num_frames,
+						   src + c, channels,
+						   dest + c, channels);
+
+	return out_frames;
+}
+
+/**
+ * A helper thread which converts a range of channels on behalf of
+ * #PcmDsd.
+ */
+class PcmDsdWorker {
+	Thread thread;
+
+	Mutex mutex;
+	Cond cond;
+
+	enum class State {
+		IDLE,
+		BUSY,
+		QUIT,
+	} state;
+
+	Dsd2Pcm *const*dsd2pcm;
+	unsigned first, last, channels;
+	const uint8_t *src;
+	size_t num_frames;
+	float *dest;
+
+public:
+	PcmDsdWorker():state(State::IDLE) {}
+
+	bool Start(Error &error) {
+		return thread.Start(Run, this, error);
+	}
+
+	void Stop() {
+		mutex.lock();
+		state = State::QUIT;
+		cond.broadcast();
+		mutex.unlock();
+
+		thread.Join();
+	}
+
+	void Submit(Dsd2Pcm *const*_dsd2pcm,
+		    unsigned _first, unsigned _last, unsigned _channels,
+		    const uint8_t *_src, size_t _num_frames, float *_dest) {
+		const ScopeLock protect(mutex);
+		assert(state == State::IDLE);
+
+		dsd2pcm = _dsd2pcm;
+		first = _first;
+		last = _last;
+		channels = _channels;
+		src = _src;
+		num_frames = _num_frames;
+		dest = _dest;
+
+		state = State::BUSY;
+		cond.broadcast();
+	}
+
+	/**
+	 * Wait until the job passed to Submit() is finished.
+	 */
+	void Wait() {
+		const ScopeLock protect(mutex);
+		while (state == State::BUSY)
+			cond.wait(mutex);
+	}
+
+private:
+	void Run() {
+		const ScopeLock protect(mutex);
+
+		while (true) {
+			switch (state) {
+			case State::IDLE:
+				cond.wait(mutex);
+				break;
+
+			case State::BUSY:
+				mutex.unlock();
+				ConvertChannels(dsd2pcm, first, last, channels,
+						src, num_frames, dest);
+				mutex.lock();
+
+				state = State::IDLE;
+				cond.broadcast();
+				break;
+
+			case State::QUIT:
+				return;
+			}
+		}
+	}
+
+	static void Run(void *ctx) {
+		PcmDsdWorker &worker = *(PcmDsdWorker *)ctx;
+		worker.Run();
+	}
+};
+
 PcmDsd::PcmDsd()
+	:factor(1), filter_length(Dsd2Pcm::FilterLength::LONG),
+	 n_workers(0)
 {
 	dsd2pcm.fill(nullptr);
 }
 
 PcmDsd::~PcmDsd()
 {
-	for (auto i : dsd2pcm)
-		if (i != nullptr)
-			dsd2pcm_destroy(i);
+	StopWorkers();
+	DeleteConverters();
+}
+
+void
+PcmDsd::Configure(unsigned _factor, Dsd2Pcm::FilterLength _filter_length)
+{
+	assert(Dsd2Pcm::IsValidFactor(_factor));
+
+	if (_factor == factor && _filter_length == filter_length)
+		return;
+
+	DeleteConverters();
+
+	factor = _factor;
+	filter_length = _filter_length;
 }
 
 void
@@ -41,7 +177,54 @@ PcmDsd::Reset()
 {
 	for (auto i : dsd2pcm)
 		if (i != nullptr)
-			dsd2pcm_reset(i);
+			i->Reset();
+}
+
+void
+PcmDsd::CreateConverters(unsigned channels)
+{
+	for (unsigned c = 0; c < channels; ++c)
+		if (dsd2pcm[c] == nullptr)
+			dsd2pcm[c] = new Dsd2Pcm(factor, filter_length);
+}
+
+void
+PcmDsd::DeleteConverters()
+{
+	for (auto &i : dsd2pcm) {
+		delete i;
+		i = nullptr;
+	}
+}
+
+void
+PcmDsd::StartWorkers(unsigned channels)
+{
+	const unsigned wanted = std::min(channels / 2 - 1, MAX_WORKERS);
+
+	while (n_workers < wanted) {
+		auto *worker = new PcmDsdWorker();
+
+		Error error;
+		if (!worker->Start(error)) {
+			/* no problem; the remaining channels will be
+			   converted by the calling thread */
+			delete worker;
+			break;
+		}
+
+		workers[n_workers++] = worker;
+	}
+}
+
+void
+PcmDsd::StopWorkers()
+{
+	while (n_workers > 0) {
+		auto *worker = workers[--n_workers];
+		worker->Stop();
+		delete worker;
+	}
 }
 
 ConstBuffer<float>
@@ -52,24 +235,37 @@ PcmDsd::ToFloat(unsigned channels, ConstBuffer<uint8_t> src)
 	assert(src.size % channels == 0);
 	assert(channels <= dsd2pcm.max_size());
 
-	const unsigned num_samples = src.size;
-	const unsigned num_frames = src.size / channels;
+	const size_t num_frames = src.size / channels;
+	const size_t max_out_frames = num_frames / factor + 1;
 
-	float *dest = buffer.GetT<float>(num_samples);
+	float *dest = buffer.GetT<float>(max_out_frames * channels);
 
-	for (unsigned c = 0; c < channels; ++c) {
-		if (dsd2pcm[c] == nullptr) {
-			dsd2pcm[c] = dsd2pcm_init();
-			if (dsd2pcm[c] == nullptr)
-				return nullptr;
-		}
+	CreateConverters(channels);
 
-		dsd2pcm_translate(dsd2pcm[c], num_frames,
-				  src.data + c, channels,
-				  false, dest + c, channels);
-	}
+	if (channels >= PARALLEL_CHANNELS)
+		StartWorkers(channels);
+
+	/* distribute the channels over the helper threads and this
+	   one */
+	const unsigned n_threads = channels >= PARALLEL_CHANNELS
+		? std::min(n_workers + 1, channels / 2)
+		: 1;
+	const unsigned per_thread = (channels + n_threads - 1) / n_threads;
+
+	for (unsigned i = 1; i < n_threads; ++i)
+		workers[i - 1]->Submit(dsd2pcm.data(),
+				       i * per_thread,
+				       std::min((i + 1) * per_thread, channels),
+				       channels, src.data, num_frames, dest);
+
+	const size_t out_frames =
+		ConvertChannels(dsd2pcm.data(), 0, std::min(per_thread, channels),
+				channels, src.data, num_frames, dest);
+
+	for (unsigned i = 1; i < n_threads; ++i)
+		workers[i - 1]->Wait();
 
-	return { dest, num_samples };
+	return { dest, out_frames * channels };
 }
 
 /**
@@ -22,6 +22,7 @@
 
 #include "check.h"
 #include "PcmBuffer.hxx"
+#include "Dsd2Pcm.hxx"
 #include "AudioFormat.hxx"
 
 #include <array>
@@ -29,23 +30,60 @@
 #include <stdint.h>
 
 template<typename T> struct ConstBuffer;
+class PcmDsdWorker;
 
 /**
- * Wrapper for the dsd2pcm library.
+ * Convert DSD to floating point PCM with #Dsd2Pcm, one instance per
+ * channel.  With many channels, the work is distributed over helper
+ * threads.
  */
 class PcmDsd {
+	/**
+	 * Use helper threads if there are at least this many
+	 * channels.
+	 */
+	static constexpr unsigned PARALLEL_CHANNELS = 4;
+
+	/**
+	 * The maximum number of helper threads.  Each thread
+	 * (including the caller's) converts at least two channels.
+	 */
+	static constexpr unsigned MAX_WORKERS = 3;
+
 	PcmBuffer buffer;
 
-	std::array<struct dsd2pcm_ctx_s *, MAX_CHANNELS> dsd2pcm;
+	unsigned factor;
+	Dsd2Pcm::FilterLength filter_length;
+
+	std::array<Dsd2Pcm *, MAX_CHANNELS> dsd2pcm;
+
+	std::array<PcmDsdWorker *, MAX_WORKERS> workers;
+	unsigned n_workers;
 
 public:
 	PcmDsd();
 	~PcmDsd();
 
+	/**
+	 * Configure the decimation factor and the filter.  The
+	 * output sample rate is the DSD sample rate (in bytes per
+	 * second) divided by #factor.
+	 *
+	 * @param factor a value accepted by Dsd2Pcm::IsValidFactor()
+	 */
+	void Configure(unsigned factor, Dsd2Pcm::FilterLength filter_length);
+
 	void Reset();
 
 	ConstBuffer<float> ToFloat(unsigned channels,
 				   ConstBuffer<uint8_t> src);
+
+private:
+	void CreateConverters(unsigned channels);
+	void DeleteConverters();
+
+	void StartWorkers(unsigned channels);
+	void StopWorkers();
 };
 
 /**
@@ -31,6 +31,9 @@
 
 #include <iterator>
 
+#include <assert.h>
+#include <string.h>
+
 void
 PcmExport::Open(SampleFormat sample_format, unsigned _channels,
 		Params params)
@@ -100,8 +103,19 @@ PcmExport::GetFrameSize(const AudioFormat &audio_format) const
 	return audio_format.GetFrameSize();
 }
 
+unsigned
+PcmExport::GetOutputBlockSize() const
+{
+#ifdef ENABLE_DSD
+	if (dop)
+		return 2;
+#endif
+
+	return 1;
+}
+
 ConstBuffer<void>
-PcmExport::Export(ConstBuffer<void> data)
+PcmExport::ExportPrepare(ConstBuffer<void> data)
 {
 	if (alsa_channel_order != SampleFormat::UNDEFINED)
 		data = ToAlsaChannelOrder(order_buffer, data,
@@ -119,26 +133,40 @@ PcmExport::Export(ConstBuffer<void> data)
 			.ToVoid();
 #endif
 
-	if (pack24) {
-		const auto src = ConstBuffer<int32_t>::FromVoid(data);
-		const size_t num_samples = src.size;
-		const size_t dest_size = num_samples * 3;
-		uint8_t *dest = (uint8_t *)pack_buffer.Get(dest_size);
-		assert(dest != nullptr);
-
-		pcm_pack_24(dest, src.begin(), src.end());
+	return data;
+}
 
-		data.data = dest;
-		data.size = dest_size;
-	} else if (shift8) {
-		const auto src = ConstBuffer<int32_t>::FromVoid(data);
+ConstBuffer<void>
+PcmExport::ExportPack(ConstBuffer<void> data, void *_dest) const
+{
+	assert(pack24 || shift8);
 
-		uint32_t *dest = (uint32_t *)pack_buffer.Get(data.size);
-		data.data = dest;
+	const auto src = ConstBuffer<int32_t>::FromVoid(data);
 
+	if (pack24) {
+		uint8_t *dest = (uint8_t *)_dest;
+		pcm_pack_24(dest, src.begin(), src.end());
+		return {dest, src.size * 3};
+	} else {
+		uint32_t *dest = (uint32_t *)_dest;
 		for (auto i : src)
 			*dest++ = i << 8;
+		return {_dest, data.size};
 	}
+}
+
+ConstBuffer<void>
+PcmExport::Export(ConstBuffer<void> data)
+{
+	data = ExportPrepare(data);
+
+	if (pack24) {
+		const size_t num_samples = data.size / sizeof(int32_t);
+		void *dest = pack_buffer.Get(num_samples * 3);
+		assert(dest != nullptr);
+		data = ExportPack(data, dest);
+	} else if (shift8)
+		data = ExportPack(data, pack_buffer.Get(data.size));
 
 	if (reverse_endian > 0) {
 		assert(reverse_endian >= 2);
@@ -155,6 +183,38 @@ PcmExport::Export(ConstBuffer<void> data)
 	return data;
 }
 
+size_t
+PcmExport::Export(ConstBuffer<void> data, void *dest)
+{
+	assert(dest != nullptr);
+
+	data = ExportPrepare(data);
+
+	if (pack24 || shift8) {
+		/* if the byte order needs to be reversed, that is
+		   the last step; pack into an intermediate buffer
+		   then */
+		void *pack_dest = dest;
+		if (reverse_endian > 0)
+			pack_dest = pack_buffer.Get(pack24
+						    ? data.size / 4 * 3
+						    : data.size);
+
+		data = ExportPack(data, pack_dest);
+	}
+
+	if (reverse_endian > 0) {
+		assert(reverse_endian >= 2);
+
+		const auto src = ConstBuffer<uint8_t>::FromVoid(data);
+		reverse_bytes((uint8_t *)dest, src.begin(), src.end(),
+			      reverse_endian);
+	} else if (data.data != dest)
+		memcpy(dest, data.data, data.size);
+
+	return data.size;
+}
+
 size_t
 PcmExport::CalcSourceSize(size_t size) const
 {
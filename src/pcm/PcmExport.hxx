@@ -141,6 +141,14 @@ struct PcmExport {
 	gcc_pure
 	size_t GetFrameSize(const AudioFormat &audio_format) const;
 
+	/**
+	 * Returns the number of output frames which must be exported
+	 * together.  DoP emits pairs of frames, because it alternates
+	 * between two markers.
+	 */
+	gcc_pure
+	unsigned GetOutputBlockSize() const;
+
 	/**
 	 * Export a PCM buffer.
 	 *
@@ -149,6 +157,19 @@ struct PcmExport {
 	 */
 	ConstBuffer<void> Export(ConstBuffer<void> src);
 
+	/**
+	 * Export a PCM buffer to the given destination, e.g. the
+	 * memory-mapped buffer of a sound device.  The last
+	 * conversion step writes there directly; if there is nothing
+	 * to convert, the source is copied.
+	 *
+	 * @param src the source PCM buffer
+	 * @param dest the destination buffer; it must be large
+	 * enough for the converted data
+	 * @return the number of bytes written to #dest
+	 */
+	size_t Export(ConstBuffer<void> src, void *dest);
+
 	/**
 	 * Converts the number of consumed bytes from the pcm_export()
 	 * destination buffer to the according number of bytes from the
@@ -156,6 +177,18 @@ struct PcmExport {
 	 */
 	gcc_pure
 	size_t CalcSourceSize(size_t dest_size) const;
+
+private:
+	/**
+	 * Apply the conversions which need intermediate buffers:
+	 * channel order and DSD.
+	 */
+	ConstBuffer<void> ExportPrepare(ConstBuffer<void> src);
+
+	/**
+	 * Apply #pack24 or #shift8, writing to the given buffer.
+	 */
+	ConstBuffer<void> ExportPack(ConstBuffer<void> src, void *dest) const;
 };
 
 #endif
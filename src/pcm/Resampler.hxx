@@ -54,6 +54,14 @@ public:
 	 */
 	virtual void Close() = 0;
 
+	/**
+	 * Discard the state of the current stream (e.g. buffered
+	 * samples), but keep the setup, so the resampler can be used
+	 * for a new stream with the same parameters without the cost
+	 * of Close() and Open().
+	 */
+	virtual void Reset() {}
+
 	/**
 	 * Resamples a block of PCM data.
 	 *
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "ResamplerCache.hxx"
+#include "ConfiguredResampler.hxx"
+#include "Resampler.hxx"
+#include "util/Error.hxx"
+
+#include <assert.h>
+
+PcmResamplerCache::~PcmResamplerCache()
+{
+	for (auto &i : idle)
+		Delete(i);
+}
+
+bool
+PcmResamplerCache::Create(Item &item, Error &error)
+{
+	item.resampler = pcm_resampler_create();
+
+	item.requested_format = item.src_format;
+	item.dest_format = item.resampler->Open(item.requested_format,
+						item.new_sample_rate,
+						error);
+	if (!item.dest_format.IsValid()) {
+		delete item.resampler;
+		return false;
+	}
+
+	assert(item.requested_format.channels == item.src_format.channels);
+	assert(item.dest_format.channels == item.src_format.channels);
+	assert(item.dest_format.sample_rate == item.new_sample_rate);
+
+	return true;
+}
+
+void
+PcmResamplerCache::Delete(Item &item)
+{
+	item.resampler->Close();
+	delete item.resampler;
+}
+
+void
+PcmResamplerCache::AddIdle(const Item &item)
+{
+	for (auto &i : idle) {
+		if (i.Match(item.src_format, item.new_sample_rate)) {
+			/* another thread was faster */
+			Item copy = item;
+			Delete(copy);
+			return;
+		}
+	}
+
+	idle.push_front(item);
+
+	if (idle.size() > MAX_IDLE) {
+		Delete(idle.back());
+		idle.pop_back();
+	}
+}
+
+PcmResampler *
+PcmResamplerCache::Get(AudioFormat src_format, unsigned new_sample_rate,
+		       AudioFormat &requested_format,
+		       AudioFormat &dest_format,
+		       Error &error)
+{
+	assert(src_format.IsValid());
+	assert(audio_valid_sample_rate(new_sample_rate));
+
+	{
+		const ScopeLock protect(mutex);
+
+		for (auto i = idle.begin(); i != idle.end(); ++i) {
+			if (i->Match(src_format, new_sample_rate)) {
+				requested_format = i->requested_format;
+				dest_format = i->dest_format;
+				PcmResampler *resampler = i->resampler;
+				idle.erase(i);
+				return resampler;
+			}
+		}
+	}
+
+	Item item;
+	item.src_format = src_format;
+	item.new_sample_rate = new_sample_rate;
+	if (!Create(item, error))
+		return nullptr;
+
+	requested_format = item.requested_format;
+	dest_format = item.dest_format;
+	return item.resampler;
+}
+
+void
+PcmResamplerCache::Put(PcmResampler *resampler,
+		       AudioFormat src_format, unsigned new_sample_rate,
+		       AudioFormat requested_format, AudioFormat dest_format)
+{
+	assert(resampler != nullptr);
+
+	/* discard the old stream's filter state, but keep the
+	   filter */
+	resampler->Reset();
+
+	const Item item{
+		src_format, new_sample_rate,
+		requested_format, dest_format,
+		resampler,
+	};
+
+	const ScopeLock protect(mutex);
+	AddIdle(item);
+}
+
+void
+PcmResamplerCache::Prepare(AudioFormat src_format, unsigned new_sample_rate)
+{
+	assert(src_format.IsValid());
+	assert(audio_valid_sample_rate(new_sample_rate));
+
+	{
+		const ScopeLock protect(mutex);
+		for (const auto &i : idle)
+			if (i.Match(src_format, new_sample_rate))
+				return;
+	}
+
+	Item item;
+	item.src_format = src_format;
+	item.new_sample_rate = new_sample_rate;
+
+	Error error;
+	if (!Create(item, error))
+		return;
+
+	const ScopeLock protect(mutex);
+	AddIdle(item);
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_RESAMPLER_CACHE_HXX
+#define MPD_PCM_RESAMPLER_CACHE_HXX
+
+#include "check.h"
+#include "AudioFormat.hxx"
+#include "thread/Mutex.hxx"
+
+#include <list>
+
+class Error;
+class PcmResampler;
+
+/**
+ * A small cache of opened #PcmResampler instances, keyed by the
+ * source format and the destination sample rate.  Opening a
+ * resampler can be expensive (e.g. soxr designs its filter), and a
+ * playlist alternating between sample rates would otherwise pay that
+ * price at every song border.
+ *
+ * Get() and Put() are called by the thread which owns the cache;
+ * Prepare() may be called by any other thread.
+ */
+class PcmResamplerCache {
+	/**
+	 * The maximum number of idle instances.
+	 */
+	static constexpr unsigned MAX_IDLE = 4;
+
+	struct Item {
+		AudioFormat src_format;
+		unsigned new_sample_rate;
+
+		/**
+		 * The input format requested by the resampler and its
+		 * output format; see PcmResampler::Open().
+		 */
+		AudioFormat requested_format, dest_format;
+
+		PcmResampler *resampler;
+
+		gcc_pure
+		bool Match(AudioFormat _src_format,
+			   unsigned _new_sample_rate) const {
+			return src_format == _src_format &&
+				new_sample_rate == _new_sample_rate;
+		}
+	};
+
+	Mutex mutex;
+
+	/**
+	 * Idle instances, the most recently used one first.
+	 */
+	std::list<Item> idle;
+
+public:
+	PcmResamplerCache() = default;
+	~PcmResamplerCache();
+
+	PcmResamplerCache(const PcmResamplerCache &) = delete;
+	PcmResamplerCache &operator=(const PcmResamplerCache &) = delete;
+
+	/**
+	 * Obtain an opened resampler, either from the cache or by
+	 * creating a new one.  It must be returned with Put().
+	 *
+	 * @param requested_format receives the input format
+	 * requested by the resampler
+	 * @param dest_format receives the output format
+	 * @return the resampler or nullptr on error
+	 */
+	PcmResampler *Get(AudioFormat src_format, unsigned new_sample_rate,
+			  AudioFormat &requested_format,
+			  AudioFormat &dest_format,
+			  Error &error);
+
+	/**
+	 * Return a resampler obtained by Get().  Its state is reset,
+	 * and it is kept for the next Get() call with the same
+	 * parameters.
+	 */
+	void Put(PcmResampler *resampler,
+		 AudioFormat src_format, unsigned new_sample_rate,
+		 AudioFormat requested_format, AudioFormat dest_format);
+
+	/**
+	 * Create a resampler ahead of time, so a later Get() call
+	 * doesn't have to.  Does nothing if there is one already.
+	 * Errors are ignored; Get() will report them.
+	 */
+	void Prepare(AudioFormat src_format, unsigned new_sample_rate);
+
+private:
+	/**
+	 * Open a new resampler.  Called without holding the mutex.
+	 */
+	static bool Create(Item &item, Error &error);
+
+	static void Delete(Item &item);
+
+	/**
+	 * Add an item to the front of the idle list, and evict the
+	 * least recently used one if the list is too long.  Caller
+	 * must lock the mutex.
+	 */
+	void AddIdle(const Item &item);
+};
+
+#endif
@@ -38,6 +38,7 @@ PlayerControl::PlayerControl(PlayerListener &_listener,
 	 error_type(PlayerError::NONE),
 	 tagged_song(nullptr),
 	 next_song(nullptr),
+	 last_audio_format(AudioFormat::Undefined()),
 	 total_play_time(0),
 	 border_pause(false)
 {
@@ -164,6 +164,14 @@ struct PlayerControl {
 
 	SongTime seek_time;
 
+	/**
+	 * The audio format which was most recently used to open the
+	 * audio outputs.  The player thread uses it to open them
+	 * before the decoder has reported the format of the next
+	 * song.  Only accessed by the player thread.
+	 */
+	AudioFormat last_audio_format;
+
 	CrossFadeSettings cross_fade;
 
 	double total_play_time;
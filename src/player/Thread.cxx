@@ -32,8 +32,10 @@
 #include "output/MultipleOutputs.hxx"
 #include "tag/Tag.hxx"
 #include "Idle.hxx"
+#include "AudioConfig.hxx"
 #include "util/Domain.hxx"
 #include "thread/Name.hxx"
+#include "system/Clock.hxx"
 #include "Log.hxx"
 
 #include <string.h>
@@ -84,6 +86,12 @@ class Player {
 	 */
 	bool output_open;
 
+	/**
+	 * Has OpenOutputEarly() been called for the current decoder
+	 * start-up?
+	 */
+	bool early_open_attempted;
+
 	/**
 	 * the song currently being played
 	 */
@@ -144,6 +152,13 @@ class Player {
 	 */
 	SongTime elapsed_time;
 
+	/**
+	 * The MonotonicClockUS() value when playback was started; it
+	 * is cleared when the first chunk has been submitted to the
+	 * audio outputs.  This measures the "time to first chunk".
+	 */
+	uint64_t start_clock;
+
 public:
 	Player(PlayerControl &_pc, DecoderControl &_dc,
 	       MusicBuffer &_buffer)
@@ -154,11 +169,13 @@ public:
 		 paused(false),
 		 queued(true),
 		 output_open(false),
+		 early_open_attempted(false),
 		 song(nullptr),
 		 xfade_state(CrossFadeState::UNKNOWN),
 		 cross_fade_chunks(0),
 		 cross_fade_tag(nullptr),
-		 elapsed_time(SongTime::zero()) {}
+		 elapsed_time(SongTime::zero()),
+		 start_clock(0) {}
 
 private:
 	/**
@@ -258,6 +275,18 @@ private:
 	 */
 	bool SeekDecoder();
 
+	/**
+	 * Attempt to satisfy a seek with chunks which have already
+	 * been decoded (or played recently), without involving the
+	 * decoder.  See MultipleOutputs::Rewind().
+	 *
+	 * The player lock is not held.
+	 *
+	 * @return true on success, false if the destination is not
+	 * buffered
+	 */
+	bool SeekBuffered(SongTime where);
+
 	/**
 	 * Check if the decoder has reported an error, and forward it
 	 * to PlayerControl::SetError().
@@ -289,6 +318,19 @@ private:
 	 */
 	bool OpenOutput();
 
+	/**
+	 * Open the audio outputs while the decoder is still starting
+	 * up, so opening the devices overlaps with decoder
+	 * initialization and buffering.  If the decoder hasn't
+	 * reported its audio format yet, the format which was used
+	 * last (or the configured "audio_output_format") is guessed;
+	 * CheckDecoderStartup() reopens the outputs if the guess was
+	 * wrong.  Failures are not fatal and are not reported.
+	 *
+	 * The player lock is not held.
+	 */
+	void OpenOutputEarly();
+
 	/**
 	 * Obtains the next chunk from the music pipe, optionally applies
 	 * cross-fading, and sends it to all audio outputs.
@@ -396,6 +438,7 @@ Player::ActivateDecoder()
 	/* set the "starting" flag, which will be cleared by
 	   player_check_decoder_startup() */
 	decoder_starting = true;
+	early_open_attempted = false;
 
 	/* update PlayerControl's song information */
 	pc.total_time = song->GetDuration();
@@ -440,6 +483,7 @@ Player::OpenOutput()
 	if (pc.outputs.Open(play_audio_format, buffer, error)) {
 		output_open = true;
 		paused = false;
+		pc.last_audio_format = play_audio_format;
 
 		pc.Lock();
 		pc.state = PlayerState::PLAY;
@@ -468,6 +512,48 @@ Player::OpenOutput()
 	}
 }
 
+void
+Player::OpenOutputEarly()
+{
+	assert(decoder_starting);
+	assert(!output_open);
+	assert(!paused);
+
+	early_open_attempted = true;
+
+	pc.Lock();
+	AudioFormat audio_format = !dc.IsStarting() && !dc.HasFailed()
+		? dc.out_audio_format
+		: pc.last_audio_format;
+	pc.Unlock();
+
+	if (!audio_format.IsDefined())
+		audio_format = getOutputAudioFormat(AudioFormat::Undefined());
+
+	if (!audio_format.IsValid())
+		/* no idea which format to use; wait for the
+		   decoder */
+		return;
+
+	Error error;
+	const bool success = pc.outputs.Open(audio_format, buffer, error);
+
+	/* the audio format was only a guess; outputs which have
+	   failed with it shall be retried as soon as the decoder's
+	   audio format is known, not after REOPEN_AFTER */
+	pc.outputs.ResetReopen();
+
+	if (!success) {
+		FormatDebug(player_domain, "Failed to open outputs early: %s",
+			    error.GetMessage());
+		return;
+	}
+
+	play_audio_format = audio_format;
+	output_open = true;
+	pc.last_audio_format = audio_format;
+}
+
 bool
 Player::CheckDecoderStartup()
 {
@@ -498,8 +584,13 @@ Player::CheckDecoderStartup()
 
 		idle_add(IDLE_PLAYER);
 
+		if (output_open && play_audio_format != dc.out_audio_format)
+			FormatDebug(player_domain,
+				    "Reopening outputs after early open");
+
 		play_audio_format = dc.out_audio_format;
 		decoder_starting = false;
+		early_open_attempted = false;
 
 		if (!paused && !OpenOutput()) {
 			FormatError(player_domain,
@@ -605,6 +696,12 @@ Player::SeekDecoder()
 				where = total_time;
 		}
 
+		if (SeekBuffered(where)) {
+			elapsed_time = where;
+			pc.LockCommandFinished();
+			return true;
+		}
+
 		Error error;
 		if (!dc.Seek(where + start_time, error)) {
 			/* decoder failure */
@@ -628,6 +725,32 @@ Player::SeekDecoder()
 	return true;
 }
 
+bool
+Player::SeekBuffered(SongTime where)
+{
+	assert(IsDecoderAtCurrentSong());
+
+	if (!output_open || !play_audio_format.IsDefined() ||
+	    xfade_state == CrossFadeState::ACTIVE)
+		return false;
+
+	if (!pc.outputs.CanRewind(*pipe, where))
+		return false;
+
+	FormatDebug(player_domain, "seeking within the buffer to %f",
+		    where.ToDoubleS());
+
+	pc.outputs.Rewind(*pipe);
+
+	pc.outputs.SkipTo(*pipe, where);
+
+	/* there's enough data in the pipe, no need to wait for the
+	   decoder */
+	buffering = false;
+
+	return true;
+}
+
 inline void
 Player::ProcessCommand()
 {
@@ -908,6 +1031,12 @@ Player::PlayNextChunk()
 		return false;
 	}
 
+	if (start_clock != 0) {
+		FormatDebug(player_domain, "time to first chunk: %.1f ms",
+			    (MonotonicClockUS() - start_clock) / 1000.);
+		start_clock = 0;
+	}
+
 	/* this formula should prevent that the decoder gets woken up
 	   with each chunk; it is more efficient to make it decode a
 	   larger block at a time */
@@ -956,6 +1085,8 @@ Player::Run()
 {
 	pipe = new MusicPipe();
 
+	start_clock = MonotonicClockUS();
+
 	StartDecoder(*pipe);
 	ActivateDecoder();
 
@@ -976,6 +1107,12 @@ Player::Run()
 
 		pc.Unlock();
 
+		if (decoder_starting && !output_open && !paused &&
+		    !early_open_attempted)
+			/* open the outputs while the decoder is busy
+			   with start-up and buffering */
+			OpenOutputEarly();
+
 		if (buffering) {
 			/* buffering at the start of the song - wait
 			   until the buffer is large enough, to
@@ -986,6 +1123,7 @@ Player::Run()
 				/* not enough decoded buffer space yet */
 
 				if (!paused && output_open &&
+				    !decoder_starting &&
 				    pc.outputs.Check() < 4 &&
 				    !SendSilence())
 					break;
@@ -1033,6 +1171,13 @@ Player::Run()
 		    IsDecoderAtNextSong() &&
 		    xfade_state == CrossFadeState::UNKNOWN &&
 		    !dc.LockIsStarting()) {
+			if (dc.out_audio_format != play_audio_format)
+				/* the next song has a different format:
+				   let the outputs set up the conversion
+				   while the current song is still
+				   playing */
+				pc.outputs.Prepare(dc.out_audio_format);
+
 			/* enable cross fading in this song?  if yes,
 			   calculate how many chunks will be required
 			   for it */
@@ -26,6 +26,9 @@
 #include "fs/AllocatedPath.hxx"
 #include "storage/StorageInterface.hxx"
 #include "util/UriUtil.hxx"
+#include "Log.hxx"
+
+#include <exception>
 
 #include <assert.h>
 
@@ -41,6 +44,14 @@ playlist_open_in_playlist_dir(const char *uri, Mutex &mutex, Cond &cond)
 	if (path_fs.IsNull())
 		return nullptr;
 
+	/* the playlist plugin reads the file directly; make sure
+	   edits which are still in the cache are visible */
+	try {
+		spl_flush(uri);
+	} catch (const std::exception &e) {
+		LogError(e);
+	}
+
 	return playlist_open_path(path_fs, mutex, cond);
 }
 
@@ -40,6 +40,9 @@ merge_song_metadata(DetachedSong &add, const DetachedSong &base)
 	}
 
 	add.SetLastModified(base.GetLastModified());
+
+	if (add.GetAnalysis() == nullptr)
+		add.SetAnalysis(base.GetSharedAnalysis());
 }
 
 static bool
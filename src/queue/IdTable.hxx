@@ -73,6 +73,20 @@ public:
 		return id;
 	}
 
+	/**
+	 * Insert with the specified id if it is valid and not in use,
+	 * or else with a new one.
+	 *
+	 * @return the id which was assigned
+	 */
+	unsigned Insert(unsigned position, unsigned id) {
+		if (id == 0 || id >= size || data[id] >= 0)
+			return Insert(position);
+
+		data[id] = position;
+		return id;
+	}
+
 	void Move(unsigned id, unsigned position) {
 		assert(id < size);
 		assert(data[id] >= 0);
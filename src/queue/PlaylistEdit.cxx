@@ -65,19 +65,19 @@ playlist::Clear(PlayerControl &pc)
 void
 playlist::BeginBulk()
 {
-	assert(!bulk_edit);
+	if (bulk_edit++ > 0)
+		/* nested */
+		return;
 
-	bulk_edit = true;
 	bulk_modified = false;
 }
 
 void
 playlist::CommitBulk(PlayerControl &pc)
 {
-	assert(bulk_edit);
+	assert(bulk_edit > 0);
 
-	bulk_edit = false;
-	if (!bulk_modified)
+	if (--bulk_edit > 0)
 		return;
 
 	if (queued < 0)
@@ -85,10 +85,13 @@ playlist::CommitBulk(PlayerControl &pc)
 		   ignored in "bulk" edit mode; now that we have
 		   shuffled all new songs, we can pick a random one
 		   (instead of always picking the first one that was
-		   added) */
+		   added).  This is needed even if the queue was not
+		   modified: "play" and "seek" discard the queued
+		   song, too */
 		UpdateQueuedSong(pc, nullptr);
 
-	OnModified();
+	if (bulk_modified)
+		OnModified();
 }
 
 unsigned
@@ -27,11 +27,13 @@
 #include "PlaylistError.hxx"
 #include "Playlist.hxx"
 #include "queue/QueueSave.hxx"
+#include "queue/QueueSnapshot.hxx"
 #include "fs/io/TextFile.hxx"
 #include "fs/io/BufferedOutputStream.hxx"
 #include "player/Control.hxx"
 #include "config/ConfigGlobal.hxx"
 #include "config/ConfigOption.hxx"
+#include "fs/Path.hxx"
 #include "util/CharUtil.hxx"
 #include "util/StringAPI.hxx"
 #include "util/StringCompare.hxx"
@@ -52,6 +54,7 @@
 #define PLAYLIST_STATE_FILE_MIXRAMPDELAY	"mixrampdelay: "
 #define PLAYLIST_STATE_FILE_PLAYLIST_BEGIN	"playlist_begin"
 #define PLAYLIST_STATE_FILE_PLAYLIST_END	"playlist_end"
+#define PLAYLIST_STATE_FILE_PLAYLIST_SNAPSHOT	"playlist_snapshot"
 
 #define PLAYLIST_STATE_FILE_STATE_PLAY		"play"
 #define PLAYLIST_STATE_FILE_STATE_PAUSE		"pause"
@@ -59,7 +62,7 @@
 
 void
 playlist_state_save(BufferedOutputStream &os, const struct playlist &playlist,
-		    PlayerControl &pc)
+		    PlayerControl &pc, bool queue_snapshot)
 {
 	const auto player_status = pc.LockGetStatus();
 
@@ -94,6 +97,12 @@ playlist_state_save(BufferedOutputStream &os, const struct playlist &playlist,
 	os.Format(PLAYLIST_STATE_FILE_MIXRAMPDB "%f\n", pc.GetMixRampDb());
 	os.Format(PLAYLIST_STATE_FILE_MIXRAMPDELAY "%f\n",
 		  pc.GetMixRampDelay());
+
+	if (queue_snapshot) {
+		os.Write(PLAYLIST_STATE_FILE_PLAYLIST_SNAPSHOT "\n");
+		return;
+	}
+
 	os.Write(PLAYLIST_STATE_FILE_PLAYLIST_BEGIN "\n");
 	queue_save(os, playlist.queue);
 	os.Write(PLAYLIST_STATE_FILE_PLAYLIST_END "\n");
@@ -124,9 +133,32 @@ playlist_state_load(TextFile &file, const SongLoader &song_loader,
 	playlist.queue.IncrementVersion();
 }
 
+/**
+ * Load the queue from the snapshot file.
+ *
+ * @return true if the order list has been restored, too
+ */
+static bool
+playlist_state_load_snapshot(Path path, const SongLoader &song_loader,
+			     struct playlist &playlist)
+{
+	bool complete = false;
+
+	try {
+		complete = queue_snapshot_load(path, song_loader,
+					       playlist.queue);
+	} catch (const std::exception &e) {
+		LogError(e);
+	}
+
+	playlist.queue.IncrementVersion();
+	return complete;
+}
+
 bool
 playlist_state_restore(const char *line, TextFile &file,
 		       const SongLoader &song_loader,
+		       Path snapshot_path, bool &snapshot_restored,
 		       struct playlist &playlist, PlayerControl &pc)
 {
 	int current = -1;
@@ -171,9 +203,20 @@ playlist_state_restore(const char *line, TextFile &file,
 		} else if (StringStartsWith(line,
 					    PLAYLIST_STATE_FILE_PLAYLIST_BEGIN)) {
 			playlist_state_load(file, song_loader, playlist);
+		} else if (StringIsEqual(line,
+					 PLAYLIST_STATE_FILE_PLAYLIST_SNAPSHOT)) {
+			snapshot_restored =
+				playlist_state_load_snapshot(snapshot_path,
+							     song_loader,
+							     playlist);
 		}
 	}
 
+	if (snapshot_restored)
+		/* the snapshot contains the order list; don't let
+		   SetRandom() shuffle it again */
+		playlist.queue.random = random_mode;
+
 	playlist.SetRandom(pc, random_mode);
 
 	if (!playlist.queue.IsEmpty()) {
@@ -194,7 +237,7 @@ playlist_state_restore(const char *line, TextFile &file,
 			pc.LockUpdateAudio();
 
 		if (state == PlayerState::STOP /* && config_option */)
-			playlist.current = current;
+			playlist.current = playlist.queue.PositionToOrder(current);
 		else if (seek_time.count() == 0)
 			/* TODO: log error? */
 			playlist.PlayPosition(pc, current, IgnoreError());
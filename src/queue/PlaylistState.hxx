@@ -30,14 +30,27 @@ struct PlayerControl;
 class TextFile;
 class BufferedOutputStream;
 class SongLoader;
+class Path;
 
+/**
+ * @param queue_snapshot true if the queue has been written to the
+ * queue snapshot file (see queue_snapshot_save()); only a reference
+ * to it is saved in the state file then
+ */
 void
 playlist_state_save(BufferedOutputStream &os, const playlist &playlist,
-		    PlayerControl &pc);
+		    PlayerControl &pc, bool queue_snapshot);
 
+/**
+ * @param snapshot_path the path of the queue snapshot file, which is
+ * loaded if the state file refers to it
+ * @param snapshot_restored set to true if the queue has been
+ * restored completely from the snapshot file
+ */
 bool
 playlist_state_restore(const char *line, TextFile &file,
 		       const SongLoader &song_loader,
+		       Path snapshot_path, bool &snapshot_restored,
 		       playlist &playlist, PlayerControl &pc);
 
 /**
@@ -21,7 +21,9 @@
 #include "Playlist.hxx"
 #include "db/Interface.hxx"
 #include "db/LightSong.hxx"
+#include "db/DatabaseError.hxx"
 #include "DetachedSong.hxx"
+#include "SongAnalysis.hxx"
 #include "tag/Tag.hxx"
 #include "Idle.hxx"
 #include "util/Error.hxx"
@@ -34,7 +36,16 @@ UpdatePlaylistSong(const Database &db, DetachedSong &song)
 		   from the Database */
 		return false;
 
-	const LightSong *original = db.GetSong(song.GetURI(), IgnoreError());
+	const LightSong *original;
+	try {
+		original = db.GetSong(song.GetURI(), IgnoreError());
+	} catch (const DatabaseError &) {
+		/* not found - this can happen with songs which were
+		   restored from the state file while the database
+		   was being loaded */
+		return false;
+	}
+
 	if (original == nullptr)
 		/* not found - shouldn't happen, because the update
 		   thread should ensure that all stale Song instances
@@ -42,13 +53,23 @@ UpdatePlaylistSong(const Database &db, DetachedSong &song)
 		return false;
 
 	if (original->mtime == song.GetLastModified()) {
-		/* not modified */
+		/* not modified, but the analysis may have finished
+		   meanwhile; it is not visible to clients, so this
+		   does not count as a modification */
+		if (original->analysis != nullptr &&
+		    song.GetAnalysis() == nullptr)
+			song.SetAnalysis(std::make_shared<SongAnalysis>(
+					*original->analysis));
+
 		db.ReturnSong(original);
 		return false;
 	}
 
 	song.SetLastModified(original->mtime);
 	song.SetTag(*original->tag);
+	song.SetAnalysis(original->analysis != nullptr
+			 ? std::make_shared<SongAnalysis>(*original->analysis)
+			 : nullptr);
 
 	db.ReturnSong(original);
 	return true;
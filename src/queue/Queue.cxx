@@ -21,6 +21,9 @@
 #include "Queue.hxx"
 #include "DetachedSong.hxx"
 
+#include <algorithm>
+#include <vector>
+
 Queue::Queue(unsigned _max_length)
 	:max_length(_max_length), length(0),
 	 version(1),
@@ -85,11 +88,17 @@ Queue::ModifyAtOrder(unsigned _order)
 
 unsigned
 Queue::Append(DetachedSong &&song, uint8_t priority)
+{
+	return Append(std::move(song), priority, 0);
+}
+
+unsigned
+Queue::Append(DetachedSong &&song, uint8_t priority, unsigned _id)
 {
 	assert(!IsFull());
 
 	const unsigned position = length++;
-	const unsigned id = id_table.Insert(position);
+	const unsigned id = id_table.Insert(position, _id);
 
 	auto &item = items[position];
 	item.song = new DetachedSong(std::move(song));
@@ -102,6 +111,24 @@ Queue::Append(DetachedSong &&song, uint8_t priority)
 	return id;
 }
 
+bool
+Queue::RestoreOrder(const uint32_t *src, unsigned n)
+{
+	if (n != length)
+		return false;
+
+	std::vector<bool> seen(length, false);
+	for (unsigned i = 0; i < n; ++i) {
+		if (src[i] >= length || seen[src[i]])
+			return false;
+
+		seen[src[i]] = true;
+	}
+
+	std::copy_n(src, n, order);
+	return true;
+}
+
 void
 Queue::SwapPositions(unsigned position1, unsigned position2)
 {
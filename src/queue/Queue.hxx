@@ -270,6 +270,21 @@ struct Queue {
 	 */
 	unsigned Append(DetachedSong &&song, uint8_t priority);
 
+	/**
+	 * Like Append(), but attempt to assign the specified id,
+	 * e.g. when restoring a saved queue.  If the id is not
+	 * available, a new one is generated.
+	 */
+	unsigned Append(DetachedSong &&song, uint8_t priority, unsigned id);
+
+	/**
+	 * Replace the order list, e.g. with one from a saved queue.
+	 *
+	 * @return false (and leave the order list unchanged) if the
+	 * given array is not a permutation of all positions
+	 */
+	bool RestoreOrder(const uint32_t *src, unsigned n);
+
 	/**
 	 * Swaps two songs, addressed by their position.
 	 */
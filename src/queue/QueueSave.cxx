@@ -32,6 +32,12 @@
 #include "fs/Traits.hxx"
 #include "Log.hxx"
 
+#ifdef ENABLE_DATABASE
+#include "db/Interface.hxx"
+#include "storage/StorageInterface.hxx"
+#include "util/UriUtil.hxx"
+#endif
+
 #include <stdlib.h>
 
 #define PRIO_LABEL "Prio: "
@@ -114,6 +120,24 @@ queue_load_song(TextFile &file, const SongLoader &loader,
 
 		const char *uri = endptr + 1;
 
+#ifdef ENABLE_DATABASE
+		const Database *db = loader.GetDatabase();
+		const Storage *storage = loader.GetStorage();
+		if (db != nullptr && storage != nullptr &&
+		    db->IsLoading() && uri_safe_local(uri)) {
+			/* the database is still being loaded; don't
+			   wait for it, restore the song without tags;
+			   they will be filled in by
+			   playlist::DatabaseModified() when loading
+			   has finished */
+			song = new DetachedSong(uri);
+			song->SetRealURI(storage->MapUTF8(uri));
+			queue.Append(std::move(*song), priority);
+			delete song;
+			return;
+		}
+#endif
+
 		song = new DetachedSong(uri);
 	}
 
@@ -0,0 +1,353 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "QueueSnapshot.hxx"
+#include "Queue.hxx"
+#include "PlaylistError.hxx"
+#include "DetachedSong.hxx"
+#include "SongLoader.hxx"
+#include "playlist/PlaylistSong.hxx"
+#include "tag/Tag.hxx"
+#include "tag/TagBuilder.hxx"
+#include "fs/FileInfo.hxx"
+#include "fs/io/FileReader.hxx"
+#include "fs/io/FileOutputStream.hxx"
+#include "fs/io/BufferedOutputStream.hxx"
+#include "util/StringView.hxx"
+#include "Log.hxx"
+
+#ifdef ENABLE_DATABASE
+#include "db/Interface.hxx"
+#endif
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+#include <string.h>
+
+static constexpr char QUEUE_SNAPSHOT_MAGIC[8] = {
+	'M', 'P', 'D', 'Q', 'U', 'E', 'U', '1',
+};
+
+/**
+ * Refuse to load files larger than this; they are corrupt.
+ */
+static constexpr uint64_t MAX_SNAPSHOT_SIZE = 256 * 1024 * 1024;
+
+/**
+ * The string index of an unset real URI.
+ */
+static constexpr uint32_t NO_STRING = ~uint32_t(0);
+
+/**
+ * Bit flags in each song record.
+ */
+static constexpr uint8_t SNAPSHOT_HAS_PLAYLIST = 0x1;
+
+template<typename T>
+static void
+WriteValue(BufferedOutputStream &os, T value)
+{
+	os.Write(&value, sizeof(value));
+}
+
+/**
+ * Collects the strings of all songs, assigning each distinct string
+ * an index.
+ */
+class SnapshotStringTable {
+	std::unordered_map<std::string, uint32_t> map;
+	std::vector<const std::string *> strings;
+
+public:
+	uint32_t Intern(const char *s) {
+		auto i = map.emplace(s, strings.size());
+		if (i.second)
+			strings.push_back(&i.first->first);
+		return i.first->second;
+	}
+
+	void Write(BufferedOutputStream &os) const {
+		WriteValue<uint32_t>(os, strings.size());
+		for (const auto *s : strings) {
+			WriteValue<uint32_t>(os, s->length());
+			os.Write(s->data(), s->length());
+		}
+	}
+};
+
+struct SnapshotSong {
+	uint32_t uri, real_uri;
+	std::vector<std::pair<uint8_t, uint32_t>> tag;
+};
+
+void
+queue_snapshot_save(Path path, const Queue &queue, time_t db_stamp)
+{
+	const unsigned length = queue.GetLength();
+
+	SnapshotStringTable strings;
+	std::vector<SnapshotSong> songs(length);
+
+	for (unsigned i = 0; i < length; ++i) {
+		const DetachedSong &song = queue.Get(i);
+		SnapshotSong &s = songs[i];
+
+		s.uri = strings.Intern(song.GetURI());
+		s.real_uri = song.HasRealURI()
+			? strings.Intern(song.GetRealURI())
+			: NO_STRING;
+
+		for (const auto &item : song.GetTag())
+			s.tag.emplace_back(uint8_t(item.type),
+					   strings.Intern(item.value));
+	}
+
+	FileOutputStream fos(path);
+	BufferedOutputStream os(fos);
+
+	os.Write(QUEUE_SNAPSHOT_MAGIC, sizeof(QUEUE_SNAPSHOT_MAGIC));
+	WriteValue<int64_t>(os, db_stamp);
+
+	strings.Write(os);
+
+	WriteValue<uint32_t>(os, length);
+	for (unsigned i = 0; i < length; ++i) {
+		const Queue::Item &item = queue.items[i];
+		const DetachedSong &song = *item.song;
+		const Tag &tag = song.GetTag();
+		const SnapshotSong &s = songs[i];
+
+		WriteValue<uint32_t>(os, s.uri);
+		WriteValue<uint32_t>(os, s.real_uri);
+		WriteValue<uint32_t>(os, item.id);
+		WriteValue<uint8_t>(os, item.priority);
+		WriteValue<uint8_t>(os, tag.has_playlist
+				    ? SNAPSHOT_HAS_PLAYLIST : 0);
+		WriteValue<uint16_t>(os, s.tag.size());
+		WriteValue<int64_t>(os, song.GetLastModified());
+		WriteValue<uint32_t>(os, song.GetStartTime().ToMS());
+		WriteValue<uint32_t>(os, song.GetEndTime().ToMS());
+		WriteValue<int32_t>(os, tag.duration.count());
+
+		for (const auto &t : s.tag) {
+			WriteValue<uint8_t>(os, t.first);
+			WriteValue<uint32_t>(os, t.second);
+		}
+	}
+
+	for (unsigned i = 0; i < length; ++i)
+		WriteValue<uint32_t>(os, queue.order[i]);
+
+	os.Flush();
+	fos.Commit();
+}
+
+/**
+ * Parses a snapshot file which has been read into memory.
+ */
+class SnapshotReader {
+	const uint8_t *p;
+	const uint8_t *const end;
+
+public:
+	SnapshotReader(const void *data, size_t size)
+		:p((const uint8_t *)data), end(p + size) {}
+
+	const void *Read(size_t size) {
+		if (size > size_t(end - p))
+			throw std::runtime_error("Truncated queue snapshot");
+
+		const void *result = p;
+		p += size;
+		return result;
+	}
+
+	template<typename T>
+	T ReadValue() {
+		T value;
+		memcpy(&value, Read(sizeof(value)), sizeof(value));
+		return value;
+	}
+};
+
+static std::unique_ptr<uint8_t[]>
+LoadFile(Path path, size_t &size_r)
+{
+	FileReader reader(path);
+
+	const uint64_t size = reader.GetFileInfo().GetSize();
+	if (size > MAX_SNAPSHOT_SIZE)
+		throw std::runtime_error("Queue snapshot is too large");
+
+	std::unique_ptr<uint8_t[]> buffer(new uint8_t[size]);
+	size_t position = 0;
+	while (position < size) {
+		size_t nbytes = reader.Read(buffer.get() + position,
+					    size - position);
+		if (nbytes == 0)
+			throw std::runtime_error("Truncated queue snapshot");
+
+		position += nbytes;
+	}
+
+	size_r = size;
+	return buffer;
+}
+
+/**
+ * Can the songs be taken from the snapshot without looking them up?
+ */
+gcc_pure
+static bool
+CanTrustSnapshot(gcc_unused const SongLoader &loader, time_t db_stamp)
+{
+#ifdef ENABLE_DATABASE
+	const Database *db = loader.GetDatabase();
+	if (db != nullptr) {
+		if (db->IsLoading())
+			/* the tags will be refreshed when loading has
+			   finished, see Instance::OnDatabaseLoaded() */
+			return true;
+
+		return db_stamp != 0 && db->GetUpdateStamp() == db_stamp;
+	}
+#endif
+
+	return db_stamp == 0;
+}
+
+bool
+queue_snapshot_load(Path path, const SongLoader &loader, Queue &queue)
+{
+	size_t size;
+	const auto buffer = LoadFile(path, size);
+	SnapshotReader reader(buffer.get(), size);
+
+	if (memcmp(reader.Read(sizeof(QUEUE_SNAPSHOT_MAGIC)),
+		   QUEUE_SNAPSHOT_MAGIC, sizeof(QUEUE_SNAPSHOT_MAGIC)) != 0)
+		throw std::runtime_error("Malformed queue snapshot");
+
+	const bool trust = CanTrustSnapshot(loader, reader.ReadValue<int64_t>());
+
+	const auto n_strings = reader.ReadValue<uint32_t>();
+	if (n_strings > size)
+		throw std::runtime_error("Malformed queue snapshot");
+
+	std::vector<StringView> strings;
+	strings.reserve(n_strings);
+	for (uint32_t i = 0; i < n_strings; ++i) {
+		const auto length = reader.ReadValue<uint32_t>();
+		strings.emplace_back((const char *)reader.Read(length),
+				     length);
+	}
+
+	auto GetString = [&strings](uint32_t i) -> StringView {
+		if (i >= strings.size())
+			throw std::runtime_error("Malformed queue snapshot");
+		return strings[i];
+	};
+
+	const unsigned old_length = queue.GetLength();
+	const auto n_songs = reader.ReadValue<uint32_t>();
+	bool complete = true;
+
+	for (uint32_t i = 0; i < n_songs; ++i) {
+		const StringView uri = GetString(reader.ReadValue<uint32_t>());
+		const auto real_uri = reader.ReadValue<uint32_t>();
+		const auto id = reader.ReadValue<uint32_t>();
+		const auto priority = reader.ReadValue<uint8_t>();
+		const auto flags = reader.ReadValue<uint8_t>();
+		const auto n_items = reader.ReadValue<uint16_t>();
+		const auto mtime = reader.ReadValue<int64_t>();
+		const auto start_ms = reader.ReadValue<uint32_t>();
+		const auto end_ms = reader.ReadValue<uint32_t>();
+		const auto duration_ms = reader.ReadValue<int32_t>();
+
+		TagBuilder tag;
+		tag.SetDuration(SignedSongTime::FromMS(duration_ms));
+		tag.SetHasPlaylist(flags & SNAPSHOT_HAS_PLAYLIST);
+
+		for (unsigned j = 0; j < n_items; ++j) {
+			const auto type = reader.ReadValue<uint8_t>();
+			const StringView value =
+				GetString(reader.ReadValue<uint32_t>());
+			if (type >= TAG_NUM_OF_ITEM_TYPES)
+				throw std::runtime_error("Malformed queue snapshot");
+
+			tag.AddItem(TagType(type), value);
+		}
+
+		if (uri.IsEmpty())
+			throw std::runtime_error("Malformed queue snapshot");
+
+		if (queue.IsFull()) {
+			complete = false;
+			continue;
+		}
+
+		DetachedSong song(std::string(uri.data, uri.size));
+
+		/* if the database has changed, songs which
+		   queue_save() would save in the brief format are
+		   looked up without the old metadata */
+		const bool brief = song.IsInDatabase() &&
+			start_ms == 0 && end_ms == 0;
+
+		if (trust || !brief) {
+			song.SetTag(tag.Commit());
+			song.SetLastModified(mtime);
+			song.SetStartTime(SongTime::FromMS(start_ms));
+			song.SetEndTime(SongTime::FromMS(end_ms));
+		}
+
+		if (trust) {
+			if (real_uri != NO_STRING) {
+				const StringView r = GetString(real_uri);
+				song.SetRealURI(std::string(r.data, r.size));
+			}
+		} else if (!playlist_check_translate_song(song, nullptr,
+							  loader)) {
+			complete = false;
+			continue;
+		}
+
+		queue.Append(std::move(song), priority, id);
+	}
+
+	std::vector<uint32_t> order(n_songs);
+	for (auto &i : order)
+		i = reader.ReadValue<uint32_t>();
+
+	if (!complete || old_length > 0)
+		return false;
+
+	if (!queue.RestoreOrder(order.data(), order.size())) {
+		LogWarning(playlist_domain,
+			   "Malformed order list in queue snapshot");
+		return false;
+	}
+
+	return true;
+}
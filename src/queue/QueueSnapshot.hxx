@@ -0,0 +1,56 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * A binary snapshot of the queue, which is stored next to the state
+ * file.  Unlike the text format written by queue_save(), it contains
+ * all song metadata, the ids and the order list, and all strings are
+ * stored only once.
+ */
+
+#ifndef MPD_QUEUE_SNAPSHOT_HXX
+#define MPD_QUEUE_SNAPSHOT_HXX
+
+#include <time.h>
+
+struct Queue;
+class Path;
+class SongLoader;
+
+/**
+ * Write the queue to a snapshot file.  Throws on error.
+ *
+ * @param db_stamp the update stamp of the database (0 if there is
+ * none); if it is still the same when the snapshot is loaded, the
+ * songs are restored without looking them up
+ */
+void
+queue_snapshot_save(Path path, const Queue &queue, time_t db_stamp);
+
+/**
+ * Load a snapshot written by queue_snapshot_save() and append its
+ * songs to the queue.  Throws on error.
+ *
+ * @return true if the snapshot was restored completely, including the
+ * order list; false if songs were skipped
+ */
+bool
+queue_snapshot_load(Path path, const SongLoader &loader, Queue &queue);
+
+#endif
@@ -22,6 +22,7 @@
 #include "util/Error.hxx"
 #include "util/Domain.hxx"
 #include "LogV.hxx"
+#include "LogBackend.hxx"
 
 #include <unistd.h>
 #include <stdarg.h>
@@ -41,6 +42,12 @@ gcc_noreturn
 static void
 Abort()
 {
+#ifndef ANDROID
+	/* _exit() doesn't give the log thread a chance to write
+	   the message */
+	FlushLogQueue();
+#endif
+
 	_exit(EXIT_FAILURE);
 }
 
@@ -32,6 +32,7 @@
 
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <errno.h>
 
 #ifndef WIN32
 #include <poll.h>
@@ -116,6 +117,37 @@ FileDescriptor::SetBlocking()
 	fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
 }
 
+int
+FileDescriptor::EnlargePipe(unsigned size)
+{
+	assert(IsDefined());
+
+#if defined(F_GETPIPE_SZ) && defined(F_SETPIPE_SZ)
+	const int current = fcntl(fd, F_GETPIPE_SZ);
+	if (current < 0)
+		return -1;
+
+	while (size > unsigned(current)) {
+		const int result = fcntl(fd, F_SETPIPE_SZ, size);
+		if (result >= 0)
+			return result;
+
+		/* EPERM: above /proc/sys/fs/pipe-max-size, or the
+		   user's pipe buffer quota is exhausted */
+		if (errno != EPERM)
+			return -1;
+
+		size /= 2;
+	}
+
+	return current;
+#else
+	(void)size;
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
 #endif
 
 #ifdef USE_EVENTFD
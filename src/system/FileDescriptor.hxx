@@ -108,6 +108,17 @@ public:
 	 */
 	void SetBlocking();
 
+	/**
+	 * Enlarge the buffer of this pipe to (at least) the given
+	 * number of bytes.  If the kernel doesn't allow this size
+	 * for unprivileged processes, the largest permitted size is
+	 * used.  The buffer is never shrunk.
+	 *
+	 * @return the new size of the buffer or -1 on error (or if
+	 * the operating system doesn't support this)
+	 */
+	int EnlargePipe(unsigned size);
+
 	/**
 	 * Duplicate the file descriptor onto the given file descriptor.
 	 */
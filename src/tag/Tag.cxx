@@ -66,9 +66,9 @@ Tag::Clear()
 	tag_pool_lock.lock();
 	for (unsigned i = 0; i < num_items; ++i)
 		tag_pool_put_item(items[i]);
+	tag_pool_free_items(items, num_items);
 	tag_pool_lock.unlock();
 
-	delete[] items;
 	items = nullptr;
 	num_items = 0;
 }
@@ -79,9 +79,8 @@ Tag::Tag(const Tag &other)
 	 items(nullptr)
 {
 	if (num_items > 0) {
-		items = new TagItem *[num_items];
-
 		tag_pool_lock.lock();
+		items = tag_pool_alloc_items(num_items);
 		for (unsigned i = 0; i < num_items; i++)
 			items[i] = tag_pool_dup_item(other.items[i]);
 		tag_pool_lock.unlock();
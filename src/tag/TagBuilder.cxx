@@ -53,8 +53,10 @@ TagBuilder::TagBuilder(Tag &&other)
 	std::copy_n(other.items, other.num_items, std::back_inserter(items));
 
 	/* discard the pointers from the Tag object */
+	tag_pool_lock.lock();
+	tag_pool_free_items(other.items, other.num_items);
+	tag_pool_lock.unlock();
 	other.num_items = 0;
-	delete[] other.items;
 	other.items = nullptr;
 }
 
@@ -99,8 +101,10 @@ TagBuilder::operator=(Tag &&other)
 	std::copy_n(other.items, other.num_items, std::back_inserter(items));
 
 	/* discard the pointers from the Tag object */
+	tag_pool_lock.lock();
+	tag_pool_free_items(other.items, other.num_items);
+	tag_pool_lock.unlock();
 	other.num_items = 0;
-	delete[] other.items;
 	other.items = nullptr;
 
 	return *this;
@@ -128,7 +132,9 @@ TagBuilder::Commit(Tag &tag)
 	   object */
 	const unsigned n_items = items.size();
 	tag.num_items = n_items;
-	tag.items = new TagItem *[n_items];
+	tag_pool_lock.lock();
+	tag.items = tag_pool_alloc_items(n_items);
+	tag_pool_lock.unlock();
 	std::copy_n(items.begin(), n_items, tag.items);
 	items.clear();
 
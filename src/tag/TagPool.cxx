@@ -21,7 +21,7 @@
 #include "TagPool.hxx"
 #include "TagItem.hxx"
 #include "util/Cast.hxx"
-#include "util/VarSize.hxx"
+#include "util/SlabAllocator.hxx"
 #include "util/StringView.hxx"
 
 #include <assert.h>
@@ -32,6 +32,16 @@ Mutex tag_pool_lock;
 
 static constexpr size_t NUM_SLOTS = 4096;
 
+/**
+ * Allocates #TagPoolSlot objects.  Protected by #tag_pool_lock.
+ */
+static SlabAllocator slot_allocator;
+
+/**
+ * Allocates the Tag::items arrays.  Protected by #tag_pool_lock.
+ */
+static SlabAllocator array_allocator;
+
 struct TagPoolSlot {
 	TagPoolSlot *next;
 	unsigned char ref;
@@ -45,19 +55,31 @@ struct TagPoolSlot {
 		item.value[value.size] = 0;
 	}
 
+	static constexpr size_t CalcSize(size_t value_length) {
+		return sizeof(TagPoolSlot) - sizeof(TagItem::value) +
+			value_length + 1;
+	}
+
 	static TagPoolSlot *Create(TagPoolSlot *_next, TagType type,
 				   StringView value);
+
+	void Delete();
 } gcc_packed;
 
 TagPoolSlot *
 TagPoolSlot::Create(TagPoolSlot *_next, TagType type,
 		    StringView value)
 {
-	TagPoolSlot *dummy;
-	return NewVarSize<TagPoolSlot>(sizeof(dummy->item.value),
-				       value.size + 1,
-				       _next, type,
-				       value);
+	void *p = slot_allocator.Allocate(CalcSize(value.size));
+	return ::new(p) TagPoolSlot(_next, type, value);
+}
+
+void
+TagPoolSlot::Delete()
+{
+	const size_t size = CalcSize(strlen(item.value));
+	this->~TagPoolSlot();
+	slot_allocator.Free(this, size);
 }
 
 static TagPoolSlot *slots[NUM_SLOTS];
@@ -166,5 +188,25 @@ tag_pool_put_item(TagItem *item)
 	}
 
 	*slot_p = slot->next;
-	DeleteVarSize(slot);
+	slot->Delete();
+}
+
+TagItem **
+tag_pool_alloc_items(unsigned n)
+{
+	return (TagItem **)array_allocator.Allocate(n * sizeof(TagItem *));
+}
+
+void
+tag_pool_free_items(TagItem **items, unsigned n)
+{
+	array_allocator.Free(items, n * sizeof(TagItem *));
+}
+
+void
+tag_pool_get_stats(SlabAllocatorStats &items, SlabAllocatorStats &arrays)
+{
+	const ScopeLock protect(tag_pool_lock);
+	items = slot_allocator.GetStats();
+	arrays = array_allocator.GetStats();
 }
@@ -27,6 +27,7 @@ extern Mutex tag_pool_lock;
 
 struct TagItem;
 struct StringView;
+struct SlabAllocatorStats;
 
 TagItem *
 tag_pool_get_item(TagType type, StringView value);
@@ -37,4 +38,27 @@ tag_pool_dup_item(TagItem *item);
 void
 tag_pool_put_item(TagItem *item);
 
+/**
+ * Allocate an array for Tag::items.  Caller must lock
+ * #tag_pool_lock.
+ *
+ * @return the array, or nullptr if n is zero
+ */
+TagItem **
+tag_pool_alloc_items(unsigned n);
+
+/**
+ * Free an array returned by tag_pool_alloc_items().  Caller must lock
+ * #tag_pool_lock.
+ */
+void
+tag_pool_free_items(TagItem **items, unsigned n);
+
+/**
+ * Obtain statistics about the memory used by the pooled #TagItem
+ * objects and by the Tag::items arrays.
+ */
+void
+tag_pool_get_stats(SlabAllocatorStats &items, SlabAllocatorStats &arrays);
+
 #endif
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SlabAllocator.hxx"
+#include "Alloc.hxx"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <stdlib.h>
+
+SlabAllocator::SlabAllocator()
+{
+	std::fill_n(free_lists, N_CLASSES, nullptr);
+}
+
+SlabAllocator::~SlabAllocator()
+{
+	while (chunks != nullptr) {
+		Chunk *chunk = chunks;
+		chunks = chunk->next;
+		free(chunk);
+	}
+}
+
+inline void *
+SlabAllocator::AllocateFromChunk(size_t size)
+{
+	if (size_t(end - position) < size) {
+		/* the rest of the current chunk is too small; it is
+		   wasted (at most MAX_SIZE bytes) */
+		Chunk *chunk = (Chunk *)xalloc(CHUNK_SIZE);
+		chunk->next = chunks;
+		chunks = chunk;
+
+		position = (char *)chunk + RoundUp(sizeof(*chunk));
+		end = (char *)chunk + CHUNK_SIZE;
+
+		stats.reserved_bytes += CHUNK_SIZE;
+	}
+
+	void *p = position;
+	position += size;
+	return p;
+}
+
+void *
+SlabAllocator::Allocate(size_t size)
+{
+	if (size == 0)
+		return nullptr;
+
+	size = RoundUp(size);
+	++stats.n_allocated;
+	stats.allocated_bytes += size;
+
+	if (size > MAX_SIZE) {
+		stats.reserved_bytes += size;
+		return xalloc(size);
+	}
+
+	FreeItem *&head = free_lists[size / GRANULARITY - 1];
+	if (head != nullptr) {
+		FreeItem *item = head;
+		head = item->next;
+		return item;
+	}
+
+	return AllocateFromChunk(size);
+}
+
+void
+SlabAllocator::Free(void *p, size_t size)
+{
+	if (p == nullptr)
+		return;
+
+	assert(size > 0);
+
+	size = RoundUp(size);
+	assert(stats.n_allocated > 0);
+	assert(stats.allocated_bytes >= size);
+	--stats.n_allocated;
+	stats.allocated_bytes -= size;
+
+	if (size > MAX_SIZE) {
+		stats.reserved_bytes -= size;
+		free(p);
+		return;
+	}
+
+	FreeItem *item = (FreeItem *)p;
+	FreeItem *&head = free_lists[size / GRANULARITY - 1];
+	item->next = head;
+	head = item;
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_SLAB_ALLOCATOR_HXX
+#define MPD_SLAB_ALLOCATOR_HXX
+
+#include "Compiler.h"
+
+#include <stddef.h>
+
+struct SlabAllocatorStats {
+	/**
+	 * The number of allocations which have not been freed yet.
+	 */
+	size_t n_allocated = 0;
+
+	/**
+	 * The sum of their sizes (rounded up to the granularity).
+	 */
+	size_t allocated_bytes = 0;
+
+	/**
+	 * The amount of memory obtained from the system, including
+	 * freed allocations waiting to be reused.
+	 */
+	size_t reserved_bytes = 0;
+
+	SlabAllocatorStats &operator+=(const SlabAllocatorStats &other) {
+		n_allocated += other.n_allocated;
+		allocated_bytes += other.allocated_bytes;
+		reserved_bytes += other.reserved_bytes;
+		return *this;
+	}
+};
+
+/**
+ * An allocator for many small objects with a long lifetime, e.g. the
+ * songs of the music database.  It carves them out of large chunks,
+ * which avoids the per-allocation overhead of malloc(), and keeps
+ * separate free lists for each size class.  Chunks are only returned
+ * to the system by the destructor.
+ *
+ * The caller must pass the size of an allocation to Free().
+ *
+ * This class is not thread-safe.
+ */
+class SlabAllocator {
+	/**
+	 * Allocation sizes are rounded up to a multiple of this.  It
+	 * is also the guaranteed alignment.
+	 */
+	static constexpr size_t GRANULARITY = 8;
+
+	/**
+	 * Larger allocations are passed to malloc().
+	 */
+	static constexpr size_t MAX_SIZE = 512;
+
+	static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+	static constexpr size_t N_CLASSES = MAX_SIZE / GRANULARITY;
+
+	struct FreeItem {
+		FreeItem *next;
+	};
+
+	struct Chunk {
+		Chunk *next;
+	};
+
+	FreeItem *free_lists[N_CLASSES];
+
+	Chunk *chunks = nullptr;
+
+	/**
+	 * The unused rest of the most recent chunk.
+	 */
+	char *position = nullptr, *end = nullptr;
+
+	SlabAllocatorStats stats;
+
+public:
+	SlabAllocator();
+	~SlabAllocator();
+
+	SlabAllocator(const SlabAllocator &) = delete;
+	SlabAllocator &operator=(const SlabAllocator &) = delete;
+
+	/**
+	 * Allocate memory.  This method never fails; in
+	 * out-of-memory situations, it aborts the process.
+	 *
+	 * @return the new allocation, or nullptr if the size is zero
+	 */
+	gcc_malloc
+	void *Allocate(size_t size);
+
+	/**
+	 * Free an allocation returned by Allocate().
+	 *
+	 * @param size the size that was passed to Allocate()
+	 */
+	void Free(void *p, size_t size);
+
+	const SlabAllocatorStats &GetStats() const {
+		return stats;
+	}
+
+private:
+	static constexpr size_t RoundUp(size_t size) {
+		return (size + GRANULARITY - 1) & ~(GRANULARITY - 1);
+	}
+
+	void *AllocateFromChunk(size_t size);
+};
+
+#endif
@@ -0,0 +1,610 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * A load generator for the MPD protocol.  It opens many connections
+ * to a running MPD and mixes the traffic of typical clients:
+ *
+ * - "idle" waiters, which only wait for notifications
+ * - pollers, which send "status" and "currentsong" every second
+ * - syncers, which send "status" every second and "plchanges" when
+ *   the queue has been modified
+ * - heavy clients, which send "listallinfo" and "search" back to
+ *   back
+ *
+ * After the given number of seconds, it prints the throughput and
+ * the latency percentiles of each command.
+ *
+ * Don't forget to raise "max_connections" in the MPD configuration.
+ */
+
+#include "config.h"
+#include "event/Loop.hxx"
+#include "event/BufferedSocket.hxx"
+#include "event/TimeoutMonitor.hxx"
+#include "net/Resolver.hxx"
+#include "system/fd_util.h"
+#include "util/Error.hxx"
+#include "util/Macros.hxx"
+#include "Log.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netdb.h>
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * The interval of pollers and syncers.
+ */
+static constexpr unsigned POLL_INTERVAL_MS = 1000;
+
+/**
+ * Open no more than this many connections at a time.  MPD's listen
+ * backlog is small, and overflowing it would measure the TCP SYN
+ * retransmit timeout.
+ */
+static constexpr unsigned MAX_CONNECTING = 4;
+
+static const char *const search_words[] = {
+	"love", "night", "blue", "fire", "dream", "rain", "the", "a",
+};
+
+enum class Command {
+	CONNECT,
+	IDLE,
+	STATUS,
+	CURRENTSONG,
+	PLCHANGES,
+	LISTALLINFO,
+	SEARCH,
+	COUNT,
+};
+
+static const char *const command_names[] = {
+	"connect",
+	"idle",
+	"status",
+	"currentsong",
+	"plchanges",
+	"listallinfo",
+	"search",
+};
+
+static_assert(ARRAY_SIZE(command_names) == unsigned(Command::COUNT),
+	      "Wrong command name table");
+
+struct CommandStats {
+	/**
+	 * The duration of each completed command [ms].
+	 */
+	std::vector<float> latencies;
+
+	/**
+	 * The total size of all responses.
+	 */
+	uint64_t bytes = 0;
+
+	/**
+	 * The number of "ACK" responses.
+	 */
+	unsigned errors = 0;
+};
+
+enum class ClientKind {
+	IDLE,
+	POLL,
+	SYNC,
+	HEAVY,
+};
+
+/**
+ * Allow as many connections as the hard limit permits.
+ */
+static void
+RaiseFileLimit()
+{
+	struct rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+}
+
+static int
+Connect(const addrinfo &ai)
+{
+	int fd = socket_cloexec_nonblock(ai.ai_family, ai.ai_socktype,
+					 ai.ai_protocol);
+	if (fd < 0)
+		return -1;
+
+	if (connect(fd, ai.ai_addr, ai.ai_addrlen) < 0 &&
+	    errno != EINPROGRESS) {
+		close_socket(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+class LoadGenerator;
+
+class LoadClient final : BufferedSocket, TimeoutMonitor {
+	LoadGenerator &generator;
+
+	const ClientKind kind;
+
+	/**
+	 * The command whose response is being received.  CONNECT
+	 * means we're waiting for the greeting; COUNT means no
+	 * command is pending.
+	 */
+	Command command = Command::CONNECT;
+
+	Clock::time_point start;
+
+	size_t response_bytes;
+
+	/**
+	 * The queue version reported by the last "status" response,
+	 * and the one which has been synchronized with "plchanges".
+	 */
+	long playlist, synced_playlist = -1;
+
+	/**
+	 * Alternate between "listallinfo" and "search".
+	 */
+	unsigned heavy_step = 0;
+
+public:
+	LoadClient(EventLoop &_loop, int _fd, LoadGenerator &_generator,
+		   ClientKind _kind)
+		:BufferedSocket(_fd, _loop), TimeoutMonitor(_loop),
+		 generator(_generator), kind(_kind),
+		 start(Clock::now()), response_bytes(0) {}
+
+	~LoadClient() {
+		if (BufferedSocket::IsDefined())
+			BufferedSocket::Close();
+	}
+
+	bool IsConnected() const {
+		return BufferedSocket::IsDefined();
+	}
+
+private:
+	void Send(Command _command, const char *request);
+
+	/**
+	 * Send the next command, or schedule the timer.
+	 */
+	void Next();
+
+	void Finish(bool success);
+	void Disconnect();
+
+	bool HandleLine(const char *line, size_t length);
+
+	/* virtual methods from class BufferedSocket */
+	InputResult OnSocketInput(void *data, size_t length) override;
+	void OnSocketError(Error &&error) override;
+	void OnSocketClosed() override;
+
+	/* virtual methods from class TimeoutMonitor */
+	void OnTimeout() override;
+};
+
+/**
+ * Opens the connections and collects the statistics.
+ */
+class LoadGenerator {
+	EventLoop &loop;
+
+	const addrinfo &address;
+
+	/**
+	 * The kinds of the clients which have not been connected yet.
+	 */
+	std::vector<ClientKind> pending;
+
+	std::vector<LoadClient *> clients;
+
+	unsigned n_connecting = 0, n_failed = 0;
+
+public:
+	CommandStats stats[unsigned(Command::COUNT)];
+
+	std::minstd_rand rng;
+
+	LoadGenerator(EventLoop &_loop, const addrinfo &_address,
+		      std::vector<ClientKind> &&_pending)
+		:loop(_loop), address(_address),
+		 pending(std::move(_pending)) {
+		/* connect in random order, so all kinds of clients
+		   get active from the start */
+		std::shuffle(pending.begin(), pending.end(), rng);
+	}
+
+	~LoadGenerator() {
+		for (auto *client : clients)
+			delete client;
+	}
+
+	unsigned GetFailedCount() const {
+		return n_failed;
+	}
+
+	size_t GetClientCount() const {
+		return clients.size();
+	}
+
+	gcc_pure
+	unsigned GetConnectedCount() const;
+
+	void ConnectMore();
+
+	/**
+	 * A client has received the greeting, or it has failed to
+	 * connect.
+	 */
+	void OnConnectFinished(bool success) {
+		--n_connecting;
+		if (!success)
+			++n_failed;
+
+		ConnectMore();
+	}
+};
+
+unsigned
+LoadGenerator::GetConnectedCount() const
+{
+	unsigned n = 0;
+	for (const auto *client : clients)
+		n += client->IsConnected();
+	return n;
+}
+
+void
+LoadGenerator::ConnectMore()
+{
+	while (n_connecting < MAX_CONNECTING && !pending.empty()) {
+		const ClientKind kind = pending.back();
+		pending.pop_back();
+
+		int fd = Connect(address);
+		if (fd < 0) {
+			++n_failed;
+			continue;
+		}
+
+		clients.push_back(new LoadClient(loop, fd, *this, kind));
+		++n_connecting;
+	}
+}
+
+void
+LoadClient::Send(Command _command, const char *request)
+{
+	command = _command;
+	start = Clock::now();
+	response_bytes = 0;
+
+	const size_t length = strlen(request);
+	if (BufferedSocket::Write(request, length) != ssize_t(length)) {
+		/* the socket buffer is empty while no command is
+		   pending, so this is an error */
+		Disconnect();
+	}
+}
+
+void
+LoadClient::Next()
+{
+	command = Command::COUNT;
+
+	switch (kind) {
+	case ClientKind::IDLE:
+		Send(Command::IDLE, "idle\n");
+		break;
+
+	case ClientKind::POLL:
+		TimeoutMonitor::Schedule(POLL_INTERVAL_MS);
+		break;
+
+	case ClientKind::SYNC:
+		if (playlist != synced_playlist && synced_playlist >= 0) {
+			char request[32];
+			snprintf(request, sizeof(request), "plchanges %ld\n",
+				 synced_playlist);
+			synced_playlist = playlist;
+			Send(Command::PLCHANGES, request);
+		} else
+			TimeoutMonitor::Schedule(POLL_INTERVAL_MS);
+		break;
+
+	case ClientKind::HEAVY:
+		if (heavy_step++ % 2 == 0)
+			Send(Command::LISTALLINFO, "listallinfo\n");
+		else {
+			const char *word =
+				search_words[generator.rng() %
+					     ARRAY_SIZE(search_words)];
+			const std::string request =
+				std::string("search any \"") + word + "\"\n";
+			Send(Command::SEARCH, request.c_str());
+		}
+		break;
+	}
+}
+
+void
+LoadClient::Finish(bool success)
+{
+	const std::chrono::duration<float, std::milli> duration =
+		Clock::now() - start;
+
+	CommandStats &s = generator.stats[unsigned(command)];
+	s.latencies.push_back(duration.count());
+	s.bytes += response_bytes;
+	if (!success)
+		++s.errors;
+
+	switch (command) {
+	case Command::CONNECT:
+		generator.OnConnectFinished(true);
+
+		if (kind == ClientKind::POLL || kind == ClientKind::SYNC) {
+			/* spread the pollers over the interval */
+			command = Command::COUNT;
+			TimeoutMonitor::Schedule(generator.rng() %
+						 POLL_INTERVAL_MS);
+			return;
+		}
+
+		break;
+
+	case Command::STATUS:
+		if (kind == ClientKind::POLL) {
+			Send(Command::CURRENTSONG, "currentsong\n");
+			return;
+		}
+
+		if (synced_playlist < 0) {
+			/* the initial synchronization */
+			synced_playlist = playlist;
+			Send(Command::PLCHANGES, "plchanges 0\n");
+			return;
+		}
+
+		break;
+
+	default:
+		break;
+	}
+
+	Next();
+}
+
+void
+LoadClient::Disconnect()
+{
+	if (command == Command::CONNECT)
+		generator.OnConnectFinished(false);
+
+	TimeoutMonitor::Cancel();
+	BufferedSocket::Close();
+}
+
+bool
+LoadClient::HandleLine(const char *line, size_t length)
+{
+	response_bytes += length + 1;
+
+	if (command == Command::CONNECT) {
+		if (memcmp(line, "OK MPD ", 7) != 0) {
+			fprintf(stderr, "Not a MPD server\n");
+			Disconnect();
+			return false;
+		}
+
+		Finish(true);
+		return true;
+	}
+
+	if (command == Command::COUNT) {
+		fprintf(stderr, "Unexpected response\n");
+		Disconnect();
+		return false;
+	}
+
+	if (length == 2 && memcmp(line, "OK", 2) == 0)
+		Finish(true);
+	else if (memcmp(line, "ACK ", 4) == 0)
+		Finish(false);
+	else if (command == Command::STATUS &&
+		 memcmp(line, "playlist: ", 10) == 0)
+		playlist = strtol(line + 10, nullptr, 10);
+
+	return IsConnected();
+}
+
+BufferedSocket::InputResult
+LoadClient::OnSocketInput(void *data, size_t length)
+{
+	char *p = (char *)data, *const end = p + length;
+
+	while (true) {
+		char *newline = (char *)memchr(p, '\n', end - p);
+		if (newline == nullptr)
+			break;
+
+		*newline = 0;
+		const size_t line_length = newline - p;
+		const char *line = p;
+		p = newline + 1;
+		BufferedSocket::ConsumeInput(line_length + 1);
+
+		if (!HandleLine(line, line_length))
+			return InputResult::CLOSED;
+	}
+
+	return InputResult::MORE;
+}
+
+void
+LoadClient::OnSocketError(Error &&error)
+{
+	LogError(error);
+	Disconnect();
+}
+
+void
+LoadClient::OnSocketClosed()
+{
+	Disconnect();
+}
+
+void
+LoadClient::OnTimeout()
+{
+	Send(Command::STATUS, "status\n");
+}
+
+/**
+ * Stops the #EventLoop after the configured duration.
+ */
+class StopTimer final : TimeoutMonitor {
+public:
+	StopTimer(EventLoop &_loop, unsigned seconds)
+		:TimeoutMonitor(_loop) {
+		ScheduleSeconds(seconds);
+	}
+
+private:
+	void OnTimeout() override {
+		TimeoutMonitor::GetEventLoop().Break();
+	}
+};
+
+static float
+Percentile(const std::vector<float> &sorted, float p)
+{
+	return sorted[size_t(p * (sorted.size() - 1))];
+}
+
+static void
+PrintReport(CommandStats *stats, double seconds)
+{
+	printf("%-12s %8s %9s %10s %9s %9s %9s %9s %6s\n",
+	       "command", "count", "per_s", "kB_per_s",
+	       "p50_ms", "p90_ms", "p99_ms", "max_ms", "ACK");
+
+	for (unsigned i = 0; i < unsigned(Command::COUNT); ++i) {
+		CommandStats &s = stats[i];
+		if (s.latencies.empty())
+			continue;
+
+		std::sort(s.latencies.begin(), s.latencies.end());
+
+		printf("%-12s %8zu %9.1f %10.1f %9.2f %9.2f %9.2f %9.2f %6u\n",
+		       command_names[i], s.latencies.size(),
+		       s.latencies.size() / seconds,
+		       s.bytes / 1024. / seconds,
+		       Percentile(s.latencies, 0.5),
+		       Percentile(s.latencies, 0.9),
+		       Percentile(s.latencies, 0.99),
+		       s.latencies.back(), s.errors);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	if (argc != 7) {
+		fprintf(stderr, "Usage: BenchClients HOST[:PORT] SECONDS"
+			" IDLE POLL SYNC HEAVY\n");
+		return EXIT_FAILURE;
+	}
+
+	const unsigned seconds = strtoul(argv[2], nullptr, 10);
+	if (seconds == 0) {
+		fprintf(stderr, "Invalid duration\n");
+		return EXIT_FAILURE;
+	}
+
+	/* the number of clients of each kind */
+	const ClientKind kinds[] = {
+		ClientKind::IDLE, ClientKind::POLL,
+		ClientKind::SYNC, ClientKind::HEAVY,
+	};
+	unsigned counts[ARRAY_SIZE(kinds)];
+	for (unsigned i = 0; i < ARRAY_SIZE(kinds); ++i)
+		counts[i] = strtoul(argv[3 + i], nullptr, 10);
+
+	Error error;
+	addrinfo *ai = resolve_host_port(argv[1], 6600, 0, SOCK_STREAM,
+					 error);
+	if (ai == nullptr) {
+		LogError(error);
+		return EXIT_FAILURE;
+	}
+
+	RaiseFileLimit();
+
+	std::vector<ClientKind> pending;
+	for (unsigned i = 0; i < ARRAY_SIZE(kinds); ++i)
+		pending.insert(pending.end(), counts[i], kinds[i]);
+
+	EventLoop event_loop;
+	LoadGenerator generator(event_loop, *ai, std::move(pending));
+	generator.ConnectMore();
+
+	const auto start = Clock::now();
+
+	{
+		StopTimer stop_timer(event_loop, seconds);
+		event_loop.Run();
+	}
+
+	const std::chrono::duration<double> duration = Clock::now() - start;
+
+	if (generator.GetFailedCount() > 0)
+		fprintf(stderr, "%u connections failed\n",
+			generator.GetFailedCount());
+
+	printf("%u of %zu clients connected after %.1f s\n",
+	       generator.GetConnectedCount(), generator.GetClientCount(),
+	       duration.count());
+	PrintReport(generator.stats, duration.count());
+
+	freeaddrinfo(ai);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,562 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Generate a synthetic music library with a realistic tag
+ * distribution, and measure the speed of the #SimpleDatabase
+ * operations on it: save, load, the journal written after an
+ * update, and the queries behind "find", "search", "list", "stats",
+ * "listallinfo" and song lookups.
+ *
+ * The database file is left behind, and can be used to test MPD
+ * itself with a large library.
+ */
+
+#include "config.h"
+#include "db/plugins/simple/SimpleDatabasePlugin.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/DatabasePlugin.hxx"
+#include "db/DatabaseListener.hxx"
+#include "db/DatabaseLock.hxx"
+#include "db/Selection.hxx"
+#include "db/Stats.hxx"
+#include "db/LightSong.hxx"
+#include "config/Block.hxx"
+#include "tag/Tag.hxx"
+#include "tag/TagBuilder.hxx"
+#include "tag/Mask.hxx"
+#include "lib/icu/Init.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/FileSystem.hxx"
+#include "fs/FileInfo.hxx"
+#include "event/Loop.hxx"
+#include "SongFilter.hxx"
+#include "util/Error.hxx"
+#include "util/Macros.hxx"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <iostream>
+using std::cout;
+using std::cerr;
+using std::endl;
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+static const char *const words[] = {
+	"Love", "Night", "Black", "Blue", "Fire", "Heart", "Dream",
+	"Rain", "Summer", "Shadow", "Golden", "River", "Silent", "Wild",
+	"Electric", "Midnight", "Crystal", "Broken", "Little", "Lost",
+	"Stone", "Ocean", "Secret", "Paper", "Velvet", "Winter", "Echo",
+	"Glass", "Thunder", "Morning", "Desert", "Ghost", "Neon",
+	"Paradise", "Highway", "Angel", "Mirror", "Garden", "Machine",
+	"Satellite", "Canyon", "Harbor", "Island", "Radio", "Sugar",
+	"Storm", "Kingdom", "Horizon", "Tiger", "Diamond",
+};
+
+static const char *const genres[] = {
+	"Rock", "Pop", "Jazz", "Classical", "Electronic", "Hip-Hop",
+	"Metal", "Folk", "Blues", "Country", "Soul", "Reggae", "Punk",
+	"Ambient", "Soundtrack", "Funk", "Latin", "Indie", "R&B",
+	"Techno", "House", "Gospel", "World", "Disco", "Grunge",
+	"Ska", "Trance", "Opera", "Swing", "Bluegrass",
+};
+
+class MyDatabaseListener final : public DatabaseListener {
+public:
+	virtual void OnDatabaseModified() override {}
+	virtual void OnDatabaseLoaded(bool) override {}
+	virtual void OnDatabaseAnalyzed() override {}
+	virtual void OnDatabaseSongRemoved(const LightSong &) override {}
+};
+
+/**
+ * Values picked from the generated library, used as query
+ * parameters.
+ */
+struct Library {
+	std::vector<std::string> artists, albums;
+	std::vector<std::string> uris;
+	unsigned n_songs = 0;
+};
+
+/**
+ * Generates names and tag values.  A Zipf-like distribution makes a
+ * few artists and genres very popular, like in a real collection.
+ */
+class Generator {
+	std::minstd_rand rng;
+
+	std::vector<std::string> artist_names;
+	std::discrete_distribution<unsigned> artist_dist;
+	std::discrete_distribution<unsigned> genre_dist;
+
+	unsigned n_albums = 0;
+
+	static std::vector<double> ZipfWeights(unsigned n) {
+		std::vector<double> w(n);
+		for (unsigned i = 0; i < n; ++i)
+			w[i] = 1.0 / (i + 1);
+		return w;
+	}
+
+public:
+	Generator(unsigned seed, unsigned n_artists)
+		:rng(seed) {
+		for (unsigned i = 0; i < n_artists; ++i)
+			artist_names.emplace_back(MakeName(i));
+
+		const auto aw = ZipfWeights(n_artists);
+		artist_dist = std::discrete_distribution<unsigned>(aw.begin(),
+								   aw.end());
+
+		const auto gw = ZipfWeights(ARRAY_SIZE(genres));
+		genre_dist = std::discrete_distribution<unsigned>(gw.begin(),
+								  gw.end());
+	}
+
+	unsigned Uniform(unsigned min, unsigned max) {
+		return std::uniform_int_distribution<unsigned>(min, max)(rng);
+	}
+
+	const char *Word() {
+		return words[Uniform(0, ARRAY_SIZE(words) - 1)];
+	}
+
+	std::string Phrase(unsigned max_words) {
+		std::string s = Word();
+		for (unsigned n = Uniform(1, max_words); n > 1; --n) {
+			s.push_back(' ');
+			s.append(Word());
+		}
+		return s;
+	}
+
+	/**
+	 * A unique artist name for the given index.
+	 */
+	static std::string MakeName(unsigned i) {
+		const unsigned n = ARRAY_SIZE(words);
+		std::string s = words[i % n];
+		s.push_back(' ');
+		s.append(words[(i / n + i) % n]);
+
+		if (i >= n * n) {
+			char suffix[16];
+			sprintf(suffix, " %u", i / (n * n));
+			s.append(suffix);
+		}
+
+		return s;
+	}
+
+	const std::string &Artist() {
+		return artist_names[artist_dist(rng)];
+	}
+
+	const char *Genre() {
+		return genres[genre_dist(rng)];
+	}
+
+	std::string Album() {
+		/* the number keeps album names unique enough to be
+		   meaningful in "find album" */
+		char suffix[16];
+		sprintf(suffix, " %u", ++n_albums);
+		return Phrase(3) + suffix;
+	}
+};
+
+static void
+AddAlbum(Generator &g, Library &library, Directory &root,
+	 unsigned n_tracks)
+{
+	const bool compilation = g.Uniform(0, 19) == 0;
+	const std::string album_artist = compilation
+		? std::string("Various Artists")
+		: g.Artist();
+	const std::string album = g.Album();
+	const char *genre = g.Genre();
+
+	char date[8];
+	sprintf(date, "%u", g.Uniform(1955, 2016));
+
+	Directory *artist_dir = root.MakeChild(album_artist.c_str());
+	Directory *dir = artist_dir->CreateChild(album.c_str());
+
+	const time_t mtime = 1262304000 + g.Uniform(0, 200000000);
+
+	for (unsigned track = 1; track <= n_tracks; ++track) {
+		const std::string &artist = compilation
+			? g.Artist()
+			: album_artist;
+		const std::string title = g.Phrase(4);
+
+		char buffer[256], track_string[8];
+		snprintf(buffer, sizeof(buffer), "%02u - %s.flac",
+			 track, title.c_str());
+		sprintf(track_string, "%u", track);
+
+		TagBuilder tag;
+		tag.SetDuration(SignedSongTime::FromS(g.Uniform(90, 480)));
+		tag.AddItem(TAG_ARTIST, artist.c_str());
+		tag.AddItem(TAG_ALBUM_ARTIST, album_artist.c_str());
+		tag.AddItem(TAG_ALBUM, album.c_str());
+		tag.AddItem(TAG_TITLE, title.c_str());
+		tag.AddItem(TAG_TRACK, track_string);
+		tag.AddItem(TAG_GENRE, genre);
+		tag.AddItem(TAG_DATE, date);
+
+		Song *song = Song::NewFile(buffer, *dir);
+		song->tag = tag.Commit();
+		song->mtime = mtime;
+		dir->AddSong(song);
+
+		if (library.uris.size() < 100000 || g.Uniform(0, 9) == 0)
+			library.uris.emplace_back(dir->GetPath() +
+						  std::string("/") + buffer);
+	}
+
+	library.n_songs += n_tracks;
+
+	if (library.artists.size() < 1000 && !compilation)
+		library.artists.push_back(album_artist);
+	if (library.albums.size() < 1000)
+		library.albums.push_back(album);
+}
+
+static void
+Populate(Generator &g, Library &library, Directory &root, unsigned n_songs)
+{
+	const ScopeDatabaseLock protect;
+
+	while (library.n_songs < n_songs)
+		AddAlbum(g, library, root,
+			 std::min(g.Uniform(6, 16), n_songs - library.n_songs));
+}
+
+/**
+ * Simulate an update which modified some albums: their songs are
+ * re-tagged and their directories are marked dirty.
+ */
+static unsigned
+Modify(Generator &g, Directory &root, unsigned percent)
+{
+	const ScopeDatabaseLock protect;
+
+	unsigned n = 0;
+	for (auto &artist_dir : root.children) {
+		for (auto &dir : artist_dir.children) {
+			if (g.Uniform(0, 99) >= percent)
+				continue;
+
+			for (auto &song : dir.songs) {
+				TagBuilder tag(std::move(song.tag));
+				tag.RemoveType(TAG_GENRE);
+				tag.AddItem(TAG_GENRE, g.Genre());
+				song.tag = tag.Commit();
+				song.mtime += 3600;
+				++n;
+			}
+
+			dir.MarkDirty();
+		}
+	}
+
+	return n;
+}
+
+class Stopwatch {
+	std::chrono::steady_clock::time_point start;
+
+public:
+	Stopwatch():start(std::chrono::steady_clock::now()) {}
+
+	double Elapsed() const {
+		const std::chrono::duration<double> d =
+			std::chrono::steady_clock::now() - start;
+		return d.count();
+	}
+};
+
+static long
+GetPeakMemory()
+{
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) < 0)
+		return -1;
+
+	return usage.ru_maxrss;
+}
+
+static void
+Report(const char *name, double seconds, unsigned n_ops,
+       const std::string &detail=std::string())
+{
+	char buffer[256];
+	snprintf(buffer, sizeof(buffer), "%-22s %6u x %12.4f ms  peak %8ld kB",
+		 name, n_ops, seconds * 1000 / n_ops, GetPeakMemory());
+	cout << buffer;
+	if (!detail.empty())
+		cout << "  " << detail;
+	cout << endl;
+}
+
+static void
+Check(bool success, const Error &error)
+{
+	if (!success) {
+		cerr << error.GetMessage() << endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+static SimpleDatabase *
+OpenDatabase(EventLoop &event_loop, DatabaseListener &listener,
+	     const ConfigBlock &block)
+{
+	Error error;
+	Database *db = simple_db_plugin.create(event_loop, listener,
+					       block, error);
+	Check(db != nullptr, error);
+	Check(db->Open(error), error);
+	db->WaitLoaded();
+	return (SimpleDatabase *)db;
+}
+
+static void
+CloseDatabase(SimpleDatabase *db)
+{
+	db->Close();
+	delete db;
+}
+
+static std::string
+FileSize(Path path)
+{
+	FileInfo fi;
+	if (!GetFileInfo(path, fi))
+		return std::string();
+
+	return std::to_string(fi.GetSize() / 1024) + " kB";
+}
+
+static void
+BenchFilter(const Database &db, const char *name,
+	    const std::vector<std::string> &values, unsigned tag,
+	    bool fold_case, unsigned n_ops)
+{
+	unsigned n_found = 0;
+	const Stopwatch stopwatch;
+
+	for (unsigned i = 0; i < n_ops; ++i) {
+		const SongFilter filter(tag, values[i % values.size()].c_str(),
+					fold_case);
+		const DatabaseSelection selection("", true, &filter);
+
+		Error error;
+		Check(db.Visit(selection, [&n_found](const LightSong &,
+						     Error &){
+					       ++n_found;
+					       return true;
+				       }, error), error);
+	}
+
+	Report(name, stopwatch.Elapsed(), n_ops,
+	       std::to_string(n_found / n_ops) + " songs");
+}
+
+static void
+BenchList(const Database &db, const char *name, TagType tag,
+	  tag_mask_t group_mask)
+{
+	unsigned n_found = 0;
+	const Stopwatch stopwatch;
+
+	const DatabaseSelection selection("", true);
+	Error error;
+	Check(db.VisitUniqueTags(selection, tag, group_mask,
+				 [&n_found](const Tag &, Error &){
+					 ++n_found;
+					 return true;
+				 }, error), error);
+
+	Report(name, stopwatch.Elapsed(), 1,
+	       std::to_string(n_found) + " values");
+}
+
+static void
+BenchQueries(const Database &db, const Library &library)
+{
+	BenchFilter(db, "find artist", library.artists, TAG_ARTIST,
+		    false, 20);
+	BenchFilter(db, "find album", library.albums, TAG_ALBUM,
+		    false, 20);
+
+	std::vector<std::string> needles;
+	for (unsigned i = 0; i < 20; ++i)
+		needles.emplace_back(words[i * 7 % ARRAY_SIZE(words)]);
+	needles[0] = "mid";
+	needles[1] = "ocean g";
+
+	BenchFilter(db, "search title", needles, TAG_TITLE, true, 20);
+	BenchFilter(db, "search any", needles,
+		    LOCATE_TAG_ANY_TYPE, true, 5);
+
+	BenchList(db, "list artist", TAG_ARTIST, 0);
+	BenchList(db, "list album", TAG_ALBUM,
+		  tag_mask_t(1) << TAG_ALBUM_ARTIST);
+	BenchList(db, "list genre", TAG_GENRE, 0);
+
+	{
+		const Stopwatch stopwatch;
+		const DatabaseSelection selection("", true);
+		DatabaseStats stats;
+		Error error;
+		Check(db.GetStats(selection, stats, error), error);
+		Report("stats", stopwatch.Elapsed(), 1,
+		       std::to_string(stats.artist_count) + " artists, " +
+		       std::to_string(stats.album_count) + " albums");
+	}
+
+	{
+		unsigned n_found = 0;
+		const Stopwatch stopwatch;
+		const DatabaseSelection selection("", true);
+		Error error;
+		Check(db.Visit(selection, [&n_found](const LightSong &song,
+						     Error &){
+					       n_found += song.tag->num_items > 0;
+					       return true;
+				       }, error), error);
+		Report("visit all", stopwatch.Elapsed(), 1,
+		       std::to_string(n_found) + " songs");
+	}
+
+	{
+		std::minstd_rand rng(42);
+		std::uniform_int_distribution<size_t> dist(0, library.uris.size() - 1);
+
+		const unsigned n_ops = 100000;
+		const Stopwatch stopwatch;
+		for (unsigned i = 0; i < n_ops; ++i) {
+			Error error;
+			const auto *song = db.GetSong(library.uris[dist(rng)].c_str(),
+						      error);
+			Check(song != nullptr, error);
+			db.ReturnSong(song);
+		}
+
+		Report("get song", stopwatch.Elapsed(), n_ops);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	if (argc < 2 || argc > 4) {
+		cerr << "Usage: BenchDatabase DBFILE [SONGS [SEED]]" << endl;
+		return EXIT_FAILURE;
+	}
+
+	const char *const db_path = argv[1];
+	const unsigned n_songs = argc > 2
+		? strtoul(argv[2], nullptr, 10)
+		: 100000;
+	const unsigned seed = argc > 3
+		? strtoul(argv[3], nullptr, 10)
+		: 1;
+
+	if (n_songs == 0) {
+		cerr << "Invalid number of songs" << endl;
+		return EXIT_FAILURE;
+	}
+
+	/* the collation is needed for sorting directories */
+	Error error;
+	Check(IcuInit(error), error);
+
+	const auto path = AllocatedPath::FromFS(db_path);
+	const auto journal_path = AllocatedPath::FromFS(std::string(db_path) +
+							".journal");
+	RemoveFile(path);
+	RemoveFile(journal_path);
+
+	ConfigBlock block;
+	block.AddBlockParam("path", db_path);
+	block.AddBlockParam("compress", "no");
+	block.AddBlockParam("journal", "yes");
+
+	EventLoop event_loop;
+	MyDatabaseListener listener;
+
+	Library library;
+
+	{
+		SimpleDatabase *db = OpenDatabase(event_loop, listener, block);
+
+		/* about 10 albums per artist on average */
+		Generator g(seed, std::max(n_songs / 120, 1u));
+
+		Stopwatch stopwatch;
+		Populate(g, library, db->GetRoot(), n_songs);
+		Report("generate", stopwatch.Elapsed(), 1,
+		       std::to_string(library.n_songs) + " songs");
+
+		stopwatch = Stopwatch();
+		db->Save();
+		Report("save", stopwatch.Elapsed(), 1, FileSize(path));
+
+		CloseDatabase(db);
+	}
+
+	{
+		Stopwatch stopwatch;
+		SimpleDatabase *db = OpenDatabase(event_loop, listener, block);
+		Report("load", stopwatch.Elapsed(), 1);
+
+		BenchQueries(*db, library);
+
+		Generator g(seed + 1, 1);
+		stopwatch = Stopwatch();
+		const unsigned n_modified = Modify(g, db->GetRoot(), 1);
+		db->Save();
+		Report("update 1% + journal", stopwatch.Elapsed(), 1,
+		       std::to_string(n_modified) + " songs, " +
+		       FileSize(journal_path));
+
+		CloseDatabase(db);
+	}
+
+	{
+		const Stopwatch stopwatch;
+		SimpleDatabase *db = OpenDatabase(event_loop, listener, block);
+		Report("load + journal", stopwatch.Elapsed(), 1);
+		CloseDatabase(db);
+	}
+
+	IcuFinish();
+	return EXIT_SUCCESS;
+}
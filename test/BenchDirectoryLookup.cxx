@@ -0,0 +1,121 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Measure the speed of path lookups in a large #Directory, the way
+ * SimpleDatabase::GetSong() does them.
+ */
+
+#include "config.h"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/DatabaseLock.hxx"
+
+#include <chrono>
+#include <iostream>
+using std::cout;
+using std::cerr;
+using std::endl;
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void
+Populate(Directory &root, unsigned n)
+{
+	char name[64];
+
+	for (unsigned i = 0; i < n; ++i) {
+		sprintf(name, "dir%06u", i);
+		Directory *dir = root.CreateChild(name);
+
+		sprintf(name, "song%06u.flac", i);
+		dir->AddSong(Song::NewFile(name, *dir));
+	}
+
+	Directory *big = root.CreateChild("big");
+	for (unsigned i = 0; i < n; ++i) {
+		sprintf(name, "song%06u.flac", i);
+		big->AddSong(Song::NewFile(name, *big));
+	}
+}
+
+static bool
+Lookup(Directory &root, const char *uri)
+{
+	auto r = root.LookupDirectory(uri);
+	return r.uri != nullptr && strchr(r.uri, '/') == nullptr &&
+		r.directory->FindSong(r.uri) != nullptr;
+}
+
+static double
+Run(Directory &root, unsigned n, bool big)
+{
+	char uri[64];
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < n; ++i) {
+		if (big)
+			sprintf(uri, "big/song%06u.flac", i);
+		else
+			sprintf(uri, "dir%06u/song%06u.flac", i, i);
+
+		if (!Lookup(root, uri)) {
+			cerr << "Not found: " << uri << endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+	return duration.count();
+}
+
+int
+main(int argc, char **argv)
+{
+	if (argc > 2) {
+		cerr << "Usage: BenchDirectoryLookup [N]" << endl;
+		return EXIT_FAILURE;
+	}
+
+	const unsigned n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000;
+	if (n == 0) {
+		cerr << "Invalid number" << endl;
+		return EXIT_FAILURE;
+	}
+
+	const ScopeDatabaseLock protect;
+
+	Directory *root = Directory::NewRoot();
+	Populate(*root, n);
+
+	const double children = Run(*root, n, false);
+	const double songs = Run(*root, n, true);
+
+	cout << n << " directories: "
+	     << children * 1e9 / n << " ns per lookup" << endl;
+	cout << n << " songs in one directory: "
+	     << songs * 1e9 / n << " ns per lookup" << endl;
+
+	delete root;
+	return EXIT_SUCCESS;
+}
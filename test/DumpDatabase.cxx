@@ -57,6 +57,14 @@ public:
 		cout << "DatabaseModified" << endl;
 	}
 
+	virtual void OnDatabaseLoaded(bool success) override {
+		cout << "DatabaseLoaded " << success << endl;
+	}
+
+	virtual void OnDatabaseAnalyzed() override {
+		cout << "DatabaseAnalyzed" << endl;
+	}
+
 	virtual void OnDatabaseSongRemoved(const LightSong &song) override {
 		cout << "SongRemoved " << song.GetURI() << endl;
 	}
@@ -138,6 +146,8 @@ try {
 		return EXIT_FAILURE;
 	}
 
+	db->WaitLoaded();
+
 	const DatabaseSelection selection("", true);
 
 	if (!db->Visit(selection, DumpDirectory, DumpSong, DumpPlaylist,
@@ -42,6 +42,8 @@ decoder_initialized(Decoder &decoder,
 		duration.ToDoubleS());
 
 	decoder.initialized = true;
+	decoder.audio_format = audio_format;
+	decoder.frame_size = audio_format.GetFrameSize();
 }
 
 DecoderCommand
@@ -127,7 +129,7 @@ decoder_timestamp(gcc_unused Decoder &decoder,
 }
 
 DecoderCommand
-decoder_data(gcc_unused Decoder &decoder,
+decoder_data(Decoder &decoder,
 	     gcc_unused InputStream *is,
 	     const void *data, size_t datalen,
 	     gcc_unused uint16_t kbit_rate)
@@ -138,10 +140,30 @@ decoder_data(gcc_unused Decoder &decoder,
 		fprintf(stderr, "%u kbit/s\n", kbit_rate);
 	}
 
+	decoder.n_bytes += datalen;
+
 	gcc_unused ssize_t nbytes = write(1, data, datalen);
 	return DecoderCommand::NONE;
 }
 
+DecoderCommand
+decoder_data_begin(Decoder &decoder,
+		   gcc_unused InputStream *is,
+		   WritableBuffer<void> &dest)
+{
+	const size_t size = sizeof(decoder.buffer) -
+		sizeof(decoder.buffer) % decoder.frame_size;
+	dest = { decoder.buffer, size };
+	return DecoderCommand::NONE;
+}
+
+DecoderCommand
+decoder_data_commit(Decoder &decoder, size_t length, uint16_t kbit_rate)
+{
+	return decoder_data(decoder, nullptr,
+			    decoder.buffer, length, kbit_rate);
+}
+
 DecoderCommand
 decoder_tag(gcc_unused Decoder &decoder,
 	    gcc_unused InputStream *is,
@@ -23,6 +23,10 @@
 #include "check.h"
 #include "thread/Mutex.hxx"
 #include "thread/Cond.hxx"
+#include "AudioFormat.hxx"
+
+#include <stddef.h>
+#include <stdint.h>
 
 struct Decoder {
 	Mutex mutex;
@@ -30,8 +34,24 @@ struct Decoder {
 
 	bool initialized;
 
+	AudioFormat audio_format;
+
+	size_t frame_size;
+
+	/**
+	 * The number of bytes passed to decoder_data(), for
+	 * run_decoder's speed report.
+	 */
+	uint64_t n_bytes;
+
+	/**
+	 * The buffer handed out by decoder_data_begin().
+	 */
+	uint8_t buffer[4096];
+
 	Decoder()
-		:initialized(false) {}
+		:initialized(false), audio_format(AudioFormat::Undefined()),
+		 frame_size(1), n_bytes(0) {}
 };
 
 #endif
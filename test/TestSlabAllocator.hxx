@@ -0,0 +1,80 @@
+/*
+ * Unit tests for class SlabAllocator.
+ */
+
+#include "check.h"
+#include "util/SlabAllocator.hxx"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <stdint.h>
+#include <string.h>
+
+class TestSlabAllocator : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(TestSlabAllocator);
+	CPPUNIT_TEST(TestReuse);
+	CPPUNIT_TEST(TestLarge);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestReuse() {
+		SlabAllocator allocator;
+
+		CPPUNIT_ASSERT(allocator.Allocate(0) == nullptr);
+		CPPUNIT_ASSERT_EQUAL(size_t(0),
+				     allocator.GetStats().n_allocated);
+
+		void *a = allocator.Allocate(13);
+		void *b = allocator.Allocate(16);
+		void *c = allocator.Allocate(100);
+		CPPUNIT_ASSERT(a != nullptr);
+		CPPUNIT_ASSERT(b != nullptr);
+		CPPUNIT_ASSERT(c != nullptr);
+		CPPUNIT_ASSERT(a != b);
+		CPPUNIT_ASSERT_EQUAL(uintptr_t(0), uintptr_t(a) % 8);
+		CPPUNIT_ASSERT_EQUAL(uintptr_t(0), uintptr_t(c) % 8);
+
+		memset(a, 'a', 13);
+		memset(b, 'b', 16);
+		memset(c, 'c', 100);
+
+		CPPUNIT_ASSERT_EQUAL(size_t(3),
+				     allocator.GetStats().n_allocated);
+		CPPUNIT_ASSERT_EQUAL(size_t(16 + 16 + 104),
+				     allocator.GetStats().allocated_bytes);
+
+		/* 13 and 16 bytes are in the same size class */
+		allocator.Free(a, 13);
+		CPPUNIT_ASSERT_EQUAL(a, allocator.Allocate(15));
+		CPPUNIT_ASSERT_EQUAL(size_t(3),
+				     allocator.GetStats().n_allocated);
+
+		allocator.Free(c, 100);
+		CPPUNIT_ASSERT_EQUAL(c, allocator.Allocate(97));
+		CPPUNIT_ASSERT_EQUAL(size_t(16 + 16 + 104),
+				     allocator.GetStats().allocated_bytes);
+
+		const size_t reserved = allocator.GetStats().reserved_bytes;
+		CPPUNIT_ASSERT(reserved > 0);
+		allocator.Free(b, 16);
+		CPPUNIT_ASSERT_EQUAL(reserved,
+				     allocator.GetStats().reserved_bytes);
+	}
+
+	void TestLarge() {
+		SlabAllocator allocator;
+
+		void *p = allocator.Allocate(100000);
+		CPPUNIT_ASSERT(p != nullptr);
+		memset(p, 0, 100000);
+		CPPUNIT_ASSERT_EQUAL(size_t(100000),
+				     allocator.GetStats().reserved_bytes);
+
+		allocator.Free(p, 100000);
+		CPPUNIT_ASSERT_EQUAL(size_t(0),
+				     allocator.GetStats().n_allocated);
+		CPPUNIT_ASSERT_EQUAL(size_t(0),
+				     allocator.GetStats().reserved_bytes);
+	}
+};
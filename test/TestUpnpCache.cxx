@@ -0,0 +1,283 @@
+/*
+ * Unit tests for src/db/plugins/upnp/Cache.cxx
+ */
+
+#include "config.h"
+#include "db/plugins/upnp/Cache.hxx"
+#include "system/Clock.hxx"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+
+/**
+ * The fake monotonic clock used by #UpnpCache [ms].
+ */
+static unsigned now_ms = 1000000;
+
+unsigned
+MonotonicClockMS()
+{
+	return now_ms;
+}
+
+/* the real destructor lives in Directory.cxx, which needs expat */
+UPnPDirContent::~UPnPDirContent() {}
+
+static const std::string server_uri = "http://server/";
+
+/**
+ * Build a container listing with the given number of music items.
+ */
+static UPnPDirContent
+MakeListing(const char *objid, unsigned n_items=1)
+{
+	UPnPDirContent content;
+	for (unsigned i = 0; i < n_items; ++i) {
+		const auto name = std::to_string(i);
+
+		UPnPDirObject object;
+		object.id = std::string(objid) + "/" + name;
+		object.parent_id = objid;
+		object.name = name;
+		object.type = UPnPDirObject::Type::ITEM;
+		object.item_class = UPnPDirObject::ItemClass::MUSIC;
+		content.objects.emplace_back(std::move(object));
+	}
+
+	return content;
+}
+
+static UPnPDirObject
+MakeObject(const std::string &id)
+{
+	UPnPDirObject object;
+	object.id = id;
+	object.parent_id = "0";
+	object.name = id;
+	object.type = UPnPDirObject::Type::ITEM;
+	object.item_class = UPnPDirObject::ItemClass::MUSIC;
+	return object;
+}
+
+static bool
+HasListing(const UpnpCache &cache, unsigned objid)
+{
+	return cache.GetListing(server_uri,
+				std::to_string(objid).c_str()) != nullptr;
+}
+
+static bool
+HasObject(const UpnpCache &cache, unsigned objid)
+{
+	UPnPDirObject object;
+	return cache.GetObject(server_uri, std::to_string(objid).c_str(),
+			       object);
+}
+
+class TestUpnpCache : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(TestUpnpCache);
+	CPPUNIT_TEST(Disabled);
+	CPPUNIT_TEST(Expire);
+	CPPUNIT_TEST(UpdateId);
+	CPPUNIT_TEST(Objects);
+	CPPUNIT_TEST(Searches);
+	CPPUNIT_TEST(PurgeExpired);
+	CPPUNIT_TEST(PurgeOldest);
+	CPPUNIT_TEST(PurgeObjects);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void Disabled() {
+		UpnpCache cache(0);
+		CPPUNIT_ASSERT(!cache.IsEnabled());
+		CPPUNIT_ASSERT(!cache.CheckUpdateId(server_uri));
+
+		/* the listing is passed through, but not cached */
+		auto content = cache.PutListing(server_uri, "0",
+						MakeListing("0"));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), content->objects.size());
+		CPPUNIT_ASSERT(cache.GetListing(server_uri, "0") == nullptr);
+
+		UPnPDirObject object;
+		CPPUNIT_ASSERT(!cache.GetObject(server_uri, "0/0", object));
+	}
+
+	void Expire() {
+		UpnpCache cache(60);
+
+		CPPUNIT_ASSERT(cache.GetListing(server_uri, "0") == nullptr);
+		auto content = cache.PutListing(server_uri, "0",
+						MakeListing("0"));
+		CPPUNIT_ASSERT(cache.GetListing(server_uri, "0") == content);
+
+		now_ms += 59999;
+		CPPUNIT_ASSERT(cache.GetListing(server_uri, "0") == content);
+
+		now_ms += 1;
+		CPPUNIT_ASSERT(cache.GetListing(server_uri, "0") == nullptr);
+
+		/* putting it again replaces the expired item */
+		content = cache.PutListing(server_uri, "0", MakeListing("0"));
+		CPPUNIT_ASSERT(cache.GetListing(server_uri, "0") == content);
+	}
+
+	void UpdateId() {
+		UpnpCache cache(3600);
+		const std::string other_uri = "http://other/";
+
+		/* the first query is always due */
+		CPPUNIT_ASSERT(cache.CheckUpdateId(server_uri));
+		CPPUNIT_ASSERT(cache.SetUpdateId(server_uri, "1"));
+		cache.PutListing(server_uri, "0", MakeListing("0"));
+		cache.PutListing(other_uri, "0", MakeListing("0"));
+
+		/* the queries are rate-limited */
+		CPPUNIT_ASSERT(!cache.CheckUpdateId(server_uri));
+		now_ms += 4999;
+		CPPUNIT_ASSERT(!cache.CheckUpdateId(server_uri));
+		now_ms += 1;
+		CPPUNIT_ASSERT(cache.CheckUpdateId(server_uri));
+
+		/* an unchanged "SystemUpdateID" keeps the cache */
+		CPPUNIT_ASSERT(!cache.SetUpdateId(server_uri, "1"));
+		CPPUNIT_ASSERT(cache.GetListing(server_uri, "0") != nullptr);
+
+		/* a new one flushes all items of this server, but
+		   not those of other servers */
+		CPPUNIT_ASSERT(cache.SetUpdateId(server_uri, "2"));
+		CPPUNIT_ASSERT(cache.GetListing(server_uri, "0") == nullptr);
+		UPnPDirObject object;
+		CPPUNIT_ASSERT(!cache.GetObject(server_uri, "0/0", object));
+		CPPUNIT_ASSERT(cache.GetListing(other_uri, "0") != nullptr);
+
+		cache.Flush(other_uri);
+		CPPUNIT_ASSERT(cache.GetListing(other_uri, "0") == nullptr);
+	}
+
+	void Objects() {
+		UpnpCache cache(60);
+
+		UPnPDirObject object;
+		CPPUNIT_ASSERT(!cache.GetObject(server_uri, "0/0", object));
+
+		/* listing a container caches the metadata of its
+		   children */
+		cache.PutListing(server_uri, "0", MakeListing("0", 2));
+		CPPUNIT_ASSERT(cache.GetObject(server_uri, "0/1", object));
+		CPPUNIT_ASSERT_EQUAL(std::string("1"), object.name);
+		CPPUNIT_ASSERT_EQUAL(std::string("0"), object.parent_id);
+
+		cache.PutObject(server_uri, MakeObject("x"));
+		CPPUNIT_ASSERT(cache.GetObject(server_uri, "x", object));
+		CPPUNIT_ASSERT_EQUAL(std::string("x"), object.name);
+
+		now_ms += 60000;
+		CPPUNIT_ASSERT(!cache.GetObject(server_uri, "0/1", object));
+		CPPUNIT_ASSERT(!cache.GetObject(server_uri, "x", object));
+	}
+
+	void Searches() {
+		UpnpCache cache(60);
+
+		auto content = cache.PutSearch(server_uri, "0", "upnp:artist = \"a\"",
+					       MakeListing("0", 3));
+		CPPUNIT_ASSERT(cache.GetSearch(server_uri, "0",
+					       "upnp:artist = \"a\"") == content);
+		CPPUNIT_ASSERT(cache.GetSearch(server_uri, "0",
+					       "upnp:artist = \"b\"") == nullptr);
+		CPPUNIT_ASSERT(cache.GetSearch(server_uri, "1",
+					       "upnp:artist = \"a\"") == nullptr);
+
+		/* search results are not container listings */
+		CPPUNIT_ASSERT(cache.GetListing(server_uri, "0") == nullptr);
+
+		UPnPDirObject object;
+		CPPUNIT_ASSERT(cache.GetObject(server_uri, "0/2", object));
+	}
+
+	/**
+	 * When the cache is full, expired listings are removed
+	 * first; valid ones are kept if that makes enough room.
+	 */
+	void PurgeExpired() {
+		UpnpCache cache(60);
+
+		for (unsigned i = 0; i < 6; ++i)
+			cache.PutListing(server_uri, std::to_string(i).c_str(),
+					 MakeListing("x", 0));
+
+		now_ms += 30000;
+		for (unsigned i = 6; i < 256; ++i)
+			cache.PutListing(server_uri, std::to_string(i).c_str(),
+					 MakeListing("x", 0));
+
+		/* the first 6 expire; the cache is full now */
+		now_ms += 30000;
+		cache.PutListing(server_uri, "256", MakeListing("x", 0));
+
+		for (unsigned i = 0; i < 6; ++i)
+			CPPUNIT_ASSERT(!HasListing(cache, i));
+		for (unsigned i = 6; i <= 256; ++i)
+			CPPUNIT_ASSERT(HasListing(cache, i));
+	}
+
+	/**
+	 * If there are no expired listings, the oldest ones are
+	 * evicted, until three quarters of the maximum are left.
+	 */
+	void PurgeOldest() {
+		UpnpCache cache(3600);
+
+		/* add them in a shuffled order, so the map order
+		   differs from the age order */
+		constexpr unsigned N = 300;
+		std::vector<unsigned> order;
+		for (unsigned i = 0; i < N; ++i)
+			order.push_back((i * 7) % N);
+
+		for (unsigned i : order) {
+			++now_ms;
+			cache.PutListing(server_uri, std::to_string(i).c_str(),
+					 MakeListing("x", 0));
+		}
+
+		/* the 257th item evicted the 64 oldest ones: 256 -
+		   192 */
+		for (unsigned j = 0; j < N; ++j)
+			CPPUNIT_ASSERT_EQUAL(j >= 64,
+					     HasListing(cache, order[j]));
+	}
+
+	void PurgeObjects() {
+		UpnpCache cache(3600);
+
+		constexpr unsigned N = 16384 + 100;
+		for (unsigned i = 0; i < N; ++i) {
+			++now_ms;
+			cache.PutObject(server_uri,
+					MakeObject(std::to_string(i)));
+		}
+
+		/* 16384 - 12288 */
+		for (unsigned i = 0; i < N; ++i)
+			CPPUNIT_ASSERT_EQUAL(i >= 4096, HasObject(cache, i));
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestUpnpCache);
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -26,6 +26,7 @@
 #include "input/InputStream.hxx"
 #include "fs/Path.hxx"
 #include "AudioFormat.hxx"
+#include "system/Clock.hxx"
 #include "util/Error.hxx"
 #include "Log.hxx"
 
@@ -61,6 +62,8 @@ int main(int argc, char **argv)
 		return EXIT_FAILURE;
 	}
 
+	const uint64_t start_time = MonotonicClockUS();
+
 	if (plugin->file_decode != nullptr) {
 		plugin->FileDecode(decoder, Path::FromFS(uri));
 	} else if (plugin->stream_decode != nullptr) {
@@ -81,6 +84,8 @@ int main(int argc, char **argv)
 		return EXIT_FAILURE;
 	}
 
+	const double elapsed = (MonotonicClockUS() - start_time) / 1000000.;
+
 	decoder_plugin_deinit_all();
 	input_stream_global_finish();
 
@@ -89,5 +94,13 @@ int main(int argc, char **argv)
 		return EXIT_FAILURE;
 	}
 
+	/* report the decoding speed; this is useful for benchmarking
+	   decoder plugins with "run_decoder ... >/dev/null" */
+	const double duration = decoder.n_bytes /
+		decoder.audio_format.GetTimeToSize();
+	fprintf(stderr, "decoded %.3f s in %.3f s (%.1fx realtime)\n",
+		duration, elapsed,
+		elapsed > 0 ? duration / elapsed : 0.);
+
 	return 0;
 }
@@ -114,10 +114,12 @@ run_output(AudioOutput *ao, AudioFormat audio_format)
 		if (length < sizeof(buffer)) {
 			ssize_t nbytes = read(0, buffer + length,
 					      sizeof(buffer) - length);
-			if (nbytes <= 0)
+			if (nbytes > 0)
+				length += (size_t)nbytes;
+			else if (length < frame_size)
+				/* end of file, and everything has
+				   been played */
 				break;
-
-			length += (size_t)nbytes;
 		}
 
 		size_t play_length = (length / frame_size) * frame_size;
@@ -140,6 +142,7 @@ run_output(AudioOutput *ao, AudioFormat audio_format)
 		}
 	}
 
+	ao_plugin_drain(ao);
 	ao_plugin_close(ao);
 	ao_plugin_disable(ao);
 	return true;
@@ -0,0 +1,98 @@
+#!/bin/sh -e
+#
+# Play the same input through the ALSA output plugin twice, with and
+# without "use_mmap", into alsa-lib's "file" PCM (with a "null"
+# slave), and compare the results.  Both may end with silence which
+# fills the last partial period; the mmap code always starts the
+# device, so it may have more of it.
+#
+# DoP output is also checked for correctly alternating markers.
+
+TMP="$(pwd)/test/tmp/alsa_mmap"
+
+mkdir -p "$TMP"
+head -c 1000004 /dev/urandom >"$TMP/in"
+
+cat >"$TMP/asound.conf" <<EOF
+pcm.null {
+	type null
+}
+pcm.file_no {
+	type file
+	slave.pcm "null"
+	file "$TMP/out_no"
+	format "raw"
+}
+pcm.file_yes {
+	type file
+	slave.pcm "null"
+	file "$TMP/out_yes"
+	format "raw"
+}
+EOF
+
+ALSA_CONFIG_PATH="$TMP/asound.conf"
+export ALSA_CONFIG_PATH
+
+# is the given part of the file all zero?
+is_silence() {
+	test "$(tail -c +$(($2 + 1)) "$1" |tr -d '\000' |wc -c)" -eq 0
+}
+
+# check the DoP markers (the most significant byte of each 24 bit
+# sample in a 32 bit container) of the given number of bytes; only
+# silence may follow the first silent frame
+check_dop() {
+	head -c $2 "$1" |od -An -v -tx1 -w8 |awk '
+		/^( 00)+$/ { silence = 1; next }
+		silence { exit 1 }
+		$3 != "05" && $3 != "fa" { exit 1 }
+		NR > 1 && $3 == prev { exit 1 }
+		{ prev = $3 }'
+}
+
+# usage: run NAME FORMAT BUFFER_TIME PERIOD_TIME [DOP]
+run() {
+	for mmap in no yes; do
+		cat >"$TMP/$mmap.conf" <<EOF
+audio_output {
+	type "alsa"
+	name "alsa"
+	device "file_$mmap"
+	mixer_type "none"
+	use_mmap "$mmap"
+	dop "${5:-no}"
+	buffer_time "$3"
+	period_time "$4"
+}
+EOF
+		rm -f "$TMP/out_$mmap"
+		./test/run_output "$TMP/$mmap.conf" alsa "$2" <"$TMP/in" 2>/dev/null
+	done
+
+	size_no=$(wc -c <"$TMP/out_no")
+	size_yes=$(wc -c <"$TMP/out_yes")
+	size=$((size_no < size_yes ? size_no : size_yes))
+
+	if ! cmp -s -n $size "$TMP/out_no" "$TMP/out_yes" ||
+		! is_silence "$TMP/out_no" $size ||
+		! is_silence "$TMP/out_yes" $size; then
+		echo "$1: mmap output differs" >&2
+		exit 1
+	fi
+
+	if [ "${5:-no}" = yes ] && ! check_dop "$TMP/out_yes" $size; then
+		echo "$1: bad DoP markers" >&2
+		exit 1
+	fi
+}
+
+run "S16" 44100:16:2 100000 25000
+run "S16, odd buffer size" 44100:16:2 68050 15873
+run "S16, tiny buffer" 44100:16:2 839 113
+run "S24" 48000:24:2 85000 21000
+run "S32, 6 channels" 44100:32:6 45351 11338
+run "float" 44100:f:2 100000 25000
+run "DoP" 352800:dsd:2 23220 5805 yes
+run "DoP, odd buffer size" 352800:dsd:2 17012 5669 yes
+run "DoP, tiny buffer" 352800:dsd:2 210 28 yes
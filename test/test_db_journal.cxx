@@ -0,0 +1,325 @@
+#include "config.h"
+#include "db/plugins/simple/DatabaseSave.hxx"
+#include "db/plugins/simple/DirectorySave.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/DatabaseLock.hxx"
+#include "tag/TagBuilder.hxx"
+#include "lib/icu/Init.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/FileSystem.hxx"
+#include "fs/io/FileOutputStream.hxx"
+#include "fs/io/BufferedOutputStream.hxx"
+#include "fs/io/TextFile.hxx"
+#include "util/Error.hxx"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+class StringOutputStream final : public OutputStream {
+public:
+	std::string value;
+
+	void Write(const void *data, size_t size) override {
+		value.append((const char *)data, size);
+	}
+};
+
+/**
+ * Serialize the whole tree, for comparing two trees.
+ */
+static std::string
+Dump(const Directory &root)
+{
+	StringOutputStream sos;
+	BufferedOutputStream bos(sos);
+
+	{
+		const ScopeDatabaseLock protect;
+		directory_save(bos, root);
+	}
+
+	bos.Flush();
+	return sos.value;
+}
+
+static void
+WriteFile(Path path, const std::string &data)
+{
+	FileOutputStream fos(path);
+	fos.Write(data.data(), data.length());
+	fos.Commit();
+}
+
+static Song *
+AddSong(Directory &directory, const char *name, const char *title)
+{
+	Song *song = Song::NewFile(name, directory);
+	song->mtime = 1000;
+
+	TagBuilder tag;
+	tag.AddItem(TAG_TITLE, title);
+	tag.Commit(song->tag);
+
+	directory.AddSong(song);
+	return song;
+}
+
+/* the journal must belong to this (fake) database file */
+static constexpr time_t BASE_MTIME = 1234567890;
+static constexpr uint64_t BASE_SIZE = 4321;
+
+class JournalTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(JournalTest);
+	CPPUNIT_TEST(TestReplay);
+	CPPUNIT_TEST(TestTruncated);
+	CPPUNIT_TEST(TestWrongBase);
+	CPPUNIT_TEST_SUITE_END();
+
+	AllocatedPath db_path = AllocatedPath::Null();
+	AllocatedPath journal_path = AllocatedPath::Null();
+
+	/* the tree which is being modified and saved */
+	Directory *root;
+
+	/* the tree loaded from the database file and the journal */
+	Directory *loaded;
+
+public:
+	void setUp() override {
+		char dir[] = "/tmp/test_db_journal.XXXXXX";
+		CPPUNIT_ASSERT(mkdtemp(dir) != nullptr);
+		db_path = AllocatedPath::Build(AllocatedPath::FromFS(dir),
+					       "db");
+		journal_path = AllocatedPath::Build(AllocatedPath::FromFS(dir),
+						    "db.journal");
+
+		root = Directory::NewRoot();
+		loaded = Directory::NewRoot();
+
+		const ScopeDatabaseLock protect;
+		Directory *a = root->MakeChild("a");
+		a->mtime = 100;
+		AddSong(*a, "1.ogg", "One");
+		AddSong(*a, "2.ogg", "Two");
+
+		Directory *b = a->MakeChild("b");
+		b->mtime = 200;
+		AddSong(*b, "3.ogg", "Three");
+
+		Directory *d = root->MakeChild("d");
+		AddSong(*d, "4.ogg", "Four");
+	}
+
+	void tearDown() override {
+		delete root;
+		delete loaded;
+
+		RemoveFile(db_path);
+		RemoveFile(journal_path);
+		rmdir(db_path.GetDirectoryName().c_str());
+	}
+
+	/**
+	 * Write #root to the database file and load it into #loaded,
+	 * as if MPD had been restarted.
+	 */
+	void Snapshot() {
+		{
+			FileOutputStream fos(db_path);
+			BufferedOutputStream bos(fos);
+			{
+				const ScopeDatabaseLock protect;
+				directory_save(bos, *root);
+				root->ClearDirty();
+			}
+			bos.Flush();
+			fos.Commit();
+		}
+
+		Reload();
+		CPPUNIT_ASSERT_EQUAL(Dump(*root), Dump(*loaded));
+	}
+
+	/**
+	 * Discard #loaded and load it from the database file again.
+	 */
+	void Reload() {
+		delete loaded;
+		loaded = Directory::NewRoot();
+
+		TextFile file(db_path);
+		Error error;
+		const ScopeDatabaseLock protect;
+		CPPUNIT_ASSERT(directory_load(file, *loaded, error));
+		loaded->ClearDirty();
+	}
+
+	/**
+	 * Append journal records for all dirty directories of #root.
+	 *
+	 * @return the data which was appended
+	 */
+	std::string Journal(std::string &journal) {
+		StringOutputStream sos;
+		BufferedOutputStream bos(sos);
+		if (journal.empty())
+			db_journal_save_header(bos, BASE_MTIME, BASE_SIZE);
+
+		{
+			const ScopeDatabaseLock protect;
+			db_journal_save(bos, *root);
+		}
+
+		bos.Flush();
+		journal += sos.value;
+		return sos.value;
+	}
+
+	bool Replay(const std::string &journal, Error &error) {
+		WriteFile(journal_path, journal);
+
+		TextFile file(journal_path);
+		bool success = db_journal_load(file, *loaded,
+					       BASE_MTIME, BASE_SIZE, error);
+
+		/* like SimpleDatabase::LoadJournal() */
+		const ScopeDatabaseLock protect;
+		loaded->Sort();
+		loaded->ClearDirty();
+		return success;
+	}
+
+	/**
+	 * Modify several directories of #root.
+	 */
+	void Modify() {
+		const ScopeDatabaseLock protect;
+
+		/* a song was added and one was modified */
+		Directory *a = root->FindChild("a");
+		a->mtime = 101;
+		AddSong(*a, "0.ogg", "Zero");
+		a->FindSong("2.ogg")->tag.Clear();
+		a->MarkDirty();
+
+		/* a directory was deleted */
+		a->FindChild("b")->Delete();
+
+		/* a new directory tree */
+		Directory *c = root->MakeChild("c");
+		c->mtime = 300;
+		AddSong(*c, "5.ogg", "Five");
+		Directory *e = c->MakeChild("e");
+		AddSong(*e, "6.ogg", "Six");
+
+		/* a song was removed */
+		Directory *d = root->FindChild("d");
+		Song *song = d->FindSong("4.ogg");
+		d->RemoveSong(song);
+		song->Free();
+
+		root->Sort();
+	}
+
+	void TestReplay() {
+		Snapshot();
+
+		std::string journal;
+		Modify();
+		Journal(journal);
+
+		/* a second update, appended to the journal */
+		{
+			const ScopeDatabaseLock protect;
+			AddSong(*root->FindChild("d"), "7.ogg", "Seven");
+			root->Sort();
+		}
+		Journal(journal);
+
+		Error error;
+		CPPUNIT_ASSERT(Replay(journal, error));
+		CPPUNIT_ASSERT_EQUAL(Dump(*root), Dump(*loaded));
+
+		/* replaying it again does not change anything */
+		CPPUNIT_ASSERT(Replay(journal, error));
+		CPPUNIT_ASSERT_EQUAL(Dump(*root), Dump(*loaded));
+	}
+
+	void TestTruncated() {
+		Snapshot();
+
+		std::string journal;
+		Modify();
+		Journal(journal);
+		const std::string expected = Dump(*root);
+
+		/* one more record, which will be cut off */
+		{
+			const ScopeDatabaseLock protect;
+			AddSong(*root->FindChild("c"), "8.ogg", "Eight");
+			root->Sort();
+		}
+		const std::string last = Journal(journal);
+		CPPUNIT_ASSERT_EQUAL(std::string::npos,
+				     last.find(DIRECTORY_RECORD_BEGIN, 1));
+
+		/* every truncation of the last record leaves the tree
+		   as it was after the complete records; only the
+		   final newline is optional */
+		for (size_t n = 2; n < last.length(); ++n) {
+			Reload();
+
+			Error error;
+			CPPUNIT_ASSERT(!Replay(journal.substr(0, journal.length() - n),
+					       error));
+			CPPUNIT_ASSERT(error.IsDefined());
+			CPPUNIT_ASSERT_EQUAL(expected, Dump(*loaded));
+		}
+	}
+
+	void TestWrongBase() {
+		Snapshot();
+
+		std::string journal;
+		Modify();
+		Journal(journal);
+
+		const std::string before = Dump(*loaded);
+
+		/* a journal of an older database file must not be
+		   applied */
+		WriteFile(journal_path, journal);
+		TextFile file(journal_path);
+		Error error;
+		CPPUNIT_ASSERT(!db_journal_load(file, *loaded,
+						BASE_MTIME + 1, BASE_SIZE,
+						error));
+		CPPUNIT_ASSERT_EQUAL(before, Dump(*loaded));
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(JournalTest);
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	Error error;
+	if (!IcuInit(error))
+		return EXIT_FAILURE;
+
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	const bool success = runner.run();
+
+	IcuFinish();
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
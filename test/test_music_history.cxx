@@ -0,0 +1,196 @@
+#include "config.h"
+#include "MusicHistory.hxx"
+#include "MusicPipe.hxx"
+#include "MusicBuffer.hxx"
+#include "MusicChunk.hxx"
+#include "AudioFormat.hxx"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <stdlib.h>
+
+/* one full chunk is exactly one second of audio */
+static constexpr AudioFormat audio_format(CHUNK_SIZE / 4,
+					  SampleFormat::S16, 2);
+
+class MusicHistoryTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(MusicHistoryTest);
+	CPPUNIT_TEST(TestLimit);
+	CPPUNIT_TEST(TestNotKept);
+	CPPUNIT_TEST(TestSeekInside);
+	CPPUNIT_TEST(TestSeekOutside);
+	CPPUNIT_TEST_SUITE_END();
+
+	MusicBuffer *buffer;
+
+	/* the chunks which are still queued for the outputs */
+	MusicPipe queued;
+
+	/* the chunks which the player has not yet submitted */
+	MusicPipe pipe;
+
+	MusicHistory history;
+
+public:
+	void setUp() override {
+		buffer = new MusicBuffer(32);
+		history.SetMaxSize(4);
+	}
+
+	void tearDown() override {
+		history.Clear(*buffer);
+		queued.Clear(*buffer);
+		pipe.Clear(*buffer);
+		delete buffer;
+	}
+
+	/**
+	 * Allocate a full chunk which begins at the given position
+	 * [seconds], or player silence if it is negative.
+	 */
+	MusicChunk *MakeChunk(int t) {
+		MusicChunk *chunk = buffer->Allocate();
+		CPPUNIT_ASSERT(chunk != nullptr);
+
+		auto w = chunk->Write(audio_format,
+				      SongTime::FromS(t < 0 ? 0u : unsigned(t)),
+				      0);
+		CPPUNIT_ASSERT_EQUAL(CHUNK_SIZE, w.size);
+		chunk->Expand(audio_format, w.size);
+
+		if (t < 0)
+			chunk->time = SignedSongTime::Negative();
+		return chunk;
+	}
+
+	void Fill(MusicPipe &p, int begin, int end) {
+		for (int t = begin; t < end; ++t)
+			p.Push(MakeChunk(t));
+	}
+
+	/* simulate playing the given range */
+	void Play(int begin, int end) {
+		for (int t = begin; t < end; ++t)
+			history.Push(*buffer, MakeChunk(t));
+	}
+
+	void TestLimit() {
+		Play(0, 6);
+		CPPUNIT_ASSERT_EQUAL(4u, history.GetSize());
+		CPPUNIT_ASSERT(history.GetStartTime() ==
+			       SignedSongTime::FromS(2));
+
+		/* a smaller limit is applied to the next chunk */
+		history.SetMaxSize(2);
+		Play(6, 7);
+		CPPUNIT_ASSERT_EQUAL(2u, history.GetSize());
+		CPPUNIT_ASSERT(history.GetStartTime() ==
+			       SignedSongTime::FromS(5));
+
+		/* disabled */
+		history.SetMaxSize(0);
+		history.Clear(*buffer);
+		Play(7, 8);
+		CPPUNIT_ASSERT_EQUAL(0u, history.GetSize());
+		CPPUNIT_ASSERT(history.GetStartTime().IsNegative());
+	}
+
+	void TestNotKept() {
+		/* player silence is not part of the song */
+		history.Push(*buffer, MakeChunk(-1));
+		CPPUNIT_ASSERT_EQUAL(0u, history.GetSize());
+
+		/* cross-faded chunks cannot be played again */
+		MusicChunk *chunk = MakeChunk(0);
+		chunk->other = MakeChunk(100);
+		history.Push(*buffer, chunk);
+		CPPUNIT_ASSERT_EQUAL(0u, history.GetSize());
+
+		/* all of them have been returned to the buffer */
+		for (unsigned i = 0; i < 32; ++i)
+			pipe.Push(MakeChunk(i));
+	}
+
+	void TestSeekInside() {
+		Play(0, 4);
+		Fill(queued, 4, 6);
+		queued.Push(MakeChunk(-1));
+		Fill(pipe, 6, 8);
+
+		CPPUNIT_ASSERT(history.Contains(pipe, audio_format,
+						SongTime::FromS(0u)));
+		CPPUNIT_ASSERT(history.Contains(pipe, audio_format,
+						SongTime::FromS(5.5)));
+		CPPUNIT_ASSERT(history.Contains(pipe, audio_format,
+						SongTime::FromS(7.9)));
+
+		const auto where = SongTime::FromS(2.5);
+		CPPUNIT_ASSERT(history.Contains(pipe, audio_format, where));
+
+		history.Rewind(*buffer, queued, pipe);
+		CPPUNIT_ASSERT(queued.IsEmpty());
+		CPPUNIT_ASSERT_EQUAL(0u, history.GetSize());
+
+		/* the silence has been dropped */
+		CPPUNIT_ASSERT_EQUAL(8u, pipe.GetSize());
+
+		history.Skip(*buffer, pipe, audio_format, where);
+
+		/* playback resumes at the chunk containing the
+		   destination, and the skipped ones are available to
+		   the next seek */
+		CPPUNIT_ASSERT(pipe.Peek()->time == SignedSongTime::FromS(2));
+		CPPUNIT_ASSERT_EQUAL(6u, pipe.GetSize());
+		CPPUNIT_ASSERT_EQUAL(2u, history.GetSize());
+		CPPUNIT_ASSERT(history.GetStartTime() ==
+			       SignedSongTime::FromS(0));
+
+		/* the whole range is still contiguous */
+		unsigned t = 2;
+		for (const MusicChunk *i = pipe.Peek(); i != nullptr;
+		     i = i->next, ++t)
+			CPPUNIT_ASSERT(i->time == SignedSongTime::FromS(t));
+	}
+
+	void TestSeekOutside() {
+		Play(0, 6);
+		Fill(queued, 6, 7);
+		Fill(pipe, 7, 8);
+
+		/* the oldest chunks have been released already */
+		CPPUNIT_ASSERT(!history.Contains(pipe, audio_format,
+						 SongTime::FromS(1.5)));
+
+		/* not decoded yet */
+		CPPUNIT_ASSERT(!history.Contains(pipe, audio_format,
+						 SongTime::FromS(8u)));
+		CPPUNIT_ASSERT(!history.Contains(pipe, audio_format,
+						 SongTime::FromS(60u)));
+
+		/* the decoder has not submitted anything */
+		MusicPipe empty;
+		CPPUNIT_ASSERT(!history.Contains(empty, audio_format,
+						 SongTime::FromS(3u)));
+
+		/* without a history, only the pipe can be used */
+		history.Clear(*buffer);
+		CPPUNIT_ASSERT(!history.Contains(pipe, audio_format,
+						 SongTime::FromS(3u)));
+		CPPUNIT_ASSERT(history.Contains(pipe, audio_format,
+						SongTime::FromS(7u)));
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MusicHistoryTest);
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -130,6 +130,7 @@ class PcmExportTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST(TestDop);
 #endif
 	CPPUNIT_TEST(TestAlsaChannelOrder);
+	CPPUNIT_TEST(TestExportToBuffer);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -141,6 +142,50 @@ public:
 	void TestDop();
 #endif
 	void TestAlsaChannelOrder();
+	void TestExportToBuffer();
 };
 
+class PcmLoudnessTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(PcmLoudnessTest);
+	CPPUNIT_TEST(TestSine);
+	CPPUNIT_TEST(TestSilence);
+	CPPUNIT_TEST(TestMerge);
+	CPPUNIT_TEST(TestMixRamp);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestSine();
+	void TestSilence();
+	void TestMerge();
+	void TestMixRamp();
+};
+
+class PcmResamplerCacheTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(PcmResamplerCacheTest);
+	CPPUNIT_TEST(TestReuse);
+	CPPUNIT_TEST(TestPrepare);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestReuse();
+	void TestPrepare();
+};
+
+#ifdef ENABLE_DSD
+
+class PcmDsdTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(PcmDsdTest);
+	CPPUNIT_TEST(TestCompareDsd2Pcm);
+	CPPUNIT_TEST(TestDecimation);
+	CPPUNIT_TEST(TestMultiChannel);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestCompareDsd2Pcm();
+	void TestDecimation();
+	void TestMultiChannel();
+};
+
+#endif
+
 #endif
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "test_pcm_all.hxx"
+#include "test_pcm_util.hxx"
+#include "pcm/PcmDsd.hxx"
+#include "pcm/Dsd2Pcm.hxx"
+#include "pcm/dsd2pcm/dsd2pcm.h"
+#include "util/ConstBuffer.hxx"
+
+#include <math.h>
+
+/**
+ * Compare the output of #Dsd2Pcm (without decimation) with the
+ * original dsd2pcm library, feeding both in odd-sized pieces.
+ */
+void
+PcmDsdTest::TestCompareDsd2Pcm()
+{
+	constexpr size_t N = 4096;
+	const TestDataBuffer<uint8_t, N> src;
+
+	float expected[N], result[N];
+
+	dsd2pcm_ctx *ctx = dsd2pcm_init();
+	dsd2pcm_translate(ctx, N, src, 1, false, expected, 1);
+	dsd2pcm_destroy(ctx);
+
+	Dsd2Pcm d(1, Dsd2Pcm::FilterLength::LONG);
+	size_t position = 0;
+	for (size_t chunk = 1; position < N; chunk = chunk * 3 + 1) {
+		if (chunk > N - position)
+			chunk = N - position;
+
+		CPPUNIT_ASSERT_EQUAL(chunk,
+				     d.Translate(chunk, src + position, 1,
+						 result + position, 1));
+		position += chunk;
+	}
+
+	for (size_t i = 0; i < N; ++i)
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(expected[i], result[i], 1e-6);
+}
+
+static void
+TestDecimation(unsigned factor, Dsd2Pcm::FilterLength length)
+{
+	constexpr size_t N = 8192;
+	float dest[N];
+
+	/* silence: the 0x69 pattern */
+	const TestDataBuffer<uint8_t, N> silence([](){ return 0x69; });
+
+	Dsd2Pcm d(factor, length);
+	const size_t n = d.Translate(N, silence, 1, dest, 1);
+	CPPUNIT_ASSERT_EQUAL(N / factor, n);
+
+	for (size_t i = 0; i < n; ++i)
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0, dest[i], 1e-2);
+
+	/* full scale DC: all bits set; after the filter has settled,
+	   the output must be 1 */
+	const TestDataBuffer<uint8_t, N> dc([](){ return 0xff; });
+
+	d.Reset();
+	CPPUNIT_ASSERT_EQUAL(N / factor, d.Translate(N, dc, 1, dest, 1));
+
+	for (size_t i = n / 2; i < n; ++i)
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0, dest[i], 1e-3);
+}
+
+void
+PcmDsdTest::TestDecimation()
+{
+	for (unsigned factor = 1; factor <= Dsd2Pcm::MAX_FACTOR; factor *= 2) {
+		::TestDecimation(factor, Dsd2Pcm::FilterLength::SHORT);
+		::TestDecimation(factor, Dsd2Pcm::FilterLength::LONG);
+	}
+}
+
+/**
+ * Multi-channel conversion (which uses helper threads) must give
+ * the same result as converting each channel on its own.
+ */
+void
+PcmDsdTest::TestMultiChannel()
+{
+	constexpr unsigned channels = 6;
+	constexpr unsigned factor = 4;
+	constexpr size_t N = 4096 * channels;
+	const TestDataBuffer<uint8_t, N> src;
+
+	PcmDsd dsd;
+	dsd.Configure(factor, Dsd2Pcm::FilterLength::LONG);
+
+	auto result = dsd.ToFloat(channels, src);
+	CPPUNIT_ASSERT_EQUAL(N / factor, result.size);
+
+	float expected[N / factor];
+	for (unsigned c = 0; c < channels; ++c) {
+		Dsd2Pcm d(factor, Dsd2Pcm::FilterLength::LONG);
+		d.Translate(N / channels, src + c, channels,
+			    expected + c, channels);
+	}
+
+	for (size_t i = 0; i < N / factor; ++i)
+		CPPUNIT_ASSERT_EQUAL(expected[i], result.data[i]);
+}
@@ -169,6 +169,21 @@ PcmExportTest::TestDop()
 	auto dest = e.Export({src, sizeof(src)});
 	CPPUNIT_ASSERT_EQUAL(sizeof(expected), dest.size);
 	CPPUNIT_ASSERT(memcmp(dest.data, expected, dest.size) == 0);
+
+	/* DoP frames are generated in pairs; an odd one at the end
+	   is discarded */
+	static constexpr uint8_t src2[] = {
+		0x01, 0x23, 0x45, 0x67,
+		0x89, 0xab, 0xcd, 0xef,
+		0x10, 0x32, 0x54, 0x76,
+	};
+
+	dest = e.Export({src2, sizeof(src2)});
+	CPPUNIT_ASSERT_EQUAL(sizeof(expected), dest.size);
+	CPPUNIT_ASSERT(memcmp(dest.data, expected, dest.size) == 0);
+
+	dest = e.Export({src2 + 8, 4});
+	CPPUNIT_ASSERT_EQUAL(size_t(0), dest.size);
 }
 
 #endif
@@ -235,3 +250,57 @@ PcmExportTest::TestAlsaChannelOrder()
 	TestAlsaChannelOrder51<SampleFormat::S32>();
 	TestAlsaChannelOrder71<SampleFormat::S32>();
 }
+
+/**
+ * Check that exporting to a caller-provided buffer gives the same
+ * result as Export() with internal buffers.
+ */
+static void
+TestExportToBuffer(SampleFormat sample_format, unsigned channels,
+		   PcmExport::Params params)
+{
+	static constexpr int32_t src[] = {
+		0x0, 0x1, 0x100, 0x10000, 0x7fffff, -0x800000,
+		0x123456, 0x654321, -0x1, 0x5a5a5a, 0x0, 0x42,
+	};
+
+	PcmExport e;
+	e.Open(sample_format, channels, params);
+
+	const auto expected = e.Export({src, sizeof(src)});
+
+	uint8_t dest[sizeof(src) * 2];
+	const size_t size = e.Export({src, sizeof(src)}, dest);
+	CPPUNIT_ASSERT_EQUAL(expected.size, size);
+	CPPUNIT_ASSERT(memcmp(dest, expected.data, size) == 0);
+}
+
+void
+PcmExportTest::TestExportToBuffer()
+{
+	PcmExport::Params params;
+	::TestExportToBuffer(SampleFormat::S24_P32, 2, params);
+
+	params.shift8 = true;
+	::TestExportToBuffer(SampleFormat::S24_P32, 2, params);
+
+	params.reverse_endian = true;
+	::TestExportToBuffer(SampleFormat::S24_P32, 2, params);
+
+	params.shift8 = false;
+	params.pack24 = true;
+	::TestExportToBuffer(SampleFormat::S24_P32, 2, params);
+
+	params.reverse_endian = false;
+	::TestExportToBuffer(SampleFormat::S24_P32, 2, params);
+
+	params.pack24 = false;
+	params.alsa_channel_order = true;
+	::TestExportToBuffer(SampleFormat::S16, 6, params);
+
+#ifdef ENABLE_DSD
+	params = PcmExport::Params();
+	params.dop = true;
+	::TestExportToBuffer(SampleFormat::DSD, 2, params);
+#endif
+}
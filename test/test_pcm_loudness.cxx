@@ -0,0 +1,134 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "test_pcm_all.hxx"
+#include "pcm/LoudnessMeter.hxx"
+#include "pcm/MixRampMeter.hxx"
+#include "MixRampInfo.hxx"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <math.h>
+#include <string.h>
+
+static constexpr unsigned SAMPLE_RATE = 48000;
+
+/**
+ * Generate a stereo 997 Hz sine wave.
+ *
+ * @param level the peak level [dBFS]
+ */
+static std::vector<float>
+GenerateSine(double level, double seconds)
+{
+	const double amplitude = pow(10, level / 20);
+	const size_t n_frames = seconds * SAMPLE_RATE;
+
+	std::vector<float> v;
+	v.reserve(n_frames * 2);
+	for (size_t i = 0; i < n_frames; ++i) {
+		const float x = amplitude * sin(2 * M_PI * 997 * i / SAMPLE_RATE);
+		v.push_back(x);
+		v.push_back(x);
+	}
+
+	return v;
+}
+
+static void
+Feed(LoudnessMeter &meter, const std::vector<float> &v)
+{
+	/* feed odd-sized portions to exercise the block splitting */
+	const float *p = &v.front();
+	size_t n_frames = v.size() / 2;
+	while (n_frames > 0) {
+		size_t n = std::min<size_t>(n_frames, 1237);
+		meter.Feed(p, n);
+		p += n * 2;
+		n_frames -= n;
+	}
+}
+
+void
+PcmLoudnessTest::TestSine()
+{
+	/* according to EBU Tech 3341, a stereo sine at -23 dBFS
+	   measures -23 LUFS */
+	LoudnessMeter meter(SAMPLE_RATE, 2);
+	Feed(meter, GenerateSine(-23, 20));
+
+	CPPUNIT_ASSERT(fabs(meter.GetHistogram().GetIntegrated() + 23) < 0.1);
+	CPPUNIT_ASSERT(fabs(meter.GetPeak() - pow(10, -23. / 20)) < 0.001);
+}
+
+void
+PcmLoudnessTest::TestSilence()
+{
+	LoudnessMeter meter(SAMPLE_RATE, 2);
+	Feed(meter, std::vector<float>(SAMPLE_RATE * 2 * 5, 0.f));
+
+	CPPUNIT_ASSERT(meter.GetHistogram().GetIntegrated() < -70);
+	CPPUNIT_ASSERT_EQUAL(0.f, meter.GetPeak());
+}
+
+void
+PcmLoudnessTest::TestMerge()
+{
+	/* the relative gate removes the quiet part (EBU Tech 3341
+	   test case 3) */
+	LoudnessMeter a(SAMPLE_RATE, 2), b(SAMPLE_RATE, 2);
+	Feed(a, GenerateSine(-36, 10));
+	Feed(b, GenerateSine(-23, 20));
+
+	LoudnessHistogram album;
+	album.Merge(a.GetHistogram());
+	album.Merge(b.GetHistogram());
+
+	CPPUNIT_ASSERT(fabs(album.GetIntegrated() + 23) < 0.1);
+}
+
+void
+PcmLoudnessTest::TestMixRamp()
+{
+	/* 2 seconds of silence, 5 seconds at -20 dBFS RMS, 3 seconds
+	   of silence */
+	std::vector<float> v(SAMPLE_RATE * 2 * 2, 0.f);
+	const auto sine = GenerateSine(-17, 5);
+	v.insert(v.end(), sine.begin(), sine.end());
+	v.insert(v.end(), SAMPLE_RATE * 2 * 3, 0.f);
+
+	MixRampMeter meter(SAMPLE_RATE, 2);
+	meter.Feed(&v.front(), v.size() / 2);
+
+	const auto info = meter.GetInfo();
+	CPPUNIT_ASSERT(info.GetStart() != nullptr);
+	CPPUNIT_ASSERT(info.GetEnd() != nullptr);
+
+	/* the first entry is at -90 dB, the last one at -21 dB,
+	   because the signal never reaches -18 dB */
+	CPPUNIT_ASSERT_EQUAL(std::string("-90.00 2.00;"),
+			     std::string(info.GetStart(), 12));
+	CPPUNIT_ASSERT_EQUAL(std::string("-21.00 2.00;"),
+			     std::string(info.GetStart() + strlen(info.GetStart()) - 12));
+	CPPUNIT_ASSERT_EQUAL(std::string("-90.00 3.00;"),
+			     std::string(info.GetEnd(), 12));
+}
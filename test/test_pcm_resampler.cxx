@@ -0,0 +1,88 @@
+/*
+ * Copyright 2003-2016 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "test_pcm_all.hxx"
+#include "pcm/ResamplerCache.hxx"
+#include "pcm/ConfiguredResampler.hxx"
+#include "pcm/FallbackResampler.hxx"
+#include "util/Error.hxx"
+
+static constexpr AudioFormat cd_format(44100, SampleFormat::S16, 2);
+static constexpr AudioFormat hires_format(96000, SampleFormat::S24_P32, 2);
+
+/* replaces the one from ConfiguredResampler.cxx, which needs the
+   configuration */
+PcmResampler *
+pcm_resampler_create()
+{
+	return new FallbackPcmResampler();
+}
+
+void
+PcmResamplerCacheTest::TestReuse()
+{
+	PcmResamplerCache cache;
+	AudioFormat requested, dest;
+	Error error;
+
+	PcmResampler *a = cache.Get(cd_format, 48000, requested, dest, error);
+	CPPUNIT_ASSERT(a != nullptr);
+	CPPUNIT_ASSERT_EQUAL(48000u, dest.sample_rate);
+	cache.Put(a, cd_format, 48000, requested, dest);
+
+	/* a different source format must not get the same instance */
+	AudioFormat requested2, dest2;
+	PcmResampler *b = cache.Get(hires_format, 48000,
+				    requested2, dest2, error);
+	CPPUNIT_ASSERT(b != nullptr);
+	CPPUNIT_ASSERT(b != a);
+
+	/* the cached instance remembers its formats */
+	AudioFormat requested3, dest3;
+	PcmResampler *c = cache.Get(cd_format, 48000,
+				    requested3, dest3, error);
+	CPPUNIT_ASSERT(c == a);
+	CPPUNIT_ASSERT(requested3 == requested);
+	CPPUNIT_ASSERT(dest3 == dest);
+
+	cache.Put(b, hires_format, 48000, requested2, dest2);
+	cache.Put(c, cd_format, 48000, requested3, dest3);
+}
+
+void
+PcmResamplerCacheTest::TestPrepare()
+{
+	PcmResamplerCache cache;
+	cache.Prepare(cd_format, 48000);
+
+	AudioFormat requested, dest;
+	Error error;
+	PcmResampler *a = cache.Get(cd_format, 48000, requested, dest, error);
+	CPPUNIT_ASSERT(a != nullptr);
+	cache.Put(a, cd_format, 48000, requested, dest);
+
+	/* there is already an idle instance; this must not replace
+	   it */
+	cache.Prepare(cd_format, 48000);
+
+	PcmResampler *b = cache.Get(cd_format, 48000, requested, dest, error);
+	CPPUNIT_ASSERT(b == a);
+	cache.Put(b, cd_format, 48000, requested, dest);
+}
@@ -0,0 +1,228 @@
+#include "config.h"
+#include "queue/Playlist.hxx"
+#include "player/Control.hxx"
+#include "player/Listener.hxx"
+#include "output/MultipleOutputs.hxx"
+#include "DetachedSong.hxx"
+#include "SongLoader.hxx"
+#include "Idle.hxx"
+#include "util/Error.hxx"
+#include "Log.hxx"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+#include <vector>
+
+#include <assert.h>
+#include <stdlib.h>
+
+Tag::Tag(const Tag &) {}
+void Tag::Clear() {}
+
+void
+idle_add(gcc_unused unsigned flags)
+{
+}
+
+void
+FormatDebug(gcc_unused const Domain &domain,
+	    gcc_unused const char *fmt, ...)
+{
+}
+
+DetachedSong *
+SongLoader::LoadSong(gcc_unused const char *uri_utf8,
+		     gcc_unused Error &error) const
+{
+	return nullptr;
+}
+
+/*
+ * A fake #PlayerControl which does not talk to a player thread; it
+ * records the songs it was asked to play, seek and enqueue, and it
+ * keeps #PlayerControl::next_song like the player thread does.
+ */
+
+static std::vector<std::string> played, seeked, enqueued;
+
+static void
+Record(std::vector<std::string> &v, DetachedSong *song)
+{
+	v.emplace_back(song->GetURI());
+	delete song;
+}
+
+PlayerControl::PlayerControl(PlayerListener &_listener,
+			     MultipleOutputs &_outputs,
+			     unsigned _buffer_chunks,
+			     unsigned _buffered_before_play)
+	:listener(_listener), outputs(_outputs),
+	 buffer_chunks(_buffer_chunks),
+	 buffered_before_play(_buffered_before_play),
+	 command(PlayerCommand::NONE),
+	 state(PlayerState::STOP),
+	 error_type(PlayerError::NONE),
+	 tagged_song(nullptr),
+	 next_song(nullptr),
+	 total_play_time(0),
+	 border_pause(false)
+{
+}
+
+PlayerControl::~PlayerControl()
+{
+	delete next_song;
+}
+
+bool
+PlayerControl::Play(DetachedSong *song, gcc_unused Error &error_r)
+{
+	delete next_song;
+	next_song = nullptr;
+
+	Record(played, song);
+	state = PlayerState::PLAY;
+	return true;
+}
+
+bool
+PlayerControl::LockSeek(DetachedSong *song, gcc_unused SongTime t,
+			gcc_unused Error &error_r)
+{
+	/* seeking cancels the queued song */
+	delete next_song;
+	next_song = nullptr;
+
+	Record(seeked, song);
+	return true;
+}
+
+void
+PlayerControl::LockEnqueueSong(DetachedSong *song)
+{
+	assert(next_song == nullptr);
+
+	enqueued.emplace_back(song->GetURI());
+	next_song = song;
+}
+
+void PlayerControl::LockCancel() {}
+void PlayerControl::LockStop() { state = PlayerState::STOP; }
+void PlayerControl::LockClearError() {}
+void PlayerControl::LockSetPause(gcc_unused bool pause_flag) {}
+void PlayerControl::LockSetBorderPause(gcc_unused bool _border_pause) {}
+
+player_status
+PlayerControl::LockGetStatus()
+{
+	return player_status();
+}
+
+class NullPlayerListener final : public PlayerListener {
+	void OnPlayerSync() override {}
+	void OnPlayerTagModified() override {}
+};
+
+class PlaylistBulkTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(PlaylistBulkTest);
+	CPPUNIT_TEST(TestSeek);
+	CPPUNIT_TEST(TestSeekBulk);
+	CPPUNIT_TEST(TestAppendBulk);
+	CPPUNIT_TEST_SUITE_END();
+
+	NullPlayerListener listener;
+
+	/* the fake PlayerControl never touches the outputs */
+	alignas(MultipleOutputs) char outputs[sizeof(MultipleOutputs)];
+
+	PlayerControl *pc;
+	playlist *pl;
+
+public:
+	void setUp() override {
+		played.clear();
+		seeked.clear();
+		enqueued.clear();
+
+		pc = new PlayerControl(listener,
+				       *(MultipleOutputs *)outputs, 0, 0);
+		pl = new playlist(16);
+
+		pl->AppendSong(*pc, DetachedSong("0.ogg"));
+		pl->AppendSong(*pc, DetachedSong("1.ogg"));
+		pl->AppendSong(*pc, DetachedSong("2.ogg"));
+
+		Error error;
+		CPPUNIT_ASSERT(pl->PlayPosition(*pc, 0, error));
+
+		/* the player thread would now call OnPlayerSync() */
+		pl->SyncWithPlayer(*pc);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), enqueued.size());
+		CPPUNIT_ASSERT_EQUAL(std::string("1.ogg"), enqueued.back());
+	}
+
+	void tearDown() override {
+		delete pl;
+		delete pc;
+	}
+
+	void TestSeek() {
+		Error error;
+		CPPUNIT_ASSERT(pl->SeekSongPosition(*pc, 0, SongTime::FromS(10u),
+						    error));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), seeked.size());
+
+		/* the seek has discarded the queued song; the next
+		   one must be queued again for gapless playback */
+		CPPUNIT_ASSERT_EQUAL(size_t(2), enqueued.size());
+		CPPUNIT_ASSERT_EQUAL(std::string("1.ogg"), enqueued.back());
+		CPPUNIT_ASSERT_EQUAL(1, pl->queued);
+		CPPUNIT_ASSERT(pc->next_song != nullptr);
+	}
+
+	void TestSeekBulk() {
+		/* a command list with a "seek" command */
+		pl->BeginBulk();
+
+		Error error;
+		CPPUNIT_ASSERT(pl->SeekSongPosition(*pc, 0, SongTime::FromS(10u),
+						    error));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), enqueued.size());
+
+		pl->CommitBulk(*pc);
+
+		/* the queue was not modified, but committing the
+		   bulk edit must still queue the next song */
+		CPPUNIT_ASSERT_EQUAL(size_t(2), enqueued.size());
+		CPPUNIT_ASSERT_EQUAL(std::string("1.ogg"), enqueued.back());
+		CPPUNIT_ASSERT_EQUAL(1, pl->queued);
+		CPPUNIT_ASSERT(pc->next_song != nullptr);
+	}
+
+	void TestAppendBulk() {
+		pl->BeginBulk();
+		pl->AppendSong(*pc, DetachedSong("3.ogg"));
+		pl->AppendSong(*pc, DetachedSong("4.ogg"));
+		pl->CommitBulk(*pc);
+
+		/* the queued song was still valid */
+		CPPUNIT_ASSERT_EQUAL(size_t(1), enqueued.size());
+		CPPUNIT_ASSERT_EQUAL(1, pl->queued);
+		CPPUNIT_ASSERT_EQUAL(5u, pl->GetLength());
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PlaylistBulkTest);
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
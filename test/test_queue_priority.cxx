@@ -30,10 +30,12 @@ check_descending_priority(const Queue *queue,
 class QueuePriorityTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST_SUITE(QueuePriorityTest);
 	CPPUNIT_TEST(TestPriority);
+	CPPUNIT_TEST(TestRestore);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
 	void TestPriority();
+	void TestRestore();
 };
 
 void
@@ -193,6 +195,45 @@ QueuePriorityTest::TestPriority()
 	CPPUNIT_ASSERT_EQUAL(6u, a_order);
 }
 
+void
+QueuePriorityTest::TestRestore()
+{
+	Queue queue(8);
+
+	/* restore the ids of a saved queue */
+	CPPUNIT_ASSERT_EQUAL(7u, queue.Append(DetachedSong("a.ogg"), 0, 7));
+	CPPUNIT_ASSERT_EQUAL(3u, queue.Append(DetachedSong("b.ogg"), 0, 3));
+	CPPUNIT_ASSERT_EQUAL(12u, queue.Append(DetachedSong("c.ogg"), 0, 12));
+
+	/* ids which are in use or out of range are replaced */
+	const unsigned d = queue.Append(DetachedSong("d.ogg"), 0, 7);
+	CPPUNIT_ASSERT(d != 7 && d != 3 && d != 12);
+	const unsigned e = queue.Append(DetachedSong("e.ogg"), 0, 1000);
+	CPPUNIT_ASSERT(e != 7 && e != 3 && e != 12 && e != d && e < 1000);
+
+	CPPUNIT_ASSERT_EQUAL(1, queue.IdToPosition(3));
+	CPPUNIT_ASSERT_EQUAL(2, queue.IdToPosition(12));
+
+	/* the order list must be a permutation of all positions */
+	static constexpr uint32_t short_order[] = { 4, 3, 2, 1 };
+	CPPUNIT_ASSERT(!queue.RestoreOrder(short_order,
+					   ARRAY_SIZE(short_order)));
+
+	static constexpr uint32_t duplicate_order[] = { 4, 3, 2, 1, 1 };
+	CPPUNIT_ASSERT(!queue.RestoreOrder(duplicate_order,
+					   ARRAY_SIZE(duplicate_order)));
+
+	static constexpr uint32_t bad_order[] = { 4, 3, 2, 1, 5 };
+	CPPUNIT_ASSERT(!queue.RestoreOrder(bad_order,
+					   ARRAY_SIZE(bad_order)));
+	CPPUNIT_ASSERT_EQUAL(4u, queue.OrderToPosition(4));
+
+	static constexpr uint32_t order[] = { 4, 3, 2, 1, 0 };
+	CPPUNIT_ASSERT(queue.RestoreOrder(order, ARRAY_SIZE(order)));
+	CPPUNIT_ASSERT_EQUAL(4u, queue.OrderToPosition(0));
+	CPPUNIT_ASSERT_EQUAL(0u, queue.OrderToPosition(4));
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(QueuePriorityTest);
 
 int
@@ -0,0 +1,255 @@
+#include "config.h"
+#include "decoder/SeekTable.hxx"
+#include "fs/io/Reader.hxx"
+#include "fs/io/OutputStream.hxx"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+
+#include <stdlib.h>
+#include <string.h>
+
+class StringOutputStream final : public OutputStream {
+public:
+	std::string value;
+
+	void Write(const void *data, size_t size) override {
+		value.append((const char *)data, size);
+	}
+};
+
+/**
+ * Returns at most 3 bytes per call, to check that partial reads
+ * are handled.
+ */
+class StringReader final : public Reader {
+	const std::string &value;
+	size_t position = 0;
+
+public:
+	explicit StringReader(const std::string &_value):value(_value) {}
+
+	size_t Read(void *data, size_t size) override {
+		size_t n = std::min<size_t>({size, value.length() - position,
+					     3});
+		memcpy(data, value.data() + position, n);
+		position += n;
+		return n;
+	}
+};
+
+static bool
+ReadTable(SeekTable &table, const std::string &data)
+{
+	StringReader reader(data);
+	return table.Read(reader);
+}
+
+static bool
+IsMalformed(const std::string &data)
+{
+	SeekTable table(10);
+	table.SetFile("mad", "/music/a.mp3", 100000, 1234567890);
+
+	try {
+		ReadTable(table, data);
+		return false;
+	} catch (const std::runtime_error &) {
+		/* the table must not be modified */
+		CPPUNIT_ASSERT(table.IsEmpty());
+		return true;
+	}
+}
+
+/* the offset of the first entry in the data written by MakeTable() */
+static constexpr size_t ENTRIES_OFFSET =
+	8 + 4 + sizeof("mad /music/a.mp3") - 1 + 8 + 8 + 8 + 4;
+
+static std::string
+MakeTable()
+{
+	SeekTable table(10);
+	table.SetFile("mad", "/music/a.mp3", 100000, 1234567890);
+	table.Add(0, 0);
+	table.Add(10, 4000);
+	table.Add(25, 9000);
+	table.Add(40, 15000);
+
+	StringOutputStream os;
+	table.Write(os);
+	return os.value;
+}
+
+class SeekTableTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(SeekTableTest);
+	CPPUNIT_TEST(TestFind);
+	CPPUNIT_TEST(TestAdd);
+	CPPUNIT_TEST(TestRoundTrip);
+	CPPUNIT_TEST(TestByteOrder);
+	CPPUNIT_TEST(TestOtherFile);
+	CPPUNIT_TEST(TestTruncated);
+	CPPUNIT_TEST(TestMalformed);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestFind() {
+		SeekTable table(10);
+		CPPUNIT_ASSERT(table.Find(0) == nullptr);
+		CPPUNIT_ASSERT(table.Find(100) == nullptr);
+
+		table.Add(10, 1000);
+		table.Add(30, 3000);
+		table.Add(50, 5000);
+
+		/* before the first entry */
+		CPPUNIT_ASSERT(table.Find(0) == nullptr);
+		CPPUNIT_ASSERT(table.Find(9) == nullptr);
+
+		/* exact match */
+		CPPUNIT_ASSERT_EQUAL(offset_type(1000), table.Find(10)->offset);
+		CPPUNIT_ASSERT_EQUAL(offset_type(3000), table.Find(30)->offset);
+
+		/* between two entries: the one before */
+		CPPUNIT_ASSERT_EQUAL(offset_type(1000), table.Find(29)->offset);
+		CPPUNIT_ASSERT_EQUAL(offset_type(3000), table.Find(31)->offset);
+
+		/* after the last entry */
+		CPPUNIT_ASSERT_EQUAL(offset_type(5000), table.Find(50)->offset);
+		CPPUNIT_ASSERT_EQUAL(uint64_t(50),
+				     table.Find(uint64_t(-1))->position);
+	}
+
+	void TestAdd() {
+		SeekTable table(10);
+		table.Add(0, 0);
+
+		/* too close */
+		table.Add(9, 900);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), table.GetSize());
+
+		table.Add(30, 3000);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), table.GetSize());
+
+		/* fills a gap */
+		table.Add(15, 1500);
+		CPPUNIT_ASSERT_EQUAL(size_t(3), table.GetSize());
+		CPPUNIT_ASSERT_EQUAL(offset_type(1500), table.Find(20)->offset);
+
+		/* too close to the following entry */
+		table.Add(25, 2500);
+		CPPUNIT_ASSERT_EQUAL(size_t(3), table.GetSize());
+	}
+
+	void TestRoundTrip() {
+		const auto data = MakeTable();
+
+		SeekTable table(10);
+		table.SetFile("mad", "/music/a.mp3", 100000, 1234567890);
+		CPPUNIT_ASSERT(ReadTable(table, data));
+		CPPUNIT_ASSERT_EQUAL(size_t(4), table.GetSize());
+		CPPUNIT_ASSERT_EQUAL(offset_type(0), table.Find(5)->offset);
+		CPPUNIT_ASSERT_EQUAL(offset_type(4000), table.Find(24)->offset);
+		CPPUNIT_ASSERT_EQUAL(offset_type(9000), table.Find(39)->offset);
+		CPPUNIT_ASSERT_EQUAL(offset_type(15000), table.Find(99)->offset);
+
+		/* writing it again yields the same data */
+		StringOutputStream os;
+		table.Write(os);
+		CPPUNIT_ASSERT(os.value == data);
+	}
+
+	void TestByteOrder() {
+		const auto data = MakeTable();
+
+		/* the entry count and the second entry, little-endian */
+		CPPUNIT_ASSERT(data.compare(ENTRIES_OFFSET - 4, 4,
+					    "\x04\0\0\0", 4) == 0);
+		CPPUNIT_ASSERT(data.compare(ENTRIES_OFFSET + 16, 16,
+					    "\x0a\0\0\0\0\0\0\0"
+					    "\xa0\x0f\0\0\0\0\0\0", 16) == 0);
+		CPPUNIT_ASSERT_EQUAL(ENTRIES_OFFSET + 4 * 16, data.length());
+	}
+
+	void TestOtherFile() {
+		const auto data = MakeTable();
+
+		/* the file has been modified */
+		SeekTable table1(10);
+		table1.SetFile("mad", "/music/a.mp3", 100000, 1234567891);
+		CPPUNIT_ASSERT(!ReadTable(table1, data));
+		CPPUNIT_ASSERT(table1.IsEmpty());
+
+		/* hash collision */
+		SeekTable table2(10);
+		table2.SetFile("mad", "/music/b.mp3", 100000, 1234567890);
+		CPPUNIT_ASSERT(!ReadTable(table2, data));
+		CPPUNIT_ASSERT(table2.IsEmpty());
+
+		/* different units */
+		SeekTable table3(20);
+		table3.SetFile("mad", "/music/a.mp3", 100000, 1234567890);
+		CPPUNIT_ASSERT(!ReadTable(table3, data));
+		CPPUNIT_ASSERT(table3.IsEmpty());
+	}
+
+	void TestTruncated() {
+		const auto data = MakeTable();
+
+		for (size_t i = 0; i < data.length(); ++i)
+			CPPUNIT_ASSERT(IsMalformed(data.substr(0, i)));
+	}
+
+	void TestMalformed() {
+		const auto data = MakeTable();
+		CPPUNIT_ASSERT(!IsMalformed(data));
+
+		std::string bad = data;
+		bad[0] = 'X';
+		CPPUNIT_ASSERT(IsMalformed(bad));
+
+		/* absurd entry count */
+		bad = data;
+		bad.replace(ENTRIES_OFFSET - 4, 4, "\xff\xff\xff\x7f", 4);
+		CPPUNIT_ASSERT(IsMalformed(bad));
+
+		/* an entry count which is too large */
+		bad = data;
+		bad[ENTRIES_OFFSET - 4] = 5;
+		CPPUNIT_ASSERT(IsMalformed(bad));
+
+		/* positions not ascending: the second entry's position
+		   is 0 now */
+		bad = data;
+		bad[ENTRIES_OFFSET + 16] = 0;
+		CPPUNIT_ASSERT(IsMalformed(bad));
+
+		/* offsets not ascending: the second entry's offset is
+		   10000 now, the third one's is 9000 */
+		bad = data;
+		bad[ENTRIES_OFFSET + 24] = '\x10';
+		bad[ENTRIES_OFFSET + 25] = '\x27';
+		CPPUNIT_ASSERT(IsMalformed(bad));
+
+		/* offset beyond the end of the file */
+		bad = data;
+		bad[ENTRIES_OFFSET + 3 * 16 + 8 + 3] = 1;
+		CPPUNIT_ASSERT(IsMalformed(bad));
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(SeekTableTest);
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,171 @@
+#include "config.h"
+#include "SongSave.hxx"
+#include "SongAnalysis.hxx"
+#include "DetachedSong.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/FileSystem.hxx"
+#include "fs/io/FileOutputStream.hxx"
+#include "fs/io/BufferedOutputStream.hxx"
+#include "fs/io/TextFile.hxx"
+#include "util/StringCompare.hxx"
+#include "util/Error.hxx"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <memory>
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+class SongSaveTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(SongSaveTest);
+	CPPUNIT_TEST(TestAnalysis);
+	CPPUNIT_TEST(TestAnalysisUndefined);
+	CPPUNIT_TEST(TestNoAnalysis);
+	CPPUNIT_TEST(TestMalformed);
+	CPPUNIT_TEST_SUITE_END();
+
+	AllocatedPath path = AllocatedPath::Null();
+
+	Directory *root;
+
+public:
+	void setUp() override {
+		char buffer[] = "/tmp/test_song_save.XXXXXX";
+		int fd = mkstemp(buffer);
+		CPPUNIT_ASSERT(fd >= 0);
+		close(fd);
+
+		path = AllocatedPath::FromFS(buffer);
+		root = Directory::NewRoot();
+	}
+
+	void tearDown() override {
+		delete root;
+		RemoveFile(path);
+	}
+
+	void Save(const Song &song) {
+		FileOutputStream fos(path);
+		BufferedOutputStream bos(fos);
+		song_save(bos, song);
+		bos.Flush();
+		fos.Commit();
+	}
+
+	void WriteFile(const char *data) {
+		FileOutputStream fos(path);
+		fos.Write(data, strlen(data));
+		fos.Commit();
+	}
+
+	DetachedSong *Load(Error &error) {
+		TextFile file(path);
+		const char *line = file.ReadLine();
+		CPPUNIT_ASSERT(line != nullptr);
+
+		const char *uri = StringAfterPrefix(line, SONG_BEGIN);
+		CPPUNIT_ASSERT(uri != nullptr);
+
+		return song_load(file, uri, error);
+	}
+
+	/**
+	 * Save a song with the given analysis, and load it again.
+	 */
+	std::unique_ptr<DetachedSong>
+	RoundTrip(std::shared_ptr<const SongAnalysis> analysis) {
+		Song *song = Song::NewFile("a.ogg", *root);
+		song->mtime = 1234;
+		song->analysis = std::move(analysis);
+		Save(*song);
+		song->Free();
+
+		Error error;
+		std::unique_ptr<DetachedSong> loaded(Load(error));
+		CPPUNIT_ASSERT(loaded != nullptr);
+		CPPUNIT_ASSERT_EQUAL(std::string("a.ogg"),
+				     std::string(loaded->GetURI()));
+		CPPUNIT_ASSERT_EQUAL(time_t(1234), loaded->GetLastModified());
+		return loaded;
+	}
+
+	void TestAnalysis() {
+		auto analysis = std::make_shared<SongAnalysis>();
+		auto &track = analysis->replay_gain.tuples[REPLAY_GAIN_TRACK];
+		auto &album = analysis->replay_gain.tuples[REPLAY_GAIN_ALBUM];
+		track.gain = -7.25;
+		track.peak = 0.987654;
+		album.gain = 1.5;
+		album.peak = 1.0;
+		analysis->mix_ramp.SetStart("0.00 0.00;-10.00 1.20;");
+		analysis->mix_ramp.SetEnd("-10.00 3.40;");
+
+		const auto song = RoundTrip(analysis);
+		const SongAnalysis *loaded = song->GetAnalysis();
+		CPPUNIT_ASSERT(loaded != nullptr);
+
+		const auto &track2 = loaded->replay_gain.tuples[REPLAY_GAIN_TRACK];
+		const auto &album2 = loaded->replay_gain.tuples[REPLAY_GAIN_ALBUM];
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(-7.25, track2.gain, 0.001);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(0.987654, track2.peak, 0.000001);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(1.5, album2.gain, 0.001);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0, album2.peak, 0.000001);
+
+		CPPUNIT_ASSERT_EQUAL(std::string("0.00 0.00;-10.00 1.20;"),
+				     std::string(loaded->mix_ramp.GetStart()));
+		CPPUNIT_ASSERT_EQUAL(std::string("-10.00 3.40;"),
+				     std::string(loaded->mix_ramp.GetEnd()));
+	}
+
+	void TestAnalysisUndefined() {
+		/* the song could not be analyzed; the empty result
+		   must survive, so it is not analyzed again */
+		const auto song = RoundTrip(std::make_shared<SongAnalysis>());
+		const SongAnalysis *loaded = song->GetAnalysis();
+		CPPUNIT_ASSERT(loaded != nullptr);
+		CPPUNIT_ASSERT(!loaded->replay_gain.IsDefined());
+		CPPUNIT_ASSERT(loaded->mix_ramp.GetStart() == nullptr);
+		CPPUNIT_ASSERT(loaded->mix_ramp.GetEnd() == nullptr);
+	}
+
+	void TestNoAnalysis() {
+		const auto song = RoundTrip(nullptr);
+		CPPUNIT_ASSERT(song->GetAnalysis() == nullptr);
+	}
+
+	void TestMalformed() {
+		Error error;
+
+		WriteFile(SONG_BEGIN "a.ogg\n"
+			  "Analysis: -7.25 0.9\n"
+			  "song_end\n");
+		CPPUNIT_ASSERT(Load(error) == nullptr);
+		CPPUNIT_ASSERT(error.IsDefined());
+
+		/* MixRamp data without a preceding "Analysis" line */
+		error.Clear();
+		WriteFile(SONG_BEGIN "a.ogg\n"
+			  "AnalysisMixRampEnd: -10.00 3.40;\n"
+			  "song_end\n");
+		CPPUNIT_ASSERT(Load(error) == nullptr);
+		CPPUNIT_ASSERT(error.IsDefined());
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(SongSaveTest);
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,224 @@
+#include "config.h"
+#include "db/update/Queue.hxx"
+#include "db/update/Service.hxx"
+#include "db/update/InotifyQueue.hxx"
+#include "event/Loop.hxx"
+#include "event/TimeoutMonitor.hxx"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+#include <vector>
+#include <utility>
+
+#include <stdlib.h>
+
+/*
+ * A fake #UpdateService which records the paths submitted by the
+ * #InotifyQueue.
+ */
+
+static std::vector<std::pair<const UpdateService *, std::string>> submitted;
+
+unsigned
+UpdateService::Enqueue(const char *path, gcc_unused bool discard)
+{
+	submitted.emplace_back(this, path);
+	return submitted.size();
+}
+
+static std::vector<std::string>
+GetSubmitted(const UpdateService &update)
+{
+	std::vector<std::string> result;
+	for (const auto &i : submitted)
+		if (i.first == &update)
+			result.push_back(i.second);
+	return result;
+}
+
+/* the fake objects are never dereferenced, only compared */
+static char fake_objects[3];
+static SimpleDatabase &db1 = *(SimpleDatabase *)&fake_objects[0];
+static SimpleDatabase &db2 = *(SimpleDatabase *)&fake_objects[1];
+static Storage &storage = *(Storage *)&fake_objects[2];
+
+static std::vector<std::string>
+PopAll(UpdateQueue &queue)
+{
+	std::vector<std::string> result;
+	UpdateQueueItem item;
+	while ((item = queue.Pop()).IsDefined())
+		result.push_back(item.path_utf8);
+	return result;
+}
+
+typedef std::vector<std::string> Paths;
+
+class BreakTimer final : TimeoutMonitor {
+public:
+	explicit BreakTimer(EventLoop &_loop):TimeoutMonitor(_loop) {}
+
+	using TimeoutMonitor::ScheduleSeconds;
+
+private:
+	void OnTimeout() override {
+		GetEventLoop().Break();
+	}
+};
+
+class UpdateQueueTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(UpdateQueueTest);
+	CPPUNIT_TEST(TestMerge);
+	CPPUNIT_TEST(TestDiscard);
+	CPPUNIT_TEST(TestDatabases);
+	CPPUNIT_TEST(TestErase);
+	CPPUNIT_TEST(TestInotifyQueue);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestMerge() {
+		UpdateQueue queue;
+
+		CPPUNIT_ASSERT_EQUAL(1u, queue.Push(db1, storage, "a/x.ogg",
+						    false, 1));
+		CPPUNIT_ASSERT_EQUAL(2u, queue.Push(db1, storage, "a/y.ogg",
+						    false, 2));
+		CPPUNIT_ASSERT_EQUAL(3u, queue.Push(db1, storage, "b",
+						    false, 3));
+
+		/* covered by a queued job: its id is returned */
+		CPPUNIT_ASSERT_EQUAL(1u, queue.Push(db1, storage, "a/x.ogg",
+						    false, 4));
+		CPPUNIT_ASSERT_EQUAL(3u, queue.Push(db1, storage, "b/c/z.ogg",
+						    false, 5));
+
+		/* "ab" is not inside "a" */
+		CPPUNIT_ASSERT_EQUAL(6u, queue.Push(db1, storage, "ab",
+						    false, 6));
+
+		/* covers both files in "a", which are removed */
+		CPPUNIT_ASSERT_EQUAL(7u, queue.Push(db1, storage, "a",
+						    false, 7));
+
+		CPPUNIT_ASSERT(PopAll(queue) == Paths({"b", "ab", "a"}));
+
+		/* the music directory covers everything */
+		queue.Push(db1, storage, "a", false, 8);
+		queue.Push(db1, storage, "", false, 9);
+		CPPUNIT_ASSERT_EQUAL(9u, queue.Push(db1, storage, "b",
+						    false, 10));
+		CPPUNIT_ASSERT(PopAll(queue) == Paths({""}));
+	}
+
+	void TestDiscard() {
+		UpdateQueue queue;
+
+		/* "rescan" does more than "update" */
+		CPPUNIT_ASSERT_EQUAL(1u, queue.Push(db1, storage, "a",
+						    true, 1));
+		CPPUNIT_ASSERT_EQUAL(1u, queue.Push(db1, storage, "a/x.ogg",
+						    false, 2));
+
+		/* but not the other way round */
+		CPPUNIT_ASSERT_EQUAL(3u, queue.Push(db1, storage, "b",
+						    false, 3));
+		CPPUNIT_ASSERT_EQUAL(4u, queue.Push(db1, storage, "b/y.ogg",
+						    true, 4));
+
+		CPPUNIT_ASSERT(PopAll(queue) == Paths({"a", "b", "b/y.ogg"}));
+	}
+
+	void TestDatabases() {
+		UpdateQueue queue;
+
+		/* jobs of different (mounted) databases are never
+		   merged */
+		CPPUNIT_ASSERT_EQUAL(1u, queue.Push(db1, storage, "",
+						    false, 1));
+		CPPUNIT_ASSERT_EQUAL(2u, queue.Push(db2, storage, "a",
+						    false, 2));
+		CPPUNIT_ASSERT(PopAll(queue) == Paths({"", "a"}));
+	}
+
+	void TestErase() {
+		UpdateQueue queue;
+
+		queue.Push(db1, storage, "a", false, 1);
+		queue.Push(db2, storage, "b", false, 2);
+		queue.Push(db1, storage, "c", false, 3);
+
+		queue.Erase(db1);
+		CPPUNIT_ASSERT(PopAll(queue) == Paths({"b"}));
+	}
+
+	void TestInotifyQueue();
+};
+
+void
+UpdateQueueTest::TestInotifyQueue()
+{
+	EventLoop loop;
+
+	/* the fake objects are only compared */
+	char fake_update[4];
+	auto &update1 = *(UpdateService *)&fake_update[0];
+	auto &update2 = *(UpdateService *)&fake_update[1];
+	auto &update3 = *(UpdateService *)&fake_update[2];
+	auto &update4 = *(UpdateService *)&fake_update[3];
+
+	/* single files are submitted as such; nested paths are
+	   merged */
+	InotifyQueue queue1(loop, update1);
+	queue1.Enqueue("a/x.ogg");
+	queue1.Enqueue("a/y.ogg");
+	queue1.Enqueue("a/x.ogg");
+	queue1.Enqueue("b/c/z.ogg");
+	queue1.Enqueue("b");
+	queue1.Enqueue("b/d.ogg");
+
+	/* a directory replaces the queued files inside it */
+	InotifyQueue queue2(loop, update2);
+	queue2.Enqueue("a/x.ogg");
+	queue2.Enqueue("ab/y.ogg");
+	queue2.Enqueue("a");
+
+	/* too many files in one directory are merged into an update
+	   of that directory */
+	InotifyQueue queue3(loop, update3);
+	queue3.Enqueue("c.ogg");
+	for (unsigned i = 0; i < 40; ++i)
+		queue3.Enqueue(("a/" + std::to_string(i) + ".ogg").c_str());
+	queue3.Enqueue("a/b/z.ogg");
+
+	/* the same in the music directory */
+	InotifyQueue queue4(loop, update4);
+	for (unsigned i = 0; i < 40; ++i)
+		queue4.Enqueue((std::to_string(i) + ".ogg").c_str());
+	queue4.Enqueue("a/x.ogg");
+
+	/* the queues submit their paths after 5 seconds */
+	BreakTimer timer(loop);
+	timer.ScheduleSeconds(7);
+	loop.Run();
+
+	CPPUNIT_ASSERT(GetSubmitted(update1) ==
+		       Paths({"a/x.ogg", "a/y.ogg", "b"}));
+	CPPUNIT_ASSERT(GetSubmitted(update2) == Paths({"ab/y.ogg", "a"}));
+	CPPUNIT_ASSERT(GetSubmitted(update3) == Paths({"c.ogg", "a"}));
+	CPPUNIT_ASSERT(GetSubmitted(update4) == Paths({""}));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(UpdateQueueTest);
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
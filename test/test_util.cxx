@@ -7,6 +7,7 @@
 #include "SplitStringTest.hxx"
 #include "UriUtilTest.hxx"
 #include "TestCircularBuffer.hxx"
+#include "TestSlabAllocator.hxx"
 
 #include <cppunit/TestFixture.h>
 #include <cppunit/extensions/TestFactoryRegistry.h>
@@ -19,6 +20,7 @@ CPPUNIT_TEST_SUITE_REGISTRATION(DivideStringTest);
 CPPUNIT_TEST_SUITE_REGISTRATION(SplitStringTest);
 CPPUNIT_TEST_SUITE_REGISTRATION(UriUtilTest);
 CPPUNIT_TEST_SUITE_REGISTRATION(TestCircularBuffer);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestSlabAllocator);
 
 int
 main(gcc_unused int argc, gcc_unused char **argv)